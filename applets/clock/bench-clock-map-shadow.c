@@ -0,0 +1,118 @@
+/* Benchmark for the rendering of the night side of the world map
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include "clock-map-shadow.h"
+
+int
+main (int    argc,
+      char **argv)
+{
+        ClockMapShadow *shadow;
+        GdkPixbuf      *map;
+        GdkPixbuf      *dest;
+        guchar         *pixels;
+        gint64          start;
+        gint64          full = 0;
+        gint64          refresh = 0;
+        guint64         columns = 0;
+        time_t          now;
+        int             rowstride;
+        int             min_x, max_x;
+        int             i;
+
+        int             width = 3840;
+        int             height = 1920;
+        int             iterations = 60;
+        int             step = 60;
+
+        GError         *error;
+        GOptionContext *context;
+        GOptionEntry options[] = {
+                { "width", 'w', 0, G_OPTION_ARG_INT, &width, "Width of the map", "WIDTH" },
+                { "height", 'h', 0, G_OPTION_ARG_INT, &height, "Height of the map", "HEIGHT" },
+                { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Number of refreshes timed", "N" },
+                { "step", 's', 0, G_OPTION_ARG_INT, &step, "Seconds between two refreshes", "SECONDS" },
+                { NULL, 0, 0, 0, NULL, NULL, NULL }
+        };
+
+        context = g_option_context_new ("");
+        g_option_context_add_main_entries (context, options, NULL);
+
+        error = NULL;
+        if (!g_option_context_parse (context, &argc, &argv, &error)) {
+                g_printerr ("%s\n", error->message);
+                g_error_free (error);
+                g_option_context_free (context);
+
+                return 1;
+        }
+
+        g_option_context_free (context);
+
+        if (width <= 0 || height <= 0 || iterations <= 0 || step < 0) {
+                g_printerr ("The size and the number of refreshes must be positive\n");
+                return 1;
+        }
+
+        map = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+        pixels = gdk_pixbuf_get_pixels (map);
+        rowstride = gdk_pixbuf_get_rowstride (map);
+        for (i = 0; i < rowstride * height; i++)
+                pixels[i] = g_random_int_range (0, 256);
+
+        dest = gdk_pixbuf_copy (map);
+        shadow = clock_map_shadow_new ();
+        now = time (NULL);
+
+        g_print ("%dx%d map, %d refreshes every %d s\n",
+                 width, height, iterations, step);
+
+        /* after a change of the map or of its size: all of it is
+         * composited */
+        for (i = 0; i < iterations; i++) {
+                clock_map_shadow_invalidate (shadow);
+
+                start = g_get_monotonic_time ();
+                clock_map_shadow_render (shadow, map, dest, now + (time_t) i * step,
+                                         &min_x, &max_x);
+                full += g_get_monotonic_time () - start;
+        }
+
+        /* the refreshes of the clock: only the band of the terminator
+         * is composited */
+        clock_map_shadow_render (shadow, map, dest, now, &min_x, &max_x);
+        for (i = 1; i <= iterations; i++) {
+                start = g_get_monotonic_time ();
+                clock_map_shadow_render (shadow, map, dest, now + (time_t) i * step,
+                                         &min_x, &max_x);
+                refresh += g_get_monotonic_time () - start;
+
+                if (min_x <= max_x)
+                        columns += max_x - min_x + 1;
+        }
+
+        g_print ("full render: %10.1f us\n", (double) full / iterations);
+        g_print ("refresh:     %10.1f us, %.0f columns composited\n",
+                 (double) refresh / iterations, (double) columns / iterations);
+
+        clock_map_shadow_free (shadow);
+        g_object_unref (dest);
+        g_object_unref (map);
+
+        return 0;
+}
@@ -0,0 +1,112 @@
+/* Benchmark for the formatting of the clock label with the seconds shown
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <locale.h>
+#include <time.h>
+#include <glib.h>
+#include "clock-time-format.h"
+
+int
+main (int    argc,
+      char **argv)
+{
+        ClockTimeFormat *compiled;
+        struct tm        tm;
+        time_t           start_time;
+        time_t           t;
+        gint64           start;
+        gint64           plain;
+        gint64           cached;
+        guint            n_rendered = 0;
+
+        int              ticks = 86400;
+        char            *format = NULL;
+
+        GError         *error;
+        GOptionContext *context;
+        GOptionEntry options[] = {
+                { "ticks", 'n', 0, G_OPTION_ARG_INT, &ticks, "Number of seconds rendered", "N" },
+                { "format", 'f', 0, G_OPTION_ARG_STRING, &format, "strftime() format of the label", "FORMAT" },
+                { NULL, 0, 0, 0, NULL, NULL, NULL }
+        };
+
+        setlocale (LC_ALL, "");
+
+        context = g_option_context_new ("");
+        g_option_context_add_main_entries (context, options, NULL);
+
+        error = NULL;
+        if (!g_option_context_parse (context, &argc, &argv, &error)) {
+                g_printerr ("%s\n", error->message);
+                g_error_free (error);
+                g_option_context_free (context);
+
+                return 1;
+        }
+
+        g_option_context_free (context);
+
+        if (ticks <= 0) {
+                g_printerr ("The number of seconds must be positive\n");
+                return 1;
+        }
+
+        /* the default format of the clock with the date and seconds */
+        if (!format)
+                format = g_strdup ("%a %b %e, %l:%M:%S %p");
+
+        start_time = time (NULL);
+
+        /* what the clock did on each tick before: the whole format,
+         * then the conversion from the locale encoding */
+        start = g_get_monotonic_time ();
+        for (t = start_time; t < start_time + ticks; t++) {
+                char   buf[256];
+                gsize  len;
+                char  *utf8;
+
+                localtime_r (&t, &tm);
+                len = strftime (buf, sizeof (buf), format, &tm);
+                buf[len] = '\0';
+
+                utf8 = g_locale_to_utf8 (buf, -1, NULL, NULL, NULL);
+                n_rendered += utf8 ? 1 : 0;
+                g_free (utf8);
+        }
+        plain = g_get_monotonic_time () - start;
+
+        compiled = clock_time_format_new (format);
+
+        start = g_get_monotonic_time ();
+        for (t = start_time; t < start_time + ticks; t++) {
+                localtime_r (&t, &tm);
+                n_rendered += clock_time_format_render (compiled, &tm) != NULL;
+        }
+        cached = g_get_monotonic_time () - start;
+
+        clock_time_format_free (compiled);
+
+        g_print ("\"%s\", %d ticks\n", format, ticks);
+        g_print ("strftime():                 %8.3f us per tick\n",
+                 (double) plain / ticks);
+        g_print ("clock_time_format_render(): %8.3f us per tick\n",
+                 (double) cached / ticks);
+
+        g_free (format);
+
+        return n_rendered == 0;
+}
@@ -505,7 +505,17 @@ calendar_window_new (time_t     *static_current_time,
 void
 calendar_window_refresh (CalendarWindow *calwin)
 {
+	struct tm tm1;
+
 	g_return_if_fail (CALENDAR_IS_WINDOW (calwin));
+
+	/* the window is kept around when it is hidden: show today again */
+	localtime_r (calwin->priv->current_time, &tm1);
+	gtk_calendar_select_month (GTK_CALENDAR (calwin->priv->calendar),
+				   (guint) tm1.tm_mon, (guint) (tm1.tm_year + 1900));
+	gtk_calendar_select_day (GTK_CALENDAR (calwin->priv->calendar), (guint) tm1.tm_mday);
+	gtk_calendar_clear_marks (GTK_CALENDAR (calwin->priv->calendar));
+	calendar_mark_today (GTK_CALENDAR (calwin->priv->calendar));
 }
 
 gboolean
@@ -0,0 +1,144 @@
+/*
+ * clock-fill-queue.c: content of the calendar popup built in slices
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "clock-fill-queue.h"
+
+/* The items are filled in from an idle, in slices of at most @slice
+ * microseconds, so that the popup shows at once and its content comes
+ * in as it is built. At least one item is filled per slice. */
+struct _ClockFillQueue {
+        gint64                   slice;
+        ClockFillQueueReadyFunc  ready;
+        ClockFillQueueFillFunc   fill;
+        gpointer                 user_data;
+
+        /* the items still to fill, in order */
+        GSList                  *pending;
+        guint                    idle_id;
+};
+
+ClockFillQueue *
+clock_fill_queue_new (gint64                  slice,
+                      ClockFillQueueReadyFunc ready,
+                      ClockFillQueueFillFunc  fill,
+                      gpointer                user_data)
+{
+        ClockFillQueue *queue;
+
+        queue = g_new0 (ClockFillQueue, 1);
+        queue->slice = slice;
+        queue->ready = ready;
+        queue->fill = fill;
+        queue->user_data = user_data;
+
+        return queue;
+}
+
+void
+clock_fill_queue_free (ClockFillQueue *queue)
+{
+        if (!queue)
+                return;
+
+        clock_fill_queue_clear (queue);
+        g_free (queue);
+}
+
+/* Replaces the items to fill with @items, which are referenced. Filling
+ * only begins with clock_fill_queue_start(). */
+void
+clock_fill_queue_set_items (ClockFillQueue *queue,
+                            GSList         *items)
+{
+        g_slist_free_full (queue->pending, g_object_unref);
+        queue->pending = g_slist_copy_deep (items, (GCopyFunc) g_object_ref, NULL);
+}
+
+/* Drops the items not filled yet, and stops filling */
+void
+clock_fill_queue_clear (ClockFillQueue *queue)
+{
+        if (queue->idle_id)
+                g_source_remove (queue->idle_id);
+        queue->idle_id = 0;
+
+        g_slist_free_full (queue->pending, g_object_unref);
+        queue->pending = NULL;
+}
+
+static gboolean
+clock_fill_queue_idle (gpointer data)
+{
+        ClockFillQueue *queue = data;
+        gint64          slice_start;
+
+        if (queue->ready && !queue->ready (queue->user_data)) {
+                queue->idle_id = 0;
+                return G_SOURCE_REMOVE;
+        }
+
+        slice_start = g_get_monotonic_time ();
+
+        while (queue->pending) {
+                GObject *item = queue->pending->data;
+
+                queue->pending = g_slist_delete_link (queue->pending,
+                                                      queue->pending);
+                queue->fill (item, queue->user_data);
+                g_object_unref (item);
+
+                if (g_get_monotonic_time () - slice_start > queue->slice)
+                        break;
+        }
+
+        if (queue->pending)
+                return G_SOURCE_CONTINUE;
+
+        queue->idle_id = 0;
+        return G_SOURCE_REMOVE;
+}
+
+/* Fills the pending items from an idle. The ready function is called
+ * first even if there are none. */
+void
+clock_fill_queue_start (ClockFillQueue *queue)
+{
+        if (queue->idle_id)
+                return;
+
+        queue->idle_id = g_idle_add (clock_fill_queue_idle, queue);
+}
+
+gboolean
+clock_fill_queue_is_running (ClockFillQueue *queue)
+{
+        return queue->idle_id != 0;
+}
+
+guint
+clock_fill_queue_get_n_pending (ClockFillQueue *queue)
+{
+        return g_slist_length (queue->pending);
+}
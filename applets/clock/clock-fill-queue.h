@@ -0,0 +1,57 @@
+/*
+ * clock-fill-queue.h: content of the calendar popup built in slices
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __CLOCK_FILL_QUEUE_H__
+#define __CLOCK_FILL_QUEUE_H__
+
+#include <glib-object.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _ClockFillQueue ClockFillQueue;
+
+/* Called before each slice: returns FALSE to stop filling until
+ * clock_fill_queue_start() is called again */
+typedef gboolean (* ClockFillQueueReadyFunc) (gpointer user_data);
+typedef void     (* ClockFillQueueFillFunc)  (GObject  *item,
+                                              gpointer  user_data);
+
+ClockFillQueue *clock_fill_queue_new           (gint64                   slice,
+                                                ClockFillQueueReadyFunc  ready,
+                                                ClockFillQueueFillFunc   fill,
+                                                gpointer                 user_data);
+void            clock_fill_queue_free          (ClockFillQueue          *queue);
+
+void            clock_fill_queue_set_items     (ClockFillQueue          *queue,
+                                                GSList                  *items);
+void            clock_fill_queue_clear         (ClockFillQueue          *queue);
+
+void            clock_fill_queue_start         (ClockFillQueue          *queue);
+gboolean        clock_fill_queue_is_running    (ClockFillQueue          *queue);
+guint           clock_fill_queue_get_n_pending (ClockFillQueue          *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_FILL_QUEUE_H__ */
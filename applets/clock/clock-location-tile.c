@@ -486,10 +486,10 @@ format_time (struct tm   *now,
 }
 
 static char *
-convert_time_to_str (time_t now, ClockFormat clock_format)
+convert_time_to_str (ClockLocation *location, time_t now, ClockFormat clock_format)
 {
         const gchar *format;
-        struct tm *tm;
+        struct tm tm;
         gchar buf[128];
 
         if (clock_format == CLOCK_FORMAT_12) {
@@ -507,8 +507,8 @@ convert_time_to_str (time_t now, ClockFormat clock_format)
                 format = _("%H:%M");
         }
 
-        tm = localtime (&now);
-        strftime (buf, sizeof (buf) - 1, format, tm);
+        clock_location_localtime_at (location, now, &tm);
+        strftime (buf, sizeof (buf) - 1, format, &tm);
 
         return g_locale_to_utf8 (buf, -1, NULL, NULL, NULL);
 }
@@ -577,7 +577,6 @@ weather_info_setup_tooltip (WeatherInfo *info, ClockLocation *location, GtkToolt
         gchar *temp, *apparent;
         gchar *line1, *line2, *line3, *line4, *tip;
         const gchar *icon_name;
-        const gchar *sys_timezone;
         time_t sunrise_time, sunset_time;
         gchar *sunrise_str, *sunset_str;
         gint icon_scale;
@@ -619,15 +618,12 @@ weather_info_setup_tooltip (WeatherInfo *info, ClockLocation *location, GtkToolt
         else
                 line3 = g_strdup ("");
 
-        sys_timezone = getenv ("TZ");
-        setenv ("TZ", clock_location_get_timezone (location), 1);
-        tzset ();
         if (weather_info_get_value_sunrise (info, &sunrise_time))
-                sunrise_str = convert_time_to_str (sunrise_time, clock_format);
+                sunrise_str = convert_time_to_str (location, sunrise_time, clock_format);
         else
                 sunrise_str = g_strdup ("???");
         if (weather_info_get_value_sunset (info, &sunset_time))
-                sunset_str = convert_time_to_str (sunset_time, clock_format);
+                sunset_str = convert_time_to_str (location, sunset_time, clock_format);
         else
                 sunset_str = g_strdup ("???");
         line4 = g_strdup_printf (_("Sunrise: %s / Sunset: %s"),
@@ -635,12 +631,6 @@ weather_info_setup_tooltip (WeatherInfo *info, ClockLocation *location, GtkToolt
         g_free (sunrise_str);
         g_free (sunset_str);
 
-        if (sys_timezone)
-                setenv ("TZ", sys_timezone, 1);
-        else
-                unsetenv ("TZ");
-        tzset ();
-
         tip = g_strdup_printf ("<b>%s</b>\n%s\n%s%s", line1, line2, line3, line4);
         gtk_tooltip_set_markup (tooltip, tip);
         g_free (line1);
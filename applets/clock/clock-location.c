@@ -19,6 +19,7 @@
 
 #include "clock-location.h"
 #include "clock-marshallers.h"
+#include "clock-scheduler.h"
 #include "set-timezone.h"
 #include "system-timezone.h"
 
@@ -30,7 +31,9 @@ typedef struct {
 
         gchar *timezone;
 
-        gchar *tzname;
+        /* parsed from the zoneinfo of timezone, used without touching
+         * the TZ environment variable */
+        GTimeZone *zone;
 
         gfloat latitude;
         gfloat longitude;
@@ -38,6 +41,7 @@ typedef struct {
         gchar *weather_code;
         WeatherInfo *weather_info;
         guint weather_timeout;
+        guint weather_interval;
         guint weather_retry_time;
 
         TempUnit temperature_unit;
@@ -59,8 +63,7 @@ enum {
 static guint location_signals[LAST_SIGNAL] = { 0 };
 
 static void clock_location_finalize (GObject *);
-static void clock_location_set_tz (ClockLocation *this);
-static void clock_location_unset_tz (ClockLocation *this);
+static void clock_location_load_zone (ClockLocation *this);
 static gboolean update_weather_info (gpointer data);
 static void setup_weather_updates (ClockLocation *loc);
 
@@ -113,9 +116,7 @@ clock_location_new (const gchar *name, const gchar *city,
         priv->city = g_strdup (city);
         priv->timezone = g_strdup (timezone);
 
-        /* initialize priv->tzname */
-        clock_location_set_tz (this);
-        clock_location_unset_tz (this);
+        clock_location_load_zone (this);
 
         priv->latitude = latitude;
         priv->longitude = longitude;
@@ -134,6 +135,16 @@ clock_location_new (const gchar *name, const gchar *city,
 
 static ClockLocation *current_location = NULL;
 
+/* zone of the system, shared by the locations to compute their offset.
+ * It is dropped when the system timezone changes, so it is only used
+ * under the lock, through get_system_zone(). */
+static GTimeZone *system_zone = NULL;
+G_LOCK_DEFINE_STATIC (system_zone);
+
+/* all the locations, to load their zone again when the zoneinfo is
+ * updated */
+static GList *locations = NULL;
+
 static void
 clock_location_class_init (ClockLocationClass *this_class)
 {
@@ -173,6 +184,43 @@ network_changed (GNetworkMonitor *monitor,
         }
 }
 
+static void
+system_timezone_changed (SystemTimezone *systz,
+                         const char     *new_tz,
+                         ClockLocation  *loc)
+{
+        G_LOCK (system_zone);
+        g_clear_pointer (&system_zone, g_time_zone_unref);
+        G_UNLOCK (system_zone);
+
+        /* the zoneinfo might have been updated too */
+        clock_location_load_zone (loc);
+}
+
+static void
+zoneinfo_changed (SystemTimezone *systz,
+                  gpointer        data)
+{
+        GList *l;
+
+        G_LOCK (system_zone);
+        g_clear_pointer (&system_zone, g_time_zone_unref);
+        G_UNLOCK (system_zone);
+
+        /* GLib hands out the same zone for an identifier as long as it
+         * is in use: all the zones are dropped before any is loaded
+         * again, or the locations sharing a timezone would get the zone
+         * parsed from the previous zoneinfo */
+        for (l = locations; l; l = l->next) {
+                ClockLocationPrivate *priv = clock_location_get_instance_private (l->data);
+
+                g_clear_pointer (&priv->zone, g_time_zone_unref);
+        }
+
+        for (l = locations; l; l = l->next)
+                clock_location_load_zone (l->data);
+}
+
 static void
 clock_location_init (ClockLocation *this)
 {
@@ -183,10 +231,19 @@ clock_location_init (ClockLocation *this)
         priv->city = NULL;
 
         priv->systz = system_timezone_new ();
+        g_signal_connect (priv->systz, "changed",
+                          G_CALLBACK (system_timezone_changed), this);
+
+        /* the system timezone is shared by all the locations, which
+         * are all reloaded from a single handler */
+        if (locations == NULL)
+                g_signal_connect (priv->systz, "zoneinfo-changed",
+                                  G_CALLBACK (zoneinfo_changed), NULL);
+        locations = g_list_prepend (locations, this);
 
         priv->timezone = NULL;
 
-        priv->tzname = NULL;
+        priv->zone = NULL;
 
         priv->latitude = 0;
         priv->longitude = 0;
@@ -213,10 +270,19 @@ clock_location_finalize (GObject *g_obj)
         g_clear_pointer (&priv->name, g_free);
         g_clear_pointer (&priv->city, g_free);
 
+        g_signal_handlers_disconnect_by_func (priv->systz,
+                                              G_CALLBACK (system_timezone_changed),
+                                              CLOCK_LOCATION (g_obj));
+
+        locations = g_list_remove (locations, g_obj);
+        if (locations == NULL)
+                g_signal_handlers_disconnect_by_func (priv->systz,
+                                                      G_CALLBACK (zoneinfo_changed),
+                                                      NULL);
         g_clear_object (&priv->systz);
 
         g_clear_pointer (&priv->timezone, g_free);
-        g_clear_pointer (&priv->tzname, g_free);
+        g_clear_pointer (&priv->zone, g_time_zone_unref);
         g_clear_pointer (&priv->weather_code, g_free);
 
         if (priv->weather_info) {
@@ -225,7 +291,7 @@ clock_location_finalize (GObject *g_obj)
         }
 
         if (priv->weather_timeout) {
-                g_source_remove (priv->weather_timeout);
+                clock_scheduler_remove (priv->weather_timeout);
                 priv->weather_timeout = 0;
         }
 
@@ -292,14 +358,26 @@ clock_location_set_timezone (ClockLocation *loc, const gchar *timezone)
 
         g_free (priv->timezone);
         priv->timezone = g_strdup (timezone);
+
+        clock_location_load_zone (loc);
 }
 
 gchar *
 clock_location_get_tzname (ClockLocation *loc)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
+        const gchar *abbreviation;
+        gint interval;
+
+        interval = g_time_zone_find_interval (priv->zone,
+                                              G_TIME_TYPE_UNIVERSAL,
+                                              time (NULL));
+        abbreviation = g_time_zone_get_abbreviation (priv->zone, interval);
 
-        return priv->tzname;
+        if (abbreviation && *abbreviation != '\0')
+                return (gchar *) abbreviation;
+        else
+                return NULL;
 }
 
 void
@@ -322,78 +400,73 @@ clock_location_set_coords (ClockLocation *loc, gfloat latitude,
         priv->longitude = longitude;
 }
 
-static void
-clock_location_set_tzname (ClockLocation *this, const char *tzname)
+static GTimeZone *
+clock_location_new_zone (const gchar *timezone)
 {
-        ClockLocationPrivate *priv = clock_location_get_instance_private (CLOCK_LOCATION(this));
+        GTimeZone *zone;
 
-        if (priv->tzname && strcmp (priv->tzname, tzname) == 0)
-                return;
+#if GLIB_CHECK_VERSION (2, 68, 0)
+        zone = g_time_zone_new_identifier (timezone);
+        if (zone == NULL)
+                zone = g_time_zone_new_utc ();
+#else
+        zone = g_time_zone_new (timezone);
+#endif
 
-        g_free (priv->tzname);
-        if (tzname && *tzname != '\0') {
-                priv->tzname = g_strdup (tzname);
-        } else {
-                priv->tzname = NULL;
-        }
+        return zone;
 }
 
+/* The zoneinfo is parsed once here, and not each time the time of the
+ * location is needed: this is what makes it cheap to have many
+ * locations. */
 static void
-clock_location_set_tz (ClockLocation *this)
+clock_location_load_zone (ClockLocation *this)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (this);
 
-        time_t now_t;
-        struct tm now;
+        g_clear_pointer (&priv->zone, g_time_zone_unref);
+        priv->zone = clock_location_new_zone (priv->timezone);
+}
 
-        if (priv->timezone == NULL) {
-                return;
-        }
+/* Returns the offset from UTC of @zone at @t, in seconds, and whether
+ * it is daylight saving time. */
+static gint32
+get_zone_offset (GTimeZone *zone,
+                 time_t     t,
+                 gboolean  *is_dst)
+{
+        gint interval;
 
-        setenv ("TZ", priv->timezone, 1);
-        tzset();
+        interval = g_time_zone_find_interval (zone, G_TIME_TYPE_UNIVERSAL, t);
 
-        now_t = time (NULL);
-        localtime_r (&now_t, &now);
+        if (is_dst)
+                *is_dst = g_time_zone_is_dst (zone, interval);
 
-        if (now.tm_isdst > 0) {
-                clock_location_set_tzname (this, tzname[1]);
-        } else {
-                clock_location_set_tzname (this, tzname[0]);
-        }
+        return g_time_zone_get_offset (zone, interval);
 }
 
-static void
-clock_location_unset_tz (ClockLocation *this)
+/* Like localtime_r(), in the timezone of @loc, and thread-safe as the
+ * environment is not touched. tm_isdst is set, but not tm_gmtoff and
+ * tm_zone: use clock_location_get_offset() and
+ * clock_location_get_tzname() for these. */
+void
+clock_location_localtime_at (ClockLocation *loc,
+                             time_t         t,
+                             struct tm     *tm)
 {
-        ClockLocationPrivate *priv = clock_location_get_instance_private (this);
-        const char *env_timezone;
-
-        if (priv->timezone == NULL) {
-                return;
-        }
-
-        env_timezone = system_timezone_get_env (priv->systz);
+        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
+        gboolean is_dst;
+        time_t local_t;
 
-        if (env_timezone) {
-                setenv ("TZ", env_timezone, 1);
-        } else {
-                unsetenv ("TZ");
-        }
-        tzset();
+        local_t = t + get_zone_offset (priv->zone, t, &is_dst);
+        gmtime_r (&local_t, tm);
+        tm->tm_isdst = is_dst ? 1 : 0;
 }
 
 void
 clock_location_localtime (ClockLocation *loc, struct tm *tm)
 {
-        time_t now;
-
-        clock_location_set_tz (loc);
-
-        time (&now);
-        localtime_r (&now, tm);
-
-        clock_location_unset_tz (loc);
+        clock_location_localtime_at (loc, time (NULL), tm);
 }
 
 gboolean
@@ -434,36 +507,37 @@ clock_location_is_current (ClockLocation *loc)
         return FALSE;
 }
 
+/* Returns a new reference to the zone of the system */
+static GTimeZone *
+get_system_zone (ClockLocation *loc)
+{
+        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
+        GTimeZone *zone;
+
+        G_LOCK (system_zone);
+        if (system_zone == NULL)
+                system_zone = clock_location_new_zone (system_timezone_get (priv->systz));
+        zone = g_time_zone_ref (system_zone);
+        G_UNLOCK (system_zone);
+
+        return zone;
+}
+
 glong
 clock_location_get_offset (ClockLocation *loc)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
-        glong sys_timezone, local_timezone;
-        glong offset;
+        GTimeZone *zone;
         time_t t;
-        struct tm *tm;
+        glong offset;
 
+        zone = get_system_zone (loc);
         t = time (NULL);
 
-        unsetenv ("TZ");
-        tm = localtime (&t);
-        sys_timezone = timezone;
-
-        if (tm->tm_isdst > 0) {
-                sys_timezone -= 3600;
-        }
-
-        setenv ("TZ", priv->timezone, 1);
-        tm = localtime (&t);
-        local_timezone = timezone;
-
-        if (tm->tm_isdst > 0) {
-                local_timezone -= 3600;
-        }
+        offset = get_zone_offset (zone, t, NULL) -
+                 get_zone_offset (priv->zone, t, NULL);
 
-        offset = local_timezone - sys_timezone;
-
-        clock_location_unset_tz (loc);
+        g_time_zone_unref (zone);
 
         return offset;
 }
@@ -590,6 +664,38 @@ clock_location_get_weather_info (ClockLocation *loc)
         return priv->weather_info;
 }
 
+static void weather_update_timeout (gpointer data);
+
+/* The updates are aligned on minutes, so that they are done at the same
+ * time as the ones of the clock. They are not done again when the time
+ * of the system is set. */
+static void
+schedule_weather_update (ClockLocation *loc)
+{
+        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
+
+        if (priv->weather_timeout)
+                clock_scheduler_remove (priv->weather_timeout);
+        priv->weather_timeout =
+                clock_scheduler_add_delay ((gint64) priv->weather_interval * G_USEC_PER_SEC,
+                                           weather_update_timeout, loc);
+}
+
+static void
+weather_update_timeout (gpointer data)
+{
+        ClockLocation *loc = data;
+        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
+
+        priv->weather_timeout = 0;
+
+        /* in case the update doesn't complete, try again after the
+         * same time */
+        schedule_weather_update (loc);
+
+        update_weather_info (loc);
+}
+
 static void
 set_weather_update_timeout (ClockLocation *loc)
 {
@@ -613,10 +719,8 @@ set_weather_update_timeout (ClockLocation *loc)
                         priv->weather_retry_time = WEATHER_TIMEOUT_MAX;
         }
 
-        if (priv->weather_timeout)
-                g_source_remove (priv->weather_timeout);
-        priv->weather_timeout =
-                g_timeout_add_seconds (timeout, update_weather_info, loc);
+        priv->weather_interval = timeout;
+        schedule_weather_update (loc);
 }
 
 static void
@@ -705,7 +809,7 @@ setup_weather_updates (ClockLocation *loc)
         }
 
         if (priv->weather_timeout) {
-                g_source_remove (priv->weather_timeout);
+                clock_scheduler_remove (priv->weather_timeout);
                 priv->weather_timeout = 0;
         }
 
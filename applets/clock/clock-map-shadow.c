@@ -0,0 +1,247 @@
+/*
+ * clock-map-shadow.c: the night side of the world map
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include <glib.h>
+
+#include "clock-map-shadow.h"
+#include "clock-sunpos.h"
+
+/* twilight */
+#define CLOCK_MAP_TWILIGHT 0.01
+
+struct _ClockMapShadow {
+        /* FALSE if the map changed since it was composited */
+        gboolean valid;
+
+        /* The terms of the position vectors of the rows and columns,
+         * for a map of width x height */
+        gint width;
+        gint height;
+        gdouble *row_sin_lat;
+        gdouble *row_cos_lat;
+        gdouble *col_sin_lon;
+        gdouble *col_cos_lon;
+        /* scratch buffers for one row and for the columns */
+        gdouble *row_dot;
+        gdouble *col_dot;
+
+        /* The shade of each pixel of the composited map */
+        guchar *shade;
+};
+
+ClockMapShadow *
+clock_map_shadow_new (void)
+{
+        return g_new0 (ClockMapShadow, 1);
+}
+
+void
+clock_map_shadow_free (ClockMapShadow *shadow)
+{
+        if (!shadow)
+                return;
+
+        g_free (shadow->row_sin_lat);
+        g_free (shadow->row_cos_lat);
+        g_free (shadow->col_sin_lon);
+        g_free (shadow->col_cos_lon);
+        g_free (shadow->row_dot);
+        g_free (shadow->col_dot);
+        g_free (shadow->shade);
+        g_free (shadow);
+}
+
+/* The map changed: the next render composites all of it again */
+void
+clock_map_shadow_invalidate (ClockMapShadow *shadow)
+{
+        shadow->valid = FALSE;
+}
+
+static void
+clock_map_shadow_compute_vector (gdouble lat, gdouble lon, gdouble *vec)
+{
+        gdouble lat_rad, lon_rad;
+        lat_rad = lat * (M_PI/180.0);
+        lon_rad = lon * (M_PI/180.0);
+
+        vec[0] = sin(lon_rad) * cos(lat_rad);
+        vec[1] = sin(lat_rad);
+        vec[2] = cos(lon_rad) * cos(lat_rad);
+}
+
+/* Returns the alpha of the shadow at a position, from the dot product of
+ * its vector and the one of the sun */
+static inline guchar
+clock_map_shadow_get_shade (gdouble dot)
+{
+        if (dot > CLOCK_MAP_TWILIGHT) {
+                return 0x00;
+        }
+
+        if (dot < -CLOCK_MAP_TWILIGHT) {
+                return 0xFF;
+        }
+
+        return (guchar)(-128 * ((dot / CLOCK_MAP_TWILIGHT) - 1));
+}
+
+/* The vector of a position is (sin(lon) cos(lat), sin(lat), cos(lon)
+ * cos(lat)): the sines and cosines only depend on the row or on the
+ * column, and are computed once per size. */
+static void
+clock_map_shadow_update_tables (ClockMapShadow *shadow, gint width, gint height)
+{
+        int x, y;
+
+        if (shadow->shade &&
+            shadow->width == width && shadow->height == height)
+                return;
+
+        shadow->width = width;
+        shadow->height = height;
+
+        shadow->row_sin_lat = g_renew (gdouble, shadow->row_sin_lat, height);
+        shadow->row_cos_lat = g_renew (gdouble, shadow->row_cos_lat, height);
+        shadow->col_sin_lon = g_renew (gdouble, shadow->col_sin_lon, width);
+        shadow->col_cos_lon = g_renew (gdouble, shadow->col_cos_lon, width);
+        shadow->row_dot = g_renew (gdouble, shadow->row_dot, width);
+        shadow->col_dot = g_renew (gdouble, shadow->col_dot, width);
+
+        g_free (shadow->shade);
+        shadow->shade = g_new (guchar, (gsize) width * height);
+
+        for (y = 0; y < height; y++) {
+                gdouble lat = (height / 2.0 - y) / (height / 2.0) * 90.0;
+
+                shadow->row_sin_lat[y] = sin (lat * (M_PI/180.0));
+                shadow->row_cos_lat[y] = cos (lat * (M_PI/180.0));
+        }
+
+        for (x = 0; x < width; x++) {
+                gdouble lon = (x - width / 2.0) / (width / 2.0) * 180.0;
+
+                shadow->col_sin_lon[x] = sin (lon * (M_PI/180.0));
+                shadow->col_cos_lon[x] = cos (lon * (M_PI/180.0));
+        }
+
+        shadow->valid = FALSE;
+}
+
+/* Composites the shadow of the night at @now onto @map, in @dest, which
+ * has the same size. Only the pixels whose shade changed since the last
+ * time are composited again, unless the map itself changed: between two
+ * refreshes, this is the band of columns around the terminator. Returns
+ * the range of columns which changed in @min_x and @max_x, with @max_x <
+ * @min_x if none did. */
+void
+clock_map_shadow_render (ClockMapShadow *shadow,
+                         GdkPixbuf      *map,
+                         GdkPixbuf      *dest,
+                         time_t          now,
+                         gint           *min_x,
+                         gint           *max_x)
+{
+        static const guchar shadow_color[3] = { 0x6d, 0x9c, 0xcd };
+        int x, y;
+        int height, width;
+        int n_channels, rowstride;
+        int map_n_channels, map_rowstride;
+        const guchar *map_pixels;
+        guchar *pixels;
+        gdouble sun_lat, sun_lon;
+        gdouble sun_vec[3];
+        gboolean valid;
+
+        width = gdk_pixbuf_get_width (map);
+        height = gdk_pixbuf_get_height (map);
+
+        g_return_if_fail (gdk_pixbuf_get_width (dest) == width);
+        g_return_if_fail (gdk_pixbuf_get_height (dest) == height);
+
+        clock_map_shadow_update_tables (shadow, width, height);
+
+        valid = shadow->valid;
+        shadow->valid = TRUE;
+
+        n_channels = gdk_pixbuf_get_n_channels (dest);
+        rowstride = gdk_pixbuf_get_rowstride (dest);
+        pixels = gdk_pixbuf_get_pixels (dest);
+
+        map_n_channels = gdk_pixbuf_get_n_channels (map);
+        map_rowstride = gdk_pixbuf_get_rowstride (map);
+        map_pixels = gdk_pixbuf_get_pixels (map);
+
+        /* the sun vector is the same for the whole map */
+        sun_position (now, &sun_lat, &sun_lon);
+        clock_map_shadow_compute_vector (sun_lat, sun_lon, sun_vec);
+
+        for (x = 0; x < width; x++)
+                shadow->col_dot[x] = shadow->col_sin_lon[x] * sun_vec[0] +
+                                     shadow->col_cos_lon[x] * sun_vec[2];
+
+        *min_x = width;
+        *max_x = -1;
+
+        for (y = 0; y < height; y++) {
+                gdouble  cos_lat = shadow->row_cos_lat[y];
+                gdouble  sin_lat = shadow->row_sin_lat[y] * sun_vec[1];
+                guchar  *shade = shadow->shade + (gsize) y * width;
+
+                /* kept apart from the loop below so that it can be
+                 * vectorized */
+                for (x = 0; x < width; x++)
+                        shadow->row_dot[x] = cos_lat * shadow->col_dot[x] + sin_lat;
+
+                for (x = 0; x < width; x++) {
+                        const guchar *src;
+                        guchar       *dest_pixel;
+                        guchar        new_shade;
+                        guint         alpha;
+                        int           i;
+
+                        new_shade = clock_map_shadow_get_shade (shadow->row_dot[x]);
+                        if (valid && shade[x] == new_shade)
+                                continue;
+
+                        shade[x] = new_shade;
+                        *min_x = MIN (*min_x, x);
+                        *max_x = MAX (*max_x, x);
+
+                        src = map_pixels + y * map_rowstride + x * map_n_channels;
+                        dest_pixel = pixels + y * rowstride + x * n_channels;
+
+                        /* the shadow is composited with an overall
+                         * alpha of 0x66 */
+                        alpha = new_shade * 0x66 / 0xff;
+                        for (i = 0; i < 3; i++)
+                                dest_pixel[i] = src[i] + ((gint) shadow_color[i] - src[i]) * (gint) alpha / 0xff;
+                        if (n_channels == 4)
+                                dest_pixel[3] = map_n_channels == 4 ? src[3] : 0xff;
+                }
+        }
+}
@@ -0,0 +1,49 @@
+/*
+ * clock-map-shadow.h: the night side of the world map
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __CLOCK_MAP_SHADOW_H__
+#define __CLOCK_MAP_SHADOW_H__
+
+#include <time.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _ClockMapShadow ClockMapShadow;
+
+ClockMapShadow *clock_map_shadow_new        (void);
+void            clock_map_shadow_free       (ClockMapShadow *shadow);
+
+void            clock_map_shadow_invalidate (ClockMapShadow *shadow);
+void            clock_map_shadow_render     (ClockMapShadow *shadow,
+                                             GdkPixbuf      *map,
+                                             GdkPixbuf      *dest,
+                                             time_t          now,
+                                             gint           *min_x,
+                                             gint           *max_x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_MAP_SHADOW_H__ */
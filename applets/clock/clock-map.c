@@ -9,7 +9,7 @@
 
 #include "clock.h"
 #include "clock-map.h"
-#include "clock-sunpos.h"
+#include "clock-map-shadow.h"
 #include "clock-marshallers.h"
 
 enum {
@@ -32,6 +32,11 @@ static char *marker_files[MARKER_NB] = {
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
+/* The decoded pixbufs are shared by all the maps: the markers are loaded
+ * once, and the stock map once per size, as long as a map uses it. */
+static GdkPixbuf *marker_pixbufs[MARKER_NB] = { NULL };
+static GSList    *stock_map_pixbufs = NULL;
+
 typedef struct {
         time_t last_refresh;
 
@@ -45,11 +50,9 @@ typedef struct {
 
         GdkPixbuf *location_map_pixbuf;
 
-        /* The shadow itself */
-        GdkPixbuf *shadow_pixbuf;
-
         /* The map with the shadow composited onto it */
         GdkPixbuf *shadow_map_pixbuf;
+        ClockMapShadow *shadow;
 } ClockMapPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (ClockMap, clock_map, GTK_TYPE_WIDGET)
@@ -127,18 +130,58 @@ clock_map_init (ClockMap *this)
 	priv->height = 0;
 	priv->highlight_timeout_id = 0;
         priv->stock_map_pixbuf = NULL;
+        priv->shadow = clock_map_shadow_new ();
 
         g_assert (sizeof (marker_files)/sizeof (char *) == MARKER_NB);
 
         for (i = 0; i < MARKER_NB; i++) {
-                char *resource;
+                if (!marker_pixbufs[i]) {
+                        char *resource;
+
+                        resource = g_strconcat (CLOCK_RESOURCE_PATH "icons/", marker_files[i], NULL);
+                        marker_pixbufs[i] = gdk_pixbuf_new_from_resource (resource, NULL);
+                        g_free (resource);
+                }
 
-                resource = g_strconcat (CLOCK_RESOURCE_PATH "icons/", marker_files[i], NULL);
-                priv->location_marker_pixbuf[i] = gdk_pixbuf_new_from_resource (resource, NULL);
-                g_free (resource);
+                if (marker_pixbufs[i])
+                        priv->location_marker_pixbuf[i] = g_object_ref (marker_pixbufs[i]);
         }
 }
 
+static void
+stock_map_pixbuf_finalized (gpointer  data,
+                            GObject  *where_the_object_was)
+{
+        stock_map_pixbufs = g_slist_remove (stock_map_pixbufs, where_the_object_was);
+}
+
+static GdkPixbuf *
+clock_map_get_stock_map_pixbuf (gint width, gint height)
+{
+        GdkPixbuf *pixbuf;
+        GSList    *l;
+
+        for (l = stock_map_pixbufs; l; l = l->next) {
+                pixbuf = l->data;
+
+                if (gdk_pixbuf_get_width (pixbuf) == width &&
+                    gdk_pixbuf_get_height (pixbuf) == height)
+                        return g_object_ref (pixbuf);
+        }
+
+        pixbuf = gdk_pixbuf_new_from_resource_at_scale (CLOCK_RESOURCE_PATH "icons/clock-map.png",
+                                                        width, height,
+                                                        FALSE,
+                                                        NULL);
+        if (pixbuf) {
+                g_object_weak_ref (G_OBJECT (pixbuf),
+                                   stock_map_pixbuf_finalized, NULL);
+                stock_map_pixbufs = g_slist_prepend (stock_map_pixbufs, pixbuf);
+        }
+
+        return pixbuf;
+}
+
 static void
 clock_map_finalize (GObject *g_obj)
 {
@@ -157,8 +200,8 @@ clock_map_finalize (GObject *g_obj)
 	}
 
         g_clear_object (&priv->location_map_pixbuf);
-        g_clear_object (&priv->shadow_pixbuf);
         g_clear_object (&priv->shadow_map_pixbuf);
+        g_clear_pointer (&priv->shadow, clock_map_shadow_free);
 
         G_OBJECT_CLASS (clock_map_parent_class)->finalize (g_obj);
 }
@@ -190,10 +233,8 @@ clock_map_refresh (ClockMap *this)
         }
 
         if (!priv->stock_map_pixbuf) {
-                priv->stock_map_pixbuf = gdk_pixbuf_new_from_resource_at_scale (CLOCK_RESOURCE_PATH "icons/clock-map.png",
-                                                                                priv->width, priv->height,
-                                                                                FALSE,
-                                                                                NULL);
+                priv->stock_map_pixbuf = clock_map_get_stock_map_pixbuf (priv->width,
+                                                                         priv->height);
         }
 
         clock_map_place_locations (this);
@@ -380,6 +421,8 @@ clock_map_mark (ClockMap *this, gfloat latitude, gfloat longitude, gint mark)
         if (partial != NULL) {
                 g_object_unref (partial);
         }
+
+        clock_map_shadow_invalidate (priv->shadow);
 }
 
 /**
@@ -414,12 +457,20 @@ clock_map_place_locations (ClockMap *this)
         ClockMapPrivate *priv = clock_map_get_instance_private (this);
         GSList *locs;
 
-        if (priv->location_map_pixbuf) {
-                g_object_unref (priv->location_map_pixbuf);
-                priv->location_map_pixbuf = NULL;
+        /* reuse the pixbuf if the size didn't change */
+        if (priv->location_map_pixbuf &&
+            gdk_pixbuf_get_width (priv->location_map_pixbuf) == gdk_pixbuf_get_width (priv->stock_map_pixbuf) &&
+            gdk_pixbuf_get_height (priv->location_map_pixbuf) == gdk_pixbuf_get_height (priv->stock_map_pixbuf)) {
+                gdk_pixbuf_copy_area (priv->stock_map_pixbuf, 0, 0,
+                                      gdk_pixbuf_get_width (priv->stock_map_pixbuf),
+                                      gdk_pixbuf_get_height (priv->stock_map_pixbuf),
+                                      priv->location_map_pixbuf, 0, 0);
+        } else {
+                g_clear_object (&priv->location_map_pixbuf);
+                priv->location_map_pixbuf = gdk_pixbuf_copy (priv->stock_map_pixbuf);
         }
 
-        priv->location_map_pixbuf = gdk_pixbuf_copy (priv->stock_map_pixbuf);
+        clock_map_shadow_invalidate (priv->shadow);
 
 	locs = NULL;
 	g_signal_emit (this, signals[NEED_LOCATIONS], 0, &locs);
@@ -455,109 +506,44 @@ clock_map_place_locations (ClockMap *this)
 #endif
 }
 
+/* Composites the shadow onto the map, in shadow_map_pixbuf, and returns
+ * the range of columns which changed in @min_x and @max_x */
 static void
-clock_map_compute_vector (gdouble lat, gdouble lon, gdouble *vec)
+clock_map_render_shadow_pixbuf (ClockMap *this,
+                                gint     *min_x,
+                                gint     *max_x)
 {
-        gdouble lat_rad, lon_rad;
-        lat_rad = lat * (M_PI/180.0);
-        lon_rad = lon * (M_PI/180.0);
-
-        vec[0] = sin(lon_rad) * cos(lat_rad);
-        vec[1] = sin(lat_rad);
-        vec[2] = cos(lon_rad) * cos(lat_rad);
-}
-
-static guchar
-clock_map_is_sunlit (gdouble pos_lat, gdouble pos_long,
-                         gdouble sun_lat, gdouble sun_long)
-{
-        gdouble pos_vec[3];
-        gdouble sun_vec[3];
-        gdouble dot;
-
-        /* twilight */
-        gdouble epsilon = 0.01;
-
-        clock_map_compute_vector (pos_lat, pos_long, pos_vec);
-        clock_map_compute_vector (sun_lat, sun_long, sun_vec);
-
-        /* compute the dot product of the two */
-        dot = pos_vec[0]*sun_vec[0] + pos_vec[1]*sun_vec[1]
-                + pos_vec[2]*sun_vec[2];
+        ClockMapPrivate *priv = clock_map_get_instance_private (this);
 
-        if (dot > epsilon) {
-                return 0x00;
-        }
+        if (priv->shadow_map_pixbuf &&
+            (gdk_pixbuf_get_width (priv->shadow_map_pixbuf) != gdk_pixbuf_get_width (priv->location_map_pixbuf) ||
+             gdk_pixbuf_get_height (priv->shadow_map_pixbuf) != gdk_pixbuf_get_height (priv->location_map_pixbuf)))
+                g_clear_object (&priv->shadow_map_pixbuf);
 
-        if (dot < -epsilon) {
-                return 0xFF;
+        if (!priv->shadow_map_pixbuf) {
+                priv->shadow_map_pixbuf = gdk_pixbuf_copy (priv->location_map_pixbuf);
+                clock_map_shadow_invalidate (priv->shadow);
         }
 
-        return (guchar)(-128 * ((dot / epsilon) - 1));
-}
-
-static void
-clock_map_render_shadow_pixbuf (GdkPixbuf *pixbuf)
-{
-        int x, y;
-        int height, width;
-        int n_channels, rowstride;
-        guchar *pixels, *p;
-        gdouble sun_lat, sun_lon;
-        time_t now = time (NULL);
-
-        n_channels = gdk_pixbuf_get_n_channels (pixbuf);
-        rowstride = gdk_pixbuf_get_rowstride (pixbuf);
-        pixels = gdk_pixbuf_get_pixels (pixbuf);
-
-        width = gdk_pixbuf_get_width (pixbuf);
-        height = gdk_pixbuf_get_height (pixbuf);
-
-        sun_position (now, &sun_lat, &sun_lon);
-
-        for (y = 0; y < height; y++) {
-                gdouble lat = (height / 2.0 - y) / (height / 2.0) * 90.0;
-
-                for (x = 0; x < width; x++) {
-                        guchar shade;
-                        gdouble lon =
-                                (x - width / 2.0) / (width / 2.0) * 180.0;
-
-                        shade = clock_map_is_sunlit (lat, lon,
-                                                         sun_lat, sun_lon);
-
-                        p = pixels + y * rowstride + x * n_channels;
-                        p[3] = shade;
-                }
-        }
+        clock_map_shadow_render (priv->shadow,
+                                 priv->location_map_pixbuf,
+                                 priv->shadow_map_pixbuf,
+                                 time (NULL),
+                                 min_x, max_x);
 }
 
 static void
 clock_map_render_shadow (ClockMap *this)
 {
-        ClockMapPrivate *priv = clock_map_get_instance_private (this);
-
-        if (priv->shadow_pixbuf) {
-                g_object_unref (priv->shadow_pixbuf);
-        }
-
-        priv->shadow_pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
-                                              priv->width, priv->height);
-
-        /* Initialize to all shadow */
-        gdk_pixbuf_fill (priv->shadow_pixbuf, 0x6d9ccdff);
-
-        clock_map_render_shadow_pixbuf (priv->shadow_pixbuf);
-
-        if (priv->shadow_map_pixbuf) {
-                g_object_unref (priv->shadow_map_pixbuf);
-        }
+        gint min_x, max_x;
 
-        priv->shadow_map_pixbuf = gdk_pixbuf_copy (priv->location_map_pixbuf);
+        clock_map_render_shadow_pixbuf (this, &min_x, &max_x);
 
-        gdk_pixbuf_composite (priv->shadow_pixbuf, priv->shadow_map_pixbuf,
-                              0, 0, priv->width, priv->height,
-                              0, 0, 1, 1, GDK_INTERP_NEAREST, 0x66);
+        if (min_x <= max_x)
+                gtk_widget_queue_draw_area (GTK_WIDGET (this),
+                                            min_x, 0,
+                                            max_x - min_x + 1,
+                                            gtk_widget_get_allocated_height (GTK_WIDGET (this)));
 }
 
 static void
@@ -567,7 +553,6 @@ clock_map_display (ClockMap *this)
 
         if (priv->width > 0 || priv->height > 0)
                 clock_map_render_shadow (this);
-	gtk_widget_queue_draw (GTK_WIDGET (this));
 
         time (&priv->last_refresh);
 }
@@ -0,0 +1,353 @@
+/*
+ * clock-scheduler.c: shared wakeups of the clock applet
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#include <glib-unix.h>
+#endif
+
+#include <glib.h>
+
+#include "clock-scheduler.h"
+
+/* All the clocks and locations of the process share one wakeup: the work
+ * due at a deadline is run in one go, and the deadlines are aligned on
+ * wall-clock boundaries so that they fall together.
+ *
+ * The deadlines are in wall-clock time, as returned by
+ * g_get_real_time(). When possible, they are set on a timerfd with an
+ * absolute time, which fires on time after a suspend, and is cancelled
+ * when the time of the system is set: the clocks are run again then.
+ *
+ * Work that is not tied to the time of day, like the weather updates,
+ * is due after a delay instead: it keeps its monotonic deadline when the
+ * time of the system is set, and only its wakeup is moved. */
+
+#if defined (HAVE_SYS_TIMERFD_H) && !defined (TFD_TIMER_CANCEL_ON_SET)
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+typedef struct {
+        guint              id;
+        /* the wakeup, in wall-clock time */
+        gint64             deadline;
+        /* for the entries added with a delay, in monotonic time, or -1 */
+        gint64             monotonic_deadline;
+        ClockSchedulerFunc func;
+        gpointer           user_data;
+} ClockSchedulerEntry;
+
+static GSList   *entries = NULL;
+/* the entries being run, while dispatching */
+static GSList   *due_entries = NULL;
+static gboolean  dispatching = FALSE;
+static guint     last_id = 0;
+
+/* the deadline the wakeup is set for, or -1 */
+static gint64    armed_deadline = -1;
+static guint     timeout_id = 0;
+
+#ifdef HAVE_SYS_TIMERFD_H
+static int       timer_fd = -1;
+static gboolean  timer_fd_failed = FALSE;
+#endif
+
+static void clock_scheduler_arm (void);
+
+static void
+clock_scheduler_dispatch (void)
+{
+        GSList *l;
+        GSList *next;
+        gint64  now;
+
+        now = g_get_real_time ();
+
+        for (l = entries; l; l = next) {
+                ClockSchedulerEntry *entry = l->data;
+
+                next = l->next;
+
+                if (entry->deadline <= now) {
+                        entries = g_slist_delete_link (entries, l);
+                        due_entries = g_slist_prepend (due_entries, entry);
+                }
+        }
+        due_entries = g_slist_reverse (due_entries);
+
+        /* the entries can be added and removed from the callbacks */
+        dispatching = TRUE;
+        for (l = due_entries; l; l = l->next) {
+                ClockSchedulerEntry *entry = l->data;
+
+                if (entry->func)
+                        entry->func (entry->user_data);
+        }
+        dispatching = FALSE;
+
+        g_slist_free_full (due_entries, g_free);
+        due_entries = NULL;
+
+        armed_deadline = -1;
+        clock_scheduler_arm ();
+}
+
+static gboolean
+clock_scheduler_timeout (gpointer data)
+{
+        timeout_id = 0;
+        clock_scheduler_dispatch ();
+
+        return FALSE;
+}
+
+#ifdef HAVE_SYS_TIMERFD_H
+static gboolean
+clock_scheduler_timer_fd_cb (gint         fd,
+                             GIOCondition condition,
+                             gpointer     data)
+{
+        guint64 expirations;
+
+        if (read (fd, &expirations, sizeof (expirations)) < 0 &&
+            errno == ECANCELED) {
+                clock_scheduler_time_changed ();
+                return TRUE;
+        }
+
+        clock_scheduler_dispatch ();
+
+        return TRUE;
+}
+
+static gboolean
+clock_scheduler_arm_timer_fd (gint64 deadline)
+{
+        struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+
+        if (timer_fd < 0 && !timer_fd_failed) {
+                timer_fd = timerfd_create (CLOCK_REALTIME,
+                                           TFD_CLOEXEC | TFD_NONBLOCK);
+                if (timer_fd < 0)
+                        timer_fd_failed = TRUE;
+                else
+                        g_unix_fd_add (timer_fd, G_IO_IN,
+                                       clock_scheduler_timer_fd_cb, NULL);
+        }
+
+        if (timer_fd < 0)
+                return FALSE;
+
+        /* a zero time would disarm the timer, any time in the past
+         * fires it */
+        deadline = MAX (deadline, 1);
+        spec.it_value.tv_sec = deadline / G_USEC_PER_SEC;
+        spec.it_value.tv_nsec = (deadline % G_USEC_PER_SEC) * 1000;
+
+        if (timerfd_settime (timer_fd,
+                             TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                             &spec, NULL) == 0)
+                return TRUE;
+
+        /* kernels older than 3.0 */
+        return timerfd_settime (timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == 0;
+}
+#endif
+
+static void
+clock_scheduler_arm (void)
+{
+        GSList *l;
+        gint64  deadline = -1;
+        gint64  delay;
+
+        if (dispatching)
+                return;
+
+        for (l = entries; l; l = l->next) {
+                ClockSchedulerEntry *entry = l->data;
+
+                if (deadline < 0 || entry->deadline < deadline)
+                        deadline = entry->deadline;
+        }
+
+        if (deadline == armed_deadline)
+                return;
+
+        armed_deadline = deadline;
+
+        if (timeout_id) {
+                g_source_remove (timeout_id);
+                timeout_id = 0;
+        }
+
+#ifdef HAVE_SYS_TIMERFD_H
+        if (deadline < 0) {
+                struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+
+                if (timer_fd >= 0)
+                        timerfd_settime (timer_fd, 0, &spec, NULL);
+                return;
+        }
+
+        if (clock_scheduler_arm_timer_fd (deadline))
+                return;
+#else
+        if (deadline < 0)
+                return;
+#endif
+
+        /* wake up on time, and not one millisecond early */
+        delay = deadline - g_get_real_time ();
+        delay = MAX (delay, 0);
+        timeout_id = g_timeout_add ((delay + 999) / 1000,
+                                    clock_scheduler_timeout, NULL);
+}
+
+/* Returns the wakeup of a monotonic deadline: the first minute after
+ * it, so that it falls with the clocks */
+static gint64
+clock_scheduler_get_monotonic_wakeup (gint64 monotonic_deadline)
+{
+        gint64 delay;
+
+        delay = MAX (monotonic_deadline - g_get_monotonic_time (), 0);
+
+        return clock_scheduler_next_boundary (g_get_real_time () + delay,
+                                              CLOCK_SCHEDULER_MINUTE);
+}
+
+static guint
+clock_scheduler_add_entry (gint64             deadline,
+                           gint64             monotonic_deadline,
+                           ClockSchedulerFunc func,
+                           gpointer           user_data)
+{
+        ClockSchedulerEntry *entry;
+
+        entry = g_new0 (ClockSchedulerEntry, 1);
+        entry->id = ++last_id;
+        entry->deadline = deadline;
+        entry->monotonic_deadline = monotonic_deadline;
+        entry->func = func;
+        entry->user_data = user_data;
+
+        entries = g_slist_prepend (entries, entry);
+        clock_scheduler_arm ();
+
+        return entry->id;
+}
+
+/* Calls @func with @user_data once, at @deadline, in wall-clock time.
+ * Returns an id for clock_scheduler_remove(). */
+guint
+clock_scheduler_add (gint64             deadline,
+                     ClockSchedulerFunc func,
+                     gpointer           user_data)
+{
+        g_return_val_if_fail (func != NULL, 0);
+
+        return clock_scheduler_add_entry (deadline, -1, func, user_data);
+}
+
+/* Calls @func with @user_data once, at the first minute after @delay
+ * microseconds have passed, whatever the time of the system is set to
+ * meanwhile. Returns an id for clock_scheduler_remove(). */
+guint
+clock_scheduler_add_delay (gint64             delay,
+                           ClockSchedulerFunc func,
+                           gpointer           user_data)
+{
+        gint64 monotonic_deadline;
+
+        g_return_val_if_fail (func != NULL, 0);
+
+        monotonic_deadline = g_get_monotonic_time () + MAX (delay, 0);
+
+        return clock_scheduler_add_entry (clock_scheduler_get_monotonic_wakeup (monotonic_deadline),
+                                          monotonic_deadline, func, user_data);
+}
+
+void
+clock_scheduler_remove (guint id)
+{
+        GSList *l;
+
+        for (l = entries; l; l = l->next) {
+                ClockSchedulerEntry *entry = l->data;
+
+                if (entry->id == id) {
+                        entries = g_slist_delete_link (entries, l);
+                        g_free (entry);
+                        clock_scheduler_arm ();
+                        return;
+                }
+        }
+
+        for (l = due_entries; l; l = l->next) {
+                ClockSchedulerEntry *entry = l->data;
+
+                if (entry->id == id) {
+                        entry->func = NULL;
+                        return;
+                }
+        }
+}
+
+/* Returns the first multiple of @period after @time, to align deadlines */
+gint64
+clock_scheduler_next_boundary (gint64 time,
+                               gint64 period)
+{
+        g_return_val_if_fail (period > 0, time);
+
+        return (time / period + 1) * period;
+}
+
+/* Runs the clocks at once, as their deadlines are not meaningful
+ * anymore: when the time of the system is set, or after resuming from a
+ * suspend if this was not noticed. The entries added with a delay keep
+ * their monotonic deadline, and only get a new wakeup. It is fine to
+ * call this several times in a row, the work is only done once. */
+void
+clock_scheduler_time_changed (void)
+{
+        GSList *l;
+
+        for (l = entries; l; l = l->next) {
+                ClockSchedulerEntry *entry = l->data;
+
+                if (entry->monotonic_deadline < 0)
+                        entry->deadline = 0;
+                else
+                        entry->deadline = clock_scheduler_get_monotonic_wakeup (entry->monotonic_deadline);
+        }
+
+        armed_deadline = -1;
+        clock_scheduler_arm ();
+}
@@ -0,0 +1,52 @@
+/*
+ * clock-scheduler.h: shared wakeups of the clock applet
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __CLOCK_SCHEDULER_H__
+#define __CLOCK_SCHEDULER_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CLOCK_SCHEDULER_MINUTE (60 * G_USEC_PER_SEC)
+
+typedef void (* ClockSchedulerFunc) (gpointer user_data);
+
+guint  clock_scheduler_add           (gint64              deadline,
+                                      ClockSchedulerFunc  func,
+                                      gpointer            user_data);
+guint  clock_scheduler_add_delay     (gint64              delay,
+                                      ClockSchedulerFunc  func,
+                                      gpointer            user_data);
+void   clock_scheduler_remove        (guint               id);
+
+gint64 clock_scheduler_next_boundary (gint64              time,
+                                      gint64              period);
+
+void   clock_scheduler_time_changed  (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_SCHEDULER_H__ */
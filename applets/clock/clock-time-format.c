@@ -0,0 +1,330 @@
+/*
+ * clock-time-format.c: strftime() formats compiled for repeated use
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "clock-time-format.h"
+
+/* The format is split once into literal text and conversions, each one
+ * knowing the finest field of the time it depends on. When the time is
+ * rendered again, only the conversions depending on a field which changed
+ * are formatted again: with the seconds shown, this is usually only %S.
+ * The result is only converted from the locale encoding when it changed. */
+
+typedef enum {
+        CLOCK_TIME_FIELD_NONE = 0,
+        CLOCK_TIME_FIELD_DAY,
+        CLOCK_TIME_FIELD_HOUR,
+        CLOCK_TIME_FIELD_MINUTE,
+        CLOCK_TIME_FIELD_SECOND
+} ClockTimeField;
+
+/* A conversion longer than this is rendered as "???" */
+#define CLOCK_TIME_MAX_CONVERSION 65536
+
+typedef struct {
+        /* the conversion after a space, or NULL for literal text: with
+         * the space, strftime() only returns 0 when the buffer is too
+         * small, and not when the conversion is empty */
+        char           *spec;
+        ClockTimeField  field;
+        char           *text;
+} ClockTimeToken;
+
+struct _ClockTimeFormat {
+        GArray    *tokens;
+
+        gboolean   rendered;
+        struct tm  last_tm;
+        /* tm_zone of last_tm, which may not outlive a change of zone */
+        char      *last_zone;
+
+        GString   *result;
+        char      *utf8;
+};
+
+static ClockTimeField
+get_conversion_field (char conversion)
+{
+        switch (conversion) {
+        case 'S': case 'T': case 'r': case 's': case 'c': case 'X': case '+':
+                return CLOCK_TIME_FIELD_SECOND;
+        case 'M': case 'R':
+                return CLOCK_TIME_FIELD_MINUTE;
+        /* the timezone changes with daylight saving time, on the hour */
+        case 'H': case 'I': case 'k': case 'l': case 'p': case 'P':
+        case 'z': case 'Z':
+                return CLOCK_TIME_FIELD_HOUR;
+        default:
+                return CLOCK_TIME_FIELD_DAY;
+        }
+}
+
+static void
+add_token (ClockTimeFormat *format,
+           char            *spec,
+           ClockTimeField   field,
+           char            *text)
+{
+        ClockTimeToken token;
+
+        token.spec = spec;
+        token.field = field;
+        token.text = text;
+
+        g_array_append_val (format->tokens, token);
+}
+
+static void
+flush_literal (ClockTimeFormat *format,
+               GString         *literal)
+{
+        if (literal->len == 0)
+                return;
+
+        add_token (format, NULL, CLOCK_TIME_FIELD_NONE,
+                   g_strndup (literal->str, literal->len));
+        g_string_truncate (literal, 0);
+}
+
+/* @format is a strftime() format, in the encoding of the locale */
+ClockTimeFormat *
+clock_time_format_new (const char *format)
+{
+        ClockTimeFormat *retval;
+        GString         *literal;
+        const char      *p;
+
+        g_return_val_if_fail (format != NULL, NULL);
+
+        retval = g_new0 (ClockTimeFormat, 1);
+        retval->tokens = g_array_new (FALSE, FALSE, sizeof (ClockTimeToken));
+        retval->result = g_string_new (NULL);
+
+        literal = g_string_new (NULL);
+
+        p = format;
+        while (*p) {
+                const char *q;
+
+                if (*p != '%') {
+                        g_string_append_c (literal, *p++);
+                        continue;
+                }
+
+                /* flags, width and modifiers of glibc */
+                q = p + 1;
+                while (*q && strchr ("_-0^#", *q))
+                        q++;
+                while (g_ascii_isdigit (*q))
+                        q++;
+                if (*q == 'E' || *q == 'O')
+                        q++;
+
+                if (*q == '\0') {
+                        g_string_append (literal, p);
+                        break;
+                }
+
+                if (*q == '%' && q == p + 1) {
+                        g_string_append_c (literal, '%');
+                } else if (*q == 'n' && q == p + 1) {
+                        g_string_append_c (literal, '\n');
+                } else if (*q == 't' && q == p + 1) {
+                        g_string_append_c (literal, '\t');
+                } else {
+                        flush_literal (retval, literal);
+                        add_token (retval,
+                                   g_strdup_printf (" %.*s", (int) (q - p + 1), p),
+                                   get_conversion_field (*q),
+                                   g_strdup (""));
+                }
+
+                p = q + 1;
+        }
+
+        flush_literal (retval, literal);
+        g_string_free (literal, TRUE);
+
+        return retval;
+}
+
+void
+clock_time_format_free (ClockTimeFormat *format)
+{
+        guint i;
+
+        if (format == NULL)
+                return;
+
+        for (i = 0; i < format->tokens->len; i++) {
+                ClockTimeToken *token = &g_array_index (format->tokens, ClockTimeToken, i);
+
+                g_free (token->spec);
+                g_free (token->text);
+        }
+
+        g_array_free (format->tokens, TRUE);
+        g_string_free (format->result, TRUE);
+        g_free (format->utf8);
+        g_free (format->last_zone);
+        g_free (format);
+}
+
+static ClockTimeField
+get_changed_field (ClockTimeFormat *format,
+                   const struct tm *tm)
+{
+        const struct tm *old_tm = &format->last_tm;
+
+        /* a change of timezone can move every field, or only its name */
+#ifdef HAVE_STRUCT_TM_TM_GMTOFF
+        if (old_tm->tm_gmtoff != tm->tm_gmtoff)
+                return CLOCK_TIME_FIELD_DAY;
+#endif
+#ifdef HAVE_STRUCT_TM_TM_ZONE
+        if (g_strcmp0 (format->last_zone, tm->tm_zone) != 0)
+                return CLOCK_TIME_FIELD_DAY;
+#endif
+        if (old_tm->tm_year != tm->tm_year || old_tm->tm_yday != tm->tm_yday)
+                return CLOCK_TIME_FIELD_DAY;
+        if (old_tm->tm_hour != tm->tm_hour || old_tm->tm_isdst != tm->tm_isdst)
+                return CLOCK_TIME_FIELD_HOUR;
+        if (old_tm->tm_min != tm->tm_min)
+                return CLOCK_TIME_FIELD_MINUTE;
+        if (old_tm->tm_sec != tm->tm_sec)
+                return CLOCK_TIME_FIELD_SECOND;
+
+        return CLOCK_TIME_FIELD_NONE;
+}
+
+/* Applies the conversion @spec to @tm in @buf, of @size bytes, or in a
+ * larger buffer returned in @heap_buf if it doesn't fit. Returns the
+ * result, without the leading space. */
+static const char *
+format_conversion (const char       *spec,
+                   const struct tm  *tm,
+                   char             *buf,
+                   gsize             size,
+                   char            **heap_buf)
+{
+        gsize len;
+
+        *heap_buf = NULL;
+
+        while ((len = strftime (buf, size, spec, tm)) == 0) {
+                if (size >= CLOCK_TIME_MAX_CONVERSION)
+                        return "???";
+
+                size *= 2;
+                *heap_buf = g_realloc (*heap_buf, size);
+                buf = *heap_buf;
+        }
+
+        buf[len] = '\0';
+
+        return buf + 1;
+}
+
+/* Returns @format applied to @tm, in UTF-8, or "???" if it is empty.
+ * The string belongs to @format, and is valid until the next call. */
+const char *
+clock_time_format_render (ClockTimeFormat *format,
+                          const struct tm *tm)
+{
+        ClockTimeField  changed_field;
+        gboolean        changed = FALSE;
+        const char     *charset;
+        guint           i;
+
+        g_return_val_if_fail (format != NULL, NULL);
+        g_return_val_if_fail (tm != NULL, NULL);
+
+        if (format->rendered) {
+                changed_field = get_changed_field (format, tm);
+                if (changed_field == CLOCK_TIME_FIELD_NONE)
+                        return format->utf8;
+        } else {
+                changed_field = CLOCK_TIME_FIELD_DAY;
+                changed = TRUE;
+        }
+
+        format->rendered = TRUE;
+        format->last_tm = *tm;
+#ifdef HAVE_STRUCT_TM_TM_ZONE
+        if (g_strcmp0 (format->last_zone, tm->tm_zone) != 0) {
+                g_free (format->last_zone);
+                format->last_zone = g_strdup (tm->tm_zone);
+        }
+#endif
+
+        for (i = 0; i < format->tokens->len; i++) {
+                ClockTimeToken *token = &g_array_index (format->tokens, ClockTimeToken, i);
+                char            buf[128];
+                char           *heap_buf;
+                const char     *text;
+
+                if (token->spec == NULL || token->field < changed_field)
+                        continue;
+
+                text = format_conversion (token->spec, tm,
+                                          buf, sizeof (buf), &heap_buf);
+
+                if (strcmp (text, token->text) != 0) {
+                        g_free (token->text);
+                        token->text = g_strdup (text);
+                        changed = TRUE;
+                }
+
+                g_free (heap_buf);
+        }
+
+        if (!changed)
+                return format->utf8;
+
+        g_string_truncate (format->result, 0);
+        for (i = 0; i < format->tokens->len; i++) {
+                ClockTimeToken *token = &g_array_index (format->tokens, ClockTimeToken, i);
+
+                g_string_append (format->result, token->text);
+        }
+
+        g_free (format->utf8);
+
+        if (format->result->len == 0)
+                format->utf8 = g_strdup ("???");
+        else if (g_get_charset (&charset))
+                format->utf8 = g_strdup (format->result->str);
+        else
+                format->utf8 = g_locale_to_utf8 (format->result->str, -1,
+                                                 NULL, NULL, NULL);
+
+        if (!format->utf8)
+                format->utf8 = g_strdup (format->result->str);
+
+        return format->utf8;
+}
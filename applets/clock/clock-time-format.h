@@ -0,0 +1,44 @@
+/*
+ * clock-time-format.h: strftime() formats compiled for repeated use
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __CLOCK_TIME_FORMAT_H__
+#define __CLOCK_TIME_FORMAT_H__
+
+#include <time.h>
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _ClockTimeFormat ClockTimeFormat;
+
+ClockTimeFormat *clock_time_format_new    (const char       *format);
+void             clock_time_format_free   (ClockTimeFormat  *format);
+
+const char      *clock_time_format_render (ClockTimeFormat  *format,
+                                           const struct tm  *tm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_TIME_FORMAT_H__ */
@@ -67,9 +67,12 @@
 #include "clock.h"
 
 #include "calendar-window.h"
+#include "clock-fill-queue.h"
 #include "clock-location.h"
 #include "clock-location-tile.h"
 #include "clock-map.h"
+#include "clock-scheduler.h"
+#include "clock-time-format.h"
 #include "clock-utils.h"
 #include "set-timezone.h"
 #include "system-timezone.h"
@@ -174,10 +177,19 @@ struct _ClockData {
         /* Locations */
         GSList *locations;
         GSList *location_tiles;
+        /* the locations still without a tile, in the order of the tiles */
+        ClockFillQueue *tile_queue;
+        guint   prewarm_id;
 
         /* runtime data */
         time_t             current_time;
         char              *timeformat;
+        /* timeformat, or the custom format, compiled */
+        ClockTimeFormat   *label_format;
+        /* the text of the label, to only update it when it changes */
+        char              *label_text;
+        /* day and dst of the date in the tooltip, or -1 */
+        int                tooltip_key;
         guint              timeout;
         MatePanelAppletOrient  orient;
         int                size;
@@ -212,9 +224,11 @@ static int clock_numbers = 0;
 */
 
 static void  update_clock (ClockData * cd);
+static void  update_clock_full (ClockData *cd,
+                                gboolean   force);
 static void  update_tooltip (ClockData * cd);
 static void  update_panel_weather (ClockData *cd);
-static int   clock_timeout_callback (gpointer data);
+static void  clock_timeout_callback (gpointer data);
 static float get_itime    (time_t current_time);
 
 static void set_atk_name_description (GtkWidget *widget,
@@ -230,6 +244,11 @@ static void display_help_dialog       (GtkAction  *action,
 static void display_about_dialog      (GtkAction  *action,
                                        ClockData  *cd);
 static void position_calendar_popup   (ClockData  *cd);
+static void destroy_calendar_popup    (ClockData  *cd);
+static void queue_fill_locations      (ClockData  *cd);
+static void clock_vbox_visible_changed (GtkWidget  *widget,
+                                        GParamSpec *pspec,
+                                        ClockData  *cd);
 static void update_orient (ClockData *cd);
 static void applet_change_orient (MatePanelApplet       *applet,
                                   MatePanelAppletOrient  orient,
@@ -296,14 +315,17 @@ calculate_minimum_width (GtkWidget   *widget,
         return width;
 }
 
+/* The updates are run by the scheduler shared with the other clocks and
+ * the locations, at the next second or minute of the wall clock. */
 static void
 clock_set_timeout (ClockData *cd,
                    time_t     now)
 {
-        int timeouttime;
+        gint64 deadline;
 
         if (cd->format == CLOCK_FORMAT_INTERNET) {
                 int itime_ms;
+                int timeouttime;
 
                 itime_ms = ((unsigned int) (get_itime (now) * 1000));
 
@@ -315,30 +337,33 @@ clock_set_timeout (ClockData *cd,
                         itime_ms += (tv.tv_usec * 86.4) / 1000;
                         timeouttime = ((999 - itime_ms % 1000) * 86.4) / 100 + 1;
                 }
-        } else {
-                 struct timeval tv;
-
-                gettimeofday (&tv, NULL);
-                 timeouttime = (G_USEC_PER_SEC - tv.tv_usec)/1000+20;
 
+                deadline = g_get_real_time () + (gint64) timeouttime * 1000;
+        } else {
                 /* timeout of one minute if we don't care about the seconds */
-                 if (cd->format != CLOCK_FORMAT_UNIX &&
+                if (cd->format != CLOCK_FORMAT_UNIX &&
                     !cd->showseconds &&
                     (!cd->set_time_window || !gtk_widget_get_visible (cd->set_time_window)))
-                         timeouttime += 1000 * (59 - now % 60);
-         }
+                        deadline = clock_scheduler_next_boundary (g_get_real_time (),
+                                                                  CLOCK_SCHEDULER_MINUTE);
+                else
+                        deadline = clock_scheduler_next_boundary (g_get_real_time (),
+                                                                  G_USEC_PER_SEC);
+        }
 
-        cd->timeout = g_timeout_add (timeouttime,
-                                     clock_timeout_callback,
-                                     cd);
+        cd->timeout = clock_scheduler_add (deadline,
+                                           clock_timeout_callback,
+                                           cd);
 }
 
-static int
+static void
 clock_timeout_callback (gpointer data)
 {
         ClockData *cd = data;
         time_t new_time;
 
+        cd->timeout = 0;
+
         time (&new_time);
 
         if (!cd->showseconds &&
@@ -348,19 +373,17 @@ clock_timeout_callback (gpointer data)
                 if (cd->format == CLOCK_FORMAT_INTERNET &&
                     (unsigned int)get_itime (new_time) !=
                     (unsigned int)get_itime (cd->current_time)) {
-                        update_clock (cd);
+                        update_clock_full (cd, FALSE);
                 } else if ((cd->format == CLOCK_FORMAT_12 ||
                             cd->format == CLOCK_FORMAT_24) &&
                            new_time / 60 != cd->current_time / 60) {
-                        update_clock (cd);
+                        update_clock_full (cd, FALSE);
                 }
         } else {
-                update_clock (cd);
+                update_clock_full (cd, FALSE);
         }
 
         clock_set_timeout (cd, new_time);
-
-        return FALSE;
 }
 
 static float
@@ -512,8 +535,23 @@ get_updated_timeformat (ClockData *cd)
 static void
 update_timeformat (ClockData *cd)
 {
+        char *custom_format = NULL;
+
         g_free (cd->timeformat);
         cd->timeformat = get_updated_timeformat (cd);
+
+        g_clear_pointer (&cd->label_format, clock_time_format_free);
+
+        if (cd->format == CLOCK_FORMAT_CUSTOM) {
+                custom_format = g_locale_from_utf8 (cd->custom_format, -1,
+                                                    NULL, NULL, NULL);
+                /* the label shows "???" for an unusable format */
+                cd->label_format = clock_time_format_new (custom_format ? custom_format : "");
+                g_free (custom_format);
+        } else if (cd->format == CLOCK_FORMAT_12 ||
+                   cd->format == CLOCK_FORMAT_24) {
+                cd->label_format = clock_time_format_new (cd->timeformat);
+        }
 }
 
 /* sets accessible name and description for the widget */
@@ -540,6 +578,10 @@ update_location_tiles (ClockData *cd)
 {
         GSList *l;
 
+        /* nothing to update while they can't be seen */
+        if (!cd->calendar_popup || !gtk_widget_get_visible (cd->calendar_popup))
+                return;
+
         for (l = cd->location_tiles; l; l = l->next) {
                 ClockLocationTile *tile;
 
@@ -574,16 +616,9 @@ format_time (ClockData *cd)
                         utf8 = g_strdup_printf ("@%3.2f", itime);
                 else
                         utf8 = g_strdup_printf ("@%3d", (unsigned int) itime);
-        } else if (cd->format == CLOCK_FORMAT_CUSTOM) {
-                char *timeformat = g_locale_from_utf8 (cd->custom_format, -1,
-                                                       NULL, NULL, NULL);
-                if (!timeformat)
-                        strcpy (hour, "???");
-                else if (strftime (hour, sizeof (hour), timeformat, tm)== 0)
-                        strcpy (hour, "???");
-                g_free (timeformat);
-
-                utf8 = g_locale_to_utf8 (hour, -1, NULL, NULL, NULL);
+        } else if (cd->label_format) {
+                /* only the fields which changed are formatted again */
+                utf8 = g_strdup (clock_time_format_render (cd->label_format, tm));
         } else {
                 if (strftime (hour, sizeof (hour), cd->timeformat, tm) == 0)
                         strcpy (hour, "???");
@@ -608,8 +643,11 @@ format_time_24 (ClockData *cd)
         return g_locale_to_utf8 (buf, -1, NULL, NULL, NULL);
 }
 
+/* Unless @force is set, the label is left alone if its text didn't
+ * change: this is most of the ticks when the seconds are not shown. */
 static void
-update_clock (ClockData * cd)
+update_clock_full (ClockData *cd,
+                   gboolean   force)
 {
         gboolean use_markup;
         char *utf8, *text;
@@ -617,24 +655,28 @@ update_clock (ClockData * cd)
         time (&cd->current_time);
         utf8 = format_time (cd);
 
-        use_markup = FALSE;
-        if (pango_parse_markup (utf8, -1, 0, NULL, &text, NULL, NULL))
-                use_markup = TRUE;
-        else
-                text = g_strdup (utf8);
+        if (force || g_strcmp0 (utf8, cd->label_text) != 0) {
+                use_markup = FALSE;
+                if (pango_parse_markup (utf8, -1, 0, NULL, &text, NULL, NULL))
+                        use_markup = TRUE;
+                else
+                        text = g_strdup (utf8);
 
-        if (use_markup)
-                gtk_label_set_markup (GTK_LABEL (cd->clockw), utf8);
-        else
-                gtk_label_set_text (GTK_LABEL (cd->clockw), utf8);
+                if (use_markup)
+                        gtk_label_set_markup (GTK_LABEL (cd->clockw), utf8);
+                else
+                        gtk_label_set_text (GTK_LABEL (cd->clockw), utf8);
 
-        set_atk_name_description (cd->applet, text, NULL);
+                set_atk_name_description (cd->applet, text, NULL);
 
-        g_free (utf8);
-        g_free (text);
+                g_free (text);
 
-        update_orient (cd);
-        gtk_widget_queue_resize (cd->panel_button);
+                update_orient (cd);
+                gtk_widget_queue_resize (cd->panel_button);
+        }
+
+        g_free (cd->label_text);
+        cd->label_text = utf8;
 
         update_tooltip (cd);
         update_location_tiles (cd);
@@ -650,6 +692,12 @@ update_clock (ClockData * cd)
         }
 }
 
+static void
+update_clock (ClockData * cd)
+{
+        update_clock_full (cd, TRUE);
+}
+
 static void
 update_tooltip (ClockData * cd)
 {
@@ -660,11 +708,16 @@ update_tooltip (ClockData * cd)
                 char date[256];
                 char *utf8, *loc;
                 char *zone;
-                time_t now_t;
-                struct tm now;
+                int key;
 
                 tm = localtime (&cd->current_time);
 
+                /* the date only changes once a day */
+                key = ((tm->tm_year * 366) + tm->tm_yday) * 2 + (tm->tm_isdst > 0);
+                if (key == cd->tooltip_key)
+                        return;
+                cd->tooltip_key = key;
+
                 utf8 = NULL;
 
                 /* Show date in tooltip. */
@@ -680,13 +733,9 @@ update_tooltip (ClockData * cd)
 
                 utf8 = g_locale_to_utf8 (date, -1, NULL, NULL, NULL);
 
-                /* Add the timezone name */
+                /* Add the timezone name, set by localtime () */
 
-                tzset ();
-                time (&now_t);
-                localtime_r (&now_t, &now);
-
-                if (now.tm_isdst > 0) {
+                if (tm->tm_isdst > 0) {
                         zone = tzname[1];
                 } else {
                         zone = tzname[0];
@@ -696,7 +745,9 @@ update_tooltip (ClockData * cd)
 
                 g_free (utf8);
         } else {
-                if (cd->calendar_popup)
+                cd->tooltip_key = -1;
+
+                if (cd->calendar_popup && gtk_widget_get_visible (cd->calendar_popup))
                         tip = _("Click to hide month calendar");
                 else
                         tip = _("Click to view month calendar");
@@ -728,7 +779,7 @@ refresh_clock_timeout(ClockData *cd)
         update_timeformat (cd);
 
         if (cd->timeout)
-                g_source_remove (cd->timeout);
+                clock_scheduler_remove (cd->timeout);
 
         update_clock (cd);
 
@@ -743,7 +794,7 @@ static void
 refresh_click_timeout_time_only (ClockData *cd)
 {
         if (cd->timeout)
-                g_source_remove (cd->timeout);
+                clock_scheduler_remove (cd->timeout);
         clock_timeout_callback (cd);
 }
 
@@ -781,27 +832,30 @@ destroy_clock (GtkWidget * widget, ClockData *cd)
         cd->settings = NULL;
 
         if (cd->timeout)
-                g_source_remove (cd->timeout);
+                clock_scheduler_remove (cd->timeout);
         cd->timeout = 0;
 
         if (cd->props)
                 gtk_widget_destroy (cd->props);
         cd->props = NULL;
 
-        if (cd->calendar_popup)
-                gtk_widget_destroy (cd->calendar_popup);
-        cd->calendar_popup = NULL;
+        if (cd->prewarm_id)
+                g_source_remove (cd->prewarm_id);
+        cd->prewarm_id = 0;
+
+        destroy_calendar_popup (cd);
+
+        clock_fill_queue_free (cd->tile_queue);
+        cd->tile_queue = NULL;
 
         g_free (cd->timeformat);
+        g_clear_pointer (&cd->label_format, clock_time_format_free);
+        g_free (cd->label_text);
 
         g_free (cd->custom_format);
 
         free_locations (cd);
 
-        if (cd->location_tiles)
-                g_slist_free (cd->location_tiles);
-        cd->location_tiles = NULL;
-
         if (cd->systz) {
                 g_object_unref (cd->systz);
                 cd->systz = NULL;
@@ -1113,6 +1167,10 @@ create_clock_window (ClockData *cd)
         cd->clock_vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
         gtk_container_add (GTK_CONTAINER (locations_box), cd->clock_vbox);
 
+        /* the locations box is only visible while it is expanded */
+        g_signal_connect (cd->clock_vbox, "notify::visible",
+                          G_CALLBACK (clock_vbox_visible_changed), cd);
+
         cd->clock_group = gtk_size_group_new (GTK_SIZE_GROUP_HORIZONTAL);
 
         gtk_container_foreach (GTK_CONTAINER (locations_box),
@@ -1245,12 +1303,35 @@ location_tile_need_clock_format_cb(ClockLocationTile *tile, gpointer data)
         return cd->format;
 }
 
+static void
+add_location_tile (GObject  *item,
+                   gpointer  data)
+{
+        ClockData         *cd = data;
+        ClockLocation     *loc = CLOCK_LOCATION (item);
+        ClockLocationTile *city;
+
+        city = clock_location_tile_new (loc, CLOCK_FACE_SMALL);
+        g_signal_connect (city, "tile-pressed",
+                          G_CALLBACK (location_tile_pressed_cb), cd);
+        g_signal_connect (city, "need-clock-format",
+                          G_CALLBACK (location_tile_need_clock_format_cb), cd);
+
+        gtk_box_pack_start (GTK_BOX (cd->cities_section),
+                            GTK_WIDGET (city),
+                            FALSE, FALSE, 0);
+
+        cd->location_tiles = g_slist_prepend (cd->location_tiles, city);
+
+        clock_location_tile_refresh (city, TRUE);
+        gtk_widget_show_all (GTK_WIDGET (city));
+}
+
 static void
 create_cities_section (ClockData *cd)
 {
         GSList *node;
         GSList *cities;
-        GSList *l;
 
         if (cd->cities_section) {
                 gtk_widget_destroy (cd->cities_section);
@@ -1276,29 +1357,17 @@ create_cities_section (ClockData *cd)
         node = g_slist_copy (cities);
         node = g_slist_sort (node, sort_locations_by_time_reverse_and_name);
 
-        for (l = node; l; l = g_slist_next (l)) {
-                ClockLocation *loc = l->data;
-                ClockLocationTile *city = clock_location_tile_new (loc, CLOCK_FACE_SMALL);
-                g_signal_connect (city, "tile-pressed",
-                                  G_CALLBACK (location_tile_pressed_cb), cd);
-                g_signal_connect (city, "need-clock-format",
-                                  G_CALLBACK (location_tile_need_clock_format_cb), cd);
-
-                gtk_box_pack_start (GTK_BOX (cd->cities_section),
-                                    GTK_WIDGET (city),
-                                    FALSE, FALSE, 0);
-
-                cd->location_tiles = g_slist_prepend (cd->location_tiles, city);
-
-                clock_location_tile_refresh (city, TRUE);
-        }
+        /* the tiles themselves are added by the tile queue */
+        clock_fill_queue_set_items (cd->tile_queue, node);
 
         g_slist_free (node);
 
         gtk_box_pack_end (GTK_BOX (cd->clock_vbox),
                           cd->cities_section, FALSE, FALSE, 0);
 
-        gtk_widget_show_all (cd->cities_section);
+        gtk_widget_show (cd->cities_section);
+
+        queue_fill_locations (cd);
 }
 
 static GSList *
@@ -1334,42 +1403,130 @@ create_map_section (ClockData *cd)
         gtk_widget_show (cd->map_widget);
 }
 
+/* The map and the location tiles are only built while they can be seen,
+ * as they are in the expander of the locations: when it is collapsed,
+ * this waits for it to be expanded. They are built from an idle, a few
+ * tiles at a time, so that the popup shows at once and its content is
+ * filled in as it comes. */
+#define CLOCK_FILL_LOCATIONS_SLICE 4000
+
+static gboolean
+fill_locations_ready (gpointer data)
+{
+        ClockData *cd = data;
+
+        if (!cd->clock_vbox || !gtk_widget_get_visible (cd->clock_vbox))
+                return FALSE;
+
+        if (!cd->map_widget)
+                create_map_section (cd);
+
+        return TRUE;
+}
+
+static void
+queue_fill_locations (ClockData *cd)
+{
+        if (!cd->clock_vbox)
+                return;
+
+        if (cd->map_widget && clock_fill_queue_get_n_pending (cd->tile_queue) == 0)
+                return;
+
+        clock_fill_queue_start (cd->tile_queue);
+}
+
+static void
+clock_vbox_visible_changed (GtkWidget  *widget,
+                            GParamSpec *pspec,
+                            ClockData  *cd)
+{
+        queue_fill_locations (cd);
+}
+
+static void
+build_calendar_popup (ClockData *cd)
+{
+        cd->calendar_popup = create_calendar (cd);
+        g_object_add_weak_pointer (G_OBJECT (cd->calendar_popup),
+                                   (gpointer *) &cd->calendar_popup);
+
+        create_clock_window (cd);
+        create_cities_store (cd);
+        create_cities_section (cd);
+        queue_fill_locations (cd);
+}
+
+static void
+destroy_calendar_popup (ClockData *cd)
+{
+        clock_fill_queue_clear (cd->tile_queue);
+
+        if (cd->calendar_popup)
+                gtk_widget_destroy (cd->calendar_popup);
+        cd->calendar_popup = NULL;
+        cd->cities_section = NULL;
+        cd->map_widget = NULL;
+        cd->clock_vbox = NULL;
+
+        if (cd->clock_group)
+                g_object_unref (cd->clock_group);
+        cd->clock_group = NULL;
+
+        if (cd->location_tiles)
+                g_slist_free (cd->location_tiles);
+        cd->location_tiles = NULL;
+}
+
+/* The popup is built once, ahead of time, and only hidden when it is
+ * closed, so that it opens at once. */
+static gboolean
+prewarm_calendar_popup (gpointer data)
+{
+        ClockData *cd = data;
+
+        cd->prewarm_id = 0;
+
+        if (!cd->calendar_popup)
+                build_calendar_popup (cd);
+
+        return G_SOURCE_REMOVE;
+}
+
 static void
 update_calendar_popup (ClockData *cd)
 {
+        GSList *l;
+
         if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (cd->panel_button))) {
-                if (cd->calendar_popup) {
-                        gtk_widget_destroy (cd->calendar_popup);
-                        cd->calendar_popup = NULL;
-                        cd->cities_section = NULL;
-                        cd->map_widget = NULL;
-                        cd->clock_vbox = NULL;
-
-                        if (cd->location_tiles)
-                                g_slist_free (cd->location_tiles);
-                        cd->location_tiles = NULL;
-                }
+                if (cd->calendar_popup)
+                        gtk_widget_hide (cd->calendar_popup);
                 update_tooltip (cd);
                 return;
         }
 
-        if (!cd->calendar_popup) {
-                cd->calendar_popup = create_calendar (cd);
-                g_object_add_weak_pointer (G_OBJECT (cd->calendar_popup),
-                                           (gpointer *) &cd->calendar_popup);
-                update_tooltip (cd);
+        /* the order of the content depends on the orientation */
+        if (cd->calendar_popup &&
+            calendar_window_get_invert_order (CALENDAR_WINDOW (cd->calendar_popup)) !=
+            (cd->orient == MATE_PANEL_APPLET_ORIENT_UP))
+                destroy_calendar_popup (cd);
 
-                create_clock_window (cd);
-                create_cities_store (cd);
-                create_cities_section (cd);
-                create_map_section (cd);
-        }
+        if (!cd->calendar_popup)
+                build_calendar_popup (cd);
 
-        if (cd->calendar_popup && gtk_widget_get_realized (cd->panel_button)) {
+        if (gtk_widget_get_realized (cd->panel_button)) {
                 calendar_window_refresh (CALENDAR_WINDOW (cd->calendar_popup));
                 position_calendar_popup (cd);
                 gtk_window_present (GTK_WINDOW (cd->calendar_popup));
+
+                /* they were not updated while the popup was hidden */
+                for (l = cd->location_tiles; l; l = l->next)
+                        clock_location_tile_refresh (CLOCK_LOCATION_TILE (l->data), TRUE);
+                if (cd->map_widget)
+                        clock_map_update_time (CLOCK_MAP (cd->map_widget));
         }
+
+        update_tooltip (cd);
 }
 
 static void
@@ -2408,6 +2565,13 @@ clock_timezone_changed (SystemTimezone *systz,
                         const char     *new_tz,
                         ClockData      *cd)
 {
+        /* the name of the timezone is in the tooltip */
+        cd->tooltip_key = -1;
+
+        /* without the timezone in struct tm, the label format cannot
+         * tell that the zone changed */
+        update_timeformat (cd);
+
         /* This will refresh the current location */
         save_cities_store (cd);
 
@@ -2467,8 +2631,10 @@ custom_format_changed (GSettings    *settings,
         g_free (clock->custom_format);
         clock->custom_format = g_strdup (value);
 
-        if (clock->format == CLOCK_FORMAT_CUSTOM)
+        if (clock->format == CLOCK_FORMAT_CUSTOM) {
+                update_timeformat (clock);
                 refresh_clock (clock);
+        }
         g_free (value);
 }
 
@@ -2549,6 +2715,7 @@ load_gsettings (ClockData *cd)
         cd->show_temperature = g_settings_get_boolean (cd->settings, KEY_SHOW_TEMPERATURE);
         cd->showweek = g_settings_get_boolean (cd->settings, KEY_SHOW_WEEK);
         cd->timeformat = NULL;
+        cd->tooltip_key = -1;
 
         cd->can_handle_format_12 = (clock_locale_format () == CLOCK_FORMAT_12);
         if (!cd->can_handle_format_12 && cd->format == CLOCK_FORMAT_12)
@@ -2577,7 +2744,10 @@ load_gsettings (ClockData *cd)
  * updated weather data.  Without this extra code, the user would most
  * likely wake the system up and see the weather from an hour ago, and if
  * the clock is set to not display seconds (only minutes), the clock may
- * show an inaccurate time for up to a minute after resume.
+ * show an inaccurate time for up to a minute after resume.  The clocks
+ * are run again by the scheduler, which usually notices the resume by
+ * itself.  The weather updates are due after a monotonic delay, which
+ * doesn't count the time spent asleep, so they are done here.
  */
 static void
 system_manager_signal_cb (GDBusProxy *proxy,
@@ -2607,7 +2777,7 @@ system_manager_signal_cb (GDBusProxy *proxy,
                  */
                 if (active == FALSE)
                 {
-                        update_clock (cd);
+                        clock_scheduler_time_changed ();
                         update_weather_locations (cd);
                 }
         }
@@ -2664,6 +2834,11 @@ fill_clock_applet (MatePanelApplet *applet)
 
         cd->applet = GTK_WIDGET (applet);
 
+        cd->tile_queue = clock_fill_queue_new (CLOCK_FILL_LOCATIONS_SLICE,
+                                               fill_locations_ready,
+                                               add_location_tile,
+                                               cd);
+
         setup_gsettings (cd);
         load_gsettings (cd);
 
@@ -2727,6 +2902,9 @@ fill_clock_applet (MatePanelApplet *applet)
          * hibernate). */
         setup_monitor_for_resume (cd);
 
+        cd->prewarm_id = g_idle_add_full (G_PRIORITY_LOW,
+                                          prewarm_calendar_popup, cd, NULL);
+
         return TRUE;
 }
 
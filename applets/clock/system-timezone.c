@@ -63,6 +63,10 @@
 #define ETC_CONF_D_CLOCK    "/etc/conf.d/clock"
 #define ETC_LOCALTIME       "/etc/localtime"
 
+/* How long to wait after the last change to the zoneinfo before telling
+ * that it changed, in seconds: an update of tzdata rewrites many files */
+#define ZONEINFO_CHANGED_DELAY 2
+
 /* The first 4 characters in a timezone file, from tzfile.h */
 #define TZ_MAGIC "TZif"
 
@@ -80,10 +84,13 @@ typedef struct {
         char *tz;
         char *env_tz;
         GFileMonitor *monitors[CHECK_NB];
+        GFileMonitor *zoneinfo_monitor;
+        guint zoneinfo_changed_id;
 } SystemTimezonePrivate;
 
 enum {
 	CHANGED,
+	ZONEINFO_CHANGED,
 	LAST_SIGNAL
 };
 
@@ -101,6 +108,11 @@ static void system_timezone_monitor_changed (GFileMonitor *handle,
                                              GFile *other_file,
                                              GFileMonitorEvent event,
                                              gpointer user_data);
+static void system_timezone_zoneinfo_monitor_changed (GFileMonitor *handle,
+                                                      GFile *file,
+                                                      GFile *other_file,
+                                                      GFileMonitorEvent event,
+                                                      gpointer user_data);
 static char *system_timezone_find (void);
 
 SystemTimezone *
@@ -147,6 +159,17 @@ system_timezone_class_init (SystemTimezoneClass *class)
 			      NULL, NULL,
 			      g_cclosure_marshal_VOID__STRING,
 			      G_TYPE_NONE, 1, G_TYPE_STRING);
+
+        /* The timezone data was updated: zones loaded before might
+         * have the wrong rules */
+        system_timezone_signals[ZONEINFO_CHANGED] =
+		g_signal_new ("zoneinfo-changed",
+			      G_OBJECT_CLASS_TYPE (g_obj_class),
+			      G_SIGNAL_RUN_FIRST,
+			      G_STRUCT_OFFSET (SystemTimezoneClass, zoneinfo_changed),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
 }
 
 static void
@@ -160,6 +183,8 @@ system_timezone_init (SystemTimezone *systz)
         priv->env_tz = NULL;
         for (i = 0; i < CHECK_NB; i++)
                 priv->monitors[i] = NULL;
+        priv->zoneinfo_monitor = NULL;
+        priv->zoneinfo_changed_id = 0;
 }
 
 static GObject *
@@ -218,6 +243,24 @@ system_timezone_constructor (GType                  type,
                                           obj);
         }
 
+        /* tzdata updates always rewrite the files at the top of the
+         * zoneinfo, like zone.tab, so its subdirectories need not be
+         * monitored */
+        if (g_file_test (SYSTEM_ZONEINFODIR, G_FILE_TEST_IS_DIR)) {
+                GFile *dir;
+
+                dir = g_file_new_for_path (SYSTEM_ZONEINFODIR);
+                priv->zoneinfo_monitor = g_file_monitor_directory (dir,
+                                                                   G_FILE_MONITOR_NONE,
+                                                                   NULL, NULL);
+                g_object_unref (dir);
+
+                if (priv->zoneinfo_monitor)
+                        g_signal_connect (priv->zoneinfo_monitor, "changed",
+                                          G_CALLBACK (system_timezone_zoneinfo_monitor_changed),
+                                          obj);
+        }
+
         systz_singleton = obj;
 
         return systz_singleton;
@@ -240,6 +283,12 @@ system_timezone_finalize (GObject *obj)
                 g_clear_object (&priv->monitors[i]);
         }
 
+        g_clear_object (&priv->zoneinfo_monitor);
+        if (priv->zoneinfo_changed_id) {
+                g_source_remove (priv->zoneinfo_changed_id);
+                priv->zoneinfo_changed_id = 0;
+        }
+
         G_OBJECT_CLASS (system_timezone_parent_class)->finalize (obj);
 
         g_assert (obj == systz_singleton);
@@ -280,6 +329,45 @@ system_timezone_monitor_changed (GFileMonitor *handle,
         g_free (new_tz);
 }
 
+static gboolean
+system_timezone_zoneinfo_changed (gpointer user_data)
+{
+        SystemTimezonePrivate *priv;
+
+        priv = system_timezone_get_instance_private (user_data);
+        priv->zoneinfo_changed_id = 0;
+
+        g_signal_emit (G_OBJECT (user_data),
+                       system_timezone_signals[ZONEINFO_CHANGED], 0);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+system_timezone_zoneinfo_monitor_changed (GFileMonitor *handle,
+                                          GFile *file,
+                                          GFile *other_file,
+                                          GFileMonitorEvent event,
+                                          gpointer user_data)
+{
+        SystemTimezonePrivate *priv;
+
+        priv = system_timezone_get_instance_private (user_data);
+
+        if (event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+            event != G_FILE_MONITOR_EVENT_DELETED &&
+            event != G_FILE_MONITOR_EVENT_CREATED)
+                return;
+
+        if (priv->zoneinfo_changed_id)
+                g_source_remove (priv->zoneinfo_changed_id);
+
+        priv->zoneinfo_changed_id =
+                g_timeout_add_seconds (ZONEINFO_CHANGED_DELAY,
+                                       system_timezone_zoneinfo_changed,
+                                       user_data);
+}
+
 /*
  * Code to deal with the system timezone on all distros.
  * There's no dependency on the SystemTimezone GObject here.
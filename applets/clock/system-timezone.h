@@ -53,6 +53,7 @@ typedef struct
 
 	void (* changed) (SystemTimezone *systz,
 			  const char     *tz);
+	void (* zoneinfo_changed) (SystemTimezone *systz);
 } SystemTimezoneClass;
 
 GType system_timezone_get_type (void);
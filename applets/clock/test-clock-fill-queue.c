@@ -0,0 +1,277 @@
+/* Test for the filling of the calendar popup in slices
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib-object.h>
+#include "clock-fill-queue.h"
+
+#define N_ITEMS 8
+
+/* how long filling an item takes in the slices test */
+#define FILL_TIME 2000
+
+typedef struct {
+        GObject  *items[N_ITEMS];
+        /* the indices of the items filled, in order */
+        GString  *filled;
+        gboolean  ready;
+        guint     n_ready_calls;
+        gulong    fill_time;
+} TestData;
+
+static gboolean
+test_ready (gpointer user_data)
+{
+        TestData *data = user_data;
+
+        data->n_ready_calls++;
+
+        return data->ready;
+}
+
+static void
+test_fill (GObject  *item,
+           gpointer  user_data)
+{
+        TestData *data = user_data;
+        int       i;
+
+        for (i = 0; i < N_ITEMS; i++) {
+                if (data->items[i] == item)
+                        break;
+        }
+        g_assert_cmpint (i, <, N_ITEMS);
+
+        g_string_append_c (data->filled, 'a' + i);
+
+        if (data->fill_time)
+                g_usleep (data->fill_time);
+}
+
+/* The queue holds the only references to the items: they are dropped
+ * as the items are filled or cleared */
+static ClockFillQueue *
+setup_queue (TestData *data,
+             gint64    slice)
+{
+        ClockFillQueue *queue;
+        GSList         *items = NULL;
+        int             i;
+
+        data->filled = g_string_new (NULL);
+        data->ready = TRUE;
+        data->n_ready_calls = 0;
+        data->fill_time = 0;
+
+        for (i = N_ITEMS - 1; i >= 0; i--) {
+                data->items[i] = g_object_new (G_TYPE_OBJECT, NULL);
+                g_object_add_weak_pointer (data->items[i], (gpointer *) &data->items[i]);
+                items = g_slist_prepend (items, data->items[i]);
+        }
+
+        queue = clock_fill_queue_new (slice, test_ready, test_fill, data);
+        clock_fill_queue_set_items (queue, items);
+
+        g_slist_free_full (items, g_object_unref);
+
+        return queue;
+}
+
+static void
+assert_items_released (TestData *data)
+{
+        int i;
+
+        for (i = 0; i < N_ITEMS; i++)
+                g_assert_null (data->items[i]);
+}
+
+static void
+run_until_done (ClockFillQueue *queue)
+{
+        while (clock_fill_queue_is_running (queue))
+                g_main_context_iteration (NULL, TRUE);
+}
+
+/* All the items are filled, in order, and only once started */
+static void
+test_order (void)
+{
+        ClockFillQueue *queue;
+        TestData        data;
+
+        queue = setup_queue (&data, 4000);
+
+        while (g_main_context_iteration (NULL, FALSE));
+        g_assert_cmpstr (data.filled->str, ==, "");
+        g_assert_cmpuint (clock_fill_queue_get_n_pending (queue), ==, N_ITEMS);
+
+        clock_fill_queue_start (queue);
+        run_until_done (queue);
+
+        g_assert_cmpstr (data.filled->str, ==, "abcdefgh");
+        g_assert_cmpuint (clock_fill_queue_get_n_pending (queue), ==, 0);
+        assert_items_released (&data);
+
+        clock_fill_queue_free (queue);
+        g_string_free (data.filled, TRUE);
+}
+
+/* Each slice fills at least one item, and stops once it took longer
+ * than the slice */
+static void
+test_slices (void)
+{
+        ClockFillQueue *queue;
+        TestData        data;
+        guint           n_slices = 0;
+        guint           pending;
+
+        queue = setup_queue (&data, 3 * FILL_TIME / 2);
+        data.fill_time = FILL_TIME;
+
+        clock_fill_queue_start (queue);
+
+        pending = clock_fill_queue_get_n_pending (queue);
+        while (clock_fill_queue_is_running (queue)) {
+                guint n_filled;
+
+                g_main_context_iteration (NULL, TRUE);
+
+                n_filled = pending - clock_fill_queue_get_n_pending (queue);
+                pending -= n_filled;
+                n_slices++;
+
+                /* the first item always goes over half the slice, the
+                 * second one over the whole slice */
+                g_assert_cmpuint (n_filled, >=, 1);
+                g_assert_cmpuint (n_filled, <=, 2);
+        }
+
+        g_assert_cmpuint (n_slices, >=, N_ITEMS / 2);
+        g_assert_cmpuint (data.n_ready_calls, ==, n_slices);
+        g_assert_cmpstr (data.filled->str, ==, "abcdefgh");
+        assert_items_released (&data);
+
+        clock_fill_queue_free (queue);
+        g_string_free (data.filled, TRUE);
+}
+
+/* Nothing is filled while the content can't be seen, and filling goes
+ * on where it stopped when started again */
+static void
+test_not_ready (void)
+{
+        ClockFillQueue *queue;
+        TestData        data;
+
+        queue = setup_queue (&data, 3 * FILL_TIME / 2);
+        data.fill_time = FILL_TIME;
+
+        clock_fill_queue_start (queue);
+        g_main_context_iteration (NULL, TRUE);
+        g_assert_cmpuint (clock_fill_queue_get_n_pending (queue), <, N_ITEMS);
+
+        data.ready = FALSE;
+        run_until_done (queue);
+        g_assert_cmpuint (data.filled->len, ==, N_ITEMS - clock_fill_queue_get_n_pending (queue));
+        g_assert_cmpuint (data.filled->len, <, N_ITEMS);
+
+        data.ready = TRUE;
+        data.fill_time = 0;
+        clock_fill_queue_start (queue);
+        run_until_done (queue);
+        g_assert_cmpstr (data.filled->str, ==, "abcdefgh");
+
+        /* the ready function still runs without items: it builds
+         * what comes before them */
+        data.n_ready_calls = 0;
+        clock_fill_queue_start (queue);
+        run_until_done (queue);
+        g_assert_cmpuint (data.n_ready_calls, ==, 1);
+        g_assert_cmpstr (data.filled->str, ==, "abcdefgh");
+
+        clock_fill_queue_free (queue);
+        g_string_free (data.filled, TRUE);
+}
+
+/* Clearing the queue stops filling and releases the items left, and
+ * new items replace the pending ones */
+static void
+test_clear (void)
+{
+        ClockFillQueue *queue;
+        TestData        data;
+        GSList         *items;
+        int             i;
+
+        queue = setup_queue (&data, 3 * FILL_TIME / 2);
+        data.fill_time = FILL_TIME;
+
+        clock_fill_queue_start (queue);
+        g_main_context_iteration (NULL, TRUE);
+
+        clock_fill_queue_clear (queue);
+        g_assert_false (clock_fill_queue_is_running (queue));
+        g_assert_cmpuint (clock_fill_queue_get_n_pending (queue), ==, 0);
+        assert_items_released (&data);
+
+        while (g_main_context_iteration (NULL, FALSE));
+        g_assert_cmpuint (data.filled->len, >=, 1);
+        g_assert_cmpuint (data.filled->len, <=, 2);
+
+        /* the pending items are replaced */
+        g_string_truncate (data.filled, 0);
+        data.fill_time = 0;
+
+        for (i = 0; i < N_ITEMS; i++)
+                data.items[i] = g_object_new (G_TYPE_OBJECT, NULL);
+        g_object_add_weak_pointer (data.items[0], (gpointer *) &data.items[0]);
+
+        items = g_slist_prepend (NULL, data.items[0]);
+        clock_fill_queue_set_items (queue, items);
+        g_slist_free (items);
+        items = g_slist_prepend (NULL, data.items[1]);
+        clock_fill_queue_set_items (queue, items);
+        g_slist_free (items);
+
+        g_object_unref (data.items[0]);
+        g_assert_null (data.items[0]);
+
+        clock_fill_queue_start (queue);
+        run_until_done (queue);
+        g_assert_cmpstr (data.filled->str, ==, "b");
+
+        for (i = 1; i < N_ITEMS; i++)
+                g_object_unref (data.items[i]);
+
+        clock_fill_queue_free (queue);
+        g_string_free (data.filled, TRUE);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/clock-fill-queue/order", test_order);
+        g_test_add_func ("/clock-fill-queue/slices", test_slices);
+        g_test_add_func ("/clock-fill-queue/not-ready", test_not_ready);
+        g_test_add_func ("/clock-fill-queue/clear", test_clear);
+
+        return g_test_run ();
+}
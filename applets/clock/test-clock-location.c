@@ -0,0 +1,232 @@
+/* Test for the time conversions of the clock locations
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include "clock-location.h"
+#include "system-timezone.h"
+
+#define ZONEINFO_DIR "/usr/share/zoneinfo"
+
+/* with and without daylight saving time, in both hemispheres, with a
+ * half hour offset and with a half hour change */
+static const char *zones[] = {
+        "UTC",
+        "Europe/Paris",
+        "America/New_York",
+        "America/Sao_Paulo",
+        "Asia/Kolkata",
+        "Australia/Lord_Howe",
+        "Pacific/Chatham"
+};
+
+#define TEST_START 1704067200 /* 2024-01-01 00:00:00 UTC */
+
+static gboolean
+has_zoneinfo (const char *zone)
+{
+        char     *path;
+        gboolean  found;
+
+        path = g_build_filename (ZONEINFO_DIR, zone, NULL);
+        found = g_file_test (path, G_FILE_TEST_IS_REGULAR);
+        g_free (path);
+
+        return found;
+}
+
+/* What the locations did before: localtime_r() with TZ set */
+static void
+localtime_in_zone (const char *zone,
+                   time_t      t,
+                   struct tm  *tm)
+{
+        g_setenv ("TZ", zone, TRUE);
+        tzset ();
+        localtime_r (&t, tm);
+        g_unsetenv ("TZ");
+        tzset ();
+}
+
+static void
+assert_localtime (ClockLocation *loc,
+                  const char    *zone,
+                  time_t         t)
+{
+        struct tm expected;
+        struct tm tm;
+
+        localtime_in_zone (zone, t, &expected);
+        clock_location_localtime_at (loc, t, &tm);
+
+        g_assert_cmpint (tm.tm_year, ==, expected.tm_year);
+        g_assert_cmpint (tm.tm_mon, ==, expected.tm_mon);
+        g_assert_cmpint (tm.tm_mday, ==, expected.tm_mday);
+        g_assert_cmpint (tm.tm_hour, ==, expected.tm_hour);
+        g_assert_cmpint (tm.tm_min, ==, expected.tm_min);
+        g_assert_cmpint (tm.tm_sec, ==, expected.tm_sec);
+        g_assert_cmpint (tm.tm_wday, ==, expected.tm_wday);
+        g_assert_cmpint (tm.tm_yday, ==, expected.tm_yday);
+        g_assert_cmpint (tm.tm_isdst, ==, expected.tm_isdst);
+}
+
+static void
+test_localtime (gconstpointer data)
+{
+        const char    *zone = data;
+        ClockLocation *loc;
+        time_t         t;
+        int            i;
+
+        if (!has_zoneinfo (zone)) {
+                g_test_skip ("no zoneinfo for this timezone");
+                return;
+        }
+
+        loc = clock_location_new (zone, zone, zone, 0, 0, NULL, NULL);
+
+        /* every quarter of an hour over two years, which goes through
+         * all the changes of daylight saving time */
+        for (t = TEST_START; t < TEST_START + 2 * 366 * 86400; t += 15 * 60)
+                assert_localtime (loc, zone, t);
+
+        for (i = 0; i < 1000; i++)
+                assert_localtime (loc, zone,
+                                  g_test_rand_int_range (0, G_MAXINT));
+
+        g_object_unref (loc);
+}
+
+/* The zone is loaded again when the timezone of the location changes */
+static void
+test_set_timezone (void)
+{
+        ClockLocation *loc;
+        time_t         t;
+
+        if (!has_zoneinfo ("Europe/Paris") || !has_zoneinfo ("Asia/Kolkata")) {
+                g_test_skip ("no zoneinfo for the timezones");
+                return;
+        }
+
+        loc = clock_location_new ("Paris", "Paris", "Europe/Paris", 0, 0, NULL, NULL);
+        t = TEST_START + 180 * 86400;
+
+        assert_localtime (loc, "Europe/Paris", t);
+
+        clock_location_set_timezone (loc, "Asia/Kolkata");
+        assert_localtime (loc, "Asia/Kolkata", t);
+
+        g_object_unref (loc);
+}
+
+/* The zones of all the locations, including the ones sharing a
+ * timezone, are loaded again when the zoneinfo is updated */
+static void
+test_zoneinfo_changed (void)
+{
+        SystemTimezone *systz;
+        ClockLocation  *paris1;
+        ClockLocation  *paris2;
+        ClockLocation  *kolkata;
+        time_t          t;
+
+        if (!has_zoneinfo ("Europe/Paris") || !has_zoneinfo ("Asia/Kolkata")) {
+                g_test_skip ("no zoneinfo for the timezones");
+                return;
+        }
+
+        paris1 = clock_location_new ("Paris", "Paris", "Europe/Paris", 0, 0, NULL, NULL);
+        paris2 = clock_location_new ("Paris", "Paris", "Europe/Paris", 0, 0, NULL, NULL);
+        kolkata = clock_location_new ("Kolkata", "Kolkata", "Asia/Kolkata", 0, 0, NULL, NULL);
+        t = TEST_START + 180 * 86400;
+
+        systz = system_timezone_new ();
+        g_signal_emit_by_name (systz, "zoneinfo-changed");
+
+        assert_localtime (paris1, "Europe/Paris", t);
+        assert_localtime (paris2, "Europe/Paris", t);
+        assert_localtime (kolkata, "Asia/Kolkata", t);
+        g_assert_cmpint (clock_location_get_offset (paris1), ==,
+                         clock_location_get_offset (paris2));
+
+        /* the other locations are still reloaded once one is gone */
+        g_object_unref (paris1);
+        g_signal_emit_by_name (systz, "zoneinfo-changed");
+
+        assert_localtime (paris2, "Europe/Paris", t);
+        assert_localtime (kolkata, "Asia/Kolkata", t);
+
+        g_object_unref (paris2);
+        g_object_unref (kolkata);
+        g_object_unref (systz);
+}
+
+static void
+test_tzname (void)
+{
+        ClockLocation *loc;
+        struct tm      tm;
+        time_t         t;
+        char           expected[64];
+
+        if (!has_zoneinfo ("America/New_York")) {
+                g_test_skip ("no zoneinfo for this timezone");
+                return;
+        }
+
+        loc = clock_location_new ("New York", "New York", "America/New_York",
+                                  0, 0, NULL, NULL);
+
+        /* the abbreviation follows daylight saving time */
+        t = time (NULL);
+        g_setenv ("TZ", "America/New_York", TRUE);
+        tzset ();
+        localtime_r (&t, &tm);
+        strftime (expected, sizeof (expected), "%Z", &tm);
+        g_unsetenv ("TZ");
+        tzset ();
+
+        g_assert_cmpstr (clock_location_get_tzname (loc), ==, expected);
+
+        g_object_unref (loc);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        guint i;
+
+        g_test_init (&argc, &argv, NULL);
+
+        for (i = 0; i < G_N_ELEMENTS (zones); i++) {
+                char *path;
+
+                path = g_strdup_printf ("/clock-location/localtime/%s", zones[i]);
+                g_test_add_data_func (path, zones[i], test_localtime);
+                g_free (path);
+        }
+
+        g_test_add_func ("/clock-location/set-timezone", test_set_timezone);
+        g_test_add_func ("/clock-location/zoneinfo-changed", test_zoneinfo_changed);
+        g_test_add_func ("/clock-location/tzname", test_tzname);
+
+        return g_test_run ();
+}
@@ -0,0 +1,183 @@
+/* Test for the scheduler shared by the clocks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include "clock-scheduler.h"
+
+typedef struct {
+        GString *calls;
+        guint    id_to_remove;
+} TestData;
+
+typedef struct {
+        TestData *data;
+        char      name;
+} TestEntry;
+
+static void
+record_call (gpointer user_data)
+{
+        TestEntry *entry = user_data;
+
+        g_string_append_c (entry->data->calls, entry->name);
+}
+
+static void
+remove_entry (gpointer user_data)
+{
+        TestData *data = user_data;
+
+        g_string_append_c (data->calls, 'r');
+        clock_scheduler_remove (data->id_to_remove);
+}
+
+static void
+quit_loop (gpointer user_data)
+{
+        g_main_loop_quit (user_data);
+}
+
+static int
+compare_chars (gconstpointer a,
+               gconstpointer b,
+               gpointer      user_data)
+{
+        return *(const char *) a - *(const char *) b;
+}
+
+/* The calls made in one dispatch, in no particular order */
+static void
+assert_calls (GString    *calls,
+              const char *expected)
+{
+        char *sorted;
+
+        sorted = g_strdup (calls->str);
+        g_qsort_with_data (sorted, calls->len, 1,
+                           compare_chars, NULL);
+        g_assert_cmpstr (sorted, ==, expected);
+        g_free (sorted);
+
+        g_string_truncate (calls, 0);
+}
+
+static void
+test_next_boundary (void)
+{
+        g_assert_cmpint (clock_scheduler_next_boundary (0, CLOCK_SCHEDULER_MINUTE),
+                         ==, CLOCK_SCHEDULER_MINUTE);
+        g_assert_cmpint (clock_scheduler_next_boundary (1, CLOCK_SCHEDULER_MINUTE),
+                         ==, CLOCK_SCHEDULER_MINUTE);
+        /* a time on a boundary goes to the next one */
+        g_assert_cmpint (clock_scheduler_next_boundary (CLOCK_SCHEDULER_MINUTE, CLOCK_SCHEDULER_MINUTE),
+                         ==, 2 * CLOCK_SCHEDULER_MINUTE);
+        g_assert_cmpint (clock_scheduler_next_boundary (59 * G_USEC_PER_SEC + 999999, G_USEC_PER_SEC),
+                         ==, 60 * G_USEC_PER_SEC);
+}
+
+/* Entries due at the same time are run in one go, and an entry can
+ * remove another one from its callback */
+static void
+test_dispatch (void)
+{
+        GMainLoop *loop;
+        TestData   data;
+        TestEntry  a, b, c;
+        gint64     deadline;
+        guint      id;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        data.calls = g_string_new (NULL);
+
+        a.data = b.data = c.data = &data;
+        a.name = 'a';
+        b.name = 'b';
+        c.name = 'c';
+
+        deadline = g_get_real_time () + 50 * 1000;
+
+        clock_scheduler_add (deadline, record_call, &a);
+        clock_scheduler_add (deadline, remove_entry, &data);
+        data.id_to_remove = clock_scheduler_add (deadline + 20 * 1000, record_call, &b);
+        clock_scheduler_add (deadline, quit_loop, loop);
+
+        g_main_loop_run (loop);
+        assert_calls (data.calls, "ar");
+
+        id = clock_scheduler_add (deadline + 100 * 1000, record_call, &c);
+        clock_scheduler_add (deadline + 100 * 1000, quit_loop, loop);
+
+        g_main_loop_run (loop);
+        assert_calls (data.calls, "c");
+
+        /* removing an entry which already ran does nothing */
+        clock_scheduler_remove (id);
+
+        g_string_free (data.calls, TRUE);
+        g_main_loop_unref (loop);
+}
+
+/* When the time of the system is set, the entries in wall-clock time
+ * are run at once and the ones added with a delay are not */
+static void
+test_time_changed (void)
+{
+        GMainLoop *loop;
+        TestData   data;
+        TestEntry  clock, weather;
+        guint      weather_id;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        data.calls = g_string_new (NULL);
+
+        clock.data = weather.data = &data;
+        clock.name = 'c';
+        weather.name = 'w';
+
+        clock_scheduler_add (g_get_real_time () + 3600 * G_USEC_PER_SEC,
+                             record_call, &clock);
+        weather_id = clock_scheduler_add_delay (3600 * G_USEC_PER_SEC,
+                                                record_call, &weather);
+        clock_scheduler_add (g_get_real_time () + 3600 * G_USEC_PER_SEC,
+                             quit_loop, loop);
+
+        clock_scheduler_time_changed ();
+        /* twice in a row only runs the clocks once */
+        clock_scheduler_time_changed ();
+
+        g_main_loop_run (loop);
+
+        assert_calls (data.calls, "c");
+
+        clock_scheduler_remove (weather_id);
+
+        g_string_free (data.calls, TRUE);
+        g_main_loop_unref (loop);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/clock-scheduler/next-boundary", test_next_boundary);
+        g_test_add_func ("/clock-scheduler/dispatch", test_dispatch);
+        g_test_add_func ("/clock-scheduler/time-changed", test_time_changed);
+
+        return g_test_run ();
+}
@@ -0,0 +1,171 @@
+/* Test for the compiled strftime() formats of the clock
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <time.h>
+#include <glib.h>
+#include "clock-time-format.h"
+
+static const char *formats[] = {
+        "%H:%M",
+        "%H:%M:%S",
+        "%l:%M:%S %p",
+        "%a %b %e, %H:%M:%S",
+        "%A %d %B %Y",
+        "%T",
+        "%R",
+        "%c",
+        "%x %X",
+        "%s",
+        "%H:%M %Z %z",
+        "%j %U %W %V %G %u %w",
+        "%-I:%M:%S",
+        "%_H%3S",
+        "%%H%n%t%M",
+        "%EY %OS",
+        /* longer than the buffer first tried for a conversion */
+        "%200S:%M",
+        "time: "
+};
+
+/* Europe/Paris, without needing the timezone database: the clocks go
+ * forward on 2024-03-31 at 01:00 UTC */
+#define TEST_TZ "CET-1CEST,M3.5.0,M10.5.0/3"
+#define TEST_START 1711839480 /* 2024-03-30 22:58:00 UTC */
+
+/* the same offsets as TEST_TZ under other names, and another offset */
+#define TEST_TZ_RENAMED "MET-1MEST,M3.5.0,M10.5.0/3"
+#define TEST_TZ_MOVED "EST5EDT,M3.2.0,M11.1.0"
+
+static void
+set_timezone (const char *tz)
+{
+        g_setenv ("TZ", tz, TRUE);
+        tzset ();
+}
+
+/* Renders @format at @t with the compiled format and with a plain
+ * strftime() of the whole format */
+static void
+assert_render (ClockTimeFormat *compiled,
+               const char      *format,
+               time_t           t)
+{
+        struct tm  tm;
+        char       buf[256];
+        gsize      len;
+        char      *expected;
+
+        localtime_r (&t, &tm);
+
+        len = strftime (buf, sizeof (buf), format, &tm);
+        buf[len] = '\0';
+        expected = len == 0 ? g_strdup ("???")
+                            : g_locale_to_utf8 (buf, -1, NULL, NULL, NULL);
+
+        g_assert_cmpstr (clock_time_format_render (compiled, &tm), ==, expected);
+
+        g_free (expected);
+}
+
+static void
+test_format (gconstpointer data)
+{
+        const char      *format = data;
+        ClockTimeFormat *compiled;
+        time_t           t;
+        int              i;
+
+        compiled = clock_time_format_new (format);
+
+        /* every second over the change of day and the one of daylight
+         * saving time */
+        for (t = TEST_START; t < TEST_START + 3 * 3600; t++)
+                assert_render (compiled, format, t);
+
+        /* the same time twice */
+        assert_render (compiled, format, t);
+        assert_render (compiled, format, t);
+
+        /* jumps forward and backward, as when the system time is set */
+        for (i = 0; i < 1000; i++) {
+                t = TEST_START + g_test_rand_int_range (-400 * 86400, 400 * 86400);
+                assert_render (compiled, format, t);
+        }
+
+        clock_time_format_free (compiled);
+}
+
+/* The labels follow a change of the timezone of the system, even when
+ * only the name of the zone changes */
+static void
+test_zone_change (gconstpointer data)
+{
+        const char      *format = data;
+        ClockTimeFormat *compiled;
+        time_t           t;
+
+#if !defined (HAVE_STRUCT_TM_TM_GMTOFF) || !defined (HAVE_STRUCT_TM_TM_ZONE)
+        g_test_skip ("struct tm has no timezone");
+        return;
+#endif
+
+        compiled = clock_time_format_new (format);
+
+        for (t = TEST_START; t < TEST_START + 3 * 3600; t += 15 * 60) {
+                assert_render (compiled, format, t);
+
+                set_timezone (TEST_TZ_RENAMED);
+                assert_render (compiled, format, t);
+
+                set_timezone (TEST_TZ_MOVED);
+                assert_render (compiled, format, t);
+
+                set_timezone (TEST_TZ);
+        }
+
+        clock_time_format_free (compiled);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        guint i;
+
+        set_timezone (TEST_TZ);
+
+        g_test_init (&argc, &argv, NULL);
+
+        for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+                char *path;
+
+                path = g_strdup_printf ("/clock-time-format/render/%u", i);
+                g_test_add_data_func (path, formats[i], test_format);
+                g_free (path);
+
+                path = g_strdup_printf ("/clock-time-format/zone-change/%u", i);
+                g_test_add_data_func (path, formats[i], test_zone_change);
+                g_free (path);
+        }
+
+        return g_test_run ();
+}
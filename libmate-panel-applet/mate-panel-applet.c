@@ -29,14 +29,18 @@
 #endif
 
 #include <unistd.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <glib/gi18n-lib.h>
 #include <cairo.h>
 #include <gdk/gdk.h>
 #include <gdk/gdkkeysyms.h>
 #include <gtk/gtk.h>
+#include <gio/gunixfdlist.h>
 
 #ifdef HAVE_X11
 #include <cairo-xlib.h>
@@ -73,6 +77,11 @@ typedef struct {
 	guint              size;
 	char              *background;
 
+	/* the panel background image shared by the panel, mapped read-only */
+	cairo_surface_t   *background_image;
+	dev_t              background_image_dev;
+	ino_t              background_image_ino;
+
 	int                previous_width;
 	int                previous_height;
 
@@ -857,6 +866,7 @@ mate_panel_applet_finalize (GObject *object)
 	g_clear_pointer (&priv->size_hints, g_free);
 	g_clear_pointer (&priv->prefs_path, g_free);
 	g_clear_pointer (&priv->background, g_free);
+	g_clear_pointer (&priv->background_image, cairo_surface_destroy);
 	g_clear_pointer (&priv->id, g_free);
 
 	/* closure is owned by the factory */
@@ -1468,6 +1478,25 @@ mate_panel_applet_handle_background_string (MatePanelApplet  *applet,
 		{ /* not using X11 */
 			g_warning("Received pixmap background type, which is only supported on X11");
 		}
+	} else if (elements [0] && !strcmp (elements [0], "image")) {
+		cairo_matrix_t matrix;
+		int            x, y;
+
+		g_return_val_if_fail (pattern != NULL, PANEL_NO_BACKGROUND);
+
+		if (!priv->background_image || !elements [1] ||
+		    sscanf (elements [1], "%d,%d", &x, &y) != 2) {
+			g_warning ("Incomplete '%s' background type received", elements [0]);
+			g_strfreev (elements);
+			return PANEL_NO_BACKGROUND;
+		}
+
+		/* no copy: the applet draws straight from the shared image */
+		*pattern = cairo_pattern_create_for_surface (priv->background_image);
+		cairo_matrix_init_translate (&matrix, x, y);
+		cairo_pattern_set_matrix (*pattern, &matrix);
+
+		retval = PANEL_PIXMAP_BACKGROUND;
 	} else
 		g_warning ("Unknown background type received");
 
@@ -1509,6 +1538,10 @@ mate_panel_applet_set_background_string (MatePanelApplet *applet,
 
 	g_free (priv->background);
 	priv->background = background ? g_strdup (background) : NULL;
+
+	if (!priv->background || !g_str_has_prefix (priv->background, "image:"))
+		g_clear_pointer (&priv->background_image, cairo_surface_destroy);
+
 	mate_panel_applet_handle_background (applet);
 
 	g_object_notify (G_OBJECT (applet), "background");
@@ -2176,6 +2209,220 @@ button_press_event_new (MatePanelApplet *applet,
   return event;
 }
 
+static GDBusNodeInfo *introspection_data = NULL;
+
+static void
+mate_panel_applet_set_dbus_property (MatePanelApplet *applet,
+				     const gchar     *property_name,
+				     GVariant        *value)
+{
+	if (g_strcmp0 (property_name, "PrefsPath") == 0) {
+		mate_panel_applet_set_preferences_path (applet, g_variant_get_string (value, NULL));
+	} else if (g_strcmp0 (property_name, "Orient") == 0) {
+		mate_panel_applet_set_orient (applet, g_variant_get_uint32 (value));
+	} else if (g_strcmp0 (property_name, "Size") == 0) {
+		mate_panel_applet_set_size (applet, g_variant_get_uint32 (value));
+	} else if (g_strcmp0 (property_name, "Background") == 0) {
+		mate_panel_applet_set_background_string (applet, g_variant_get_string (value, NULL));
+	} else if (g_strcmp0 (property_name, "Flags") == 0) {
+		mate_panel_applet_set_flags (applet, g_variant_get_uint32 (value));
+	} else if (g_strcmp0 (property_name, "SizeHints") == 0) {
+		const int *size_hints;
+		gsize      n_elements;
+
+		size_hints = g_variant_get_fixed_array (value, &n_elements, sizeof (gint32));
+		mate_panel_applet_set_size_hints (applet, size_hints, n_elements, 0);
+	} else if (g_strcmp0 (property_name, "Locked") == 0) {
+		mate_panel_applet_set_locked (applet, g_variant_get_boolean (value));
+	} else if (g_strcmp0 (property_name, "LockedDown") == 0) {
+		mate_panel_applet_set_locked_down (applet, g_variant_get_boolean (value));
+	}
+}
+
+/* The panel sends all the properties that changed during a main loop
+ * iteration (typically orient, size and background when the panel is
+ * moved) in a single SetProperties call instead of one
+ * org.freedesktop.DBus.Properties.Set round trip each. */
+static void
+mate_panel_applet_set_dbus_properties (MatePanelApplet       *applet,
+				       GVariant              *properties,
+				       GDBusMethodInvocation *invocation)
+{
+	GDBusInterfaceInfo *interface_info;
+	GVariantIter        iter;
+	const gchar        *property_name;
+	GVariant           *value;
+
+	interface_info = introspection_data->interfaces[0];
+
+	/* validate everything first, so that nothing is applied on error */
+	g_variant_iter_init (&iter, properties);
+	while (g_variant_iter_next (&iter, "{&sv}", &property_name, &value)) {
+		GDBusPropertyInfo *property_info;
+		gboolean           valid;
+
+		property_info = g_dbus_interface_info_lookup_property (interface_info, property_name);
+		valid = (property_info != NULL &&
+			 (property_info->flags & G_DBUS_PROPERTY_INFO_FLAGS_WRITABLE) &&
+			 g_variant_is_of_type (value, G_VARIANT_TYPE (property_info->signature)));
+		g_variant_unref (value);
+
+		if (!valid) {
+			g_dbus_method_invocation_return_error (invocation,
+							       G_DBUS_ERROR,
+							       G_DBUS_ERROR_INVALID_ARGS,
+							       "Invalid property %s", property_name);
+			return;
+		}
+	}
+
+	g_variant_iter_init (&iter, properties);
+	while (g_variant_iter_next (&iter, "{&sv}", &property_name, &value)) {
+		mate_panel_applet_set_dbus_property (applet, property_name, value);
+		g_variant_unref (value);
+	}
+
+	g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+typedef struct {
+	gpointer data;
+	gsize    size;
+} MatePanelAppletImageMapping;
+
+static const cairo_user_data_key_t image_mapping_key;
+
+static void
+mate_panel_applet_image_mapping_free (MatePanelAppletImageMapping *mapping)
+{
+	munmap (mapping->data, mapping->size);
+	g_free (mapping);
+}
+
+static cairo_surface_t *
+mate_panel_applet_map_background_image (int fd,
+					int width,
+					int height,
+					int stride,
+					gsize file_size)
+{
+	MatePanelAppletImageMapping *mapping;
+	cairo_surface_t             *surface;
+	gsize                        size;
+	gpointer                     data;
+
+	if (width <= 0 || height <= 0 ||
+	    stride < cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width))
+		return NULL;
+
+	size = (gsize) stride * height;
+	if (file_size < size)
+		return NULL;
+
+	data = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	/* cairo only reads from source surfaces */
+	surface = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
+						       width, height, stride);
+
+	mapping = g_new (MatePanelAppletImageMapping, 1);
+	mapping->data = data;
+	mapping->size = size;
+
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS ||
+	    cairo_surface_set_user_data (surface, &image_mapping_key, mapping,
+					 (cairo_destroy_func_t) mate_panel_applet_image_mapping_free) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy (surface);
+		mate_panel_applet_image_mapping_free (mapping);
+		return NULL;
+	}
+
+	return surface;
+}
+
+/* The panel hands over its background as an image in a memory file
+ * instead of an X pixmap: the image is mapped once, and every background
+ * pattern is drawn straight from it. This works on Wayland too. */
+static void
+mate_panel_applet_set_background_image (MatePanelApplet       *applet,
+					GVariant              *parameters,
+					GDBusMethodInvocation *invocation)
+{
+	MatePanelAppletPrivate *priv;
+	GUnixFDList            *fd_list;
+	struct stat             buf;
+	gint32                  handle;
+	int                     width, height, stride;
+	int                     x, y;
+	int                     fd;
+	gchar                  *background;
+	GError                 *error = NULL;
+
+	priv = mate_panel_applet_get_instance_private (applet);
+
+	g_variant_get (parameters, "(hiiiii)", &handle, &width, &height, &stride, &x, &y);
+
+	fd_list = g_dbus_message_get_unix_fd_list (g_dbus_method_invocation_get_message (invocation));
+	if (!fd_list) {
+		g_dbus_method_invocation_return_error (invocation,
+						       G_DBUS_ERROR,
+						       G_DBUS_ERROR_INVALID_ARGS,
+						       "No file descriptor received");
+		return;
+	}
+
+	fd = g_unix_fd_list_get (fd_list, handle, &error);
+	if (fd < 0) {
+		g_dbus_method_invocation_take_error (invocation, error);
+		return;
+	}
+
+	if (fstat (fd, &buf) != 0) {
+		close (fd);
+		g_dbus_method_invocation_return_error (invocation,
+						       G_DBUS_ERROR,
+						       G_DBUS_ERROR_INVALID_ARGS,
+						       "Invalid file descriptor received");
+		return;
+	}
+
+	/* the panel sends the same image again when the applet only moved */
+	if (!priv->background_image ||
+	    priv->background_image_dev != buf.st_dev ||
+	    priv->background_image_ino != buf.st_ino) {
+		cairo_surface_t *surface;
+
+		surface = mate_panel_applet_map_background_image (fd, width, height, stride,
+								  buf.st_size);
+		if (!surface) {
+			close (fd);
+			g_dbus_method_invocation_return_error (invocation,
+							       G_DBUS_ERROR,
+							       G_DBUS_ERROR_INVALID_ARGS,
+							       "Invalid background image received");
+			return;
+		}
+
+		g_clear_pointer (&priv->background_image, cairo_surface_destroy);
+		priv->background_image = surface;
+		priv->background_image_dev = buf.st_dev;
+		priv->background_image_ino = buf.st_ino;
+
+		/* make sure the new image is used even if the position
+		 * did not change */
+		g_clear_pointer (&priv->background, g_free);
+	}
+	close (fd);
+
+	background = g_strdup_printf ("image:%d,%d", x, y);
+	mate_panel_applet_set_background_string (applet, background);
+	g_free (background);
+
+	g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
 static void
 method_call_cb (GDBusConnection       *connection,
                 const gchar           *sender,
@@ -2199,6 +2446,14 @@ method_call_cb (GDBusConnection       *connection,
 		gdk_event_free (event);
 
 		g_dbus_method_invocation_return_value (invocation, NULL);
+	} else if (g_strcmp0 (method_name, "SetProperties") == 0) {
+		GVariant *properties;
+
+		g_variant_get (parameters, "(@a{sv})", &properties);
+		mate_panel_applet_set_dbus_properties (applet, properties, invocation);
+		g_variant_unref (properties);
+	} else if (g_strcmp0 (method_name, "SetBackgroundImage") == 0) {
+		mate_panel_applet_set_background_image (applet, parameters, invocation);
 	}
 }
 
@@ -2255,29 +2510,7 @@ set_property_cb (GDBusConnection *connection,
 		 GError         **error,
 		 gpointer         user_data)
 {
-	MatePanelApplet *applet = MATE_PANEL_APPLET (user_data);
-
-	if (g_strcmp0 (property_name, "PrefsPath") == 0) {
-		mate_panel_applet_set_preferences_path (applet, g_variant_get_string (value, NULL));
-	} else if (g_strcmp0 (property_name, "Orient") == 0) {
-		mate_panel_applet_set_orient (applet, g_variant_get_uint32 (value));
-	} else if (g_strcmp0 (property_name, "Size") == 0) {
-		mate_panel_applet_set_size (applet, g_variant_get_uint32 (value));
-	} else if (g_strcmp0 (property_name, "Background") == 0) {
-		mate_panel_applet_set_background_string (applet, g_variant_get_string (value, NULL));
-	} else if (g_strcmp0 (property_name, "Flags") == 0) {
-		mate_panel_applet_set_flags (applet, g_variant_get_uint32 (value));
-	} else if (g_strcmp0 (property_name, "SizeHints") == 0) {
-		const int *size_hints;
-		gsize      n_elements;
-
-		size_hints = g_variant_get_fixed_array (value, &n_elements, sizeof (gint32));
-		mate_panel_applet_set_size_hints (applet, size_hints, n_elements, 0);
-	} else if (g_strcmp0 (property_name, "Locked") == 0) {
-		mate_panel_applet_set_locked (applet, g_variant_get_boolean (value));
-	} else if (g_strcmp0 (property_name, "LockedDown") == 0) {
-		mate_panel_applet_set_locked_down (applet, g_variant_get_boolean (value));
-	}
+	mate_panel_applet_set_dbus_property (MATE_PANEL_APPLET (user_data), property_name, value);
 
 	return TRUE;
 }
@@ -2289,6 +2522,17 @@ static const gchar introspection_xml[] =
 	      "<arg name='button' type='u' direction='in'/>"
 	      "<arg name='time' type='u' direction='in'/>"
 	    "</method>"
+	    "<method name='SetProperties'>"
+	      "<arg name='properties' type='a{sv}' direction='in'/>"
+	    "</method>"
+	    "<method name='SetBackgroundImage'>"
+	      "<arg name='fd' type='h' direction='in'/>"
+	      "<arg name='width' type='i' direction='in'/>"
+	      "<arg name='height' type='i' direction='in'/>"
+	      "<arg name='stride' type='i' direction='in'/>"
+	      "<arg name='x' type='i' direction='in'/>"
+	      "<arg name='y' type='i' direction='in'/>"
+	    "</method>"
 	    "<property name='PrefsPath' type='s' access='readwrite'/>"
 	    "<property name='Orient' type='u' access='readwrite' />"
 	    "<property name='Size' type='u' access='readwrite'/>"
@@ -2311,8 +2555,6 @@ static const GDBusInterfaceVTable interface_vtable = {
 	{ 0 }
 };
 
-static GDBusNodeInfo *introspection_data = NULL;
-
 static void
 mate_panel_applet_register_object (MatePanelApplet *applet)
 {
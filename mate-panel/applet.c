@@ -24,6 +24,7 @@
 #include "panel-addto.h"
 #include "panel-config-global.h"
 #include "panel-applet-frame.h"
+#include "panel-applet-load-queue.h"
 #include "panel-action-button.h"
 #include "panel-menu-bar.h"
 #include "panel-separator.h"
@@ -36,12 +37,19 @@
 #include "panel-lockdown.h"
 #include "panel-schemas.h"
 
-static GSList *registered_applets = NULL;
+/* the registered applets, in registration order; each AppletInfo keeps
+ * its own links so that it is unregistered without walking the lists */
+static GQueue      registered_applets = G_QUEUE_INIT;
+/* id -> GQueue of AppletInfo, in registration order */
+static GHashTable *registered_applets_by_id = NULL;
+/* PanelObjectType -> GQueue of AppletInfo, in registration order */
+static GHashTable *registered_applets_by_type = NULL;
 static GSList *queued_position_saves = NULL;
 static guint   queued_position_source = 0;
 
 static GtkCheckMenuItem *checkbox_id = NULL;
 
+static void mate_panel_applet_unregister (AppletInfo *info);
 static void applet_menu_show (GtkWidget *w, AppletInfo *info);
 static void applet_menu_deactivate (GtkWidget *w, AppletInfo *info);
 
@@ -722,7 +730,9 @@ mate_panel_applet_destroy (GtkWidget  *widget,
 		info->settings = NULL;
 	}
 
-	registered_applets = g_slist_remove (registered_applets, info);
+	mate_panel_applet_unregister (info);
+
+	g_object_set_data (G_OBJECT (widget), "applet_info", NULL);
 
 	queued_position_saves =
 		g_slist_remove (queued_position_saves, info);
@@ -763,19 +773,10 @@ mate_panel_applet_destroy (GtkWidget  *widget,
 	g_free (info);
 }
 
-typedef struct {
-	char                      *id;
-	PanelObjectType            type;
-	char                      *toplevel_id;
-	int                        position;
-	PanelObjectEdgeRelativity  edge_relativity;
-	guint                      locked : 1;
-} MatePanelAppletToLoad;
-
-/* Each time those lists get both empty,
+/* Each time this and the load queue are both empty,
  * mate_panel_applet_queue_initial_unhide_toplevels() should be called */
-static GSList  *mate_panel_applets_to_load = NULL;
-static GSList  *mate_panel_applets_loading = NULL;
+/* applet id -> MatePanelAppletToLoad */
+static GHashTable *mate_panel_applets_loading = NULL;
 /* We have a timeout to always unhide toplevels after a delay, in case of some
  * blocking applet */
 #define         UNHIDE_TOPLEVELS_TIMEOUT_SECONDS 5
@@ -783,29 +784,58 @@ static guint    mate_panel_applet_unhide_toplevels_timeout = 0;
 
 static gboolean mate_panel_applet_have_load_idle = FALSE;
 
+/* During the initial load, the activations of out-of-process applets are
+ * issued back to back, with at most this many of them in flight. 0 means
+ * that objects are loaded one per idle iteration. */
+static guint    mate_panel_applet_activation_limit = 0;
+static guint    mate_panel_applets_activating = 0;
+static gint64   mate_panel_applets_load_start_time = 0;
+
 static void
-free_applet_to_load (MatePanelAppletToLoad *applet)
+mate_panel_applet_ensure_loading_table (void)
+{
+	if (mate_panel_applets_loading)
+		return;
+
+	mate_panel_applets_loading =
+		g_hash_table_new_full (g_str_hash, g_str_equal,
+				       NULL,
+				       (GDestroyNotify) mate_panel_applet_to_load_free);
+}
+
+static gboolean
+mate_panel_applet_to_load_is_empty (void)
+{
+	return mate_panel_applet_load_queue_is_empty ();
+}
+
+static gboolean
+mate_panel_applet_loading_is_empty (void)
 {
-	g_free (applet->id);
-	g_free (applet->toplevel_id);
-	g_free (applet);
+	return mate_panel_applets_loading == NULL ||
+	       g_hash_table_size (mate_panel_applets_loading) == 0;
 }
 
 gboolean
 mate_panel_applet_on_load_queue (const char *id)
 {
-	GSList *li;
-	for (li = mate_panel_applets_to_load; li != NULL; li = li->next) {
-		MatePanelAppletToLoad *applet = li->data;
-		if (strcmp (applet->id, id) == 0)
-			return TRUE;
-	}
-	for (li = mate_panel_applets_loading; li != NULL; li = li->next) {
-		MatePanelAppletToLoad *applet = li->data;
-		if (strcmp (applet->id, id) == 0)
-			return TRUE;
-	}
-	return FALSE;
+	if (mate_panel_applet_load_queue_contains (id))
+		return TRUE;
+
+	return mate_panel_applets_loading != NULL &&
+	       g_hash_table_contains (mate_panel_applets_loading, id);
+}
+
+static void
+mate_panel_applet_log_load_time (MatePanelAppletToLoad *applet)
+{
+	if (applet->load_start_time <= 0)
+		return;
+
+	g_debug ("Loaded object '%s' in %" G_GINT64_FORMAT " ms (%u in flight)",
+		 applet->id,
+		 (g_get_monotonic_time () - applet->load_start_time) / G_TIME_SPAN_MILLISECOND,
+		 mate_panel_applets_activating);
 }
 
 /* This doesn't do anything if the initial unhide already happened */
@@ -819,67 +849,110 @@ mate_panel_applet_queue_initial_unhide_toplevels (gpointer user_data)
 		mate_panel_applet_unhide_toplevels_timeout = 0;
 	}
 
+	if (mate_panel_applets_load_start_time > 0) {
+		g_debug ("Initial load of panel objects %s after %" G_GINT64_FORMAT " ms",
+			 user_data ? "timed out" : "done",
+			 (g_get_monotonic_time () - mate_panel_applets_load_start_time) / G_TIME_SPAN_MILLISECOND);
+		mate_panel_applets_load_start_time = 0;
+	}
+
 	for (l = panel_toplevel_list_toplevels (); l != NULL; l = l->next)
 		panel_toplevel_queue_initial_unhide ((PanelToplevel *) l->data);
 
 	return FALSE;
 }
 
+static void
+mate_panel_applet_schedule_unhide_timeout (void)
+{
+	if (mate_panel_applet_unhide_toplevels_timeout != 0)
+		g_source_remove (mate_panel_applet_unhide_toplevels_timeout);
+
+	mate_panel_applet_unhide_toplevels_timeout =
+		g_timeout_add_seconds (UNHIDE_TOPLEVELS_TIMEOUT_SECONDS,
+				       mate_panel_applet_queue_initial_unhide_toplevels,
+				       GINT_TO_POINTER (TRUE));
+}
+
+static gboolean mate_panel_applet_load_idle_handler (gpointer dummy);
+
 void
 mate_panel_applet_stop_loading (const char *id)
 {
-	MatePanelAppletToLoad *applet;
-	GSList *l;
-
-	for (l = mate_panel_applets_loading; l; l = l->next) {
-		applet = l->data;
+	MatePanelAppletToLoad *applet = NULL;
+	gboolean               was_activating = FALSE;
 
-		if (strcmp (applet->id, id) == 0)
-			break;
-	}
+	if (mate_panel_applets_loading)
+		applet = g_hash_table_lookup (mate_panel_applets_loading, id);
 
-	/* this can happen if we reload an applet after it crashed,
+	/* this can fail if we reload an applet after it crashed,
 	 * for example */
-	if (l != NULL) {
-		mate_panel_applets_loading = g_slist_delete_link (mate_panel_applets_loading, l);
-		free_applet_to_load (applet);
+	if (applet) {
+		if (applet->type == PANEL_OBJECT_APPLET &&
+		    mate_panel_applets_activating > 0) {
+			mate_panel_applets_activating--;
+			was_activating = TRUE;
+		}
+
+		mate_panel_applet_log_load_time (applet);
+		g_hash_table_remove (mate_panel_applets_loading, id);
 	}
 
-	if (mate_panel_applets_loading == NULL && mate_panel_applets_to_load == NULL)
+	if (mate_panel_applet_loading_is_empty () && mate_panel_applet_to_load_is_empty ()) {
+		mate_panel_applet_activation_limit = 0;
 		mate_panel_applet_queue_initial_unhide_toplevels (NULL);
+		return;
+	}
+
+	if (!was_activating)
+		return;
+
+	/* The toplevels are unhidden once all the applets are in; the
+	 * timeout only protects against applets that never answer, so
+	 * push it back as long as activations keep completing */
+	if (mate_panel_applet_activation_limit > 0 &&
+	    mate_panel_applet_unhide_toplevels_timeout != 0)
+		mate_panel_applet_schedule_unhide_timeout ();
+
+	/* an activation slot got freed: resume the paused queue */
+	if (!mate_panel_applet_have_load_idle && !mate_panel_applet_to_load_is_empty ()) {
+		g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+				 mate_panel_applet_load_idle_handler,
+				 NULL, NULL);
+		mate_panel_applet_have_load_idle = TRUE;
+	}
+}
+
+static gpointer
+mate_panel_applet_lookup_toplevel (const char *toplevel_id,
+				   gpointer    user_data)
+{
+	return panel_profile_get_toplevel_by_id (toplevel_id);
 }
 
+/* Starts loading the next queued object. Returns FALSE if there is
+ * nothing left that can be loaded. */
 static gboolean
-mate_panel_applet_load_idle_handler (gpointer dummy)
+mate_panel_applet_load_next (PanelObjectType *loaded_type)
 {
 	PanelObjectType    applet_type;
-	MatePanelAppletToLoad *applet = NULL;
-	PanelToplevel     *toplevel = NULL;
+	MatePanelAppletToLoad *applet;
+	gpointer           toplevel;
 	PanelWidget       *panel_widget;
-	GSList            *l;
 
-	if (!mate_panel_applets_to_load) {
+	if (mate_panel_applet_to_load_is_empty ()) {
 		mate_panel_applet_have_load_idle = FALSE;
 		return FALSE;
 	}
 
-	for (l = mate_panel_applets_to_load; l; l = l->next) {
-		applet = l->data;
+	applet = mate_panel_applet_load_queue_pop (mate_panel_applet_lookup_toplevel,
+						   NULL, &toplevel);
 
-		toplevel = panel_profile_get_toplevel_by_id (applet->toplevel_id);
-		if (toplevel)
-			break;
-	}
-
-	if (!l) {
+	if (!applet) {
 		/* All the remaining applets don't have a panel */
-		for (l = mate_panel_applets_to_load; l; l = l->next)
-			free_applet_to_load (l->data);
-		g_slist_free (mate_panel_applets_to_load);
-		mate_panel_applets_to_load = NULL;
 		mate_panel_applet_have_load_idle = FALSE;
 
-		if (mate_panel_applets_loading == NULL) {
+		if (mate_panel_applet_loading_is_empty ()) {
 			/* unhide any potential initially hidden toplevel */
 			mate_panel_applet_queue_initial_unhide_toplevels (NULL);
 		}
@@ -887,10 +960,22 @@ mate_panel_applet_load_idle_handler (gpointer dummy)
 		return FALSE;
 	}
 
-	mate_panel_applets_to_load = g_slist_delete_link (mate_panel_applets_to_load, l);
-	mate_panel_applets_loading = g_slist_append (mate_panel_applets_loading, applet);
+	if (applet->type == PANEL_OBJECT_APPLET) {
+		MatePanelAppletToLoad *previous;
+
+		/* replaced below, without a call to stop_loading() */
+		previous = g_hash_table_lookup (mate_panel_applets_loading, applet->id);
+		if (previous && previous->type == PANEL_OBJECT_APPLET &&
+		    mate_panel_applets_activating > 0)
+			mate_panel_applets_activating--;
+
+		mate_panel_applets_activating++;
+	}
 
-	panel_widget = panel_toplevel_get_panel_widget (toplevel);
+	applet->load_start_time = g_get_monotonic_time ();
+	g_hash_table_replace (mate_panel_applets_loading, applet->id, applet);
+
+	panel_widget = panel_toplevel_get_panel_widget (PANEL_TOPLEVEL (toplevel));
 
 	if (applet->edge_relativity == PANEL_EDGE_CENTER ||
 	    applet->edge_relativity == PANEL_EDGE_END) {
@@ -911,6 +996,7 @@ mate_panel_applet_load_idle_handler (gpointer dummy)
 	 * variable. So we save the type to be sure we always ignore the
 	 * applets. */
 	applet_type = applet->type;
+	*loaded_type = applet_type;
 
 	switch (applet_type) {
 	case PANEL_OBJECT_APPLET:
@@ -973,6 +1059,32 @@ mate_panel_applet_load_idle_handler (gpointer dummy)
 	return TRUE;
 }
 
+static gboolean
+mate_panel_applet_load_idle_handler (gpointer dummy)
+{
+	PanelObjectType type;
+
+	/* Out-of-process applets are activated asynchronously, and get
+	 * placed on their panel when they answer: keep issuing them in
+	 * this iteration while there are free activation slots */
+	do {
+		if (!mate_panel_applet_load_next (&type))
+			return FALSE;
+	} while (mate_panel_applet_activation_limit > 0 &&
+		 type == PANEL_OBJECT_APPLET &&
+		 mate_panel_applets_activating < mate_panel_applet_activation_limit &&
+		 !mate_panel_applet_to_load_is_empty ());
+
+	if (mate_panel_applet_activation_limit > 0 &&
+	    mate_panel_applets_activating >= mate_panel_applet_activation_limit) {
+		/* resumed by mate_panel_applet_stop_loading() */
+		mate_panel_applet_have_load_idle = FALSE;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 void
 mate_panel_applet_queue_applet_to_load (const char                *id,
 					PanelObjectType            type,
@@ -981,58 +1093,43 @@ mate_panel_applet_queue_applet_to_load (const char                *id,
 					PanelObjectEdgeRelativity  edge_relativity,
 					gboolean                   locked)
 {
-	MatePanelAppletToLoad *applet;
-
 	if (!toplevel_id) {
 		g_warning ("No toplevel on which to load object '%s'\n", id);
 		return;
 	}
 
-	applet = g_new0 (MatePanelAppletToLoad, 1);
-
-	applet->id              = g_strdup (id);
-	applet->type            = type;
-	applet->toplevel_id     = g_strdup (toplevel_id);
-	applet->position        = position;
-	applet->edge_relativity = edge_relativity;
-	applet->locked          = locked != FALSE;
-
-	mate_panel_applets_to_load = g_slist_prepend (mate_panel_applets_to_load, applet);
-}
-
-static int
-mate_panel_applet_compare (const MatePanelAppletToLoad *a,
-		      const MatePanelAppletToLoad *b)
-{
-	int c;
+	mate_panel_applet_ensure_loading_table ();
 
-	if ((c = strcmp (a->toplevel_id, b->toplevel_id)))
-		return c;
-	else if (a->edge_relativity != b->edge_relativity)
-		return a->edge_relativity - b->edge_relativity;
-	else
-		return a->position - b->position;
+	mate_panel_applet_load_queue_add (id, type, toplevel_id, position,
+					  edge_relativity, locked);
 }
 
 void
 mate_panel_applet_load_queued_applets (gboolean initial_load)
 {
-	if (!mate_panel_applets_to_load) {
+	if (mate_panel_applet_to_load_is_empty ()) {
 		mate_panel_applet_queue_initial_unhide_toplevels (NULL);
 		return;
 	}
 
-	if (mate_panel_applets_to_load && mate_panel_applet_unhide_toplevels_timeout == 0) {
+	if (initial_load) {
+		GSettings *settings;
+
+		settings = g_settings_new (PANEL_SCHEMA);
+		mate_panel_applet_activation_limit =
+			g_settings_get_uint (settings, PANEL_APPLET_ACTIVATION_LIMIT_KEY);
+		g_object_unref (settings);
+
+		mate_panel_applets_load_start_time = g_get_monotonic_time ();
+	}
+
+	if (mate_panel_applet_unhide_toplevels_timeout == 0) {
 		/* Install a timeout to make sure we don't block the
 		 * unhiding because of an applet that doesn't load */
-		mate_panel_applet_unhide_toplevels_timeout =
-			g_timeout_add_seconds (UNHIDE_TOPLEVELS_TIMEOUT_SECONDS,
-					       mate_panel_applet_queue_initial_unhide_toplevels,
-					       NULL);
+		mate_panel_applet_schedule_unhide_timeout ();
 	}
 
-	mate_panel_applets_to_load = g_slist_sort (mate_panel_applets_to_load,
-					      (GCompareFunc) mate_panel_applet_compare);
+	mate_panel_applet_load_queue_sort ();
 
 	if ( ! mate_panel_applet_have_load_idle) {
 		/* on panel startup, we don't care about redraws of the
@@ -1182,62 +1279,128 @@ mate_panel_applet_get_id (AppletInfo *info)
 const char *
 mate_panel_applet_get_id_by_widget (GtkWidget *applet_widget)
 {
-	GSList *l;
+	AppletInfo *info;
 
 	if (!applet_widget)
 		return NULL;
 
-	for (l = registered_applets; l; l = l->next) {
-		AppletInfo *info = l->data;
-
-		if (info->widget == applet_widget)
-			return info->id;
-	}
+	info = g_object_get_data (G_OBJECT (applet_widget), "applet_info");
+	if (!info || info->widget != applet_widget)
+		return NULL;
 
-	return NULL;
+	return info->id;
 }
 
 AppletInfo *
 mate_panel_applet_get_by_id (const char *id)
 {
-	GSList *l;
+	GQueue *queue;
 
-	for (l = registered_applets; l; l = l->next) {
-		AppletInfo *info = l->data;
+	if (!registered_applets_by_id)
+		return NULL;
 
-		if (!strcmp (info->id, id))
-			return info;
-	}
+	queue = g_hash_table_lookup (registered_applets_by_id, id);
 
-	return NULL;
+	return queue ? g_queue_peek_head (queue) : NULL;
 }
 
-GSList *
+GList *
 mate_panel_applet_list_applets (void)
 {
-	return registered_applets;
+	return registered_applets.head;
 }
 
 AppletInfo *
 mate_panel_applet_get_by_type (PanelObjectType object_type, GdkScreen *screen)
 {
-	GSList *l;
+	GQueue *queue;
+	GList  *l;
+
+	if (!registered_applets_by_type)
+		return NULL;
+
+	queue = g_hash_table_lookup (registered_applets_by_type,
+				     GINT_TO_POINTER (object_type));
+	if (!queue)
+		return NULL;
 
-	for (l = registered_applets; l; l = l->next) {
+	/* only the few objects of this type are looked at */
+	for (l = queue->head; l; l = l->next) {
 		AppletInfo *info = l->data;
 
-		if (info->type == object_type) {
-			if (screen) {
-				if (screen == gtk_widget_get_screen (info->widget))
-					return info;
-			} else
-				return info;
-		}
+		if (!screen || screen == gtk_widget_get_screen (info->widget))
+			return info;
 	}
 
 	return NULL;
 }
 
+static void
+mate_panel_applet_register_info (AppletInfo *info)
+{
+	GQueue *queue;
+
+	if (!registered_applets_by_id) {
+		registered_applets_by_id =
+			g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, (GDestroyNotify) g_queue_free);
+		registered_applets_by_type =
+			g_hash_table_new_full (NULL, NULL,
+					       NULL, (GDestroyNotify) g_queue_free);
+	}
+
+	g_queue_push_tail (&registered_applets, info);
+	info->registered_link = registered_applets.tail;
+
+	queue = g_hash_table_lookup (registered_applets_by_id, info->id);
+	if (!queue) {
+		queue = g_queue_new ();
+		g_hash_table_insert (registered_applets_by_id,
+				     g_strdup (info->id), queue);
+	}
+	/* another object might already be registered with the same id */
+	g_queue_push_tail (queue, info);
+
+	queue = g_hash_table_lookup (registered_applets_by_type,
+				     GINT_TO_POINTER (info->type));
+	if (!queue) {
+		queue = g_queue_new ();
+		g_hash_table_insert (registered_applets_by_type,
+				     GINT_TO_POINTER (info->type), queue);
+	}
+	g_queue_push_tail (queue, info);
+	info->type_link = queue->tail;
+}
+
+static void
+mate_panel_applet_unregister (AppletInfo *info)
+{
+	GQueue *queue;
+
+	if (!info->registered_link)
+		return;
+
+	g_queue_delete_link (&registered_applets, info->registered_link);
+	info->registered_link = NULL;
+
+	queue = g_hash_table_lookup (registered_applets_by_id, info->id);
+	if (queue) {
+		g_queue_remove (queue, info);
+		if (g_queue_is_empty (queue))
+			g_hash_table_remove (registered_applets_by_id, info->id);
+	}
+
+	queue = g_hash_table_lookup (registered_applets_by_type,
+				     GINT_TO_POINTER (info->type));
+	if (queue) {
+		g_queue_delete_link (queue, info->type_link);
+		if (g_queue_is_empty (queue))
+			g_hash_table_remove (registered_applets_by_type,
+					     GINT_TO_POINTER (info->type));
+	}
+	info->type_link = NULL;
+}
+
 AppletInfo *
 mate_panel_applet_register (GtkWidget       *applet,
 		       gpointer         data,
@@ -1304,7 +1467,7 @@ mate_panel_applet_register (GtkWidget       *applet,
 	g_object_set_data (G_OBJECT (applet),
 			   MATE_PANEL_APPLET_FORBIDDEN_PANELS, NULL);
 
-	registered_applets = g_slist_append (registered_applets, info);
+	mate_panel_applet_register_info (info);
 
 	if (panel_widget_add (panel, applet, locked, pos, exactpos) == -1 &&
 	    panel_widget_add (panel, applet, locked, 0, TRUE) == -1) {
@@ -29,6 +29,10 @@ typedef struct {
 	GSettings       *settings;
 
 	char            *id;
+
+	/* links in the lists of registered applets */
+	GList           *registered_link;
+	GList           *type_link;
 } AppletInfo;
 
 typedef gboolean (* CallbackEnabledFunc) (void);
@@ -63,7 +67,7 @@ const char *mate_panel_applet_get_id_by_widget (GtkWidget       *widget);
 AppletInfo *mate_panel_applet_get_by_id        (const char      *id);
 AppletInfo *mate_panel_applet_get_by_type      (PanelObjectType  object_type, GdkScreen *screen);
 
-GSList     *mate_panel_applet_list_applets (void);
+GList      *mate_panel_applet_list_applets (void);
 
 void        mate_panel_applet_clean        (AppletInfo    *info);
 
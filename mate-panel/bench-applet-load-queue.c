@@ -0,0 +1,143 @@
+/* Benchmark for the queue of the objects loaded at panel startup
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include "panel-applet-load-queue.h"
+
+typedef struct {
+	GHashTable *toplevels;
+	guint       n_lookups;
+} BenchProfile;
+
+/* Stands for panel_profile_get_toplevel_by_id(), counting the lookups */
+static gpointer
+lookup_toplevel (const char *toplevel_id,
+		 gpointer    user_data)
+{
+	BenchProfile *profile = user_data;
+
+	profile->n_lookups++;
+
+	return g_hash_table_lookup (profile->toplevels, toplevel_id);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	BenchProfile profile;
+	guint        n_loaded = 0;
+	gint64       start;
+	gint64       queued;
+	gint64       sorted;
+	gint64       loaded;
+	int          i;
+
+	int          n_objects = 5000;
+	int          n_toplevels = 16;
+	int          n_missing = 0;
+
+	GError         *error;
+	GOptionContext *context;
+	GOptionEntry options[] = {
+		{ "objects", 'n', 0, G_OPTION_ARG_INT, &n_objects, "Number of objects to load", "N" },
+		{ "toplevels", 't', 0, G_OPTION_ARG_INT, &n_toplevels, "Number of toplevels", "N" },
+		{ "missing", 'm', 0, G_OPTION_ARG_INT, &n_missing, "Number of toplevels of the objects that don't exist", "N" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (n_objects <= 0 || n_toplevels <= 0 || n_missing < 0) {
+		g_printerr ("The numbers of objects and toplevels must be positive\n");
+		return 1;
+	}
+
+	profile.toplevels = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	profile.n_lookups = 0;
+	for (i = 0; i < n_toplevels; i++)
+		g_hash_table_insert (profile.toplevels,
+				     g_strdup_printf ("toplevel-%d", i),
+				     GINT_TO_POINTER (i + 1));
+
+	start = g_get_monotonic_time ();
+
+	/* the objects come in no particular order from the profile; the
+	 * ones of the missing toplevels sort first, like a panel removed
+	 * while the objects stayed in the configuration */
+	for (i = 0; i < n_objects; i++) {
+		char *id;
+		char *toplevel_id;
+		int   toplevel;
+
+		id = g_strdup_printf ("object-%d", i);
+		toplevel = (i * 7919) % (n_toplevels + n_missing);
+		if (toplevel < n_missing)
+			toplevel_id = g_strdup_printf ("missing-%d", toplevel);
+		else
+			toplevel_id = g_strdup_printf ("toplevel-%d", toplevel - n_missing);
+
+		mate_panel_applet_load_queue_add (id, PANEL_OBJECT_LAUNCHER, toplevel_id,
+						  (i * 31) % 1000,
+						  (PanelObjectEdgeRelativity) (i % 3),
+						  FALSE);
+
+		g_free (toplevel_id);
+		g_free (id);
+	}
+
+	queued = g_get_monotonic_time ();
+	mate_panel_applet_load_queue_sort ();
+	sorted = g_get_monotonic_time ();
+
+	while (!mate_panel_applet_load_queue_is_empty ()) {
+		MatePanelAppletToLoad *applet;
+		gpointer               toplevel;
+
+		applet = mate_panel_applet_load_queue_pop (lookup_toplevel, &profile, &toplevel);
+		if (!applet)
+			break;
+
+		n_loaded++;
+		mate_panel_applet_to_load_free (applet);
+	}
+
+	loaded = g_get_monotonic_time ();
+
+	g_print ("%d objects on %d toplevels (%d missing)\n",
+		 n_objects, n_toplevels, n_missing);
+	g_print ("queue:  %8.1f ms\n", (double) (queued - start) / 1000);
+	g_print ("sort:   %8.1f ms\n", (double) (sorted - queued) / 1000);
+	g_print ("load:   %8.1f ms, %u objects, %u toplevel lookups\n",
+		 (double) (loaded - sorted) / 1000, n_loaded, profile.n_lookups);
+
+	g_hash_table_destroy (profile.toplevels);
+
+	return 0;
+}
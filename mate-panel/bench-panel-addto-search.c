@@ -0,0 +1,184 @@
+/* Benchmark for the search of the Add to Panel dialog
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <gtk/gtk.h>
+#include "panel-addto-search.h"
+
+typedef struct {
+	char *name;
+	char *description;
+	char *search_key;
+} BenchItem;
+
+static const char *words[] = {
+	"Terminal", "Text", "Editor", "Image", "Viewer", "Music", "Player",
+	"Office", "Writer", "Calculator", "Files", "Disk", "Usage", "System",
+	"Monitor", "Mail", "Web", "Browser", "Archive", "Manager", "Photo",
+	"Video", "Café", "Straße", "Settings", "Network", "Printer", "Screen"
+};
+
+/* The same as panel_addto_filter_func() for the application list */
+static gboolean
+filter_func (GtkTreeModel *model,
+	     GtkTreeIter  *iter,
+	     gpointer      user_data)
+{
+	PanelAddtoSearch *search = user_data;
+	BenchItem        *item;
+
+	if (panel_addto_search_is_empty (search))
+		return TRUE;
+
+	gtk_tree_model_get (model, iter, 0, &item, -1);
+
+	if (!item->search_key)
+		item->search_key = panel_addto_search_make_key (item->name,
+								item->description);
+
+	return panel_addto_search_match (search, item, item->search_key);
+}
+
+static gint64
+bench_refilter (GtkTreeModel     *filter,
+		PanelAddtoSearch *search,
+		const char       *text)
+{
+	gint64 start;
+
+	start = g_get_monotonic_time ();
+	if (panel_addto_search_set_text (search, text))
+		gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (filter));
+
+	return g_get_monotonic_time () - start;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	GtkListStore     *store;
+	GtkTreeModel     *filter;
+	PanelAddtoSearch *search;
+	BenchItem        *items;
+	GRand            *rand;
+	gint64            elapsed;
+	gint64            total = 0;
+	gint64            worst = 0;
+	glong             n_chars;
+	glong             i;
+	int               j;
+
+	int               n_items = 5000;
+	char             *text = NULL;
+
+	GError         *error;
+	GOptionContext *context;
+	GOptionEntry options[] = {
+		{ "items", 'n', 0, G_OPTION_ARG_INT, &n_items, "Number of applications in the list", "N" },
+		{ "text", 't', 0, G_OPTION_ARG_STRING, &text, "Text typed, one character at a time", "TEXT" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (n_items <= 0) {
+		g_printerr ("The number of items must be positive\n");
+		return 1;
+	}
+
+	if (!text)
+		text = g_strdup ("text editor");
+
+	if (!g_utf8_validate (text, -1, NULL) || !text [0]) {
+		g_printerr ("The text must be valid, non-empty UTF-8\n");
+		g_free (text);
+		return 1;
+	}
+
+	rand = g_rand_new_with_seed (42);
+	items = g_new0 (BenchItem, n_items);
+	store = gtk_list_store_new (1, G_TYPE_POINTER);
+
+	for (j = 0; j < n_items; j++) {
+		items [j].name = g_strdup_printf ("%s %s %d",
+						  words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+						  words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+						  j);
+		items [j].description = g_strdup_printf ("%s for the %s",
+							 words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+							 words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+
+		gtk_list_store_insert_with_values (store, NULL, -1, 0, &items [j], -1);
+	}
+
+	search = panel_addto_search_new ();
+	filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (store), NULL);
+	gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (filter),
+						filter_func, search, NULL);
+
+	g_print ("%d items\n", n_items);
+
+	/* typing the text, then erasing it: the rejected items are only
+	 * skipped while the text gets longer */
+	n_chars = g_utf8_strlen (text, -1);
+	for (i = 1 - n_chars; i < n_chars; i++) {
+		char *typed;
+		glong len = n_chars - ABS (i);
+
+		typed = g_strndup (text, g_utf8_offset_to_pointer (text, len) - text);
+		elapsed = bench_refilter (filter, search, typed);
+
+		g_print ("%s %-24s %6d shown %8" G_GINT64_FORMAT " us\n",
+			 i <= 0 ? "type " : "erase",
+			 typed, gtk_tree_model_iter_n_children (filter, NULL), elapsed);
+
+		total += elapsed;
+		worst = MAX (worst, elapsed);
+
+		g_free (typed);
+	}
+
+	g_print ("per key press: %.1f us on average, %" G_GINT64_FORMAT " us at worst\n",
+		 (double) total / (2 * n_chars - 1), worst);
+
+	g_object_unref (filter);
+	g_object_unref (store);
+	panel_addto_search_free (search);
+
+	for (j = 0; j < n_items; j++) {
+		g_free (items [j].name);
+		g_free (items [j].description);
+		g_free (items [j].search_key);
+	}
+	g_free (items);
+	g_rand_free (rand);
+	g_free (text);
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+/* Benchmark for the transformation of panel background images
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include "panel-background-transform.h"
+
+/* Times panel_background_scale_and_rotate(), which is the whole cost of
+ * a change of the panel size for an image background: the moves of the
+ * panel reuse the transformed image. */
+static void
+bench_transform (const char *name,
+		 GdkPixbuf  *image,
+		 int         width,
+		 int         height,
+		 gboolean    rotate,
+		 int         iterations)
+{
+	gint64 start;
+	gint64 elapsed;
+	int    i;
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < iterations; i++)
+		g_object_unref (panel_background_scale_and_rotate (image, width, height, rotate));
+	elapsed = g_get_monotonic_time () - start;
+
+	g_print ("%-32s %5dx%-5d %8.1f us\n",
+		 name, width, height, (double) elapsed / iterations);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	GdkPixbuf *image;
+	guchar    *pixels;
+	int        rowstride;
+	int        i;
+
+	int        image_width = 3840;
+	int        image_height = 2160;
+	int        panel_size = 48;
+	int        iterations = 20;
+	gboolean   alpha = FALSE;
+
+	GError         *error;
+	GOptionContext *context;
+	GOptionEntry options[] = {
+		{ "width", 'w', 0, G_OPTION_ARG_INT, &image_width, "Width of the image", "WIDTH" },
+		{ "height", 'h', 0, G_OPTION_ARG_INT, &image_height, "Height of the image", "HEIGHT" },
+		{ "panel-size", 's', 0, G_OPTION_ARG_INT, &panel_size, "Size of the panel", "SIZE" },
+		{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Number of transformations timed", "N" },
+		{ "alpha", 'a', 0, G_OPTION_ARG_NONE, &alpha, "Use an image with an alpha channel", NULL },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (image_width <= 0 || image_height <= 0 || panel_size <= 0 || iterations <= 0) {
+		g_printerr ("The sizes and the number of iterations must be positive\n");
+		return 1;
+	}
+
+	image = gdk_pixbuf_new (GDK_COLORSPACE_RGB, alpha, 8, image_width, image_height);
+	pixels = gdk_pixbuf_get_pixels (image);
+	rowstride = gdk_pixbuf_get_rowstride (image);
+	for (i = 0; i < rowstride * image_height; i++)
+		pixels[i] = g_random_int_range (0, 256);
+
+	g_print ("%dx%d %s image, %d iterations\n",
+		 image_width, image_height, alpha ? "RGBA" : "RGB", iterations);
+
+	/* a horizontal panel fitting the image */
+	bench_transform ("fit, horizontal", image,
+			 image_width * panel_size / image_height, panel_size,
+			 FALSE, iterations);
+	/* a vertical panel as high as the image is wide, stretching and
+	 * rotating it */
+	bench_transform ("stretch and rotate, vertical", image,
+			 image_width, panel_size,
+			 TRUE, iterations);
+	/* a vertical panel rotating the image at its size */
+	bench_transform ("rotate, vertical", image,
+			 image_width, image_height,
+			 TRUE, iterations);
+
+	g_object_unref (image);
+
+	return 0;
+}
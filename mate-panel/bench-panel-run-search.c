@@ -0,0 +1,189 @@
+/* Benchmark for the search of the program list of the Run dialog
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include "panel-run-search.h"
+
+static const char *words[] = {
+	"Terminal", "Text", "Editor", "Image", "Viewer", "Music", "Player",
+	"Office", "Writer", "Calculator", "Files", "Disk", "Usage", "System",
+	"Monitor", "Mail", "Web", "Browser", "Archive", "Manager", "Photo",
+	"Video", "Café", "Straße", "Settings", "Network", "Printer", "Screen"
+};
+
+/* Builds the keys of a synthetic desktop entry: a name of two or three
+ * words, the matching command and a description */
+static void
+make_entry (GRand              *rand,
+	    PanelRunSearchKeys *keys)
+{
+	GString *name;
+	GString *exec;
+	char    *comment;
+	int      n_words;
+	int      i;
+
+	name = g_string_new (NULL);
+	exec = g_string_new ("/usr/bin/");
+
+	n_words = g_rand_int_range (rand, 2, 4);
+	for (i = 0; i < n_words; i++) {
+		const char *word = words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))];
+		char       *lower;
+
+		if (i > 0) {
+			g_string_append_c (name, ' ');
+			g_string_append_c (exec, '-');
+		}
+
+		g_string_append (name, word);
+		lower = g_utf8_strdown (word, -1);
+		g_string_append (exec, lower);
+		g_free (lower);
+	}
+	g_string_append (exec, " %U");
+
+	comment = g_strdup_printf ("%s for the %s of the %s",
+				   name->str,
+				   words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+				   words [g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+
+	panel_run_search_keys_init (keys, name->str, comment, exec->str);
+
+	g_free (comment);
+	g_string_free (exec, TRUE);
+	g_string_free (name, TRUE);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	PanelRunSearchKeys *entries;
+	GRand              *rand;
+	gint64              start;
+	gint64              elapsed;
+	gint64              total = 0;
+	gint64              worst = 0;
+	glong               n_chars;
+	glong               i;
+	int                 j;
+
+	int                 n_entries = 5000;
+	int                 iterations = 20;
+	char               *text = NULL;
+
+	GError         *error;
+	GOptionContext *context;
+	GOptionEntry options[] = {
+		{ "entries", 'n', 0, G_OPTION_ARG_INT, &n_entries, "Number of desktop entries", "N" },
+		{ "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Number of searches timed per key press", "N" },
+		{ "text", 't', 0, G_OPTION_ARG_STRING, &text, "Text typed, one character at a time", "TEXT" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (n_entries <= 0 || iterations <= 0) {
+		g_printerr ("The numbers of entries and iterations must be positive\n");
+		return 1;
+	}
+
+	if (!text)
+		text = g_strdup ("text editor");
+
+	if (!g_utf8_validate (text, -1, NULL) || !text [0]) {
+		g_printerr ("The text must be valid, non-empty UTF-8\n");
+		g_free (text);
+		return 1;
+	}
+
+	rand = g_rand_new_with_seed (42);
+	entries = g_new0 (PanelRunSearchKeys, n_entries);
+
+	start = g_get_monotonic_time ();
+	for (j = 0; j < n_entries; j++)
+		make_entry (rand, &entries [j]);
+	g_print ("%d entries indexed in %.1f ms\n",
+		 n_entries, (double) (g_get_monotonic_time () - start) / 1000);
+
+	/* what the dialog does for each key press: score every entry
+	 * against the text typed so far */
+	n_chars = g_utf8_strlen (text, -1);
+	for (i = 1; i <= n_chars; i++) {
+		char *typed;
+		int   n_matches = 0;
+		int   k;
+
+		typed = g_strndup (text, g_utf8_offset_to_pointer (text, i) - text);
+
+		start = g_get_monotonic_time ();
+		for (k = 0; k < iterations; k++) {
+			PanelRunQuery *query;
+
+			query = panel_run_query_new (typed);
+			n_matches = 0;
+
+			for (j = 0; j < n_entries; j++) {
+				gboolean fuzzy;
+				int      score;
+
+				if (panel_run_query_match_command (query, &entries [j], &fuzzy))
+					score = panel_run_query_score_command (query, &entries [j]);
+				else
+					score = panel_run_query_score (query, &entries [j]);
+
+				if (score != PANEL_RUN_SCORE_NO_MATCH)
+					n_matches++;
+			}
+
+			panel_run_query_free (query);
+		}
+		elapsed = (g_get_monotonic_time () - start) / iterations;
+
+		g_print ("%-24s %6d matches %8" G_GINT64_FORMAT " us\n",
+			 typed, n_matches, elapsed);
+
+		total += elapsed;
+		worst = MAX (worst, elapsed);
+
+		g_free (typed);
+	}
+
+	g_print ("per key press: %.1f us on average, %" G_GINT64_FORMAT " us at worst\n",
+		 (double) total / n_chars, worst);
+
+	for (j = 0; j < n_entries; j++)
+		panel_run_search_keys_clear (&entries [j]);
+	g_free (entries);
+	g_rand_free (rand);
+	g_free (text);
+
+	return 0;
+}
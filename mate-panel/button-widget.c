@@ -17,6 +17,8 @@
 #include "panel-globals.h"
 #include "panel-enums.h"
 #include "panel-enums-gsettings.h"
+#include "panel-colorshift.h"
+#include "panel-icon-cache.h"
 
 struct _ButtonWidgetPrivate {
     GtkIconTheme     *icon_theme;
@@ -28,6 +30,8 @@ struct _ButtonWidgetPrivate {
     PanelOrientation  orientation;
 
     int               size;
+    /* scale factor the surfaces were loaded for */
+    int               scale;
 
     guint             activatable   : 1;
     guint             ignore_leave  : 1;
@@ -51,66 +55,53 @@ enum {
 
 #define BUTTON_WIDGET_DISPLACEMENT 2
 
-G_DEFINE_TYPE_WITH_PRIVATE (ButtonWidget, button_widget, GTK_TYPE_BUTTON)
+/* set on the cached surfaces loaded at their size in application pixels */
+static const cairo_user_data_key_t needs_move_key;
 
-/* colorshift a surface */
-static void
-do_colorshift (cairo_surface_t *dest, cairo_surface_t *src, int shift)
-{
-    gint    i, j;
-    gint    width, height, has_alpha, srcrowstride, destrowstride;
-    guchar *target_pixels;
-    guchar *original_pixels;
-    int     val;
-    guchar  r,g,b;
-
-    has_alpha = cairo_surface_get_content (src) != CAIRO_CONTENT_COLOR;
-    width = cairo_image_surface_get_width (src);
-    height = cairo_image_surface_get_height (src);
-    srcrowstride = cairo_image_surface_get_stride (src);
-    destrowstride = cairo_image_surface_get_stride (dest);
-    original_pixels = cairo_image_surface_get_data (src);
-    target_pixels = cairo_image_surface_get_data (dest);
-
-    for (i = 0; i < height; i++) {
-        guchar *pixdest = target_pixels + i*destrowstride;
-        guchar *pixsrc = original_pixels + i*srcrowstride;
-        for (j = 0; j < width; j++) {
-            r = *(pixsrc++);
-            g = *(pixsrc++);
-            b = *(pixsrc++);
-            val = r + shift;
-            *(pixdest++) = CLAMP(val, 0, 255);
-            val = g + shift;
-            *(pixdest++) = CLAMP(val, 0, 255);
-            val = b + shift;
-            *(pixdest++) = CLAMP(val, 0, 255);
-            if (has_alpha)
-                *(pixdest++) = *(pixsrc++);
-        }
-    }
-}
+G_DEFINE_TYPE_WITH_PRIVATE (ButtonWidget, button_widget, GTK_TYPE_BUTTON)
 
 static cairo_surface_t *
 make_hc_surface (cairo_surface_t *surface)
 {
-    cairo_t         *cr;
     cairo_surface_t *new;
+    cairo_format_t   format;
+    gint             width, height;
+    gint             srcrowstride, destrowstride;
+    guchar          *original_pixels;
+    guchar          *target_pixels;
+    gdouble          x_scale, y_scale;
+    gint             i;
 
     if (!surface)
         return NULL;
 
-    new = cairo_surface_create_similar (surface,
-                                        cairo_surface_get_content (surface),
-                                        cairo_image_surface_get_width (surface),
-                                        cairo_image_surface_get_height (surface));
+    format = cairo_image_surface_get_format (surface);
+    if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+        return cairo_surface_reference (surface);
+
+    width = cairo_image_surface_get_width (surface);
+    height = cairo_image_surface_get_height (surface);
+
+    new = cairo_image_surface_create (format, width, height);
+    if (cairo_surface_status (new) != CAIRO_STATUS_SUCCESS)
+        return new;
+
+    cairo_surface_get_device_scale (surface, &x_scale, &y_scale);
+    cairo_surface_set_device_scale (new, x_scale, y_scale);
 
-    do_colorshift (new, surface, 30);
+    cairo_surface_flush (surface);
 
-    cr = cairo_create (new);
-    cairo_set_operator (cr, CAIRO_OPERATOR_DEST_IN);
-    cairo_mask_surface (cr, surface, 0, 0);
-    cairo_destroy (cr);
+    srcrowstride = cairo_image_surface_get_stride (surface);
+    destrowstride = cairo_image_surface_get_stride (new);
+    original_pixels = cairo_image_surface_get_data (surface);
+    target_pixels = cairo_image_surface_get_data (new);
+
+    for (i = 0; i < height; i++)
+        panel_colorshift_row ((guint32 *) (target_pixels + i * destrowstride),
+                              (const guint32 *) (original_pixels + i * srcrowstride),
+                              width, 30, format == CAIRO_FORMAT_ARGB32);
+
+    cairo_surface_mark_dirty (new);
 
     return new;
 }
@@ -158,6 +149,70 @@ button_widget_unset_surfaces (ButtonWidget *button)
     button->priv->surface_hc = NULL;
 }
 
+static cairo_surface_t *
+button_widget_load_surface (ButtonWidget *button,
+                            int           scale,
+                            gboolean     *needs_move)
+{
+    cairo_surface_t *surface;
+    GdkDisplay      *display;
+    char            *error = NULL;
+
+    *needs_move = FALSE;
+
+    /* icons findable in the icon theme can be handled by gtk directly*/
+    display = gdk_display_get_default ();
+    GtkIconTheme *icon_theme = gtk_icon_theme_get_default();
+    surface =
+        gtk_icon_theme_load_surface (icon_theme,
+                                     button->priv->filename,
+                                     button->priv->size,
+                                     scale,
+                                     NULL,
+                                     GTK_ICON_LOOKUP_FORCE_SIZE | GTK_ICON_LOOKUP_FORCE_SVG,
+                                     NULL);
+
+    /*fallback to catch the case of custom icons in x11*/
+    if (!surface && GDK_IS_X11_DISPLAY (display)) {
+        surface =
+            panel_load_icon (button->priv->icon_theme,
+                             button->priv->filename,
+                             button->priv->size * scale,
+                             (button->priv->orientation & PANEL_VERTICAL_MASK)   ? button->priv->size * scale : -1,
+                             (button->priv->orientation & PANEL_HORIZONTAL_MASK) ? button->priv->size * scale: -1,
+                             &error);
+    }
+    else if (!surface) {
+        /*fallback to catch the case of custom icons not in x11*/
+        *needs_move = TRUE;
+        surface =
+            panel_load_icon (button->priv->icon_theme,
+                             button->priv->filename,
+                             button->priv->size * scale,
+                             (button->priv->orientation & PANEL_VERTICAL_MASK)   ? button->priv->size  : -1,
+                             (button->priv->orientation & PANEL_HORIZONTAL_MASK) ? button->priv->size  : -1,
+                             &error);
+    }
+    if (error) {
+        /*Last fallback for case of icon not found
+        * FIXME: this is not rendered at button->priv->size
+        */
+        *needs_move = FALSE;
+        surface =
+            gtk_icon_theme_load_surface (icon_theme,
+                                         "image-missing",
+                                         GTK_ICON_SIZE_BUTTON,
+                                         scale,
+                                         NULL,
+                                         GTK_ICON_LOOKUP_FORCE_SVG | GTK_ICON_LOOKUP_USE_BUILTIN,
+                                         NULL);
+
+        g_free (error);
+    }
+
+    return surface;
+}
+
 static void
 button_widget_reload_surface (ButtonWidget *button)
 {
@@ -168,66 +223,68 @@ button_widget_reload_surface (ButtonWidget *button)
         return;
 
     if (button->priv->filename != NULL && button->priv->filename [0] != '\0') {
-        GdkDisplay *display;
-        gint        scale;
-        char       *error = NULL;
-        /* icons findable in the icon theme can be handled by gtk directly*/
-        display = gdk_display_get_default ();
-        scale = gtk_widget_get_scale_factor (GTK_WIDGET (button));
-        GtkIconTheme *icon_theme = gtk_icon_theme_get_default();
-        button->priv->surface =
-            gtk_icon_theme_load_surface (icon_theme,
-                                         button->priv->filename,
+        cairo_surface_t *surface;
+        gboolean         needs_move;
+
+        button->priv->scale = gtk_widget_get_scale_factor (GTK_WIDGET (button));
+
+        /* the orientation decides which dimension panel_load_icon()
+         * scales the icon to */
+        surface = panel_icon_cache_lookup (button->priv->filename,
+                                           button->priv->size,
+                                           button->priv->scale,
+                                           button->priv->orientation,
+                                           PANEL_ICON_CACHE_NORMAL);
+        if (!surface) {
+            surface = button_widget_load_surface (button, button->priv->scale, &needs_move);
+            if (surface) {
+                cairo_surface_set_user_data (surface, &needs_move_key,
+                                             GINT_TO_POINTER (needs_move), NULL);
+                panel_icon_cache_insert (button->priv->filename,
                                          button->priv->size,
-                                         scale,
-                                         NULL,
-                                         GTK_ICON_LOOKUP_FORCE_SIZE | GTK_ICON_LOOKUP_FORCE_SVG,
-                                         NULL);
-
-        /*fallback to catch the case of custom icons in x11*/
-        if (!button->priv->surface && GDK_IS_X11_DISPLAY (display)) {
-            button->priv->surface =
-                panel_load_icon (button->priv->icon_theme,
-                                 button->priv->filename,
-                                 button->priv->size * scale,
-                                 (button->priv->orientation & PANEL_VERTICAL_MASK)   ? button->priv->size * scale : -1,
-                                 (button->priv->orientation & PANEL_HORIZONTAL_MASK) ? button->priv->size * scale: -1,
-                                 &error);
-        }
-        else if (!button->priv->surface) {
-            /*fallback to catch the case of custom icons not in x11*/
-            button->priv->needs_move = TRUE;
-            button->priv->surface =
-                panel_load_icon (button->priv->icon_theme,
-                                 button->priv->filename,
-                                 button->priv->size * scale,
-                                 (button->priv->orientation & PANEL_VERTICAL_MASK)   ? button->priv->size  : -1,
-                                 (button->priv->orientation & PANEL_HORIZONTAL_MASK) ? button->priv->size  : -1,
-                                 &error);
-        }
-        if (error) {
-            /*Last fallback for case of icon not found
-            * FIXME: this is not rendered at button->priv->size
-            */
-            button->priv->needs_move = FALSE;
-            button->priv->surface =
-                gtk_icon_theme_load_surface (icon_theme,
-                                             "image-missing",
-                                             GTK_ICON_SIZE_BUTTON,
-                                             scale,
-                                             NULL,
-                                             GTK_ICON_LOOKUP_FORCE_SVG | GTK_ICON_LOOKUP_USE_BUILTIN,
-                                             NULL);
-
-            g_free (error);
+                                         button->priv->scale,
+                                         button->priv->orientation,
+                                         PANEL_ICON_CACHE_NORMAL,
+                                         surface);
+            }
         }
+
+        button->priv->surface = surface;
+        button->priv->needs_move = surface != NULL &&
+            cairo_surface_get_user_data (surface, &needs_move_key) != NULL;
     }
 
-    button->priv->surface_hc = make_hc_surface (button->priv->surface);
+    /* the prelight surface is only made when first needed */
 
     gtk_widget_queue_resize (GTK_WIDGET (button));
 }
 
+static cairo_surface_t *
+button_widget_get_hc_surface (ButtonWidget *button)
+{
+    cairo_surface_t *surface;
+
+    if (!button->priv->filename)
+        return make_hc_surface (button->priv->surface);
+
+    surface = panel_icon_cache_lookup (button->priv->filename,
+                                       button->priv->size,
+                                       button->priv->scale,
+                                       button->priv->orientation,
+                                       PANEL_ICON_CACHE_HIGH_CONTRAST);
+    if (!surface) {
+        surface = make_hc_surface (button->priv->surface);
+        panel_icon_cache_insert (button->priv->filename,
+                                 button->priv->size,
+                                 button->priv->scale,
+                                 button->priv->orientation,
+                                 PANEL_ICON_CACHE_HIGH_CONTRAST,
+                                 surface);
+    }
+
+    return surface;
+}
+
 static void
 button_widget_icon_theme_changed (ButtonWidget *button)
 {
@@ -390,7 +447,7 @@ button_widget_draw (GtkWidget *widget,
 
     button_widget = BUTTON_WIDGET (widget);
 
-    if (!button_widget->priv->surface_hc && !button_widget->priv->surface)
+    if (!button_widget->priv->surface)
         return FALSE;
 
     state_flags = gtk_widget_get_state_flags (widget);
@@ -425,6 +482,8 @@ button_widget_draw (GtkWidget *widget,
     }
     else if (panel_global_config_get_highlight_when_over () &&
         (state_flags & GTK_STATE_FLAG_PRELIGHT || gtk_widget_has_focus (widget))) {
+        if (!button_widget->priv->surface_hc)
+            button_widget->priv->surface_hc = button_widget_get_hc_surface (button_widget);
         cairo_set_source_surface (cr, button_widget->priv->surface_hc, x, y);
     }
     else {
@@ -651,6 +710,7 @@ button_widget_init (ButtonWidget *button)
     button->priv->orientation = PANEL_ORIENTATION_TOP;
 
     button->priv->size = 0;
+    button->priv->scale = 1;
 
     button->priv->activatable   = FALSE;
     button->priv->ignore_leave  = FALSE;
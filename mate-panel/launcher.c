@@ -1167,7 +1167,7 @@ panel_launcher_create_copy (PanelToplevel *toplevel,
 Launcher *
 find_launcher (const char *path)
 {
-	GSList *l;
+	GList *l;
 
 	g_return_val_if_fail (path != NULL, NULL);
 
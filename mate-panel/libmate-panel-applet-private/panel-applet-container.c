@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include <gtk/gtk.h>
+#include <gio/gunixfdlist.h>
 
 #ifdef HAVE_X11
 #include <gtk/gtkx.h>
@@ -47,6 +48,11 @@ struct _MatePanelAppletContainerPrivate {
 	GtkWidget  *socket;
 
 	GHashTable *pending_ops;
+
+	/* the applet is too old to know about SetProperties */
+	gboolean    no_set_properties;
+	/* the applet is too old to know about SetBackgroundImage */
+	gboolean    no_set_background_image;
 };
 
 enum {
@@ -657,6 +663,342 @@ mate_panel_applet_container_child_set (MatePanelAppletContainer *container,
 	return task;
 }
 
+typedef struct {
+	GVariant *properties;
+	guint     n_pending;
+	GError   *error;
+} ChildSetManyData;
+
+static void
+child_set_many_data_free (ChildSetManyData *data)
+{
+	g_variant_unref (data->properties);
+	if (data->error)
+		g_error_free (data->error);
+
+	g_free (data);
+}
+
+static void
+mate_panel_applet_container_child_set_many_done (GTask *task)
+{
+	MatePanelAppletContainer *container;
+	ChildSetManyData         *data;
+
+	data = g_task_get_task_data (task);
+
+	container = MATE_PANEL_APPLET_CONTAINER (g_task_get_source_object (task));
+	if (container->priv->pending_ops)
+		g_hash_table_remove (container->priv->pending_ops, task);
+
+	if (data->error)
+		g_task_return_error (task, g_steal_pointer (&data->error));
+	else
+		g_task_return_boolean (task, TRUE);
+	g_object_unref (task);
+}
+
+static void
+set_applet_property_fallback_cb (GObject      *source_object,
+				 GAsyncResult *res,
+				 gpointer      user_data)
+{
+	GDBusConnection  *connection = G_DBUS_CONNECTION (source_object);
+	GTask            *task = G_TASK (user_data);
+	ChildSetManyData *data;
+	GVariant         *retvals;
+	GError           *error = NULL;
+
+	data = g_task_get_task_data (task);
+
+	retvals = g_dbus_connection_call_finish (connection, res, &error);
+	if (!retvals) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("Error setting property: %s\n", error->message);
+		if (!data->error)
+			data->error = error;
+		else
+			g_error_free (error);
+	} else {
+		g_variant_unref (retvals);
+	}
+
+	if (--data->n_pending == 0)
+		mate_panel_applet_container_child_set_many_done (task);
+}
+
+/* One org.freedesktop.DBus.Properties.Set call per property, for applets
+ * built against a libmate-panel-applet without SetProperties */
+static void
+mate_panel_applet_container_child_set_many_fallback (MatePanelAppletContainer *container,
+						     GTask                    *task)
+{
+	GDBusProxy       *proxy = container->priv->applet_proxy;
+	ChildSetManyData *data;
+	GCancellable     *cancellable;
+	GVariantIter      iter;
+	const gchar      *dbus_name;
+	GVariant         *value;
+
+	data = g_task_get_task_data (task);
+	cancellable = g_hash_table_lookup (container->priv->pending_ops, task);
+
+	if (!proxy || g_variant_n_children (data->properties) == 0) {
+		mate_panel_applet_container_child_set_many_done (task);
+		return;
+	}
+
+	g_variant_iter_init (&iter, data->properties);
+	while (g_variant_iter_next (&iter, "{&sv}", &dbus_name, &value)) {
+		data->n_pending++;
+		g_dbus_connection_call (g_dbus_proxy_get_connection (proxy),
+					g_dbus_proxy_get_name (proxy),
+					g_dbus_proxy_get_object_path (proxy),
+					"org.freedesktop.DBus.Properties",
+					"Set",
+					g_variant_new ("(ssv)",
+						       g_dbus_proxy_get_interface_name (proxy),
+						       dbus_name,
+						       value),
+					NULL,
+					G_DBUS_CALL_FLAGS_NO_AUTO_START,
+					-1, cancellable,
+					set_applet_property_fallback_cb,
+					task);
+		g_variant_unref (value);
+	}
+}
+
+static void
+set_applet_properties_cb (GObject      *source_object,
+			  GAsyncResult *res,
+			  gpointer      user_data)
+{
+	GDBusConnection          *connection = G_DBUS_CONNECTION (source_object);
+	GTask                    *task = G_TASK (user_data);
+	MatePanelAppletContainer *container;
+	ChildSetManyData         *data;
+	GVariant                 *retvals;
+	GError                   *error = NULL;
+
+	data = g_task_get_task_data (task);
+	container = MATE_PANEL_APPLET_CONTAINER (g_task_get_source_object (task));
+
+	retvals = g_dbus_connection_call_finish (connection, res, &error);
+	if (!retvals) {
+		if (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD) &&
+		    container->priv->pending_ops) {
+			g_error_free (error);
+			container->priv->no_set_properties = TRUE;
+			mate_panel_applet_container_child_set_many_fallback (container, task);
+			return;
+		}
+
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("Error setting properties: %s\n", error->message);
+		data->error = error;
+	} else {
+		g_variant_unref (retvals);
+	}
+
+	mate_panel_applet_container_child_set_many_done (task);
+}
+
+/* Sets all the child properties in @properties (a{sv}, keyed by child
+ * property name) with a single message to the applet. Returns NULL,
+ * without calling @callback, if there is no applet or if a property is
+ * unknown: @user_data is then still owned by the caller. */
+gconstpointer
+mate_panel_applet_container_child_set_many (MatePanelAppletContainer *container,
+					    GVariant                 *properties,
+					    GCancellable             *cancellable,
+					    GAsyncReadyCallback       callback,
+					    gpointer                  user_data)
+{
+	GDBusProxy       *proxy = container->priv->applet_proxy;
+	ChildSetManyData *data;
+	GVariantBuilder   builder;
+	GVariantIter      iter;
+	const gchar      *property_name;
+	GVariant         *value;
+	GTask            *task;
+
+	g_variant_ref_sink (properties);
+
+	if (!proxy) {
+		g_variant_unref (properties);
+		return NULL;
+	}
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_iter_init (&iter, properties);
+	while (g_variant_iter_next (&iter, "{&sv}", &property_name, &value)) {
+		const AppletPropertyInfo *info;
+
+		info = mate_panel_applet_container_child_property_get_info (property_name);
+		if (!info) {
+			g_warning ("%s: Applet has no child property named `%s'",
+				   G_STRLOC, property_name);
+			g_variant_unref (value);
+			g_variant_builder_clear (&builder);
+			g_variant_unref (properties);
+			return NULL;
+		}
+
+		g_variant_builder_add (&builder, "{sv}", info->dbus_name, value);
+		g_variant_unref (value);
+	}
+	g_variant_unref (properties);
+
+	task = g_task_new (G_OBJECT (container),
+			   cancellable,
+			   callback,
+			   user_data);
+	g_task_set_source_tag (task, mate_panel_applet_container_child_set_many);
+
+	data = g_new0 (ChildSetManyData, 1);
+	data->properties = g_variant_ref_sink (g_variant_builder_end (&builder));
+	g_task_set_task_data (task, data, (GDestroyNotify) child_set_many_data_free);
+
+	if (cancellable)
+		g_object_ref (cancellable);
+	else
+		cancellable = g_cancellable_new ();
+	g_hash_table_insert (container->priv->pending_ops, task, cancellable);
+
+	if (container->priv->no_set_properties) {
+		mate_panel_applet_container_child_set_many_fallback (container, task);
+		return task;
+	}
+
+	g_dbus_connection_call (g_dbus_proxy_get_connection (proxy),
+				g_dbus_proxy_get_name (proxy),
+				g_dbus_proxy_get_object_path (proxy),
+				MATE_PANEL_APPLET_INTERFACE,
+				"SetProperties",
+				g_variant_new ("(@a{sv})", data->properties),
+				NULL,
+				G_DBUS_CALL_FLAGS_NO_AUTO_START,
+				-1, cancellable,
+				set_applet_properties_cb,
+				task);
+
+	return task;
+}
+
+gboolean
+mate_panel_applet_container_child_set_many_finish (MatePanelAppletContainer *container,
+						   GAsyncResult             *result,
+						   GError                  **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, container), FALSE);
+	g_warn_if_fail (g_task_get_source_tag (G_TASK (result)) == mate_panel_applet_container_child_set_many);
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+set_applet_background_image_cb (GObject      *source_object,
+				GAsyncResult *res,
+				gpointer      user_data)
+{
+	GDBusConnection          *connection = G_DBUS_CONNECTION (source_object);
+	GTask                    *task = G_TASK (user_data);
+	MatePanelAppletContainer *container;
+	GVariant                 *retvals;
+	GError                   *error = NULL;
+
+	container = MATE_PANEL_APPLET_CONTAINER (g_task_get_source_object (task));
+	if (container->priv->pending_ops)
+		g_hash_table_remove (container->priv->pending_ops, task);
+
+	retvals = g_dbus_connection_call_with_unix_fd_list_finish (connection, NULL, res, &error);
+	if (!retvals) {
+		if (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+			container->priv->no_set_background_image = TRUE;
+		else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("Error setting background image: %s\n", error->message);
+		g_task_return_error (task, error);
+	} else {
+		g_variant_unref (retvals);
+		g_task_return_boolean (task, TRUE);
+	}
+
+	g_object_unref (task);
+}
+
+/* Hands the applet a read-only ARGB32 image of the whole panel background
+ * in the memory file @fd, of which the applet uses the part at @x, @y.
+ * Returns NULL when the applet does not support it: a background string
+ * must be sent instead. */
+gconstpointer
+mate_panel_applet_container_child_set_background_image (MatePanelAppletContainer *container,
+							int                       fd,
+							int                       width,
+							int                       height,
+							int                       stride,
+							int                       x,
+							int                       y,
+							GCancellable             *cancellable,
+							GAsyncReadyCallback       callback,
+							gpointer                  user_data)
+{
+	GDBusProxy  *proxy = container->priv->applet_proxy;
+	GUnixFDList *fd_list;
+	GTask       *task;
+	GError      *error = NULL;
+	gint         handle;
+
+	if (!proxy || container->priv->no_set_background_image)
+		return NULL;
+
+	fd_list = g_unix_fd_list_new ();
+	handle = g_unix_fd_list_append (fd_list, fd, &error);
+	if (handle < 0) {
+		g_warning ("Error passing background image: %s", error->message);
+		g_error_free (error);
+		g_object_unref (fd_list);
+		return NULL;
+	}
+
+	task = g_task_new (G_OBJECT (container),
+			   cancellable,
+			   callback,
+			   user_data);
+	g_task_set_source_tag (task, mate_panel_applet_container_child_set_background_image);
+
+	if (cancellable)
+		g_object_ref (cancellable);
+	else
+		cancellable = g_cancellable_new ();
+	g_hash_table_insert (container->priv->pending_ops, task, cancellable);
+
+	g_dbus_connection_call_with_unix_fd_list (g_dbus_proxy_get_connection (proxy),
+						  g_dbus_proxy_get_name (proxy),
+						  g_dbus_proxy_get_object_path (proxy),
+						  MATE_PANEL_APPLET_INTERFACE,
+						  "SetBackgroundImage",
+						  g_variant_new ("(hiiiii)", handle,
+								 width, height, stride, x, y),
+						  NULL,
+						  G_DBUS_CALL_FLAGS_NO_AUTO_START,
+						  -1, fd_list, cancellable,
+						  set_applet_background_image_cb,
+						  task);
+	g_object_unref (fd_list);
+
+	return task;
+}
+
+gboolean
+mate_panel_applet_container_child_set_background_image_finish (MatePanelAppletContainer *container,
+							       GAsyncResult             *result,
+							       GError                  **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, container), FALSE);
+	g_warn_if_fail (g_task_get_source_tag (G_TASK (result)) == mate_panel_applet_container_child_set_background_image);
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 gboolean
 mate_panel_applet_container_child_set_finish (MatePanelAppletContainer *container,
 					 GAsyncResult         *result,
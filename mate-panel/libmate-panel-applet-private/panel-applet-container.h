@@ -103,6 +103,29 @@ gconstpointer  mate_panel_applet_container_child_set           (MatePanelAppletC
 gboolean   mate_panel_applet_container_child_set_finish        (MatePanelAppletContainer *container,
 							   GAsyncResult         *result,
 							   GError              **error);
+gconstpointer  mate_panel_applet_container_child_set_many      (MatePanelAppletContainer *container,
+							   GVariant             *properties,
+							   GCancellable         *cancellable,
+							   GAsyncReadyCallback   callback,
+							   gpointer              user_data);
+gboolean   mate_panel_applet_container_child_set_many_finish   (MatePanelAppletContainer *container,
+							   GAsyncResult         *result,
+							   GError              **error);
+gconstpointer  mate_panel_applet_container_child_set_background_image
+							  (MatePanelAppletContainer *container,
+							   int                   fd,
+							   int                   width,
+							   int                   height,
+							   int                   stride,
+							   int                   x,
+							   int                   y,
+							   GCancellable         *cancellable,
+							   GAsyncReadyCallback   callback,
+							   gpointer              user_data);
+gboolean   mate_panel_applet_container_child_set_background_image_finish
+							  (MatePanelAppletContainer *container,
+							   GAsyncResult         *result,
+							   GError              **error);
 gconstpointer  mate_panel_applet_container_child_get           (MatePanelAppletContainer *container,
 							   const gchar          *property_name,
 							   GCancellable         *cancellable,
@@ -39,9 +39,20 @@
 struct _MatePanelAppletFrameDBusPrivate
 {
 	MatePanelAppletContainer *container;
-	gconstpointer             bg_operation;
+
+	/* child properties changed during this main loop iteration,
+	 * sent to the applet at once */
+	GVariantDict             *pending_properties;
+	gboolean                  pending_orient;
+	gboolean                  pending_background;
+	guint                     pending_properties_id;
 };
 
+typedef struct {
+	MatePanelAppletFrame *frame;
+	gboolean              orient_changed;
+} ChildPropertiesSetData;
+
 /* Keep in sync with mate-panel-applet.h. Uggh. */
 typedef enum {
 	APPLET_FLAGS_NONE   = 0,
@@ -183,84 +194,197 @@ mate_panel_applet_frame_dbus_popup_menu (MatePanelAppletFrame *frame,
 }
 
 static void
-change_orientation_cb (MatePanelAppletContainer *container,
-		       GAsyncResult         *res,
-		       MatePanelAppletFrame     *frame)
+child_properties_set_cb (MatePanelAppletContainer *container,
+			 GAsyncResult             *res,
+			 ChildPropertiesSetData   *data)
 {
 	GError *error = NULL;
 
-	if (!mate_panel_applet_container_child_set_finish (container, res, &error)) {
-		g_warning ("%s\n", error->message);
+	if (!mate_panel_applet_container_child_set_many_finish (container, res, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("%s\n", error->message);
 		g_error_free (error);
+	} else if (data->orient_changed) {
+		gtk_widget_queue_resize (GTK_WIDGET (data->frame));
+	}
 
-		return;
+	g_object_unref (data->frame);
+	g_free (data);
+}
+
+static void mate_panel_applet_frame_dbus_queue_background (MatePanelAppletFrameDBus *dbus_frame);
+
+static void
+child_background_image_set_cb (MatePanelAppletContainer *container,
+			       GAsyncResult             *res,
+			       MatePanelAppletFrameDBus *dbus_frame)
+{
+	GError *error = NULL;
+
+	if (!mate_panel_applet_container_child_set_background_image_finish (container, res, &error)) {
+		/* the container now knows the applet only understands
+		 * background strings */
+		if (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+			mate_panel_applet_frame_dbus_queue_background (dbus_frame);
+		g_error_free (error);
 	}
 
-	gtk_widget_queue_resize (GTK_WIDGET (frame));
+	g_object_unref (dbus_frame);
 }
 
+/* Hands the applet the shared image of the panel background if it can
+ * use it, and adds the background string to the batch otherwise.
+ *
+ * The image is not part of the SetProperties batch: its values are
+ * D-Bus properties, and a file descriptor handle only means something
+ * along with the fd list of its message, so it cannot be one. An applet
+ * also rejects the whole batch for a property it does not know, so an
+ * applet without image support would lose the orientation and size
+ * sent with it, where SetBackgroundImage fails on its own and falls
+ * back to the string. */
 static void
-mate_panel_applet_frame_dbus_change_orientation (MatePanelAppletFrame *frame,
-					    PanelOrientation  orientation)
+mate_panel_applet_frame_dbus_flush_background (MatePanelAppletFrameDBus *dbus_frame)
 {
-	MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS (frame);
+	MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
+	MatePanelAppletFrame            *frame = MATE_PANEL_APPLET_FRAME (dbus_frame);
+	GtkWidget                       *parent;
+	char                            *bg_str;
+	int                              fd;
+	int                              width, height, stride;
+	int                              x, y;
+
+	parent = gtk_widget_get_parent (GTK_WIDGET (frame));
+	if (!PANEL_IS_WIDGET (parent))
+		return;
 
-	mate_panel_applet_container_child_set (dbus_frame->priv->container,
-					  "orient",
-					  g_variant_new_uint32 (get_mate_panel_applet_orient (orientation)),
-					  NULL,
-					  (GAsyncReadyCallback)change_orientation_cb,
-					  frame);
+	fd = _mate_panel_applet_frame_get_background_image (frame, PANEL_WIDGET (parent),
+							    &width, &height, &stride, &x, &y);
+	if (fd >= 0) {
+		if (mate_panel_applet_container_child_set_background_image (priv->container,
+									    fd, width, height, stride,
+									    x, y, NULL,
+									    (GAsyncReadyCallback) child_background_image_set_cb,
+									    g_object_ref (dbus_frame)))
+			return;
+
+		g_object_unref (dbus_frame);
+	}
+
+	bg_str = _mate_panel_applet_frame_get_background_string (frame, PANEL_WIDGET (parent),
+								 PANEL_BACK_NONE);
+	if (bg_str != NULL) {
+		if (!priv->pending_properties)
+			priv->pending_properties = g_variant_dict_new (NULL);
+
+		g_variant_dict_insert_value (priv->pending_properties,
+					     "background", g_variant_new_string (bg_str));
+		g_free (bg_str);
+	}
+}
+
+static gboolean
+mate_panel_applet_frame_dbus_flush_properties (MatePanelAppletFrameDBus *dbus_frame)
+{
+	MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
+	ChildPropertiesSetData          *data;
+	GVariant                        *properties;
+
+	priv->pending_properties_id = 0;
+
+	if (priv->pending_background) {
+		priv->pending_background = FALSE;
+		mate_panel_applet_frame_dbus_flush_background (dbus_frame);
+	}
+
+	if (!priv->pending_properties)
+		return G_SOURCE_REMOVE;
+
+	properties = g_variant_dict_end (priv->pending_properties);
+	g_variant_dict_unref (priv->pending_properties);
+	priv->pending_properties = NULL;
+
+	data = g_new (ChildPropertiesSetData, 1);
+	data->frame = g_object_ref (MATE_PANEL_APPLET_FRAME (dbus_frame));
+	data->orient_changed = priv->pending_orient;
+	priv->pending_orient = FALSE;
+
+	if (!mate_panel_applet_container_child_set_many (priv->container, properties, NULL,
+							 (GAsyncReadyCallback) child_properties_set_cb,
+							 data)) {
+		g_object_unref (data->frame);
+		g_free (data);
+	}
+
+	return G_SOURCE_REMOVE;
 }
 
 static void
-mate_panel_applet_frame_dbus_change_size (MatePanelAppletFrame *frame,
-				     guint             size)
+mate_panel_applet_frame_dbus_schedule_flush (MatePanelAppletFrameDBus *dbus_frame)
 {
-	MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS (frame);
+	MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
 
-	mate_panel_applet_container_child_set (dbus_frame->priv->container,
-					  "size", g_variant_new_uint32 (size),
-					  NULL, NULL, NULL);
+	if (priv->pending_properties_id == 0)
+		priv->pending_properties_id =
+			g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+					 (GSourceFunc) mate_panel_applet_frame_dbus_flush_properties,
+					 dbus_frame, NULL);
 }
 
+/* A panel rotation or resize changes the orientation, size and
+ * background of every applet: queue the changes and send them in a
+ * single message once the current main loop iteration is done. */
 static void
-container_child_background_set (GObject      *source_object,
-				GAsyncResult *res,
-				gpointer      user_data)
+mate_panel_applet_frame_dbus_queue_property (MatePanelAppletFrameDBus *dbus_frame,
+					     const gchar              *property_name,
+					     GVariant                 *value)
 {
-	MatePanelAppletContainer *container = MATE_PANEL_APPLET_CONTAINER (source_object);
-	MatePanelAppletFrameDBus *frame = MATE_PANEL_APPLET_FRAME_DBUS (user_data);
+	MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
 
-	mate_panel_applet_container_child_set_finish (container, res, NULL);
+	if (!priv->pending_properties)
+		priv->pending_properties = g_variant_dict_new (NULL);
 
-	frame->priv->bg_operation = NULL;
+	g_variant_dict_insert_value (priv->pending_properties, property_name, value);
+
+	mate_panel_applet_frame_dbus_schedule_flush (dbus_frame);
 }
 
+/* The background is only looked up when flushing, so that it is computed
+ * once however many times it changed */
 static void
-mate_panel_applet_frame_dbus_change_background (MatePanelAppletFrame    *frame,
-					   PanelBackgroundType  type)
+mate_panel_applet_frame_dbus_queue_background (MatePanelAppletFrameDBus *dbus_frame)
+{
+	dbus_frame->priv->pending_background = TRUE;
+
+	mate_panel_applet_frame_dbus_schedule_flush (dbus_frame);
+}
+
+static void
+mate_panel_applet_frame_dbus_change_orientation (MatePanelAppletFrame *frame,
+					    PanelOrientation  orientation)
 {
 	MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS (frame);
-	MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
-	char *bg_str;
 
-	bg_str = _mate_panel_applet_frame_get_background_string (
-			frame, PANEL_WIDGET (gtk_widget_get_parent (GTK_WIDGET (frame))), type);
+	mate_panel_applet_frame_dbus_queue_property (dbus_frame,
+						     "orient",
+						     g_variant_new_uint32 (get_mate_panel_applet_orient (orientation)));
+	dbus_frame->priv->pending_orient = TRUE;
+}
 
-	if (bg_str != NULL) {
-		if (priv->bg_operation)
-			mate_panel_applet_container_cancel_operation (priv->container, priv->bg_operation);
+static void
+mate_panel_applet_frame_dbus_change_size (MatePanelAppletFrame *frame,
+				     guint             size)
+{
+	MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS (frame);
 
-		priv->bg_operation = mate_panel_applet_container_child_set (priv->container,
-						  "background",
-						  g_variant_new_string (bg_str),
-						  NULL,
-						  container_child_background_set,
-						  dbus_frame);
+	mate_panel_applet_frame_dbus_queue_property (dbus_frame,
+						     "size", g_variant_new_uint32 (size));
+}
 
-		g_free (bg_str);
-	}
+static void
+mate_panel_applet_frame_dbus_change_background (MatePanelAppletFrame    *frame,
+					   PanelBackgroundType  type)
+{
+	mate_panel_applet_frame_dbus_queue_background (MATE_PANEL_APPLET_FRAME_DBUS (frame));
 }
 
 static void
@@ -321,13 +445,18 @@ mate_panel_applet_frame_dbus_applet_lock (MatePanelAppletContainer *container,
 }
 
 static void
-mate_panel_applet_frame_dbus_finalize (GObject *object)
+mate_panel_applet_frame_dbus_dispose (GObject *object)
 {
 	MatePanelAppletFrameDBus *frame = MATE_PANEL_APPLET_FRAME_DBUS (object);
 
-	frame->priv->bg_operation = NULL;
+	if (frame->priv->pending_properties_id != 0) {
+		g_source_remove (frame->priv->pending_properties_id);
+		frame->priv->pending_properties_id = 0;
+	}
+
+	g_clear_pointer (&frame->priv->pending_properties, g_variant_dict_unref);
 
-	G_OBJECT_CLASS (mate_panel_applet_frame_dbus_parent_class)->finalize (object);
+	G_OBJECT_CLASS (mate_panel_applet_frame_dbus_parent_class)->dispose (object);
 }
 
 static void
@@ -341,7 +470,10 @@ mate_panel_applet_frame_dbus_init (MatePanelAppletFrameDBus *frame)
 	gtk_widget_show (container);
 	gtk_container_add (GTK_CONTAINER (frame), container);
 	frame->priv->container = MATE_PANEL_APPLET_CONTAINER (container);
-	frame->priv->bg_operation = NULL;
+	frame->priv->pending_properties = NULL;
+	frame->priv->pending_orient = FALSE;
+	frame->priv->pending_background = FALSE;
+	frame->priv->pending_properties_id = 0;
 
 	g_signal_connect (container, "child-property-changed::flags",
 			  G_CALLBACK (mate_panel_applet_frame_dbus_flags_changed),
@@ -369,7 +501,7 @@ mate_panel_applet_frame_dbus_class_init (MatePanelAppletFrameDBusClass *class)
 	GObjectClass *gobject_class = G_OBJECT_CLASS (class);
 	MatePanelAppletFrameClass *frame_class = MATE_PANEL_APPLET_FRAME_CLASS (class);
 
-	gobject_class->finalize = mate_panel_applet_frame_dbus_finalize;
+	gobject_class->dispose = mate_panel_applet_frame_dbus_dispose;
 
 	frame_class->init_properties = mate_panel_applet_frame_dbus_init_properties;
 	frame_class->sync_menu_state = mate_panel_applet_frame_dbus_sync_menu_state;
@@ -23,7 +23,10 @@
 
 #include <config.h>
 
+#include <errno.h>
+
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <gmodule.h>
 #include <string.h>
 
@@ -43,6 +46,9 @@ struct _MatePanelAppletsManagerDBusPrivate
 {
 	GHashTable *applet_factories;
 	GList      *monitors;
+	/* filename -> MatePanelAppletFileStamp of the applet files as they
+	 * were when last read */
+	GHashTable *file_stamps;
 };
 
 G_DEFINE_TYPE_WITH_CODE (MatePanelAppletsManagerDBus,
@@ -73,9 +79,27 @@ typedef struct _MatePanelAppletFactoryInfo {
 	gboolean            has_old_ids;
 } MatePanelAppletFactoryInfo;
 
+typedef struct {
+	/* in nanoseconds, where the system has them: package managers and
+	 * network file systems can rewrite a file within the same second */
+	gint64  mtime;
+	guint64 size;
+} MatePanelAppletFileStamp;
+
 #define MATE_PANEL_APPLET_FACTORY_GROUP "Applet Factory"
 #define MATE_PANEL_APPLETS_EXTENSION    ".mate-panel-applet"
 
+/* The parsed applet files are cached in a GVariant, that can be mapped
+ * from the disk and is only used if none of the applet files and
+ * directories changed since it was written. Bump the version when
+ * changing the format. */
+#define MATE_PANEL_APPLETS_CACHE_VERSION 2
+#define MATE_PANEL_APPLETS_CACHE_FILE    "applets.cache"
+#define MATE_PANEL_APPLETS_CACHE_APPLET_TYPE  "(smsmsmsasbb)"
+#define MATE_PANEL_APPLETS_CACHE_FACTORY_TYPE "(smsbsba" MATE_PANEL_APPLETS_CACHE_APPLET_TYPE ")"
+#define MATE_PANEL_APPLETS_CACHE_TYPE \
+	"(ussasa(sxt)a" MATE_PANEL_APPLETS_CACHE_FACTORY_TYPE ")"
+
 static void
 mate_panel_applet_factory_info_free (MatePanelAppletFactoryInfo *info)
 {
@@ -266,6 +290,323 @@ mate_panel_applets_manager_get_applets_dirs (void)
 	return g_slist_reverse (retval);
 }
 
+static gboolean
+mate_panel_applet_file_stamp_get (const gchar              *filename,
+				  MatePanelAppletFileStamp *stamp)
+{
+	GStatBuf buf;
+
+	if (g_stat (filename, &buf) != 0) {
+		stamp->mtime = -1;
+		stamp->size = 0;
+		return FALSE;
+	}
+
+	stamp->mtime = (gint64) buf.st_mtime * G_GINT64_CONSTANT (1000000000);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	stamp->mtime += buf.st_mtim.tv_nsec;
+#endif
+	stamp->size = (guint64) buf.st_size;
+
+	return TRUE;
+}
+
+static void
+mate_panel_applets_manager_dbus_set_file_stamp (MatePanelAppletsManagerDBus    *manager,
+						const gchar                    *filename,
+						const MatePanelAppletFileStamp *stamp)
+{
+	MatePanelAppletFileStamp *copy;
+
+	copy = g_new (MatePanelAppletFileStamp, 1);
+	*copy = *stamp;
+
+	g_hash_table_replace (manager->priv->file_stamps, g_strdup (filename), copy);
+}
+
+static gchar *
+mate_panel_applets_manager_dbus_get_cache_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "mate-panel",
+				 MATE_PANEL_APPLETS_CACHE_FILE, NULL);
+}
+
+/* The names and descriptions are localized, and the location of
+ * in-process applets depends on the environment */
+static gchar *
+mate_panel_applets_manager_dbus_get_cache_languages (void)
+{
+	return g_strjoinv (":", (gchar **) g_get_language_names ());
+}
+
+static const gchar *
+mate_panel_applets_manager_dbus_get_lib_prefix (void)
+{
+	const gchar *lib_prefix;
+
+	lib_prefix = g_getenv ("MATE_PANEL_APPLET_LIB_PREFIX");
+
+	return lib_prefix ? lib_prefix : "";
+}
+
+static gboolean
+mate_panel_applets_manager_dbus_cache_is_valid (GVariant *cache,
+						GSList   *dirs)
+{
+	GVariant     *child;
+	GVariantIter  iter;
+	const gchar  *str;
+	gchar        *languages;
+	gboolean      valid;
+	GSList       *d;
+
+	child = g_variant_get_child_value (cache, 0);
+	valid = g_variant_get_uint32 (child) == MATE_PANEL_APPLETS_CACHE_VERSION;
+	g_variant_unref (child);
+	if (!valid)
+		return FALSE;
+
+	languages = mate_panel_applets_manager_dbus_get_cache_languages ();
+	g_variant_get_child (cache, 1, "&s", &str);
+	valid = g_strcmp0 (str, languages) == 0;
+	g_free (languages);
+	if (!valid)
+		return FALSE;
+
+	g_variant_get_child (cache, 2, "&s", &str);
+	if (g_strcmp0 (str, mate_panel_applets_manager_dbus_get_lib_prefix ()) != 0)
+		return FALSE;
+
+	/* same directories, in the same order of precedence */
+	child = g_variant_get_child_value (cache, 3);
+	g_variant_iter_init (&iter, child);
+	d = dirs;
+	while (valid && g_variant_iter_next (&iter, "&s", &str)) {
+		valid = (d != NULL && g_strcmp0 (str, d->data) == 0);
+		if (d)
+			d = d->next;
+	}
+	g_variant_unref (child);
+	if (!valid || d != NULL)
+		return FALSE;
+
+	/* the directories change when files are added or removed, and the
+	 * files when they are modified */
+	child = g_variant_get_child_value (cache, 4);
+	g_variant_iter_init (&iter, child);
+	while (valid) {
+		MatePanelAppletFileStamp stamp;
+		gint64                   mtime;
+		guint64                  size;
+
+		if (!g_variant_iter_next (&iter, "(&sxt)", &str, &mtime, &size))
+			break;
+
+		mate_panel_applet_file_stamp_get (str, &stamp);
+		valid = (stamp.mtime == mtime && stamp.size == size);
+	}
+	g_variant_unref (child);
+
+	return valid;
+}
+
+static MatePanelAppletFactoryInfo *
+mate_panel_applet_factory_info_from_variant (GVariant *variant)
+{
+	MatePanelAppletFactoryInfo *info;
+	GVariantIter               *applets;
+	const gchar                *iid;
+	const gchar                *name;
+	const gchar                *comment;
+	const gchar                *icon;
+	const gchar               **old_ids;
+	gboolean                    x11_supported;
+	gboolean                    wayland_supported;
+
+	info = g_slice_new0 (MatePanelAppletFactoryInfo);
+
+	g_variant_get (variant, "(smsbsba" MATE_PANEL_APPLETS_CACHE_APPLET_TYPE ")",
+		       &info->id, &info->location, &info->in_process,
+		       &info->srcdir, &info->has_old_ids, &applets);
+
+	while (g_variant_iter_next (applets, "(&sm&sm&sm&s^a&sbb)",
+				    &iid, &name, &comment, &icon, &old_ids,
+				    &x11_supported, &wayland_supported)) {
+		MatePanelAppletInfo *ainfo;
+
+		ainfo = mate_panel_applet_info_new (iid, name, comment, icon, old_ids,
+						    x11_supported, wayland_supported);
+		info->applet_list = g_list_prepend (info->applet_list, ainfo);
+		g_free (old_ids);
+	}
+	g_variant_iter_free (applets);
+
+	info->applet_list = g_list_reverse (info->applet_list);
+
+	return info;
+}
+
+static GVariant *
+mate_panel_applet_factory_info_to_variant (MatePanelAppletFactoryInfo *info)
+{
+	GVariantBuilder applets;
+	GList          *l;
+
+	g_variant_builder_init (&applets, G_VARIANT_TYPE ("a" MATE_PANEL_APPLETS_CACHE_APPLET_TYPE));
+
+	for (l = info->applet_list; l; l = g_list_next (l)) {
+		MatePanelAppletInfo *ainfo = l->data;
+		const gchar * const *old_ids;
+		const gchar * const  no_ids[] = { NULL };
+
+		old_ids = mate_panel_applet_info_get_old_ids (ainfo);
+
+		g_variant_builder_add (&applets, "(smsmsms^asbb)",
+				       mate_panel_applet_info_get_iid (ainfo),
+				       mate_panel_applet_info_get_name (ainfo),
+				       mate_panel_applet_info_get_description (ainfo),
+				       mate_panel_applet_info_get_icon (ainfo),
+				       old_ids ? old_ids : no_ids,
+				       mate_panel_applet_info_get_x11_supported (ainfo),
+				       mate_panel_applet_info_get_wayland_supported (ainfo));
+	}
+
+	return g_variant_new ("(smsbsba" MATE_PANEL_APPLETS_CACHE_APPLET_TYPE ")",
+			      info->id, info->location, info->in_process,
+			      info->srcdir, info->has_old_ids, &applets);
+}
+
+static gboolean
+mate_panel_applets_manager_dbus_load_cache (MatePanelAppletsManagerDBus *manager,
+					    GSList                      *dirs)
+{
+	GMappedFile  *mapped;
+	GBytes       *bytes;
+	GVariant     *cache;
+	GVariant     *child;
+	GVariantIter  iter;
+	GVariant     *factory;
+	const gchar  *filename;
+	gint64        mtime;
+	guint64       size;
+	gchar        *cache_filename;
+
+	cache_filename = mate_panel_applets_manager_dbus_get_cache_filename ();
+	mapped = g_mapped_file_new (cache_filename, FALSE, NULL);
+	g_free (cache_filename);
+
+	if (!mapped)
+		return FALSE;
+
+	bytes = g_mapped_file_get_bytes (mapped);
+	g_mapped_file_unref (mapped);
+
+	cache = g_variant_new_from_bytes (G_VARIANT_TYPE (MATE_PANEL_APPLETS_CACHE_TYPE),
+					  bytes, FALSE);
+	g_bytes_unref (bytes);
+	g_variant_ref_sink (cache);
+
+	if (!mate_panel_applets_manager_dbus_cache_is_valid (cache, dirs)) {
+		g_variant_unref (cache);
+		return FALSE;
+	}
+
+	child = g_variant_get_child_value (cache, 4);
+	g_variant_iter_init (&iter, child);
+	while (g_variant_iter_next (&iter, "(&sxt)", &filename, &mtime, &size)) {
+		MatePanelAppletFileStamp stamp;
+
+		stamp.mtime = mtime;
+		stamp.size = size;
+		mate_panel_applets_manager_dbus_set_file_stamp (manager, filename, &stamp);
+	}
+	g_variant_unref (child);
+
+	child = g_variant_get_child_value (cache, 5);
+	g_variant_iter_init (&iter, child);
+	while ((factory = g_variant_iter_next_value (&iter))) {
+		MatePanelAppletFactoryInfo *info;
+
+		info = mate_panel_applet_factory_info_from_variant (factory);
+		g_variant_unref (factory);
+
+		if (!info->applet_list ||
+		    g_hash_table_lookup (manager->priv->applet_factories, info->id)) {
+			mate_panel_applet_factory_info_free (info);
+			continue;
+		}
+
+		g_hash_table_insert (manager->priv->applet_factories, g_strdup (info->id), info);
+	}
+	g_variant_unref (child);
+
+	g_variant_unref (cache);
+
+	return TRUE;
+}
+
+static void
+mate_panel_applets_manager_dbus_save_cache (MatePanelAppletsManagerDBus *manager,
+					    GSList                      *dirs)
+{
+	GVariantBuilder  dirs_builder;
+	GVariantBuilder  stamps;
+	GVariantBuilder  factories;
+	GHashTableIter   iter;
+	gpointer         key, value;
+	GVariant        *cache;
+	gchar           *languages;
+	gchar           *cache_filename;
+	gchar           *cache_dir;
+	GError          *error = NULL;
+	GSList          *d;
+
+	g_variant_builder_init (&dirs_builder, G_VARIANT_TYPE_STRING_ARRAY);
+	for (d = dirs; d; d = g_slist_next (d))
+		g_variant_builder_add (&dirs_builder, "s", (const gchar *) d->data);
+
+	g_variant_builder_init (&stamps, G_VARIANT_TYPE ("a(sxt)"));
+	g_hash_table_iter_init (&iter, manager->priv->file_stamps);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		MatePanelAppletFileStamp *stamp = value;
+
+		g_variant_builder_add (&stamps, "(sxt)", (const gchar *) key,
+				       stamp->mtime, stamp->size);
+	}
+
+	g_variant_builder_init (&factories, G_VARIANT_TYPE ("a" MATE_PANEL_APPLETS_CACHE_FACTORY_TYPE));
+	g_hash_table_iter_init (&iter, manager->priv->applet_factories);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add_value (&factories,
+					     mate_panel_applet_factory_info_to_variant (value));
+
+	languages = mate_panel_applets_manager_dbus_get_cache_languages ();
+	cache = g_variant_new ("(ussasa(sxt)a" MATE_PANEL_APPLETS_CACHE_FACTORY_TYPE ")",
+			       MATE_PANEL_APPLETS_CACHE_VERSION,
+			       languages,
+			       mate_panel_applets_manager_dbus_get_lib_prefix (),
+			       &dirs_builder, &stamps, &factories);
+	g_variant_ref_sink (cache);
+	g_free (languages);
+
+	cache_filename = mate_panel_applets_manager_dbus_get_cache_filename ();
+	cache_dir = g_path_get_dirname (cache_filename);
+
+	if (g_mkdir_with_parents (cache_dir, 0700) != 0 ||
+	    !g_file_set_contents (cache_filename,
+				  g_variant_get_data (cache),
+				  g_variant_get_size (cache),
+				  &error)) {
+		g_debug ("Could not write the applets cache %s: %s", cache_filename,
+			 error ? error->message : g_strerror (errno));
+		g_clear_error (&error);
+	}
+
+	g_free (cache_dir);
+	g_free (cache_filename);
+	g_variant_unref (cache);
+}
+
 static void
 applets_directory_changed (GFileMonitor     *monitor,
 			   GFile            *file,
@@ -280,6 +621,8 @@ applets_directory_changed (GFileMonitor     *monitor,
 	case G_FILE_MONITOR_EVENT_CREATED: {
 		MatePanelAppletFactoryInfo *info;
 		MatePanelAppletFactoryInfo *old_info;
+		MatePanelAppletFileStamp    stamp;
+		MatePanelAppletFileStamp   *old_stamp;
 		gchar                  *filename;
 		GSList                 *dirs, *d;
 
@@ -289,6 +632,18 @@ applets_directory_changed (GFileMonitor     *monitor,
 			return;
 		}
 
+		/* a single write emits several events: only read the file
+		 * again if it changed since it was last read */
+		mate_panel_applet_file_stamp_get (filename, &stamp);
+		old_stamp = g_hash_table_lookup (manager->priv->file_stamps, filename);
+		if (old_stamp &&
+		    old_stamp->mtime == stamp.mtime &&
+		    old_stamp->size == stamp.size) {
+			g_free (filename);
+			return;
+		}
+		mate_panel_applets_manager_dbus_set_file_stamp (manager, filename, &stamp);
+
 		info = mate_panel_applets_manager_get_applet_factory_info_from_file (filename);
 		g_free (filename);
 
@@ -337,27 +692,16 @@ static void
 mate_panel_applets_manager_dbus_load_applet_infos (MatePanelAppletsManagerDBus *manager)
 {
 	GSList *dirs;
+	GSList *d;
 
 	dirs = mate_panel_applets_manager_get_applets_dirs ();
-	for (GSList *d = dirs; d; d = g_slist_next (d)) {
-		GDir         *dir;
-		const gchar  *dirent;
+
+	/* Monitor dirs */
+	for (d = dirs; d; d = g_slist_next (d)) {
 		GFileMonitor *monitor;
 		GFile        *dir_file;
-		GError       *error = NULL;
-		gchar        *path = (gchar *) d->data;
 
-		dir = g_dir_open (path, 0, &error);
-		if (!dir) {
-			g_warning ("%s", error->message);
-			g_error_free (error);
-			g_free (path);
-
-			continue;
-		}
-
-		/* Monitor dir */
-		dir_file = g_file_new_for_path (path);
+		dir_file = g_file_new_for_path ((gchar *) d->data);
 		monitor = g_file_monitor_directory (dir_file,
 						    G_FILE_MONITOR_NONE,
 						    NULL, NULL);
@@ -368,6 +712,32 @@ mate_panel_applets_manager_dbus_load_applet_infos (MatePanelAppletsManagerDBus *
 			manager->priv->monitors = g_list_prepend (manager->priv->monitors, monitor);
 		}
 		g_object_unref (dir_file);
+	}
+
+	if (mate_panel_applets_manager_dbus_load_cache (manager, dirs)) {
+		g_slist_free_full (dirs, g_free);
+		return;
+	}
+
+	for (d = dirs; d; d = g_slist_next (d)) {
+		GDir                     *dir;
+		const gchar              *dirent;
+		MatePanelAppletFileStamp  stamp;
+		GError                   *error = NULL;
+		gchar                    *path = (gchar *) d->data;
+
+		/* the directory stamp tells whether files were added or
+		 * removed, even if it can't be opened now */
+		mate_panel_applet_file_stamp_get (path, &stamp);
+		mate_panel_applets_manager_dbus_set_file_stamp (manager, path, &stamp);
+
+		dir = g_dir_open (path, 0, &error);
+		if (!dir) {
+			g_warning ("%s", error->message);
+			g_error_free (error);
+
+			continue;
+		}
 
 		while ((dirent = g_dir_read_name (dir))) {
 			MatePanelAppletFactoryInfo *info;
@@ -377,6 +747,8 @@ mate_panel_applets_manager_dbus_load_applet_infos (MatePanelAppletsManagerDBus *
 				continue;
 
 			file = g_build_filename (path, dirent, NULL);
+			mate_panel_applet_file_stamp_get (file, &stamp);
+			mate_panel_applets_manager_dbus_set_file_stamp (manager, file, &stamp);
 			info = mate_panel_applets_manager_get_applet_factory_info_from_file (file);
 			g_free (file);
 
@@ -392,10 +764,11 @@ mate_panel_applets_manager_dbus_load_applet_infos (MatePanelAppletsManagerDBus *
 		}
 
 		g_dir_close (dir);
-		g_free (path);
 	}
 
-	g_slist_free (dirs);
+	mate_panel_applets_manager_dbus_save_cache (manager, dirs);
+
+	g_slist_free_full (dirs, g_free);
 }
 
 static GList *
@@ -658,6 +1031,11 @@ mate_panel_applets_manager_dbus_finalize (GObject *object)
 		manager->priv->applet_factories = NULL;
 	}
 
+	if (manager->priv->file_stamps) {
+		g_hash_table_destroy (manager->priv->file_stamps);
+		manager->priv->file_stamps = NULL;
+	}
+
 	G_OBJECT_CLASS (mate_panel_applets_manager_dbus_parent_class)->finalize (object);
 }
 
@@ -670,6 +1048,10 @@ mate_panel_applets_manager_dbus_init (MatePanelAppletsManagerDBus *manager)
 								 g_str_equal,
 								 (GDestroyNotify) g_free,
 								 (GDestroyNotify) mate_panel_applet_factory_info_free);
+	manager->priv->file_stamps = g_hash_table_new_full (g_str_hash,
+							    g_str_equal,
+							    (GDestroyNotify) g_free,
+							    (GDestroyNotify) g_free);
 
 	mate_panel_applets_manager_dbus_load_applet_infos (manager);
 }
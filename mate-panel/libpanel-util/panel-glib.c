@@ -102,63 +102,108 @@ panel_g_lookup_in_applications_dirs (const char *basename)
 						      _lookup_in_applications_subdir);
 }
 
-/* Copied from evolution-data-server/libedataserver/e-util.c:
- * e_util_unicode_get_utf8() */
-static char *
-_unicode_get_utf8 (const char *text, gunichar *out)
+/* Search keys are normalized and casefolded copies of the text, so that
+ * a key built from a search text can be looked for in the keys built
+ * from the items with a plain byte comparison: build the keys of the
+ * items once, and a PanelGUtf8Needle once per search text, and nothing
+ * needs to be allocated to compare them. */
+
+struct _PanelGUtf8Needle {
+	char  *key;
+	gsize  len;
+};
+
+/* Returns the search key of @text, or NULL if @text is NULL. Invalid
+ * UTF-8 gives an empty key. */
+char *
+panel_g_utf8_make_search_key (const char *text)
+{
+	const char *p;
+	char       *normalized;
+	char       *key;
+
+	if (text == NULL)
+		return NULL;
+
+	/* ASCII is left as is by the normalization, and casefolds to
+	 * lowercase: this is the case of most of the texts */
+	for (p = text; *p && !(*p & 0x80); p++)
+		;
+	if (!*p)
+		return g_ascii_strdown (text, p - text);
+
+	normalized = g_utf8_normalize (text, -1, G_NORMALIZE_ALL);
+	if (normalized == NULL)
+		return g_strdup ("");
+
+	key = g_utf8_casefold (normalized, -1);
+	g_free (normalized);
+
+	return key;
+}
+
+PanelGUtf8Needle *
+panel_g_utf8_needle_new (const char *text)
+{
+	PanelGUtf8Needle *needle;
+
+	needle = g_new0 (PanelGUtf8Needle, 1);
+	needle->key = panel_g_utf8_make_search_key (text ? text : "");
+	needle->len = strlen (needle->key);
+
+	return needle;
+}
+
+void
+panel_g_utf8_needle_free (PanelGUtf8Needle *needle)
 {
-	*out = g_utf8_get_char (text);
-	return (*out == (gunichar)-1) ? NULL : g_utf8_next_char (text);
+	if (needle == NULL)
+		return;
+
+	g_free (needle->key);
+	g_free (needle);
 }
 
-/* Copied from evolution-data-server/libedataserver/e-util.c:
- * e_util_utf8_strstrcase() */
 const char *
-panel_g_utf8_strstrcase (const char *haystack, const char *needle)
+panel_g_utf8_needle_get_key (const PanelGUtf8Needle *needle)
 {
-	gunichar *nuni;
-	gunichar unival;
-	gint nlen;
-	const char *o, *p;
-
-	if (haystack == NULL) return NULL;
-	if (needle == NULL) return NULL;
-	if (strlen (needle) == 0) return haystack;
-	if (strlen (haystack) == 0) return NULL;
-
-	nuni = g_alloca (sizeof (gunichar) * strlen (needle));
-
-	nlen = 0;
-	for (p = _unicode_get_utf8 (needle, &unival);
-	     p && unival;
-	     p = _unicode_get_utf8 (p, &unival)) {
-		nuni[nlen++] = g_unichar_tolower (unival);
-	}
-	/* NULL means there was illegal utf-8 sequence */
-	if (!p) return NULL;
-
-	o = haystack;
-	for (p = _unicode_get_utf8 (o, &unival);
-	     p && unival;
-	     p = _unicode_get_utf8 (p, &unival)) {
-		gint sc;
-		sc = g_unichar_tolower (unival);
-		/* We have valid stripped char */
-		if (sc == nuni[0]) {
-			const char *q = p;
-			gint npos = 1;
-			while (npos < nlen) {
-				q = _unicode_get_utf8 (q, &unival);
-				if (!q || !unival) return NULL;
-				sc = g_unichar_tolower (unival);
-				if (sc != nuni[npos]) break;
-				npos++;
-			}
-			if (npos == nlen) {
-				return o;
-			}
-		}
-		o = p;
+	g_return_val_if_fail (needle != NULL, NULL);
+
+	return needle->key;
+}
+
+/* Returns where @needle is found in @key, a search key made with
+ * panel_g_utf8_make_search_key(), or NULL. An empty needle is found at
+ * the start of any key. */
+const char *
+panel_g_utf8_needle_find (const PanelGUtf8Needle *needle,
+			  const char             *key)
+{
+	const char *p;
+	const char *last;
+	gsize       key_len;
+
+	g_return_val_if_fail (needle != NULL, NULL);
+
+	if (key == NULL)
+		return NULL;
+
+	if (needle->len == 0)
+		return key;
+
+	key_len = strlen (key);
+	if (key_len < needle->len)
+		return NULL;
+
+	/* both are valid UTF-8, so a match can only start on a
+	 * character: look for the first byte with memchr(), which is
+	 * vectorized by the C library, and compare the rest */
+	last = key + key_len - needle->len;
+	for (p = key;
+	     p <= last && (p = memchr (p, needle->key[0], last - p + 1)) != NULL;
+	     p++) {
+		if (memcmp (p + 1, needle->key + 1, needle->len - 1) == 0)
+			return p;
 	}
 
 	return NULL;
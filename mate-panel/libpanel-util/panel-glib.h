@@ -37,8 +37,15 @@ extern "C" {
 char       *panel_g_lookup_in_data_dirs         (const char *basename);
 char       *panel_g_lookup_in_applications_dirs (const char *basename);
 
-const char *panel_g_utf8_strstrcase             (const char *haystack,
-						 const char *needle);
+typedef struct _PanelGUtf8Needle PanelGUtf8Needle;
+
+char             *panel_g_utf8_make_search_key (const char             *text);
+
+PanelGUtf8Needle *panel_g_utf8_needle_new      (const char             *text);
+void              panel_g_utf8_needle_free     (PanelGUtf8Needle       *needle);
+const char       *panel_g_utf8_needle_get_key  (const PanelGUtf8Needle *needle);
+const char       *panel_g_utf8_needle_find     (const PanelGUtf8Needle *needle,
+						const char             *key);
 
 #ifdef __cplusplus
 }
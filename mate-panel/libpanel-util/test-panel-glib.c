@@ -0,0 +1,188 @@
+/* Test for the search keys of panel-glib
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include "panel-glib.h"
+
+/* Returns whether @text is found in @haystack, both going through the
+ * search keys like the Run dialog does. */
+static gboolean
+search (const char *text,
+	const char *haystack)
+{
+	PanelGUtf8Needle *needle;
+	char             *key;
+	gboolean          found;
+
+	needle = panel_g_utf8_needle_new (text);
+	key = panel_g_utf8_make_search_key (haystack);
+
+	found = panel_g_utf8_needle_find (needle, key) != NULL;
+
+	g_free (key);
+	panel_g_utf8_needle_free (needle);
+
+	return found;
+}
+
+static void
+assert_search_key (const char *text,
+		   const char *expected)
+{
+	char *key;
+
+	key = panel_g_utf8_make_search_key (text);
+	g_assert_cmpstr (key, ==, expected);
+	g_free (key);
+}
+
+static void
+test_ascii (void)
+{
+	assert_search_key ("Terminal", "terminal");
+	assert_search_key ("MATE-Terminal 2", "mate-terminal 2");
+
+	g_assert_true (search ("term", "MATE Terminal"));
+	g_assert_true (search ("TERM", "mate terminal"));
+	g_assert_true (search ("terminal", "Terminal"));
+	g_assert_false (search ("terminals", "Terminal"));
+	g_assert_false (search ("xterm", "Terminal"));
+}
+
+static void
+test_sharp_s (void)
+{
+	/* ß casefolds to ss, in the needle and in the haystack */
+	assert_search_key ("Straße", "strasse");
+
+	g_assert_true (search ("strasse", "Straße"));
+	g_assert_true (search ("STRASSE", "Straße"));
+	g_assert_true (search ("straße", "STRASSE"));
+	g_assert_true (search ("ss", "Fuß"));
+	g_assert_false (search ("ß", "Fus"));
+}
+
+static void
+test_combining_marks (void)
+{
+	/* é precomposed, and e followed by a combining acute accent */
+	const char *precomposed = "Caf\xc3\xa9";
+	const char *decomposed = "Cafe\xcc\x81";
+	char       *precomposed_key;
+	char       *decomposed_key;
+
+	precomposed_key = panel_g_utf8_make_search_key (precomposed);
+	decomposed_key = panel_g_utf8_make_search_key (decomposed);
+	g_assert_cmpstr (precomposed_key, ==, decomposed_key);
+	g_free (precomposed_key);
+	g_free (decomposed_key);
+
+	g_assert_true (search (precomposed, decomposed));
+	g_assert_true (search (decomposed, precomposed));
+	g_assert_true (search ("CAF\xc3\x89", "caf\xc3\xa9"));
+
+	/* compatibility forms: the "fi" ligature and a fullwidth letter */
+	g_assert_true (search ("fi", "\xef\xac\x81le"));
+	g_assert_true (search ("a", "\xef\xbc\xa1"));
+
+	g_assert_false (search ("caf\xc3\xa8", precomposed));
+}
+
+static void
+test_invalid_utf8 (void)
+{
+	PanelGUtf8Needle *needle;
+	char             *key;
+
+	/* invalid UTF-8 gives an empty key, which matches nothing but the
+	 * empty needle */
+	assert_search_key ("abc\xff", "");
+	assert_search_key ("\xc3", "");
+
+	needle = panel_g_utf8_needle_new ("\xfe\xff");
+	g_assert_cmpstr (panel_g_utf8_needle_get_key (needle), ==, "");
+	panel_g_utf8_needle_free (needle);
+
+	g_assert_false (search ("abc", "abc\xff"));
+
+	key = panel_g_utf8_make_search_key ("abc\xff");
+	needle = panel_g_utf8_needle_new ("a");
+	g_assert_null (panel_g_utf8_needle_find (needle, key));
+	panel_g_utf8_needle_free (needle);
+	g_free (key);
+}
+
+static void
+test_empty (void)
+{
+	PanelGUtf8Needle *needle;
+	const char       *key = "terminal";
+
+	assert_search_key ("", "");
+	g_assert_null (panel_g_utf8_make_search_key (NULL));
+
+	/* an empty needle is found at the start of any key */
+	needle = panel_g_utf8_needle_new ("");
+	g_assert_true (panel_g_utf8_needle_find (needle, key) == key);
+	g_assert_true (panel_g_utf8_needle_find (needle, "") != NULL);
+	g_assert_null (panel_g_utf8_needle_find (needle, NULL));
+	panel_g_utf8_needle_free (needle);
+
+	needle = panel_g_utf8_needle_new (NULL);
+	g_assert_cmpstr (panel_g_utf8_needle_get_key (needle), ==, "");
+	panel_g_utf8_needle_free (needle);
+
+	/* and nothing else is found in an empty key */
+	needle = panel_g_utf8_needle_new ("a");
+	g_assert_null (panel_g_utf8_needle_find (needle, ""));
+	g_assert_null (panel_g_utf8_needle_find (needle, NULL));
+	panel_g_utf8_needle_free (needle);
+
+	panel_g_utf8_needle_free (NULL);
+}
+
+static void
+test_position (void)
+{
+	PanelGUtf8Needle *needle;
+	const char       *key = "xterm terminal";
+
+	needle = panel_g_utf8_needle_new ("term");
+	g_assert_true (panel_g_utf8_needle_find (needle, key) == key + 1);
+	panel_g_utf8_needle_free (needle);
+
+	/* a needle at the very end of the key */
+	needle = panel_g_utf8_needle_new ("nal");
+	g_assert_true (panel_g_utf8_needle_find (needle, key) == key + 11);
+	panel_g_utf8_needle_free (needle);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/panel-glib/search-key/ascii", test_ascii);
+	g_test_add_func ("/panel-glib/search-key/sharp-s", test_sharp_s);
+	g_test_add_func ("/panel-glib/search-key/combining-marks", test_combining_marks);
+	g_test_add_func ("/panel-glib/search-key/invalid-utf8", test_invalid_utf8);
+	g_test_add_func ("/panel-glib/search-key/empty", test_empty);
+	g_test_add_func ("/panel-glib/search-key/position", test_position);
+
+	return g_test_run ();
+}
@@ -13,7 +13,7 @@
 
 /* FIXME Symbols needed by panel-util.c - sucky */
 #include "applet.h"
-GSList *mate_panel_applet_list_applets (void) { return NULL; }
+GList *mate_panel_applet_list_applets (void) { return NULL; }
 #include "panel-config-global.h"
 gboolean panel_global_config_get_tooltips_enabled (void) { return FALSE; }
 #include "panel-lockdown.h"
@@ -48,6 +48,8 @@
 #include "panel-profile.h"
 #include "panel-menu-button.h"
 #include "panel-menu-items.h"
+#include "panel-menu-snapshot.h"
+#include "panel-app-catalog.h"
 #include "panel-globals.h"
 #include "panel-run-dialog.h"
 #include "panel-lockdown.h"
@@ -56,6 +58,9 @@
 
 static GtkWidget *populate_menu_from_directory (GtkWidget          *menu,
 						MateMenuTreeDirectory *directory);
+static void populate_menu_from_snapshot (GtkWidget         *menu,
+					 PanelMenuSnapshot *snapshot,
+					 int                parent);
 
 static gboolean panel_menu_key_press_handler (GtkWidget   *widget,
 					      GdkEventKey *event);
@@ -859,28 +864,22 @@ submenu_to_display (GtkWidget *menu)
 {
 	void      (*append_callback) (GtkWidget *, gpointer);
 	gpointer  append_data;
+	PanelMenuSnapshot *snapshot = NULL;
 
 	if (!g_object_get_data (G_OBJECT (menu), "panel-menu-needs-loading"))
 		return;
 
-	g_object_set_data (G_OBJECT (menu), "panel-menu-needs-loading", NULL);
-
 	MateMenuTreeDirectory *directory =
 		g_object_get_data (G_OBJECT (menu),
 		                   "panel-menu-tree-directory");
-	if (!directory) {
-		const char *menu_path =
-			g_object_get_data (G_OBJECT (menu),
-		                           "panel-menu-tree-path");
-		if (!menu_path)
-			return;
-
-		MateMenuTree *tree =
-			g_object_get_data (G_OBJECT (menu),
-			                   "panel-menu-tree");
-		if (!tree)
-			return;
+	const char *menu_path =
+		g_object_get_data (G_OBJECT (menu),
+		                   "panel-menu-tree-path");
+	MateMenuTree *tree =
+		g_object_get_data (G_OBJECT (menu),
+		                   "panel-menu-tree");
 
+	if (!directory && menu_path && tree) {
 		directory = matemenu_tree_get_directory_from_path (tree, menu_path);
 
 		g_object_set_data_full (G_OBJECT (menu),
@@ -889,8 +888,27 @@ submenu_to_display (GtkWidget *menu)
 					(GDestroyNotify) matemenu_tree_item_unref);
 	}
 
+	if (!directory) {
+		snapshot = g_object_get_data (G_OBJECT (menu),
+					      "panel-menu-snapshot");
+
+		/* populated once the tree is loaded */
+		if (!snapshot &&
+		    g_object_get_data (G_OBJECT (menu), "panel-menu-tree-loading"))
+			return;
+	}
+
+	g_object_set_data (G_OBJECT (menu), "panel-menu-needs-loading", NULL);
+
+	if (!directory && !snapshot && (!menu_path || !tree))
+		return;
+
 	if (directory)
 		populate_menu_from_directory (menu, directory);
+	else if (snapshot)
+		populate_menu_from_snapshot (menu, snapshot,
+					     GPOINTER_TO_INT (g_object_get_data (G_OBJECT (menu),
+										 "panel-menu-snapshot-index")));
 
 	append_callback = g_object_get_data (G_OBJECT (menu),
 					     "panel-menu-append-callback");
@@ -920,19 +938,33 @@ remove_submenu_to_display_idle (gpointer data)
 	g_source_remove (idle_id);
 }
 
+static void
+queue_submenu_to_display (GtkWidget *menu)
+{
+	guint idle_id;
+
+	if (g_object_get_data (G_OBJECT (menu), "panel-menu-idle-id"))
+		return;
+
+	idle_id = g_idle_add_full (G_PRIORITY_LOW,
+				   submenu_to_display_in_idle,
+				   menu,
+				   NULL);
+	g_object_set_data_full (G_OBJECT (menu),
+				"panel-menu-idle-id",
+				GUINT_TO_POINTER (idle_id),
+				remove_submenu_to_display_idle);
+}
+
+/* A menu populated when it is first shown, or when the main loop is
+ * idle. */
 static GtkWidget *
-create_fake_menu (MateMenuTreeDirectory *directory)
+create_lazy_menu (void)
 {
 	GtkWidget *menu;
-	guint      idle_id;
 
 	menu = create_empty_menu ();
 
-	g_object_set_data_full (G_OBJECT (menu),
-				"panel-menu-tree-directory",
-				matemenu_tree_item_ref (directory),
-				(GDestroyNotify) matemenu_tree_item_unref);
-
 	g_object_set_data (G_OBJECT (menu),
 			   "panel-menu-needs-loading",
 			   GUINT_TO_POINTER (TRUE));
@@ -940,14 +972,7 @@ create_fake_menu (MateMenuTreeDirectory *directory)
 	g_signal_connect (menu, "show",
 			  G_CALLBACK (submenu_to_display), NULL);
 
-	idle_id = g_idle_add_full (G_PRIORITY_LOW,
-				   submenu_to_display_in_idle,
-				   menu,
-				   NULL);
-	g_object_set_data_full (G_OBJECT (menu),
-				"panel-menu-idle-id",
-				GUINT_TO_POINTER (idle_id),
-				remove_submenu_to_display_idle);
+	queue_submenu_to_display (menu);
 
 	g_signal_connect (menu, "button-press-event",
 			  G_CALLBACK (menu_dummy_button_press_event), NULL);
@@ -960,6 +985,22 @@ create_fake_menu (MateMenuTreeDirectory *directory)
 
 	return menu;
 }
+
+static GtkWidget *
+create_fake_menu (MateMenuTreeDirectory *directory)
+{
+	GtkWidget *menu;
+
+	menu = create_lazy_menu ();
+
+	g_object_set_data_full (G_OBJECT (menu),
+				"panel-menu-tree-directory",
+				matemenu_tree_item_ref (directory),
+				(GDestroyNotify) matemenu_tree_item_unref);
+
+	return menu;
+}
+
 GtkWidget *
 panel_image_menu_item_new (void)
 {
@@ -997,7 +1038,7 @@ create_submenu_entry (GtkWidget          *menu,
 	return menuitem;
 }
 
-static void
+static GtkWidget *
 create_submenu (GtkWidget          *menu,
 		MateMenuTreeDirectory *directory,
 		MateMenuTreeDirectory *alias_directory)
@@ -1021,9 +1062,11 @@ create_submenu (GtkWidget          *menu,
 	g_object_set_data (G_OBJECT (submenu),
 			   "panel-menu-force-icon-for-categories",
 			   GINT_TO_POINTER (force_categories_icon));
+
+	return menuitem;
 }
 
-static void
+static GtkWidget *
 create_header (GtkWidget       *menu,
 	       MateMenuTreeHeader *header)
 {
@@ -1041,9 +1084,45 @@ create_header (GtkWidget       *menu,
 
 	g_signal_connect (menuitem, "activate",
 			  G_CALLBACK (gtk_false), NULL);
+
+	return menuitem;
 }
 
 static void
+setup_menuitem_drag (GtkWidget         *menuitem,
+		     MateMenuTreeEntry *entry)
+{
+	GDesktopAppInfo *ginfo;
+	GIcon           *gicon;
+	static GtkTargetEntry menu_item_targets[] = {
+		{ "text/uri-list", 0, 0 }
+	};
+
+	if (panel_lockdown_get_locked_down ())
+		return;
+
+	gtk_drag_source_set (menuitem,
+			     GDK_BUTTON1_MASK | GDK_BUTTON2_MASK,
+			     menu_item_targets, 1,
+			     GDK_ACTION_COPY);
+
+	ginfo = matemenu_tree_entry_get_app_info (entry);
+	gicon = g_app_info_get_icon (G_APP_INFO (ginfo));
+	if (gicon != NULL)
+		gtk_drag_source_set_icon_gicon (menuitem, gicon);
+
+	g_signal_connect (menuitem, "drag-begin",
+			  G_CALLBACK (drag_begin_menu_cb),
+			  NULL);
+	g_signal_connect (menuitem, "drag-data-get",
+			  G_CALLBACK (drag_data_get_menu_cb),
+			  entry);
+	g_signal_connect (menuitem, "drag-end",
+			  G_CALLBACK (drag_end_menu_cb),
+			  NULL);
+}
+
+static GtkWidget *
 create_menuitem (GtkWidget          *menu,
 		 MateMenuTreeEntry     *entry,
 		 MateMenuTreeDirectory *alias_directory)
@@ -1099,37 +1178,7 @@ create_menuitem (GtkWidget          *menu,
 	g_signal_connect_after (menuitem, "button-press-event",
 				G_CALLBACK (menuitem_button_press_event), NULL);
 
-	if (!panel_lockdown_get_locked_down ()) {
-		static GtkTargetEntry menu_item_targets[] = {
-			{ "text/uri-list", 0, 0 }
-		};
-
-		gtk_drag_source_set (menuitem,
-				     GDK_BUTTON1_MASK | GDK_BUTTON2_MASK,
-				     menu_item_targets, 1,
-				     GDK_ACTION_COPY);
-
-		GDesktopAppInfo *ginfo;
-		ginfo = matemenu_tree_entry_get_app_info (entry);
-		if (g_app_info_get_icon (G_APP_INFO(ginfo)) != NULL) {
-			GIcon      *gicon;
-
-			gicon = g_app_info_get_icon (G_APP_INFO(ginfo));
-			if (gicon != NULL) {
-				gtk_drag_source_set_icon_gicon (menuitem, gicon);
-			}
-		}
-
-		g_signal_connect (menuitem, "drag-begin",
-		                  G_CALLBACK (drag_begin_menu_cb),
-		                  NULL);
-		g_signal_connect (menuitem, "drag-data-get",
-		                  G_CALLBACK (drag_data_get_menu_cb),
-		                  entry);
-		g_signal_connect (menuitem, "drag-end",
-		                  G_CALLBACK (drag_end_menu_cb),
-		                  NULL);
-	}
+	setup_menuitem_drag (menuitem, entry);
 
 	gtk_menu_shell_append (GTK_MENU_SHELL (menu), menuitem);
 
@@ -1137,25 +1186,28 @@ create_menuitem (GtkWidget          *menu,
 			  G_CALLBACK (activate_app_def), entry);
 
 	gtk_widget_show (menuitem);
+
+	return menuitem;
 }
 
-static void
+static GtkWidget *
 create_menuitem_from_alias (GtkWidget      *menu,
 			    MateMenuTreeAlias *alias)
 {
+	GtkWidget *menuitem = NULL;
 	gpointer item, entry;
 
 	switch (matemenu_tree_alias_get_aliased_item_type (alias)) {
 	case MATEMENU_TREE_ITEM_DIRECTORY:
 		item = matemenu_tree_alias_get_directory (alias);
-		create_submenu (menu, item, item);
+		menuitem = create_submenu (menu, item, item);
 		matemenu_tree_item_unref (item);
 		break;
 
 	case MATEMENU_TREE_ITEM_ENTRY:
 		entry = matemenu_tree_alias_get_aliased_entry(alias);
 		item = matemenu_tree_alias_get_directory (alias);
-		create_menuitem (menu, entry, item);
+		menuitem = create_menuitem (menu, entry, item);
 		matemenu_tree_item_unref (entry);
 		matemenu_tree_item_unref (item);
 		break;
@@ -1163,51 +1215,459 @@ create_menuitem_from_alias (GtkWidget      *menu,
 	default:
 		break;
 	}
+
+	return menuitem;
+}
+
+static GtkWidget *
+create_menuitem_from_tree_item (GtkWidget            *menu,
+				MateMenuTreeItemType  type,
+				gpointer              item)
+{
+	GtkWidget *menuitem = NULL;
+	char      *key;
+	char      *signature;
+
+	switch (type) {
+	case MATEMENU_TREE_ITEM_DIRECTORY:
+		menuitem = create_submenu (menu, item, NULL);
+		break;
+	case MATEMENU_TREE_ITEM_ENTRY:
+		menuitem = create_menuitem (menu, item, NULL);
+		break;
+	case MATEMENU_TREE_ITEM_SEPARATOR:
+		menuitem = add_menu_separator (menu);
+		break;
+	case MATEMENU_TREE_ITEM_ALIAS:
+		menuitem = create_menuitem_from_alias (menu, item);
+		break;
+	case MATEMENU_TREE_ITEM_HEADER:
+		menuitem = create_header (menu, item);
+		break;
+	default:
+		break;
+	}
+
+	if (!menuitem)
+		return NULL;
+
+	panel_app_catalog_item_get_key (type, item, &key, &signature);
+	g_object_set_data_full (G_OBJECT (menuitem),
+				"panel-menu-tree-item-key",
+				key ? key : g_strdup (""),
+				(GDestroyNotify) g_free);
+	g_object_set_data_full (G_OBJECT (menuitem),
+				"panel-menu-tree-item-signature",
+				signature,
+				(GDestroyNotify) g_free);
+
+	return menuitem;
 }
 
 static void
-handle_matemenu_tree_changed (MateMenuTree *tree,
-			   GtkWidget *menu)
+activate_snapshot_item (GtkWidget *menuitem,
+			gpointer   data)
 {
-	GError *error = NULL;
-	guint idle_id;
+	panel_menu_item_activate_desktop_file (menuitem,
+					       g_object_get_data (G_OBJECT (menuitem),
+								  "panel-menu-snapshot-path"));
+}
+
+/* Creates the menu items of the children of the item at @parent in
+ * @snapshot. They are replaced by the items of the tree, or bound to
+ * them if they didn't change, once it is loaded. */
+static void
+populate_menu_from_snapshot (GtkWidget         *menu,
+			     PanelMenuSnapshot *snapshot,
+			     int                parent)
+{
+	PanelMenuSnapshotItem  parent_item;
+	GList                 *children;
+	gboolean               add_separator;
+	gboolean               force_categories_icon;
+	guint                  i;
+
+	children = gtk_container_get_children (GTK_CONTAINER (menu));
+	add_separator = (children != NULL);
+	g_list_free (children);
+
+	force_categories_icon = g_object_get_data (G_OBJECT (menu),
+						   "panel-menu-force-icon-for-categories") != NULL;
+
+	/* the ranges of the items were checked when the snapshot was
+	 * loaded, so only the index of the menu is left to check */
+	if (parent < 0 || (guint) parent >= panel_menu_snapshot_get_n_items (snapshot))
+		return;
 
-	GList *list, *l;
-	list = gtk_container_get_children (GTK_CONTAINER (menu));
-	for (l = list; l; l = l->next)
+	panel_menu_snapshot_get_item (snapshot, parent, &parent_item);
+
+	for (i = parent_item.first_child;
+	     i < parent_item.first_child + parent_item.n_children;
+	     i++) {
+		PanelMenuSnapshotItem  item;
+		GtkWidget             *menuitem;
+		GtkWidget             *submenu;
+		GIcon                 *gicon;
+
+		panel_menu_snapshot_get_item (snapshot, i, &item);
+
+		if (add_separator && item.type != PANEL_MENU_SNAPSHOT_SEPARATOR)
+			add_menu_separator (menu);
+		add_separator = FALSE;
+
+		if (item.type == PANEL_MENU_SNAPSHOT_SEPARATOR) {
+			menuitem = add_menu_separator (menu);
+		} else {
+			menuitem = panel_image_menu_item_new ();
+
+			gicon = item.icon [0] ? g_icon_new_for_string (item.icon, NULL) : NULL;
+			setup_menuitem_with_icon (menuitem,
+						  panel_menu_icon_get_size (),
+						  gicon,
+						  NULL,
+						  item.name);
+			if (gicon)
+				g_object_unref (gicon);
+
+			if (item.tooltip [0])
+				panel_util_set_tooltip_text (menuitem, item.tooltip);
+
+			gtk_menu_shell_append (GTK_MENU_SHELL (menu), menuitem);
+			gtk_widget_show (menuitem);
+		}
+
+		switch (item.type) {
+		case PANEL_MENU_SNAPSHOT_DIRECTORY:
+			submenu = create_lazy_menu ();
+			g_object_set_data_full (G_OBJECT (submenu),
+						"panel-menu-snapshot",
+						panel_menu_snapshot_ref (snapshot),
+						(GDestroyNotify) panel_menu_snapshot_unref);
+			g_object_set_data (G_OBJECT (submenu),
+					   "panel-menu-snapshot-index",
+					   GINT_TO_POINTER (i));
+			g_object_set_data (G_OBJECT (submenu),
+					   "panel-menu-force-icon-for-categories",
+					   GINT_TO_POINTER (force_categories_icon));
+			gtk_menu_item_set_submenu (GTK_MENU_ITEM (menuitem), submenu);
+			break;
+
+		case PANEL_MENU_SNAPSHOT_ENTRY:
+			g_object_set_data_full (G_OBJECT (menuitem),
+						"panel-menu-snapshot-path",
+						g_strdup (item.path),
+						(GDestroyNotify) g_free);
+			g_signal_connect_after (menuitem, "button-press-event",
+						G_CALLBACK (menuitem_button_press_event), NULL);
+			g_signal_connect (menuitem, "activate",
+					  G_CALLBACK (activate_snapshot_item), NULL);
+			break;
+
+		case PANEL_MENU_SNAPSHOT_HEADER:
+			g_signal_connect (menuitem, "activate",
+					  G_CALLBACK (gtk_false), NULL);
+			break;
+
+		default:
+			break;
+		}
+
+		g_object_set_data_full (G_OBJECT (menuitem),
+					"panel-menu-tree-item-key",
+					g_strdup (item.key),
+					(GDestroyNotify) g_free);
+		g_object_set_data_full (G_OBJECT (menuitem),
+					"panel-menu-tree-item-signature",
+					g_strdup (item.signature),
+					(GDestroyNotify) g_free);
+	}
+}
+
+/* When the tree of a menu file changes, the menus already populated are
+ * updated from the new tree: the menu items of the tree items that
+ * didn't change are kept. */
+typedef struct {
+	guint kept;
+	guint inserted;
+	guint updated;
+	guint removed;
+} PanelMenuTreeReloadStats;
+
+static void update_menu_from_directory (GtkWidget                *menu,
+					MateMenuTreeDirectory    *directory,
+					PanelMenuTreeReloadStats *stats);
+
+/* Points a kept menu item to the item of the new tree. */
+static gboolean
+rebind_menuitem (GtkWidget                *menuitem,
+		 MateMenuTreeItemType      type,
+		 gpointer                  item,
+		 PanelMenuTreeReloadStats *stats)
+{
+	MateMenuTreeEntry *old_entry;
+	GtkWidget         *context_menu;
+	GtkWidget         *submenu;
+	guint              n_drag_handlers;
+
+	switch (type) {
+	case MATEMENU_TREE_ITEM_ENTRY:
+		old_entry = g_object_get_data (G_OBJECT (menuitem),
+					       "panel-menu-tree-entry");
+		if (!old_entry) {
+			/* created from the snapshot of the tree */
+			if (!g_object_get_data (G_OBJECT (menuitem), "panel-menu-snapshot-path"))
+				return FALSE;
+
+			g_signal_handlers_disconnect_by_func (menuitem,
+							      G_CALLBACK (activate_snapshot_item),
+							      NULL);
+			g_object_set_data (G_OBJECT (menuitem), "panel-menu-snapshot-path", NULL);
+
+			g_object_set_data_full (G_OBJECT (menuitem),
+						"panel-menu-tree-entry",
+						matemenu_tree_item_ref (item),
+						(GDestroyNotify) matemenu_tree_item_unref);
+
+			setup_menuitem_drag (menuitem, item);
+			g_signal_connect (menuitem, "activate",
+					  G_CALLBACK (activate_app_def), item);
+			return TRUE;
+		}
+
+		/* its context menu acts on the old entry */
+		context_menu = g_object_get_data (G_OBJECT (menuitem), "panel-item-context-menu");
+		if (context_menu) {
+			g_signal_handlers_disconnect_by_func (menuitem,
+							      G_CALLBACK (menu_destroy_context_menu),
+							      context_menu);
+			menu_destroy_context_menu (menuitem, context_menu);
+			g_object_set_data (G_OBJECT (menuitem), "panel-item-context-menu", NULL);
+		}
+
+		n_drag_handlers = g_signal_handlers_disconnect_by_func (menuitem,
+									G_CALLBACK (drag_data_get_menu_cb),
+									old_entry);
+		g_signal_handlers_disconnect_by_func (menuitem,
+						      G_CALLBACK (activate_app_def),
+						      old_entry);
+
+		g_object_set_data_full (G_OBJECT (menuitem),
+					"panel-menu-tree-entry",
+					matemenu_tree_item_ref (item),
+					(GDestroyNotify) matemenu_tree_item_unref);
+
+		if (n_drag_handlers > 0)
+			g_signal_connect (menuitem, "drag-data-get",
+					  G_CALLBACK (drag_data_get_menu_cb),
+					  item);
+		g_signal_connect (menuitem, "activate",
+				  G_CALLBACK (activate_app_def), item);
+		return TRUE;
+
+	case MATEMENU_TREE_ITEM_DIRECTORY:
+		submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (menuitem));
+		if (!submenu)
+			return FALSE;
+
+		/* not populated yet: it will be from the new directory */
+		if (!g_object_get_data (G_OBJECT (submenu), "panel-menu-needs-loading"))
+			update_menu_from_directory (submenu, item, stats);
+
+		g_object_set_data_full (G_OBJECT (submenu),
+					"panel-menu-tree-directory",
+					matemenu_tree_item_ref (item),
+					(GDestroyNotify) matemenu_tree_item_unref);
+		return TRUE;
+
+	case MATEMENU_TREE_ITEM_SEPARATOR:
+		return TRUE;
+
+	default:
+		return FALSE;
+	}
+}
+
+static void
+update_menu_from_directory (GtkWidget                *menu,
+			    MateMenuTreeDirectory    *directory,
+			    PanelMenuTreeReloadStats *stats)
+{
+	GHashTable           *old_items;
+	GList                *children;
+	GList                *removed;
+	GList                *l;
+	MateMenuTreeIter     *iter;
+	MateMenuTreeItemType  type;
+	int                   position;
+	int                   i;
+
+	/* the menu items created for the previous tree, by key: the keys
+	 * are copied, as an item is destroyed once it is replaced */
+	old_items = g_hash_table_new_full (g_str_hash, g_str_equal,
+					   g_free, (GDestroyNotify) g_queue_free);
+	removed = NULL;
+	position = -1;
+
+	children = gtk_container_get_children (GTK_CONTAINER (menu));
+	for (l = children, i = 0; l; l = l->next, i++) {
+		const char *key;
+		GQueue     *queue;
+
+		key = g_object_get_data (G_OBJECT (l->data), "panel-menu-tree-item-key");
+		if (!key)
+			continue;
+
+		if (position < 0)
+			position = i;
+
+		if (!key [0]) {
+			removed = g_list_prepend (removed, l->data);
+			continue;
+		}
+
+		queue = g_hash_table_lookup (old_items, key);
+		if (!queue) {
+			queue = g_queue_new ();
+			g_hash_table_insert (old_items, g_strdup (key), queue);
+		}
+		g_queue_push_tail (queue, l->data);
+	}
+	g_list_free (children);
+
+	if (position < 0)
+		position = 0;
+
+	iter = directory ? matemenu_tree_directory_iter (directory) : NULL;
+	while (iter && (type = matemenu_tree_iter_next (iter)) != MATEMENU_TREE_ITEM_INVALID) {
+		GtkWidget *menuitem = NULL;
+		GQueue    *queue;
+		gpointer   item;
+		char      *key;
+		char      *signature;
+
+		item = panel_app_catalog_iter_get_item (iter, type);
+
+		panel_app_catalog_item_get_key (type, item, &key, &signature);
+		queue = key ? g_hash_table_lookup (old_items, key) : NULL;
+		if (queue)
+			menuitem = g_queue_pop_head (queue);
+
+		if (menuitem &&
+		    g_strcmp0 (signature, g_object_get_data (G_OBJECT (menuitem),
+							     "panel-menu-tree-item-signature")) == 0 &&
+		    rebind_menuitem (menuitem, type, item, stats)) {
+			stats->kept++;
+		} else {
+			if (menuitem) {
+				gtk_widget_destroy (menuitem);
+				stats->updated++;
+			} else {
+				stats->inserted++;
+			}
+
+			menuitem = create_menuitem_from_tree_item (menu, type, item);
+		}
+
+		if (menuitem)
+			gtk_menu_reorder_child (GTK_MENU (menu), menuitem, position++);
+
+		g_free (key);
+		g_free (signature);
+		if (item)
+			matemenu_tree_item_unref (item);
+	}
+	if (iter)
+		matemenu_tree_iter_unref (iter);
+
+	/* what is left is not in the new tree anymore */
+	if (g_hash_table_size (old_items) > 0) {
+		GHashTableIter  hash_iter;
+		GQueue         *queue;
+
+		g_hash_table_iter_init (&hash_iter, old_items);
+		while (g_hash_table_iter_next (&hash_iter, NULL, (gpointer *) &queue)) {
+			for (l = queue->head; l; l = l->next)
+				removed = g_list_prepend (removed, l->data);
+		}
+	}
+	g_hash_table_destroy (old_items);
+
+	for (l = removed; l; l = l->next) {
 		gtk_widget_destroy (l->data);
-	g_list_free (list);
+		stats->removed++;
+	}
+	g_list_free (removed);
+}
+
+/* Populates a menu that was waiting for its tree. */
+static void
+panel_menu_tree_first_loaded (GtkWidget *menu)
+{
+	if (!g_object_get_data (G_OBJECT (menu), "panel-menu-tree-loading"))
+		return;
 
-	if (! matemenu_tree_load_sync (tree, &error)) {
-		g_warning("Menu tree reload got error:%s\n", error->message);
-		g_error_free(error);
+	g_object_set_data (G_OBJECT (menu), "panel-menu-tree-loading", NULL);
+
+	if (gtk_widget_get_visible (menu))
+		submenu_to_display (menu);
+	else
+		queue_submenu_to_display (menu);
+}
+
+static void
+panel_menu_catalog_changed (PanelAppCatalog *catalog,
+			    GtkWidget       *menu)
+{
+	PanelMenuTreeReloadStats  stats = { 0, };
+	MateMenuTreeDirectory    *directory;
+	MateMenuTree             *tree;
+	gint64                    start_time;
+
+	tree = panel_app_catalog_get_tree (catalog);
+
+	/* the load failed, the menu keeps what it has */
+	if (!tree || tree == g_object_get_data (G_OBJECT (menu), "panel-menu-tree")) {
+		panel_menu_tree_first_loaded (menu);
+		return;
 	}
 
+	start_time = g_get_monotonic_time ();
+
+	directory = matemenu_tree_get_directory_from_path (tree,
+							   g_object_get_data (G_OBJECT (menu),
+									      "panel-menu-tree-path"));
+
+	/* not populated yet: it will be from the new tree */
+	if (!g_object_get_data (G_OBJECT (menu), "panel-menu-needs-loading"))
+		update_menu_from_directory (menu, directory, &stats);
+
 	g_object_set_data_full (G_OBJECT (menu),
 				"panel-menu-tree-directory",
-				NULL, NULL);
+				directory,
+				(GDestroyNotify) matemenu_tree_item_unref);
+	g_object_set_data_full (G_OBJECT (menu),
+				"panel-menu-tree",
+				g_object_ref (tree),
+				(GDestroyNotify) g_object_unref);
+	/* the submenus populated from it keep it until they are updated */
+	g_object_set_data (G_OBJECT (menu), "panel-menu-snapshot", NULL);
 
-	g_object_set_data (G_OBJECT (menu),
-			   "panel-menu-needs-loading",
-			   GUINT_TO_POINTER (TRUE));
+	panel_menu_tree_first_loaded (menu);
 
-	idle_id = g_idle_add_full (G_PRIORITY_LOW,
-				   submenu_to_display_in_idle,
-				   menu,
-				   NULL);
-	g_object_set_data_full (G_OBJECT (menu),
-				"panel-menu-idle-id",
-				GUINT_TO_POINTER (idle_id),
-				remove_submenu_to_display_idle);
+	g_debug ("Menu %s updated in %" G_GINT64_FORMAT " ms "
+		 "(%u kept, %u inserted, %u updated, %u removed)",
+		 panel_app_catalog_get_menu_file (catalog),
+		 (g_get_monotonic_time () - start_time) / 1000,
+		 stats.kept, stats.inserted, stats.updated, stats.removed);
 }
 
 static void
-remove_matemenu_tree_monitor (GtkWidget *menu,
-                          MateMenuTree  *tree)
+remove_catalog_monitor (GtkWidget       *menu,
+			PanelAppCatalog *catalog)
 {
-        g_signal_handlers_disconnect_by_func (tree,
-                                              G_CALLBACK (handle_matemenu_tree_changed),
-                                              menu);
+	g_signal_handlers_disconnect_by_func (catalog,
+					      G_CALLBACK (panel_menu_catalog_changed),
+					      menu);
 }
 
 GtkWidget *
@@ -1215,65 +1675,56 @@ create_applications_menu (const char *menu_file,
 			  const char *menu_path,
 			  gboolean    always_show_image)
 {
-	MateMenuTree *tree;
-	GtkWidget *menu;
-	guint      idle_id;
-	GError *error = NULL;
+	PanelAppCatalog   *catalog;
+	PanelMenuSnapshot *snapshot;
+	MateMenuTree      *tree;
+	GtkWidget         *menu;
 
-	menu = create_empty_menu ();
+	menu = create_lazy_menu ();
 
 	if (always_show_image)
 		g_object_set_data (G_OBJECT (menu),
 				   "panel-menu-force-icon-for-categories",
 				   GINT_TO_POINTER (TRUE));
 
-	tree = matemenu_tree_new (menu_file, MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-	if (! matemenu_tree_load_sync (tree, &error)) {
-		g_warning("Menu tree loading got error:%s\n", error->message);
-		g_error_free(error);
-		g_object_unref(tree);
-		tree = NULL;
-	}
-
-	g_object_set_data_full (G_OBJECT (menu),
-				"panel-menu-tree",
-				g_object_ref(tree),
-				(GDestroyNotify) g_object_unref);
-
 	g_object_set_data_full (G_OBJECT (menu),
 				"panel-menu-tree-path",
 				g_strdup (menu_path ? menu_path : "/"),
 				(GDestroyNotify) g_free);
 
-	g_object_set_data (G_OBJECT (menu),
-			   "panel-menu-needs-loading",
-			   GUINT_TO_POINTER (TRUE));
+	/* The tree is shared with the other menus of the same file. It is
+	 * loaded from an idle, and the menu is shown from the snapshot of
+	 * the tree until then. Menu buttons showing a submenu need its
+	 * directory for their icon right away. */
+	catalog = panel_app_catalog_get (menu_file);
+	if (menu_path)
+		panel_app_catalog_load_sync (catalog);
 
-	g_signal_connect (menu, "show",
-			  G_CALLBACK (submenu_to_display), NULL);
-
-	idle_id = g_idle_add_full (G_PRIORITY_LOW,
-				   submenu_to_display_in_idle,
-				   menu,
-				   NULL);
-	g_object_set_data_full (G_OBJECT (menu),
-				"panel-menu-idle-id",
-				GUINT_TO_POINTER (idle_id),
-				remove_submenu_to_display_idle);
+	tree = panel_app_catalog_get_tree (catalog);
+	if (tree) {
+		g_object_set_data_full (G_OBJECT (menu),
+					"panel-menu-tree",
+					g_object_ref (tree),
+					(GDestroyNotify) g_object_unref);
+	} else {
+		g_object_set_data (G_OBJECT (menu),
+				   "panel-menu-tree-loading",
+				   GUINT_TO_POINTER (TRUE));
 
-	g_signal_connect (menu, "button-press-event",
-			  G_CALLBACK (menu_dummy_button_press_event), NULL);
+		snapshot = panel_menu_snapshot_load (menu_file);
+		if (snapshot)
+			g_object_set_data_full (G_OBJECT (menu),
+						"panel-menu-snapshot",
+						snapshot,
+						(GDestroyNotify) panel_menu_snapshot_unref);
 
-	g_signal_connect (tree, "changed", G_CALLBACK (handle_matemenu_tree_changed), menu);
-	g_signal_connect (menu, "destroy", G_CALLBACK (remove_matemenu_tree_monitor), tree);
+		panel_app_catalog_load (catalog);
+	}
 
-	g_object_unref(tree);
-
-/*HACK Fix any failures of compiz/other wm's to communicate with gtk for transparency */
-	GtkWidget *toplevel = gtk_widget_get_toplevel (menu);
-	GdkScreen *screen = gtk_widget_get_screen(GTK_WIDGET(toplevel));
-	GdkVisual *visual = gdk_screen_get_rgba_visual(screen);
-	gtk_widget_set_visual(GTK_WIDGET(toplevel), visual);
+	g_signal_connect (catalog, "changed",
+			  G_CALLBACK (panel_menu_catalog_changed), menu);
+	g_signal_connect (menu, "destroy",
+			  G_CALLBACK (remove_catalog_monitor), catalog);
 
 	return menu;
 }
@@ -1294,42 +1745,15 @@ populate_menu_from_directory (GtkWidget          *menu,
 	iter = matemenu_tree_directory_iter (directory);
 	while ((type = matemenu_tree_iter_next (iter)) != MATEMENU_TREE_ITEM_INVALID) {
 		gpointer item;
-		if (add_separator || type == MATEMENU_TREE_ITEM_SEPARATOR) {
-			add_menu_separator (menu);
-			add_separator = FALSE;
-		}
-		switch (type) {
-			case MATEMENU_TREE_ITEM_DIRECTORY:
-				item = matemenu_tree_iter_get_directory(iter);
-				create_submenu (menu, item, NULL);
-				matemenu_tree_item_unref (item);
-				break;
-
-			case MATEMENU_TREE_ITEM_ENTRY:
-				item = matemenu_tree_iter_get_entry (iter);
-				create_menuitem (menu, item, NULL);
-				matemenu_tree_item_unref (item);
-				break;
-
-			case MATEMENU_TREE_ITEM_SEPARATOR :
-				/* already added */
-				break;
-
-			case MATEMENU_TREE_ITEM_ALIAS:
-				item = matemenu_tree_iter_get_alias(iter);
-				create_menuitem_from_alias (menu, item);
-				matemenu_tree_item_unref (item);
-				break;
 
-			case MATEMENU_TREE_ITEM_HEADER:
-				item = matemenu_tree_iter_get_header(iter);
-				create_header (menu, item);
-				matemenu_tree_item_unref (item);
-				break;
+		if (add_separator && type != MATEMENU_TREE_ITEM_SEPARATOR)
+			add_menu_separator (menu);
+		add_separator = FALSE;
 
-			default:
-				break;
-		}
+		item = panel_app_catalog_iter_get_item (iter, type);
+		create_menuitem_from_tree_item (menu, type, item);
+		if (item)
+			matemenu_tree_item_unref (item);
 	}
 	matemenu_tree_iter_unref (iter);
 
@@ -0,0 +1,152 @@
+/*
+ * panel-addto-search.c: search of the items of the Add to Panel dialog
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <libpanel-util/panel-glib.h>
+
+#include "panel-addto-search.h"
+
+struct _PanelAddtoSearch {
+	char             *text;
+	/* casefolded text */
+	PanelGUtf8Needle *needle;
+	/* items not matching needle: they can't match a longer one */
+	GHashTable       *rejected;
+};
+
+/* Returns the casefolded key of an item, matched against the search */
+char *
+panel_addto_search_make_key (const char *name,
+			     const char *description)
+{
+	char *text;
+	char *key;
+
+	/* the search text is a single line, so it can't match across
+	 * the two */
+	text = g_strconcat (name ? name : "", "\n",
+			    description ? description : "", NULL);
+	key = panel_g_utf8_make_search_key (text);
+	g_free (text);
+
+	return key;
+}
+
+PanelAddtoSearch *
+panel_addto_search_new (void)
+{
+	PanelAddtoSearch *search;
+
+	search = g_new0 (PanelAddtoSearch, 1);
+	search->rejected = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	return search;
+}
+
+void
+panel_addto_search_free (PanelAddtoSearch *search)
+{
+	if (!search)
+		return;
+
+	g_free (search->text);
+	panel_g_utf8_needle_free (search->needle);
+	g_hash_table_destroy (search->rejected);
+	g_free (search);
+}
+
+/* Returns FALSE if the text is the same as before, and nothing needs to
+ * be filtered again */
+gboolean
+panel_addto_search_set_text (PanelAddtoSearch *search,
+			     const char       *text)
+{
+	PanelGUtf8Needle *new_needle;
+	char             *new_text;
+
+	new_text = g_strdup (text ? text : "");
+	g_strchomp (new_text);
+
+	if (search->text &&
+	    g_utf8_collate (new_text, search->text) == 0) {
+		g_free (new_text);
+		return FALSE;
+	}
+
+	g_free (search->text);
+	search->text = new_text;
+
+	/* when the text is extended, only the items matching the previous
+	 * one need to be looked at again */
+	new_needle = panel_g_utf8_needle_new (new_text);
+	if (!search->needle ||
+	    !panel_g_utf8_needle_find (search->needle,
+				       panel_g_utf8_needle_get_key (new_needle)))
+		g_hash_table_remove_all (search->rejected);
+	panel_g_utf8_needle_free (search->needle);
+	search->needle = new_needle;
+
+	return TRUE;
+}
+
+/* Returns whether all the items match */
+gboolean
+panel_addto_search_is_empty (const PanelAddtoSearch *search)
+{
+	return !search->needle ||
+	       PANEL_GLIB_STR_EMPTY (panel_g_utf8_needle_get_key (search->needle));
+}
+
+/* Returns the casefolded search text, or NULL before the text is set */
+const PanelGUtf8Needle *
+panel_addto_search_get_needle (const PanelAddtoSearch *search)
+{
+	return search->needle;
+}
+
+/* Returns whether @item, whose key is @key, matches the search. @key
+ * is only looked at if the item didn't already fail to match a shorter
+ * text. */
+gboolean
+panel_addto_search_match (PanelAddtoSearch *search,
+			  gconstpointer     item,
+			  const char       *key)
+{
+	if (panel_addto_search_is_empty (search))
+		return TRUE;
+
+	if (g_hash_table_contains (search->rejected, item))
+		return FALSE;
+
+	if (panel_g_utf8_needle_find (search->needle, key) != NULL)
+		return TRUE;
+
+	g_hash_table_add (search->rejected, (gpointer) item);
+
+	return FALSE;
+}
+
+guint
+panel_addto_search_get_n_rejected (const PanelAddtoSearch *search)
+{
+	return g_hash_table_size (search->rejected);
+}
@@ -0,0 +1,54 @@
+/*
+ * panel-addto-search.h: search of the items of the Add to Panel dialog
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_ADDTO_SEARCH_H__
+#define __PANEL_ADDTO_SEARCH_H__
+
+#include <glib.h>
+
+#include <libpanel-util/panel-glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _PanelAddtoSearch PanelAddtoSearch;
+
+char             *panel_addto_search_make_key       (const char             *name,
+						     const char             *description);
+
+PanelAddtoSearch *panel_addto_search_new            (void);
+void              panel_addto_search_free           (PanelAddtoSearch       *search);
+
+gboolean          panel_addto_search_set_text       (PanelAddtoSearch       *search,
+						     const char             *text);
+gboolean          panel_addto_search_is_empty       (const PanelAddtoSearch *search);
+const PanelGUtf8Needle *panel_addto_search_get_needle (const PanelAddtoSearch *search);
+gboolean          panel_addto_search_match          (PanelAddtoSearch       *search,
+						     gconstpointer           item,
+						     const char             *key);
+guint             panel_addto_search_get_n_rejected (const PanelAddtoSearch *search);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_ADDTO_SEARCH_H__ */
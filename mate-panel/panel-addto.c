@@ -50,9 +50,11 @@
 #include "panel-util.h"
 #include "panel-profile.h"
 #include "panel-addto.h"
+#include "panel-addto-search.h"
 #include "panel-icon-names.h"
 #include "panel-schemas.h"
 #include "panel-stock-icons.h"
+#include "panel-app-catalog.h"
 
 #ifdef HAVE_X11
 #include "xstuff.h"
@@ -81,7 +83,9 @@ typedef struct {
 	GSList       *application_list;
 	GSList       *settings_list;
 
-	gchar        *search_text;
+	PanelAddtoSearch *search;
+	/* desktop file paths of the launchers matching the search */
+	GHashTable   *matching_launchers;
 	gchar        *applet_search_text;
 
 	int           insertion_position;
@@ -113,6 +117,10 @@ typedef struct {
 	char                  *iid;
 	gboolean               enabled;
 	gboolean               static_data;
+	/* casefolded name and description, built when first searched */
+	char                  *search_key;
+	/* the icon of the items of the menus, shared by the catalog */
+	GIcon                 *gicon;
 } PanelAddtoItemInfo;
 
 typedef struct {
@@ -200,7 +208,7 @@ static PanelAddtoItemInfo internal_addto_items [] = {
 };
 
 enum {
-	COLUMN_ICON_NAME,
+	COLUMN_ICON,
 	COLUMN_TEXT,
 	COLUMN_DATA,
 	COLUMN_SEARCH,
@@ -218,6 +226,7 @@ static void panel_addto_present_applets      (PanelAddtoDialog *dialog);
 static gboolean panel_addto_filter_func (GtkTreeModel *model,
 					 GtkTreeIter  *iter,
 					 gpointer      data);
+static void panel_addto_update_matching_launchers (PanelAddtoDialog *dialog);
 
 static int
 panel_addto_applet_info_sort_func (PanelAddtoItemInfo *a,
@@ -309,7 +318,7 @@ panel_addto_drag_begin_cb (GtkWidget      *widget,
 	GtkTreePath  *path;
 	GtkTreeIter   iter;
 	GtkTreeIter   filter_iter;
-	gchar         *icon_name;
+	GIcon        *icon;
 
 	filter_model = gtk_tree_view_get_model (GTK_TREE_VIEW (widget));
 
@@ -321,11 +330,13 @@ panel_addto_drag_begin_cb (GtkWidget      *widget,
 
 	child_model = gtk_tree_model_filter_get_model (GTK_TREE_MODEL_FILTER (filter_model));
 	gtk_tree_model_get (child_model, &iter,
-	                    COLUMN_ICON_NAME, &icon_name,
+	                    COLUMN_ICON, &icon,
 	                    -1);
 
-	gtk_drag_set_icon_name (context, icon_name, 0, 0);
-	g_free (icon_name);
+	if (icon) {
+		gtk_drag_set_icon_gicon (context, icon, 0, 0);
+		g_object_unref (icon);
+	}
 }
 
 static void
@@ -446,6 +457,19 @@ panel_addto_query_applets (GSList *list)
 	return list;
 }
 
+/* Returns a new reference to the icon shown for @item_info */
+static GIcon *
+panel_addto_item_info_get_icon (PanelAddtoItemInfo *item_info)
+{
+	if (item_info->gicon)
+		return g_object_ref (item_info->gicon);
+
+	if (item_info->icon)
+		return g_themed_icon_new (item_info->icon);
+
+	return NULL;
+}
+
 static void
 panel_addto_append_item (PanelAddtoDialog *dialog,
 			 GtkListStore *model,
@@ -456,20 +480,23 @@ panel_addto_append_item (PanelAddtoDialog *dialog,
 	if (applet == NULL) {
 		gtk_list_store_append (model, &iter);
 		gtk_list_store_set (model, &iter,
-				    COLUMN_ICON_NAME, NULL,
+				    COLUMN_ICON, NULL,
 				    COLUMN_TEXT, NULL,
 				    COLUMN_DATA, NULL,
 				    COLUMN_SEARCH, NULL,
 				    COLUMN_ENABLED, TRUE,
 				    -1);
 	} else {
+		GIcon *icon;
+
 		gtk_list_store_append (model, &iter);
 
 		char *text = panel_addto_make_text (applet->name,
 		                                    applet->description);
+		icon = panel_addto_item_info_get_icon (applet);
 
 		gtk_list_store_set (model, &iter,
-				    COLUMN_ICON_NAME, applet->icon,
+				    COLUMN_ICON, icon,
 				    COLUMN_TEXT, text,
 				    COLUMN_DATA, applet,
 				    COLUMN_SEARCH, applet->name,
@@ -477,6 +504,8 @@ panel_addto_append_item (PanelAddtoDialog *dialog,
 				    -1);
 
 		g_free (text);
+		if (icon)
+			g_object_unref (icon);
 	}
 }
 
@@ -521,7 +550,7 @@ panel_addto_make_applet_model (PanelAddtoDialog *dialog)
 					    (GCompareFunc) panel_addto_applet_info_sort_func);
 
 	model = gtk_list_store_new (NUMBER_COLUMNS,
-				    G_TYPE_STRING,
+				    G_TYPE_ICON,
 				    G_TYPE_STRING,
 				    G_TYPE_POINTER,
 				    G_TYPE_STRING,
@@ -562,12 +591,17 @@ panel_addto_prepend_directory (GSList             **parent_list,
 	data->item_info.type          = PANEL_ADDTO_MENU;
 	data->item_info.name          = g_strdup (matemenu_tree_directory_get_name (directory));
 	data->item_info.description   = g_strdup (matemenu_tree_directory_get_comment (directory));
-	data->item_info.icon          = gicon ? g_icon_to_string(gicon) : g_strdup(PANEL_ICON_UNKNOWN);
 	data->item_info.menu_filename = g_strdup (filename);
 	data->item_info.menu_path     = matemenu_tree_directory_make_path (directory, NULL);
 	data->item_info.enabled       = TRUE;
 	data->item_info.static_data   = FALSE;
 
+	if (gicon)
+		data->item_info.gicon = g_object_ref (panel_app_catalog_get_icon (panel_app_catalog_get (filename),
+										  gicon));
+	else
+		data->item_info.icon = g_strdup (PANEL_ICON_UNKNOWN);
+
 	/* We should set the iid here to something and do
 	 * iid = g_strdup_printf ("MENU:%s", tfr->name)
 	 * but this means we'd have to free the iid later
@@ -598,11 +632,16 @@ panel_addto_prepend_entry (GSList         **parent_list,
 	data->item_info.type          = PANEL_ADDTO_LAUNCHER;
 	data->item_info.name          = g_strdup (g_app_info_get_display_name(G_APP_INFO(ginfo)));
 	data->item_info.description   = g_strdup (g_app_info_get_description(G_APP_INFO(ginfo)));
-	data->item_info.icon          = gicon ? g_icon_to_string(gicon) : g_strdup(PANEL_ICON_UNKNOWN);
 	data->item_info.launcher_path = g_strdup (matemenu_tree_entry_get_desktop_file_path (entry));
 	data->item_info.enabled       = TRUE;
 	data->item_info.static_data   = FALSE;
 
+	if (gicon)
+		data->item_info.gicon = g_object_ref (panel_app_catalog_get_icon (panel_app_catalog_get (filename),
+										  gicon));
+	else
+		data->item_info.icon = g_strdup (PANEL_ICON_UNKNOWN);
+
 	*parent_list = g_slist_prepend (*parent_list, data);
 }
 
@@ -682,12 +721,14 @@ panel_addto_populate_application_model (GtkTreeStore *store,
 
 	for (app = app_list; app != NULL; app = app->next) {
 		PanelAddtoAppList *data = app->data;
+		GIcon             *icon;
 
 		gtk_tree_store_append (store, &iter, parent);
 		char *text = panel_addto_make_text (data->item_info.name,
 		                                    data->item_info.description);
+		icon = panel_addto_item_info_get_icon (&data->item_info);
 		gtk_tree_store_set (store, &iter,
-				    COLUMN_ICON_NAME, data->item_info.icon,
+				    COLUMN_ICON, icon,
 				    COLUMN_TEXT, text,
 				    COLUMN_DATA, &(data->item_info),
 				    COLUMN_SEARCH, data->item_info.name,
@@ -695,6 +736,8 @@ panel_addto_populate_application_model (GtkTreeStore *store,
 				    -1);
 
 		g_free (text);
+		if (icon)
+			g_object_unref (icon);
 
 		if (data->children != NULL)
 			panel_addto_populate_application_model (store,
@@ -708,26 +751,21 @@ static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
 	GtkTreeStore* store;
 	MateMenuTree* tree;
 	MateMenuTreeDirectory* root;
-	GError *error = NULL;
 
 	if (dialog->filter_application_model != NULL)
 		return;
 
 	store = gtk_tree_store_new (NUMBER_COLUMNS,
-				    G_TYPE_STRING,
+				    G_TYPE_ICON,
 				    G_TYPE_STRING,
 				    G_TYPE_POINTER,
 				    G_TYPE_STRING,
 				    G_TYPE_BOOLEAN);
 
-	tree = matemenu_tree_new ("mate-applications.menu", MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-	if (! matemenu_tree_load_sync (tree, &error)) {
-		g_warning("Applications menu tree loading got error:%s\n", error->message);
-		g_error_free(error);
-		g_clear_object(&tree);
-	}
+	/* shared with the menus */
+	tree = panel_app_catalog_load_sync (panel_app_catalog_get ("mate-applications.menu"));
 
-	if ((root = matemenu_tree_get_root_directory (tree)) != NULL )
+	if (tree && (root = matemenu_tree_get_root_directory (tree)) != NULL )
 	{
 		panel_addto_make_application_list(&dialog->application_list, root, "mate-applications.menu");
 		panel_addto_populate_application_model(store, NULL, dialog->application_list);
@@ -735,22 +773,15 @@ static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
 		matemenu_tree_item_unref(root);
 	}
 
-	g_clear_object(&tree);
+	tree = panel_app_catalog_load_sync (panel_app_catalog_get ("mate-settings.menu"));
 
-	tree = matemenu_tree_new ("mate-settings.menu", MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-	if (! matemenu_tree_load_sync (tree, &error)) {
-		g_warning("Settings menu tree loading got error:%s\n", error->message);
-		g_error_free(error);
-		g_clear_object(&tree);
-	}
-
-	if ((root = matemenu_tree_get_root_directory(tree)))
+	if (tree && (root = matemenu_tree_get_root_directory(tree)))
 	{
 		GtkTreeIter iter;
 
 		gtk_tree_store_append(store, &iter, NULL);
 		gtk_tree_store_set (store, &iter,
-				    COLUMN_ICON_NAME, NULL,
+				    COLUMN_ICON, NULL,
 				    COLUMN_TEXT, NULL,
 				    COLUMN_DATA, NULL,
 				    COLUMN_SEARCH, NULL,
@@ -763,9 +794,8 @@ static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
 		matemenu_tree_item_unref(root);
 	}
 
-	g_object_unref(tree);
-
 	dialog->application_model = GTK_TREE_MODEL(store);
+	panel_addto_update_matching_launchers (dialog);
 	dialog->filter_application_model = gtk_tree_model_filter_new(GTK_TREE_MODEL(dialog->application_model), NULL);
 	gtk_tree_model_filter_set_visible_func(GTK_TREE_MODEL_FILTER(dialog->filter_application_model), panel_addto_filter_func, dialog, NULL);
 }
@@ -932,6 +962,8 @@ panel_addto_dialog_free_item_info (PanelAddtoItemInfo *item_info)
 	g_clear_pointer (&item_info->launcher_path, g_free);
 	g_clear_pointer (&item_info->menu_filename, g_free);
 	g_clear_pointer (&item_info->menu_path, g_free);
+	g_clear_pointer (&item_info->search_key, g_free);
+	g_clear_object (&item_info->gicon);
 }
 
 static void
@@ -968,7 +1000,8 @@ panel_addto_dialog_free (PanelAddtoDialog *dialog)
 					     G_CALLBACK (panel_addto_name_notify),
 					     dialog);
 
-	g_free (dialog->search_text);
+	panel_addto_search_free (dialog->search);
+	g_hash_table_destroy (dialog->matching_launchers);
 	g_free (dialog->applet_search_text);
 
 	if (dialog->addto_dialog)
@@ -1038,6 +1071,16 @@ panel_addto_name_notify (GSettings        *settings,
 	g_free (name);
 }
 
+static const char *
+panel_addto_item_info_get_search_key (PanelAddtoItemInfo *data)
+{
+	if (!data->search_key)
+		data->search_key = panel_addto_search_make_key (data->name,
+								data->description);
+
+	return data->search_key;
+}
+
 static gboolean
 panel_addto_filter_func (GtkTreeModel *model,
 			 GtkTreeIter  *iter,
@@ -1048,7 +1091,7 @@ panel_addto_filter_func (GtkTreeModel *model,
 
 	dialog = (PanelAddtoDialog *) userdata;
 
-	if (!dialog->search_text || !dialog->search_text[0])
+	if (panel_addto_search_is_empty (dialog->search))
 		return TRUE;
 
 	gtk_tree_model_get (model, iter, COLUMN_DATA, &data, -1);
@@ -1062,10 +1105,32 @@ panel_addto_filter_func (GtkTreeModel *model,
 	    gtk_tree_store_iter_depth (GTK_TREE_STORE (model), iter) == 0)
 		return TRUE;
 
-	return (panel_g_utf8_strstrcase (data->name,
-					 dialog->search_text) != NULL ||
-	        panel_g_utf8_strstrcase (data->description,
-					 dialog->search_text) != NULL);
+	/* the applications of the menus are searched in the catalogs */
+	if (data->type == PANEL_ADDTO_LAUNCHER && data->launcher_path)
+		return g_hash_table_contains (dialog->matching_launchers,
+					      data->launcher_path);
+
+	return panel_addto_search_match (dialog->search, data,
+					 panel_addto_item_info_get_search_key (data));
+}
+
+static void
+panel_addto_update_matching_launchers (PanelAddtoDialog *dialog)
+{
+	const PanelGUtf8Needle *needle;
+
+	g_hash_table_remove_all (dialog->matching_launchers);
+
+	/* the launchers are only shown once the menus are loaded */
+	if (dialog->application_model == NULL ||
+	    panel_addto_search_is_empty (dialog->search))
+		return;
+
+	needle = panel_addto_search_get_needle (dialog->search);
+	panel_app_catalog_search (panel_app_catalog_get ("mate-applications.menu"),
+				  needle, dialog->matching_launchers);
+	panel_app_catalog_search (panel_app_catalog_get ("mate-settings.menu"),
+				  needle, dialog->matching_launchers);
 }
 
 static void
@@ -1073,25 +1138,27 @@ panel_addto_search_entry_changed (GtkWidget        *entry,
 				  PanelAddtoDialog *dialog)
 {
 	GtkTreeModel *model;
-	char         *new_text;
+	const char   *new_text;
 	GtkTreeIter   iter;
 	GtkTreePath  *path;
+	gint64        start_time;
 
-	new_text = g_strdup (gtk_entry_get_text (GTK_ENTRY (dialog->search_entry)));
-	g_strchomp (new_text);
-
-	if (dialog->search_text &&
-	    g_utf8_collate (new_text, dialog->search_text) == 0) {
-		g_free (new_text);
+	new_text = gtk_entry_get_text (GTK_ENTRY (dialog->search_entry));
+	if (!panel_addto_search_set_text (dialog->search, new_text))
 		return;
-	}
 
-	g_free (dialog->search_text);
-	dialog->search_text = new_text;
+	start_time = g_get_monotonic_time ();
+
+	panel_addto_update_matching_launchers (dialog);
 
 	model = gtk_tree_view_get_model (GTK_TREE_VIEW (dialog->tree_view));
 	gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (model));
 
+	g_debug ("Add to panel: filtered \"%s\" in %" G_GINT64_FORMAT " us "
+		 "(%u items rejected)",
+		 new_text, g_get_monotonic_time () - start_time,
+		 panel_addto_search_get_n_rejected (dialog->search));
+
 	path = gtk_tree_path_new_first ();
 	if (gtk_tree_model_get_iter (model, &iter, path)) {
 		GtkTreeSelection *selection;
@@ -1248,6 +1315,9 @@ panel_addto_dialog_new (PanelWidget *panel_widget)
 	GtkTreeViewColumn *column;
 
 	dialog = g_new0 (PanelAddtoDialog, 1);
+	dialog->search = panel_addto_search_new ();
+	dialog->matching_launchers = g_hash_table_new_full (g_str_hash, g_str_equal,
+							    g_free, NULL);
 
 	g_object_set_qdata_full (G_OBJECT (panel_widget->toplevel),
 				 panel_addto_dialog_quark,
@@ -1346,7 +1416,7 @@ panel_addto_dialog_new (PanelWidget *panel_widget)
 	gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (dialog->tree_view),
 						     -1, NULL,
 						     renderer,
-						     "icon_name", COLUMN_ICON_NAME,
+						     "gicon", COLUMN_ICON,
 						     "sensitive", COLUMN_ENABLED,
 						     NULL);
 	renderer = gtk_cell_renderer_text_new ();
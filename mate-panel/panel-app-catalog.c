@@ -0,0 +1,616 @@
+/*
+ * panel-app-catalog.c: applications of the menu trees, shared by the panel
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include <libpanel-util/panel-glib.h>
+
+#include "panel-app-catalog.h"
+#include "panel-menu-snapshot.h"
+
+/* The menus, the Run dialog and the Add to Panel dialog all show the
+ * applications of the same menu files: each file is loaded once, and its
+ * tree is shared by all of them. When the tree changes, it is loaded
+ * again and "changed" is emitted once the new one is ready; the items of
+ * the previous tree stay valid as long as they are referenced.
+ *
+ * libmatemenu caches the menu directories globally, and updates this
+ * cache from its own file monitors and timeouts in the main loop: the
+ * trees are loaded, and their items released, on the main thread only.
+ * The loads are done from a low priority idle, after the menus were
+ * shown from their snapshot.
+ *
+ * The applications are indexed by desktop file path with the casefolded
+ * text searched by the dialogs, and the items with the same icon share
+ * one GIcon: both are dropped with the tree. */
+
+struct _PanelAppCatalog {
+	GObject        parent;
+
+	char          *menu_file;
+	MateMenuTree  *tree;
+
+	/* the source of the next load, and when it was requested */
+	guint          load_id;
+	gint64         start_time;
+
+	/* built from the tree when first needed */
+	GPtrArray     *applications;
+	/* desktop file path -> search key, of all the applications */
+	GHashTable    *index;
+	/* the icons handed out, each only once */
+	GHashTable    *icons;
+};
+
+enum {
+	CHANGED,
+	LAST_SIGNAL
+};
+
+static guint app_catalog_signals[LAST_SIGNAL] = { 0 };
+
+/* menu file -> PanelAppCatalog, for the lifetime of the panel */
+static GHashTable *app_catalogs = NULL;
+
+/* package managers install many files: the changes of the trees are
+ * loaded at once after this delay, in milliseconds */
+#define PANEL_APP_CATALOG_RELOAD_DELAY 1000
+
+G_DEFINE_TYPE (PanelAppCatalog, panel_app_catalog, G_TYPE_OBJECT)
+
+static void panel_app_catalog_tree_changed (MateMenuTree    *tree,
+					    PanelAppCatalog *catalog);
+
+static void
+panel_app_catalog_clear_applications (PanelAppCatalog *catalog)
+{
+	g_clear_pointer (&catalog->applications, g_ptr_array_unref);
+	g_clear_pointer (&catalog->index, g_hash_table_destroy);
+	g_clear_pointer (&catalog->icons, g_hash_table_destroy);
+}
+
+static void
+panel_app_catalog_finalize (GObject *object)
+{
+	PanelAppCatalog *catalog = PANEL_APP_CATALOG (object);
+
+	if (catalog->load_id)
+		g_source_remove (catalog->load_id);
+	catalog->load_id = 0;
+
+	if (catalog->tree)
+		g_signal_handlers_disconnect_by_func (catalog->tree,
+						      G_CALLBACK (panel_app_catalog_tree_changed),
+						      catalog);
+	g_clear_object (&catalog->tree);
+
+	panel_app_catalog_clear_applications (catalog);
+	g_free (catalog->menu_file);
+
+	G_OBJECT_CLASS (panel_app_catalog_parent_class)->finalize (object);
+}
+
+static void
+panel_app_catalog_class_init (PanelAppCatalogClass *klass)
+{
+	GObjectClass *object_class;
+
+	object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = panel_app_catalog_finalize;
+
+	app_catalog_signals[CHANGED] =
+		g_signal_new ("changed",
+			      G_TYPE_FROM_CLASS (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      0,
+			      NULL,
+			      NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+}
+
+static void
+panel_app_catalog_init (PanelAppCatalog *catalog)
+{
+}
+
+/* Returns the catalog of @menu_file. It is owned by the panel. */
+PanelAppCatalog *
+panel_app_catalog_get (const char *menu_file)
+{
+	PanelAppCatalog *catalog;
+
+	g_return_val_if_fail (menu_file != NULL, NULL);
+
+	if (!app_catalogs)
+		app_catalogs = g_hash_table_new_full (g_str_hash, g_str_equal,
+						      NULL, g_object_unref);
+
+	catalog = g_hash_table_lookup (app_catalogs, menu_file);
+	if (!catalog) {
+		catalog = g_object_new (PANEL_TYPE_APP_CATALOG, NULL);
+		catalog->menu_file = g_strdup (menu_file);
+		g_hash_table_insert (app_catalogs, catalog->menu_file, catalog);
+	}
+
+	return catalog;
+}
+
+const char *
+panel_app_catalog_get_menu_file (PanelAppCatalog *catalog)
+{
+	g_return_val_if_fail (PANEL_IS_APP_CATALOG (catalog), NULL);
+
+	return catalog->menu_file;
+}
+
+/* Returns the tree of the catalog, or NULL if it is not loaded yet. */
+MateMenuTree *
+panel_app_catalog_get_tree (PanelAppCatalog *catalog)
+{
+	g_return_val_if_fail (PANEL_IS_APP_CATALOG (catalog), NULL);
+
+	return catalog->tree;
+}
+
+static void
+panel_app_catalog_set_tree (PanelAppCatalog *catalog,
+			    MateMenuTree    *tree)
+{
+	if (catalog->tree)
+		g_signal_handlers_disconnect_by_func (catalog->tree,
+						      G_CALLBACK (panel_app_catalog_tree_changed),
+						      catalog);
+	g_clear_object (&catalog->tree);
+	panel_app_catalog_clear_applications (catalog);
+
+	catalog->tree = tree;
+	g_signal_connect (tree, "changed",
+			  G_CALLBACK (panel_app_catalog_tree_changed), catalog);
+}
+
+static void
+panel_app_catalog_load_now (PanelAppCatalog *catalog)
+{
+	MateMenuTree *tree;
+	GError       *error = NULL;
+
+	if (catalog->load_id)
+		g_source_remove (catalog->load_id);
+	catalog->load_id = 0;
+
+	tree = matemenu_tree_new (catalog->menu_file, MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
+
+	if (matemenu_tree_load_sync (tree, &error)) {
+		panel_menu_snapshot_save_tree (catalog->menu_file, tree);
+		panel_app_catalog_set_tree (catalog, tree);
+
+		g_debug ("Menu %s loaded %" G_GINT64_FORMAT " ms after it was requested",
+			 catalog->menu_file,
+			 (g_get_monotonic_time () - catalog->start_time) / 1000);
+	} else {
+		g_warning ("Menu tree loading got error:%s\n", error->message);
+		g_error_free (error);
+		g_object_unref (tree);
+	}
+
+	/* also when the load failed, for who is waiting for the tree */
+	g_signal_emit (catalog, app_catalog_signals[CHANGED], 0);
+}
+
+static gboolean
+panel_app_catalog_load_idle (gpointer user_data)
+{
+	PanelAppCatalog *catalog = user_data;
+
+	catalog->load_id = 0;
+	panel_app_catalog_load_now (catalog);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+panel_app_catalog_queue_load (PanelAppCatalog *catalog,
+			      guint            delay)
+{
+	if (catalog->load_id)
+		return;
+
+	catalog->start_time = g_get_monotonic_time ();
+
+	if (delay)
+		catalog->load_id = g_timeout_add_full (G_PRIORITY_LOW, delay,
+						       panel_app_catalog_load_idle,
+						       catalog, NULL);
+	else
+		catalog->load_id = g_idle_add_full (G_PRIORITY_LOW,
+						    panel_app_catalog_load_idle,
+						    catalog, NULL);
+}
+
+/* Queues the load of the tree if it is not loaded yet.
+ * "changed" is emitted once it is loaded. */
+void
+panel_app_catalog_load (PanelAppCatalog *catalog)
+{
+	g_return_if_fail (PANEL_IS_APP_CATALOG (catalog));
+
+	if (catalog->tree)
+		return;
+
+	panel_app_catalog_queue_load (catalog, 0);
+}
+
+/* Returns the tree of the catalog, loading it now if it is not loaded
+ * yet, or NULL if it can't be loaded. A queued load is done now. */
+MateMenuTree *
+panel_app_catalog_load_sync (PanelAppCatalog *catalog)
+{
+	g_return_val_if_fail (PANEL_IS_APP_CATALOG (catalog), NULL);
+
+	if (!catalog->tree)
+		panel_app_catalog_load_now (catalog);
+
+	return catalog->tree;
+}
+
+static void
+panel_app_catalog_tree_changed (MateMenuTree    *tree,
+				PanelAppCatalog *catalog)
+{
+	panel_app_catalog_queue_load (catalog, PANEL_APP_CATALOG_RELOAD_DELAY);
+}
+
+typedef struct {
+	char              *collate_key;
+	/* desktop file id, or path for entries without one */
+	const char        *id;
+	MateMenuTreeEntry *entry;
+} PanelAppCatalogSortItem;
+
+static void add_applications_from_dir (MateMenuTreeDirectory *directory,
+				       GArray                *items);
+
+static void
+add_application (MateMenuTreeEntry *entry,
+		 GArray            *items)
+{
+	PanelAppCatalogSortItem  item;
+	GDesktopAppInfo         *ginfo;
+	const char              *name;
+
+	ginfo = matemenu_tree_entry_get_app_info (entry);
+
+	name = g_app_info_get_display_name (G_APP_INFO (ginfo));
+	item.collate_key = g_utf8_collate_key (name ? name : "", -1);
+	item.id = matemenu_tree_entry_get_desktop_file_id (entry);
+	if (!item.id)
+		item.id = matemenu_tree_entry_get_desktop_file_path (entry);
+	item.entry = entry;
+
+	g_array_append_val (items, item);
+}
+
+static void
+add_applications_from_alias (MateMenuTreeAlias *alias,
+			     GArray            *items)
+{
+	gpointer item;
+
+	switch (matemenu_tree_alias_get_aliased_item_type (alias)) {
+	case MATEMENU_TREE_ITEM_ENTRY:
+		item = matemenu_tree_alias_get_aliased_entry (alias);
+		add_application (item, items);
+		break;
+
+	case MATEMENU_TREE_ITEM_DIRECTORY:
+		item = matemenu_tree_alias_get_aliased_directory (alias);
+		add_applications_from_dir (item, items);
+		matemenu_tree_item_unref (item);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void
+add_applications_from_dir (MateMenuTreeDirectory *directory,
+			   GArray                *items)
+{
+	MateMenuTreeIter     *iter;
+	MateMenuTreeItemType  type;
+
+	iter = matemenu_tree_directory_iter (directory);
+	while ((type = matemenu_tree_iter_next (iter)) != MATEMENU_TREE_ITEM_INVALID) {
+		gpointer item;
+
+		switch (type) {
+		case MATEMENU_TREE_ITEM_ENTRY:
+			add_application (matemenu_tree_iter_get_entry (iter), items);
+			break;
+
+		case MATEMENU_TREE_ITEM_DIRECTORY:
+			item = matemenu_tree_iter_get_directory (iter);
+			add_applications_from_dir (item, items);
+			matemenu_tree_item_unref (item);
+			break;
+
+		case MATEMENU_TREE_ITEM_ALIAS:
+			item = matemenu_tree_iter_get_alias (iter);
+			add_applications_from_alias (item, items);
+			matemenu_tree_item_unref (item);
+			break;
+
+		default:
+			break;
+		}
+	}
+	matemenu_tree_iter_unref (iter);
+}
+
+/* The name, generic name, keywords and description of @entry, one per
+ * line so that a search text can't match across them */
+static char *
+make_search_key (MateMenuTreeEntry *entry)
+{
+	GDesktopAppInfo    *ginfo;
+	const char * const *keywords;
+	const char         *text;
+	GString            *str;
+	char               *key;
+	int                 i;
+
+	ginfo = matemenu_tree_entry_get_app_info (entry);
+	str = g_string_new (g_app_info_get_display_name (G_APP_INFO (ginfo)));
+
+	text = g_desktop_app_info_get_generic_name (ginfo);
+	if (text)
+		g_string_append_printf (str, "\n%s", text);
+
+	keywords = g_desktop_app_info_get_keywords (ginfo);
+	for (i = 0; keywords && keywords [i]; i++)
+		g_string_append_printf (str, "\n%s", keywords [i]);
+
+	text = g_app_info_get_description (G_APP_INFO (ginfo));
+	if (text)
+		g_string_append_printf (str, "\n%s", text);
+
+	key = panel_g_utf8_make_search_key (str->str);
+	g_string_free (str, TRUE);
+
+	return key;
+}
+
+static int
+compare_sort_items (gconstpointer a,
+		    gconstpointer b)
+{
+	const PanelAppCatalogSortItem *item_a = a;
+	const PanelAppCatalogSortItem *item_b = b;
+
+	return strcmp (item_a->collate_key, item_b->collate_key);
+}
+
+/* Returns the MateMenuTreeEntry of all the applications of the catalog,
+ * sorted by name, each desktop file only once. The array is valid until
+ * "changed" is emitted, and is empty if the tree can't be loaded. */
+GPtrArray *
+panel_app_catalog_get_applications (PanelAppCatalog *catalog)
+{
+	MateMenuTreeDirectory *root;
+	GArray                *items;
+	GHashTable            *seen;
+	guint                  i;
+
+	g_return_val_if_fail (PANEL_IS_APP_CATALOG (catalog), NULL);
+
+	if (catalog->applications)
+		return catalog->applications;
+
+	/* a new tree drops the applications of the previous one */
+	panel_app_catalog_load_sync (catalog);
+
+	catalog->applications = g_ptr_array_new_with_free_func (matemenu_tree_item_unref);
+	catalog->index = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, g_free);
+
+	root = catalog->tree ? matemenu_tree_get_root_directory (catalog->tree) : NULL;
+	if (!root)
+		return catalog->applications;
+
+	items = g_array_new (FALSE, FALSE, sizeof (PanelAppCatalogSortItem));
+	add_applications_from_dir (root, items);
+	matemenu_tree_item_unref (root);
+
+	g_array_sort (items, compare_sort_items);
+
+	/* the same application can be in several directories, while
+	 * different applications can have the same name */
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (i = 0; i < items->len; i++) {
+		PanelAppCatalogSortItem *item;
+		GDesktopAppInfo         *ginfo;
+		const char              *path;
+
+		item = &g_array_index (items, PanelAppCatalogSortItem, i);
+		g_free (item->collate_key);
+
+		path = matemenu_tree_entry_get_desktop_file_path (item->entry);
+		if (path && !g_hash_table_contains (catalog->index, path)) {
+			g_hash_table_insert (catalog->index, g_strdup (path),
+					     make_search_key (item->entry));
+
+			ginfo = matemenu_tree_entry_get_app_info (item->entry);
+			panel_app_catalog_get_icon (catalog,
+						    g_app_info_get_icon (G_APP_INFO (ginfo)));
+		}
+
+		if (item->id && !g_hash_table_add (seen, (gpointer) item->id)) {
+			matemenu_tree_item_unref (item->entry);
+			continue;
+		}
+
+		g_ptr_array_add (catalog->applications, item->entry);
+	}
+	g_hash_table_destroy (seen);
+	g_array_free (items, TRUE);
+
+	return catalog->applications;
+}
+
+/* Adds to @matches, whose keys are freed with g_free(), a copy of the
+ * desktop file path of each application whose name, generic name,
+ * keywords or description contains @needle. */
+void
+panel_app_catalog_search (PanelAppCatalog        *catalog,
+			  const PanelGUtf8Needle *needle,
+			  GHashTable             *matches)
+{
+	GHashTableIter  iter;
+	gpointer        path;
+	gpointer        key;
+
+	g_return_if_fail (PANEL_IS_APP_CATALOG (catalog));
+	g_return_if_fail (needle != NULL);
+
+	/* the index is built with the applications */
+	panel_app_catalog_get_applications (catalog);
+
+	g_hash_table_iter_init (&iter, catalog->index);
+	while (g_hash_table_iter_next (&iter, &path, &key)) {
+		if (panel_g_utf8_needle_find (needle, key))
+			g_hash_table_add (matches, g_strdup (path));
+	}
+}
+
+/* Returns the icon of the catalog equal to @icon, so that the items with
+ * the same icon share one GIcon. It is valid until "changed" is emitted:
+ * take a reference to keep it longer. */
+GIcon *
+panel_app_catalog_get_icon (PanelAppCatalog *catalog,
+			    GIcon           *icon)
+{
+	GIcon *shared;
+
+	g_return_val_if_fail (PANEL_IS_APP_CATALOG (catalog), NULL);
+
+	if (!icon)
+		return NULL;
+
+	if (!catalog->icons)
+		catalog->icons = g_hash_table_new_full (g_icon_hash,
+							(GEqualFunc) g_icon_equal,
+							g_object_unref, NULL);
+
+	shared = g_hash_table_lookup (catalog->icons, icon);
+	if (!shared) {
+		shared = g_object_ref (icon);
+		g_hash_table_add (catalog->icons, shared);
+	}
+
+	return shared;
+}
+
+/* Returns a new reference to the current item of @iter, of @type, or
+ * NULL for separators. */
+gpointer
+panel_app_catalog_iter_get_item (MateMenuTreeIter     *iter,
+				 MateMenuTreeItemType  type)
+{
+	switch (type) {
+	case MATEMENU_TREE_ITEM_DIRECTORY:
+		return matemenu_tree_iter_get_directory (iter);
+	case MATEMENU_TREE_ITEM_ENTRY:
+		return matemenu_tree_iter_get_entry (iter);
+	case MATEMENU_TREE_ITEM_ALIAS:
+		return matemenu_tree_iter_get_alias (iter);
+	case MATEMENU_TREE_ITEM_HEADER:
+		return matemenu_tree_iter_get_header (iter);
+	default:
+		return NULL;
+	}
+}
+
+/* The key identifies the menu item created for a tree item when the tree
+ * is reloaded, and the signature tells whether the item can be kept as
+ * it is. Aliases and headers have no key, and are always recreated. */
+void
+panel_app_catalog_item_get_key (MateMenuTreeItemType   type,
+				gpointer               item,
+				char                 **key,
+				char                 **signature)
+{
+	GDesktopAppInfo *ginfo;
+	GIcon           *gicon;
+	char            *icon;
+	const char      *name;
+	const char      *description;
+	const char      *generic_name;
+
+	*key = NULL;
+	*signature = NULL;
+
+	switch (type) {
+	case MATEMENU_TREE_ITEM_DIRECTORY:
+		name = matemenu_tree_directory_get_name (item);
+		gicon = matemenu_tree_directory_get_icon (item);
+		icon = gicon ? g_icon_to_string (gicon) : NULL;
+
+		*key = g_strconcat ("directory:", name ? name : "", NULL);
+		*signature = g_strdup (icon ? icon : "");
+
+		g_free (icon);
+		break;
+
+	case MATEMENU_TREE_ITEM_ENTRY:
+		ginfo = matemenu_tree_entry_get_app_info (item);
+		name = g_app_info_get_name (G_APP_INFO (ginfo));
+		description = g_app_info_get_description (G_APP_INFO (ginfo));
+		generic_name = g_desktop_app_info_get_generic_name (ginfo);
+		gicon = g_app_info_get_icon (G_APP_INFO (ginfo));
+		icon = gicon ? g_icon_to_string (gicon) : NULL;
+
+		*key = g_strconcat ("entry:", matemenu_tree_entry_get_desktop_file_id (item), NULL);
+		*signature = g_strjoin ("\n",
+					name ? name : "",
+					icon ? icon : "",
+					description ? description : "",
+					generic_name ? generic_name : "",
+					NULL);
+
+		g_free (icon);
+		break;
+
+	case MATEMENU_TREE_ITEM_SEPARATOR:
+		*key = g_strdup ("separator");
+		break;
+
+	default:
+		break;
+	}
+}
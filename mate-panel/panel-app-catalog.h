@@ -0,0 +1,58 @@
+/*
+ * panel-app-catalog.h: applications of the menu trees, shared by the panel
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_APP_CATALOG_H__
+#define __PANEL_APP_CATALOG_H__
+
+#include <gio/gio.h>
+#include <matemenu-tree.h>
+
+#include <libpanel-util/panel-glib.h>
+
+G_BEGIN_DECLS
+
+#define PANEL_TYPE_APP_CATALOG			(panel_app_catalog_get_type ())
+G_DECLARE_FINAL_TYPE (PanelAppCatalog, panel_app_catalog, PANEL, APP_CATALOG, GObject);
+
+PanelAppCatalog   *panel_app_catalog_get              (const char      *menu_file);
+
+const char        *panel_app_catalog_get_menu_file    (PanelAppCatalog *catalog);
+MateMenuTree      *panel_app_catalog_get_tree         (PanelAppCatalog *catalog);
+void               panel_app_catalog_load             (PanelAppCatalog *catalog);
+MateMenuTree      *panel_app_catalog_load_sync        (PanelAppCatalog *catalog);
+
+GPtrArray         *panel_app_catalog_get_applications (PanelAppCatalog *catalog);
+void               panel_app_catalog_search           (PanelAppCatalog        *catalog,
+						       const PanelGUtf8Needle *needle,
+						       GHashTable             *matches);
+GIcon             *panel_app_catalog_get_icon         (PanelAppCatalog *catalog,
+						       GIcon           *icon);
+
+gpointer           panel_app_catalog_iter_get_item    (MateMenuTreeIter      *iter,
+						       MateMenuTreeItemType   type);
+void               panel_app_catalog_item_get_key     (MateMenuTreeItemType   type,
+						       gpointer               item,
+						       char                 **key,
+						       char                 **signature);
+
+G_END_DECLS
+
+#endif /* __PANEL_APP_CATALOG_H__ */
@@ -132,6 +132,13 @@ void  _mate_panel_applet_frame_update_size_hints     (MatePanelAppletFrame *fram
 char *_mate_panel_applet_frame_get_background_string (MatePanelAppletFrame    *frame,
 						 PanelWidget         *panel,
 						 PanelBackgroundType  type);
+int   _mate_panel_applet_frame_get_background_image  (MatePanelAppletFrame    *frame,
+						 PanelWidget         *panel,
+						 int                 *width,
+						 int                 *height,
+						 int                 *stride,
+						 int                 *x,
+						 int                 *y);
 
 void  _mate_panel_applet_frame_applet_broken         (MatePanelAppletFrame *frame);
 
@@ -0,0 +1,223 @@
+/*
+ * panel-applet-load-queue.c: the objects waiting to be loaded on the panels
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "panel-applet-load-queue.h"
+
+/* The objects to load are grouped by toplevel, so that looking for the
+ * next object to load only needs to look up each toplevel once */
+typedef struct {
+	char   *toplevel_id;
+	GSList *applets;
+} MatePanelAppletLoadQueue;
+
+/* toplevel id -> MatePanelAppletLoadQueue */
+static GHashTable *mate_panel_applets_to_load = NULL;
+/* the MatePanelAppletLoadQueue, sorted by toplevel id */
+static GSList     *mate_panel_applets_to_load_queues = NULL;
+/* applet id -> MatePanelAppletToLoad, for all the queued objects */
+static GHashTable *mate_panel_applets_to_load_ids = NULL;
+
+void
+mate_panel_applet_to_load_free (MatePanelAppletToLoad *applet)
+{
+	g_free (applet->id);
+	g_free (applet->toplevel_id);
+	g_free (applet);
+}
+
+static void
+free_applet_load_queue (MatePanelAppletLoadQueue *queue)
+{
+	g_slist_free_full (queue->applets, (GDestroyNotify) mate_panel_applet_to_load_free);
+	g_free (queue->toplevel_id);
+	g_free (queue);
+}
+
+static void
+mate_panel_applet_load_queue_ensure_tables (void)
+{
+	if (mate_panel_applets_to_load)
+		return;
+
+	mate_panel_applets_to_load =
+		g_hash_table_new_full (g_str_hash, g_str_equal,
+				       NULL,
+				       (GDestroyNotify) free_applet_load_queue);
+	mate_panel_applets_to_load_ids =
+		g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+/* Returns FALSE if the object is already queued */
+gboolean
+mate_panel_applet_load_queue_add (const char                *id,
+				  PanelObjectType            type,
+				  const char                *toplevel_id,
+				  int                        position,
+				  PanelObjectEdgeRelativity  edge_relativity,
+				  gboolean                   locked)
+{
+	MatePanelAppletToLoad    *applet;
+	MatePanelAppletLoadQueue *queue;
+
+	g_return_val_if_fail (id != NULL, FALSE);
+	g_return_val_if_fail (toplevel_id != NULL, FALSE);
+
+	mate_panel_applet_load_queue_ensure_tables ();
+
+	/* the same object would be registered twice */
+	if (g_hash_table_contains (mate_panel_applets_to_load_ids, id))
+		return FALSE;
+
+	applet = g_new0 (MatePanelAppletToLoad, 1);
+
+	applet->id              = g_strdup (id);
+	applet->type            = type;
+	applet->toplevel_id     = g_strdup (toplevel_id);
+	applet->position        = position;
+	applet->edge_relativity = edge_relativity;
+	applet->locked          = locked != FALSE;
+
+	queue = g_hash_table_lookup (mate_panel_applets_to_load, toplevel_id);
+	if (!queue) {
+		queue = g_new0 (MatePanelAppletLoadQueue, 1);
+		queue->toplevel_id = g_strdup (toplevel_id);
+		g_hash_table_insert (mate_panel_applets_to_load,
+				     queue->toplevel_id, queue);
+		mate_panel_applets_to_load_queues =
+			g_slist_prepend (mate_panel_applets_to_load_queues, queue);
+	}
+
+	queue->applets = g_slist_prepend (queue->applets, applet);
+	g_hash_table_insert (mate_panel_applets_to_load_ids, applet->id, applet);
+
+	return TRUE;
+}
+
+gboolean
+mate_panel_applet_load_queue_contains (const char *id)
+{
+	if (!mate_panel_applets_to_load_ids)
+		return FALSE;
+
+	return g_hash_table_contains (mate_panel_applets_to_load_ids, id);
+}
+
+gboolean
+mate_panel_applet_load_queue_is_empty (void)
+{
+	return mate_panel_applets_to_load_queues == NULL;
+}
+
+static int
+mate_panel_applet_compare (const MatePanelAppletToLoad *a,
+			   const MatePanelAppletToLoad *b)
+{
+	/* the applets of a queue all have the same toplevel */
+	if (a->edge_relativity != b->edge_relativity)
+		return a->edge_relativity - b->edge_relativity;
+	else
+		return a->position - b->position;
+}
+
+static int
+mate_panel_applet_load_queue_compare (const MatePanelAppletLoadQueue *a,
+				      const MatePanelAppletLoadQueue *b)
+{
+	return strcmp (a->toplevel_id, b->toplevel_id);
+}
+
+/* Sorts the objects in loading order: by toplevel id, then by edge
+ * relativity and position on their toplevel */
+void
+mate_panel_applet_load_queue_sort (void)
+{
+	GSList *l;
+
+	mate_panel_applets_to_load_queues =
+		g_slist_sort (mate_panel_applets_to_load_queues,
+			      (GCompareFunc) mate_panel_applet_load_queue_compare);
+
+	for (l = mate_panel_applets_to_load_queues; l; l = l->next) {
+		MatePanelAppletLoadQueue *queue = l->data;
+
+		queue->applets = g_slist_sort (queue->applets,
+					       (GCompareFunc) mate_panel_applet_compare);
+	}
+}
+
+/* Removes the next object whose toplevel exists from the queue, and
+ * returns it with its toplevel. If none of the remaining objects has a
+ * toplevel, the queue is emptied and NULL is returned. */
+MatePanelAppletToLoad *
+mate_panel_applet_load_queue_pop (MatePanelAppletToplevelLookupFunc   lookup,
+				  gpointer                            user_data,
+				  gpointer                           *toplevel)
+{
+	MatePanelAppletToLoad    *applet;
+	MatePanelAppletLoadQueue *queue = NULL;
+	GSList                   *l;
+
+	g_return_val_if_fail (lookup != NULL, NULL);
+	g_return_val_if_fail (toplevel != NULL, NULL);
+
+	*toplevel = NULL;
+
+	for (l = mate_panel_applets_to_load_queues; l; l = l->next) {
+		queue = l->data;
+
+		*toplevel = lookup (queue->toplevel_id, user_data);
+		if (*toplevel)
+			break;
+	}
+
+	if (!l) {
+		/* All the remaining objects don't have a panel */
+		mate_panel_applet_load_queue_clear ();
+		return NULL;
+	}
+
+	applet = queue->applets->data;
+	queue->applets = g_slist_delete_link (queue->applets, queue->applets);
+	g_hash_table_remove (mate_panel_applets_to_load_ids, applet->id);
+
+	if (!queue->applets) {
+		mate_panel_applets_to_load_queues =
+			g_slist_delete_link (mate_panel_applets_to_load_queues, l);
+		g_hash_table_remove (mate_panel_applets_to_load, queue->toplevel_id);
+	}
+
+	return applet;
+}
+
+void
+mate_panel_applet_load_queue_clear (void)
+{
+	if (!mate_panel_applets_to_load)
+		return;
+
+	g_slist_free (mate_panel_applets_to_load_queues);
+	mate_panel_applets_to_load_queues = NULL;
+	g_hash_table_remove_all (mate_panel_applets_to_load_ids);
+	g_hash_table_remove_all (mate_panel_applets_to_load);
+}
@@ -0,0 +1,67 @@
+/*
+ * panel-applet-load-queue.h: the objects waiting to be loaded on the panels
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_APPLET_LOAD_QUEUE_H__
+#define __PANEL_APPLET_LOAD_QUEUE_H__
+
+#include <glib.h>
+#include "panel-enums-gsettings.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	char                      *id;
+	PanelObjectType            type;
+	char                      *toplevel_id;
+	int                        position;
+	PanelObjectEdgeRelativity  edge_relativity;
+	gint64                     load_start_time;
+	guint                      locked : 1;
+} MatePanelAppletToLoad;
+
+/* Returns the toplevel with @toplevel_id, or NULL if it doesn't exist */
+typedef gpointer (*MatePanelAppletToplevelLookupFunc) (const char *toplevel_id,
+						       gpointer    user_data);
+
+void     mate_panel_applet_to_load_free (MatePanelAppletToLoad *applet);
+
+gboolean mate_panel_applet_load_queue_add      (const char                *id,
+						PanelObjectType            type,
+						const char                *toplevel_id,
+						int                        position,
+						PanelObjectEdgeRelativity  edge_relativity,
+						gboolean                   locked);
+gboolean mate_panel_applet_load_queue_contains (const char *id);
+gboolean mate_panel_applet_load_queue_is_empty (void);
+void     mate_panel_applet_load_queue_sort     (void);
+MatePanelAppletToLoad *
+	 mate_panel_applet_load_queue_pop      (MatePanelAppletToplevelLookupFunc   lookup,
+						gpointer                            user_data,
+						gpointer                           *toplevel);
+void     mate_panel_applet_load_queue_clear    (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_APPLET_LOAD_QUEUE_H__ */
@@ -0,0 +1,207 @@
+/*
+ * panel-background-transform.c: scaling and rotation of panel background images
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "panel-background-transform.h"
+
+/* test-panel-background builds the scalar kernels on SSE2 machines too */
+#if defined (__SSE2__) && !defined (PANEL_BACKGROUND_TRANSFORM_SCALAR)
+#define PANEL_BACKGROUND_TRANSFORM_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* Rotating the image writes the source rows as destination columns.
+ * Doing it a whole row at a time touches a different destination cache
+ * line for every pixel, so the image is rotated in tiles small enough
+ * for both the source and the destination lines to stay in the cache. */
+#define ROTATE_TILE_SIZE 32
+
+static void
+rotate_pixels_rgb (guchar       *dest,
+		   int           destrowstride,
+		   const guchar *src,
+		   int           srcrowstride,
+		   int           width,
+		   int           height)
+{
+	int x0, y0;
+	int x, y;
+
+	for (y0 = 0; y0 < height; y0 += ROTATE_TILE_SIZE) {
+		int y1 = MIN (y0 + ROTATE_TILE_SIZE, height);
+
+		for (x0 = 0; x0 < width; x0 += ROTATE_TILE_SIZE) {
+			int x1 = MIN (x0 + ROTATE_TILE_SIZE, width);
+
+			for (x = x0; x < x1; x++) {
+				guchar       *dstptr = dest + destrowstride * (width - x - 1) + 3 * y0;
+				const guchar *srcptr = src + srcrowstride * y0 + 3 * x;
+
+				for (y = y0; y < y1; y++) {
+					dstptr[0] = srcptr[0];
+					dstptr[1] = srcptr[1];
+					dstptr[2] = srcptr[2];
+					dstptr += 3;
+					srcptr += srcrowstride;
+				}
+			}
+		}
+	}
+}
+
+#ifdef PANEL_BACKGROUND_TRANSFORM_SSE2
+/* Rotates a 4x4 block of pixels with two rounds of unpacking */
+static inline void
+rotate_block_rgba_sse2 (guint32       *dest,
+			int            destrowstride,
+			const guint32 *src,
+			int            srcrowstride)
+{
+	__m128i r0, r1, r2, r3;
+	__m128i t0, t1, t2, t3;
+
+	r0 = _mm_loadu_si128 ((const __m128i *) (src));
+	r1 = _mm_loadu_si128 ((const __m128i *) (src + srcrowstride));
+	r2 = _mm_loadu_si128 ((const __m128i *) (src + 2 * srcrowstride));
+	r3 = _mm_loadu_si128 ((const __m128i *) (src + 3 * srcrowstride));
+
+	t0 = _mm_unpacklo_epi32 (r0, r1);
+	t1 = _mm_unpacklo_epi32 (r2, r3);
+	t2 = _mm_unpackhi_epi32 (r0, r1);
+	t3 = _mm_unpackhi_epi32 (r2, r3);
+
+	/* source column i is destination row -i */
+	_mm_storeu_si128 ((__m128i *) (dest),                     _mm_unpacklo_epi64 (t0, t1));
+	_mm_storeu_si128 ((__m128i *) (dest - destrowstride),     _mm_unpackhi_epi64 (t0, t1));
+	_mm_storeu_si128 ((__m128i *) (dest - 2 * destrowstride), _mm_unpacklo_epi64 (t2, t3));
+	_mm_storeu_si128 ((__m128i *) (dest - 3 * destrowstride), _mm_unpackhi_epi64 (t2, t3));
+}
+#endif
+
+static void
+rotate_pixels_rgba (guint32       *dest,
+		    int            destrowstride,
+		    const guint32 *src,
+		    int            srcrowstride,
+		    int            width,
+		    int            height)
+{
+	int x0, y0;
+	int x, y;
+
+	for (y0 = 0; y0 < height; y0 += ROTATE_TILE_SIZE) {
+		int y1 = MIN (y0 + ROTATE_TILE_SIZE, height);
+
+		for (x0 = 0; x0 < width; x0 += ROTATE_TILE_SIZE) {
+			int x1 = MIN (x0 + ROTATE_TILE_SIZE, width);
+
+			x = x0;
+#ifdef PANEL_BACKGROUND_TRANSFORM_SSE2
+			for (; x + 4 <= x1; x += 4) {
+				for (y = y0; y + 4 <= y1; y += 4)
+					rotate_block_rgba_sse2 (dest + destrowstride * (width - x - 1) + y,
+								destrowstride,
+								src + srcrowstride * y + x,
+								srcrowstride);
+
+				/* remaining rows of the tile */
+				for (; y < y1; y++) {
+					const guint32 *srcptr = src + srcrowstride * y + x;
+					guint32       *dstptr = dest + destrowstride * (width - x - 1) + y;
+
+					dstptr[0]                  = srcptr[0];
+					dstptr[-destrowstride]     = srcptr[1];
+					dstptr[-2 * destrowstride] = srcptr[2];
+					dstptr[-3 * destrowstride] = srcptr[3];
+				}
+			}
+#endif
+			for (; x < x1; x++) {
+				guint32       *dstptr = dest + destrowstride * (width - x - 1);
+				const guint32 *srcptr = src + srcrowstride * y0 + x;
+
+				for (y = y0; y < y1; y++) {
+					dstptr[y] = *srcptr;
+					srcptr += srcrowstride;
+				}
+			}
+		}
+	}
+}
+
+/* Returns @image scaled to @width x @height, and rotated by 90 degrees
+ * for vertical panels if @rotate is set */
+GdkPixbuf *
+panel_background_scale_and_rotate (GdkPixbuf *image,
+				   int        width,
+				   int        height,
+				   gboolean   rotate)
+{
+	GdkPixbuf *scaled;
+	GdkPixbuf *retval;
+	int        orig_width, orig_height;
+
+	g_return_val_if_fail (GDK_IS_PIXBUF (image), NULL);
+
+	orig_width  = gdk_pixbuf_get_width  (image);
+	orig_height = gdk_pixbuf_get_height (image);
+
+	if (width == orig_width &&
+	    height == orig_height) {
+		scaled = image;
+		g_object_ref (scaled);
+	} else {
+		scaled = gdk_pixbuf_scale_simple (
+				image,
+				width, height,
+				GDK_INTERP_BILINEAR);
+	}
+
+	if (rotate) {
+		if (!gdk_pixbuf_get_has_alpha (scaled)) {
+			retval = gdk_pixbuf_new (
+				GDK_COLORSPACE_RGB, FALSE, 8, height, width);
+
+			rotate_pixels_rgb (gdk_pixbuf_get_pixels (retval),
+					   gdk_pixbuf_get_rowstride (retval),
+					   gdk_pixbuf_get_pixels (scaled),
+					   gdk_pixbuf_get_rowstride (scaled),
+					   width, height);
+
+			g_object_unref (scaled);
+		} else {
+			retval = gdk_pixbuf_new (
+				GDK_COLORSPACE_RGB, TRUE, 8, height, width);
+
+			rotate_pixels_rgba ((guint32 *) gdk_pixbuf_get_pixels (retval),
+					    gdk_pixbuf_get_rowstride (retval) / 4,
+					    (const guint32 *) gdk_pixbuf_get_pixels (scaled),
+					    gdk_pixbuf_get_rowstride (scaled) / 4,
+					    width, height);
+
+			g_object_unref (scaled);
+		}
+	} else
+		retval = scaled;
+
+	return retval;
+}
@@ -0,0 +1,40 @@
+/*
+ * panel-background-transform.h: scaling and rotation of panel background images
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_BACKGROUND_TRANSFORM_H__
+#define __PANEL_BACKGROUND_TRANSFORM_H__
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+GdkPixbuf *panel_background_scale_and_rotate (GdkPixbuf *image,
+					      int        width,
+					      int        height,
+					      gboolean   rotate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_BACKGROUND_TRANSFORM_H__ */
@@ -23,11 +23,18 @@
  *      Mark McLoughlin <mark@skynet.ie>
  */
 
+#define _GNU_SOURCE /* memfd_create */
+
 #include <config.h>
 
 #include "panel-background.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
 #include <gdk/gdk.h>
 #include <gtk/gtk.h>
 #include <cairo.h>
@@ -37,6 +44,7 @@
 #include <cairo-xlib.h>
 #endif
 
+#include "panel-background-transform.h"
 #include "panel-util.h"
 
 static gboolean panel_background_composite (PanelBackground *background);
@@ -173,9 +181,19 @@ panel_background_prepare (PanelBackground *background)
 	return TRUE;
 }
 
+static void
+free_shared_image (PanelBackground *background)
+{
+	if (background->shared_fd >= 0)
+		close (background->shared_fd);
+	background->shared_fd = -1;
+}
+
 static void
 free_composited_resources (PanelBackground *background)
 {
+	free_shared_image (background);
+
 	background->composited = FALSE;
 
 	if (background->composited_pattern)
@@ -184,11 +202,13 @@ free_composited_resources (PanelBackground *background)
 }
 
 static cairo_pattern_t *
-composite_image_onto_desktop (PanelBackground *background)
+composite_image_onto_desktop (PanelBackground *background,
+			      cairo_pattern_t *previous)
 {
 	int              width, height;
 	cairo_t         *cr;
 	cairo_surface_t *surface;
+	cairo_surface_t *previous_surface;
 	cairo_pattern_t *pattern;
 
 	width  = background->region.width;
@@ -204,11 +224,35 @@ composite_image_onto_desktop (PanelBackground *background)
 
 	cr = cairo_create (surface);
 
+	if (previous &&
+	    cairo_pattern_get_surface (previous, &previous_surface) == CAIRO_STATUS_SUCCESS) {
+		int previous_width, previous_height;
+
+		/* the image is tiled from the origin, so the part of the
+		 * previous image that is still visible is unchanged: copy
+		 * it, and only tile the part that was not covered */
+		previous_width  = MIN (width, background->composited_width);
+		previous_height = MIN (height, background->composited_height);
+
+		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+		cairo_set_source_surface (cr, previous_surface, 0, 0);
+		cairo_rectangle (cr, 0, 0, previous_width, previous_height);
+		cairo_fill (cr);
+		cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+		if (width > previous_width)
+			cairo_rectangle (cr, previous_width, 0,
+					 width - previous_width, height);
+		if (height > previous_height)
+			cairo_rectangle (cr, 0, previous_height,
+					 previous_width, height - previous_height);
+	} else
+		cairo_rectangle (cr, 0, 0, width, height);
+
 	gdk_cairo_set_source_pixbuf (cr, background->transformed_image, 0, 0);
 	pattern = cairo_get_source (cr);
 	cairo_pattern_set_extend (pattern, CAIRO_EXTEND_REPEAT);
 
-	cairo_rectangle (cr, 0, 0, width, height);
 	cairo_fill (cr);
 
 	cairo_destroy (cr);
@@ -221,9 +265,23 @@ composite_image_onto_desktop (PanelBackground *background)
 static gboolean
 panel_background_composite (PanelBackground *background)
 {
+	cairo_pattern_t *previous = NULL;
+
 	if (!background->transformed)
 		return FALSE;
 
+	if (background->type == PANEL_BACK_IMAGE &&
+	    background->composited &&
+	    background->composited_pattern) {
+		/* the composited image only depends on the transformed
+		 * image and the size of the panel, not on its position */
+		if (background->composited_width == background->region.width &&
+		    background->composited_height == background->region.height)
+			return TRUE;
+
+		previous = cairo_pattern_reference (background->composited_pattern);
+	}
+
 	free_composited_resources (background);
 
 	switch (background->type) {
@@ -233,7 +291,9 @@ panel_background_composite (PanelBackground *background)
 	case PANEL_BACK_IMAGE:
         if (background->transformed_image) {
 			background->composited_pattern =
-				composite_image_onto_desktop (background);
+				composite_image_onto_desktop (background, previous);
+			background->composited_width  = background->region.width;
+			background->composited_height = background->region.height;
 		}
 		break;
 	default:
@@ -241,6 +301,9 @@ panel_background_composite (PanelBackground *background)
 		break;
 	}
 
+	if (previous)
+		cairo_pattern_destroy (previous);
+
 	background->composited = TRUE;
 
 	panel_background_prepare (background);
@@ -263,18 +326,17 @@ free_transformed_resources (PanelBackground *background)
 	background->transformed_image = NULL;
 }
 
-static GdkPixbuf *
-get_scaled_and_rotated_pixbuf (PanelBackground *background)
+/* The size the loaded image is scaled to before being rotated, which
+ * only depends on the size of the panel when fitting or stretching. */
+static void
+get_transformed_size (PanelBackground *background,
+		      int             *width_out,
+		      int             *height_out,
+		      gboolean        *rotate_out)
 {
-	GdkPixbuf *scaled;
-	GdkPixbuf *retval;
-	int        orig_width, orig_height;
-	int        panel_width, panel_height;
-	int        width, height;
-
-	load_background_file (background);
-	if (!background->loaded_image)
-		return NULL;
+	int orig_width, orig_height;
+	int panel_width, panel_height;
+	int width, height;
 
 	orig_width  = gdk_pixbuf_get_width  (background->loaded_image);
 	orig_height = gdk_pixbuf_get_height (background->loaded_image);
@@ -320,83 +382,50 @@ get_scaled_and_rotated_pixbuf (PanelBackground *background)
 		height = tmp;
 	}
 
-	if (width == orig_width &&
-	    height == orig_height) {
-		scaled = background->loaded_image;
-		g_object_ref (scaled);
-	} else {
-		scaled = gdk_pixbuf_scale_simple (
-				background->loaded_image,
-				width, height,
-				GDK_INTERP_BILINEAR);
-	}
-
-	if (background->rotate_image &&
-	    background->orientation == GTK_ORIENTATION_VERTICAL) {
-		if (!background->has_alpha) {
-			guchar *dest;
-			guchar *src;
-			int     x, y;
-			int     destrowstride;
-			int     srcrowstride;
-
-			retval = gdk_pixbuf_new (
-				GDK_COLORSPACE_RGB, FALSE, 8, height, width);
-
-			dest          = gdk_pixbuf_get_pixels (retval);
-			destrowstride = gdk_pixbuf_get_rowstride (retval);
-			src           = gdk_pixbuf_get_pixels (scaled);
-			srcrowstride  = gdk_pixbuf_get_rowstride (scaled);
-
-			for (y = 0; y < height; y++)
-				for (x = 0; x < width; x++) {
-					guchar *dstptr = & ( dest [3*y + destrowstride * (width - x - 1)] );
-					guchar *srcptr = & ( src [y * srcrowstride + 3*x] );
-					dstptr[0] = srcptr[0];
-					dstptr[1] = srcptr[1];
-					dstptr[2] = srcptr[2];
-				}
-
-			g_object_unref (scaled);
-		} else {
-			guint32 *dest;
-			guint32 *src;
-			int     x, y;
-			int     destrowstride;
-			int     srcrowstride;
-
-			retval = gdk_pixbuf_new (
-				GDK_COLORSPACE_RGB, TRUE, 8, height, width);
-
-			dest          = (guint32 *) gdk_pixbuf_get_pixels (retval);
-			destrowstride =             gdk_pixbuf_get_rowstride (retval) / 4;
-			src           = (guint32 *) gdk_pixbuf_get_pixels (scaled);
-			srcrowstride  =             gdk_pixbuf_get_rowstride (scaled) / 4;
-
-			for (y = 0; y < height; y++)
-				for (x = 0; x < width; x++)
-					dest [y + destrowstride * (width - x - 1)] =
-						src [y * srcrowstride + x];
-
-			g_object_unref (scaled);
-		}
-	} else
-		retval = scaled;
-
-	return retval;
+	*width_out  = width;
+	*height_out = height;
+	*rotate_out = (background->rotate_image &&
+		       background->orientation == GTK_ORIENTATION_VERTICAL);
 }
 
 static gboolean
 panel_background_transform (PanelBackground *background)
 {
+	int      width = 0, height = 0;
+	gboolean rotate = FALSE;
+
 	if (background->region.width == -1)
 		return FALSE;
 
+	if (background->type == PANEL_BACK_IMAGE) {
+		if (!background->loaded_image)
+			load_background_file (background);
+
+		if (background->loaded_image)
+			get_transformed_size (background, &width, &height, &rotate);
+
+		/* moving or resizing the panel does not always change the
+		 * transformed image */
+		if (background->transformed &&
+		    background->transformed_image &&
+		    background->transformed_width == width &&
+		    background->transformed_height == height &&
+		    background->transformed_rotated == rotate) {
+			panel_background_composite (background);
+			return TRUE;
+		}
+	}
+
 	free_transformed_resources (background);
 
-	if (background->type == PANEL_BACK_IMAGE)
+	if (background->type == PANEL_BACK_IMAGE && background->loaded_image) {
 		background->transformed_image =
-			get_scaled_and_rotated_pixbuf (background);
+			panel_background_scale_and_rotate (background->loaded_image,
+							   width, height, rotate);
+		background->transformed_width   = width;
+		background->transformed_height  = height;
+		background->transformed_rotated = rotate;
+	}
 
 	background->transformed = TRUE;
 
@@ -425,7 +454,8 @@ load_background_file (PanelBackground *background)
 {
 	GError *error = NULL;
 
-	if (!g_file_test (background->image, G_FILE_TEST_IS_REGULAR))
+	if (!background->image ||
+	    !g_file_test (background->image, G_FILE_TEST_IS_REGULAR))
 		return;
 
 	/* FIXME add a monitor on the file so that we reload the background
@@ -694,14 +724,11 @@ panel_background_change_region (PanelBackground *background,
 		/* only retransform the background if we have in
 		   fact changed size/orientation */
 		panel_background_transform (background);
-	else if (background->has_alpha || ! background->composited)
-		/* only do compositing if we have some alpha
-		   value to worry about */
+	else if (need_to_reprepare || ! background->composited)
+		/* the composited image does not depend on the
+		   position of the panel, only recomposite (and
+		   prepare) the background if the size changed */
 		panel_background_composite (background);
-	else if (need_to_reprepare)
-		/* at least we must prepare the background
-		   if the size changed */
-		panel_background_prepare (background);
 }
 
 void
@@ -727,7 +754,13 @@ panel_background_init (PanelBackground              *background,
 	background->region.width      = -1;
 	background->region.height     = -1;
 	background->transformed_image = NULL;
+	background->transformed_width = -1;
+	background->transformed_height = -1;
+	background->transformed_rotated = FALSE;
 	background->composited_pattern = NULL;
+	background->composited_width = -1;
+	background->composited_height = -1;
+	background->shared_fd = -1;
 
 	background->window   = NULL;
 
@@ -800,6 +833,112 @@ panel_background_make_string (PanelBackground *background,
 	return retval;
 }
 
+static int
+create_shared_memory_file (gsize size)
+{
+	int fd = -1;
+
+#ifdef HAVE_MEMFD_CREATE
+	fd = memfd_create ("mate-panel-background", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#endif
+
+	if (fd < 0) {
+		char *path;
+
+		fd = g_file_open_tmp ("mate-panel-background-XXXXXX", &path, NULL);
+		if (fd < 0)
+			return -1;
+
+		g_unlink (path);
+		g_free (path);
+	}
+
+	if (ftruncate (fd, size) != 0) {
+		close (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* Returns a file descriptor for a read-only ARGB32 copy of the composited
+ * background image, or -1 if the background is not an image. The image is
+ * only copied once per background change, and never modified afterwards:
+ * applets map it and use their part of it directly instead of each of
+ * them copying its part out of an X pixmap.
+ *
+ * The file descriptor is owned by @background.
+ */
+int
+panel_background_get_shared_image (PanelBackground *background,
+				   int             *width,
+				   int             *height,
+				   int             *stride)
+{
+	cairo_surface_t *source;
+	cairo_surface_t *surface;
+	cairo_t         *cr;
+	guchar          *data;
+	gsize            size;
+	int              fd;
+	int              w, h, s;
+
+	if (background->shared_fd < 0) {
+		if (panel_background_effective_type (background) != PANEL_BACK_IMAGE)
+			return -1;
+
+		if (cairo_pattern_get_surface (background->composited_pattern, &source) != CAIRO_STATUS_SUCCESS)
+			return -1;
+
+		w = background->region.width;
+		h = background->region.height;
+		s = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, w);
+		if (w <= 0 || h <= 0 || s <= 0)
+			return -1;
+
+		size = (gsize) s * h;
+		fd = create_shared_memory_file (size);
+		if (fd < 0) {
+			g_warning ("Could not create the shared panel background: %s",
+				   g_strerror (errno));
+			return -1;
+		}
+
+		data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (data == MAP_FAILED) {
+			close (fd);
+			return -1;
+		}
+
+		surface = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32, w, h, s);
+		cr = cairo_create (surface);
+		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+		cairo_set_source_surface (cr, source, 0, 0);
+		cairo_paint (cr);
+		cairo_destroy (cr);
+		cairo_surface_finish (surface);
+		cairo_surface_destroy (surface);
+
+		munmap (data, size);
+
+#ifdef F_ADD_SEALS
+		/* applets can rely on the file not shrinking under them */
+		fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+
+		background->shared_fd     = fd;
+		background->shared_width  = w;
+		background->shared_height = h;
+		background->shared_stride = s;
+	}
+
+	*width  = background->shared_width;
+	*height = background->shared_height;
+	*stride = background->shared_stride;
+
+	return background->shared_fd;
+}
+
 PanelBackgroundType
 panel_background_get_type (PanelBackground *background)
 {
@@ -54,7 +54,19 @@ struct _PanelBackground {
 	GtkOrientation          orientation;
 	GdkRectangle            region;
 	GdkPixbuf              *transformed_image;
+	int                     transformed_width;
+	int                     transformed_height;
+	gboolean                transformed_rotated;
 	cairo_pattern_t        *composited_pattern;
+	int                     composited_width;
+	int                     composited_height;
+
+	/* copy of the composited image in a sealed memory file, handed
+	 * over to the applets */
+	int                     shared_fd;
+	int                     shared_width;
+	int                     shared_height;
+	int                     shared_stride;
 
 	GdkWindow              *window;
 	cairo_pattern_t        *default_pattern;
@@ -109,6 +121,10 @@ void  panel_background_change_region     (PanelBackground     *background,
 char *panel_background_make_string       (PanelBackground     *background,
 					  int                  x,
 					  int                  y);
+int   panel_background_get_shared_image  (PanelBackground     *background,
+					  int                 *width,
+					  int                 *height,
+					  int                 *stride);
 
 PanelBackgroundType  panel_background_get_type   (PanelBackground *background);
 const GdkRGBA       *panel_background_get_color  (PanelBackground *background);
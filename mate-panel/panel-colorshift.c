@@ -0,0 +1,109 @@
+/*
+ * panel-colorshift.c: brightening of the icons of highlighted buttons
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "panel-colorshift.h"
+
+/* (a * b) / 255, rounded the way cairo does it */
+static inline guint32
+mul_un8 (guint32 a, guint32 b)
+{
+    guint32 t = a * b + 0x80;
+
+    return ((t >> 8) + t) >> 8;
+}
+
+void
+panel_colorshift_row_scalar (guint32       *dest,
+                             const guint32 *src,
+                             int            width,
+                             guint8         shift,
+                             gboolean       has_alpha)
+{
+    int j;
+
+    for (j = 0; j < width; j++) {
+        guint32 p = src[j];
+        guint32 a = p >> 24;
+        guint32 r = MIN (((p >> 16) & 0xff) + shift, 255);
+        guint32 g = MIN (((p >>  8) & 0xff) + shift, 255);
+        guint32 b = MIN (( p        & 0xff) + shift, 255);
+
+        if (has_alpha)
+            dest[j] = (mul_un8 (a, a) << 24) |
+                      (mul_un8 (r, a) << 16) |
+                      (mul_un8 (g, a) <<  8) |
+                       mul_un8 (b, a);
+        else
+            dest[j] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+/* Brightens the color channels of a row of premultiplied CAIRO_FORMAT_ARGB32
+ * or CAIRO_FORMAT_RGB24 pixels by @shift, then masks the result with the
+ * pixel alpha as if painted with CAIRO_OPERATOR_DEST_IN onto itself. Both
+ * passes are done at once. */
+void
+panel_colorshift_row (guint32       *dest,
+                      const guint32 *src,
+                      int            width,
+                      guint8         shift,
+                      gboolean       has_alpha)
+{
+    int j = 0;
+
+#ifdef __SSE2__
+    if (has_alpha) {
+        const __m128i shift_v = _mm_set1_epi32 (shift | (shift << 8) | (shift << 16));
+        const __m128i zero = _mm_setzero_si128 ();
+        const __m128i half = _mm_set1_epi16 (0x80);
+
+        for (; j + 4 <= width; j += 4) {
+            __m128i p, lo, hi, alo, ahi;
+
+            /* saturating add on B, G and R, alpha is left alone */
+            p = _mm_adds_epu8 (_mm_loadu_si128 ((const __m128i *) (src + j)), shift_v);
+
+            lo = _mm_unpacklo_epi8 (p, zero);
+            hi = _mm_unpackhi_epi8 (p, zero);
+
+            alo = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (lo, _MM_SHUFFLE (3, 3, 3, 3)),
+                                       _MM_SHUFFLE (3, 3, 3, 3));
+            ahi = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (hi, _MM_SHUFFLE (3, 3, 3, 3)),
+                                       _MM_SHUFFLE (3, 3, 3, 3));
+
+            lo = _mm_add_epi16 (_mm_mullo_epi16 (lo, alo), half);
+            hi = _mm_add_epi16 (_mm_mullo_epi16 (hi, ahi), half);
+            lo = _mm_srli_epi16 (_mm_add_epi16 (lo, _mm_srli_epi16 (lo, 8)), 8);
+            hi = _mm_srli_epi16 (_mm_add_epi16 (hi, _mm_srli_epi16 (hi, 8)), 8);
+
+            _mm_storeu_si128 ((__m128i *) (dest + j), _mm_packus_epi16 (lo, hi));
+        }
+    }
+#endif
+
+    panel_colorshift_row_scalar (dest + j, src + j, width - j, shift, has_alpha);
+}
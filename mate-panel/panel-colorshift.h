@@ -0,0 +1,48 @@
+/*
+ * panel-colorshift.h: brightening of the icons of highlighted buttons
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_COLORSHIFT_H__
+#define __PANEL_COLORSHIFT_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void panel_colorshift_row        (guint32       *dest,
+                                  const guint32 *src,
+                                  int            width,
+                                  guint8         shift,
+                                  gboolean       has_alpha);
+
+/* the same without the SSE2 kernel, for the ends of the rows */
+void panel_colorshift_row_scalar (guint32       *dest,
+                                  const guint32 *src,
+                                  int            width,
+                                  guint8         shift,
+                                  gboolean       has_alpha);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_COLORSHIFT_H__ */
@@ -0,0 +1,355 @@
+/*
+ * panel-executable-index.c: index of the executables in $PATH
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+
+#include "panel-executable-index.h"
+
+/* The names of the executables in $PATH, used to complete commands in
+ * the Run dialog. Directories in $PATH can be large or on slow network
+ * mounts, so they are read in a thread, once for the lifetime of the
+ * panel: the index is then kept up to date by monitoring them. */
+
+/* how long to wait for a directory to settle after it changed, in
+ * seconds */
+#define PANEL_EXECUTABLE_INDEX_RESCAN_DELAY 2
+
+/* sorted, without duplicates */
+static char     **executables = NULL;
+static guint      n_executables = 0;
+/* called every time the index is built */
+static GHookList  executables_changed_hooks;
+
+/* $PATH the index is built for */
+static char      *executables_path = NULL;
+static GList     *executables_monitors = NULL;
+static gboolean   executables_loading = FALSE;
+static gboolean   executables_dirty = FALSE;
+static guint      executables_rescan_id = 0;
+
+static void panel_executable_index_scan (void);
+
+static void
+scan_directory (const char *dirname,
+		GPtrArray  *names)
+{
+	DIR           *dir;
+	struct dirent *dent;
+	int            fd;
+
+	fd = open (dirname, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	dir = fdopendir (fd);
+	if (!dir) {
+		close (fd);
+		return;
+	}
+
+	while ((dent = readdir (dir))) {
+		struct stat st;
+
+		if (dent->d_name [0] == '.' &&
+		    (dent->d_name [1] == '\0' ||
+		     (dent->d_name [1] == '.' && dent->d_name [2] == '\0')))
+			continue;
+
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+		/* no need to stat() what can't be a program */
+		if (dent->d_type != DT_REG &&
+		    dent->d_type != DT_LNK &&
+		    dent->d_type != DT_UNKNOWN)
+			continue;
+#endif
+
+		/* follows symlinks, as g_file_test() did */
+		if (fstatat (dirfd (dir), dent->d_name, &st, 0) != 0 ||
+		    !S_ISREG (st.st_mode) ||
+		    !(st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+			continue;
+
+		if (faccessat (dirfd (dir), dent->d_name, X_OK, 0) != 0)
+			continue;
+
+		g_ptr_array_add (names, g_strdup (dent->d_name));
+	}
+
+	closedir (dir);
+}
+
+static int
+compare_names (gconstpointer a,
+	       gconstpointer b)
+{
+	return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static void
+panel_executable_index_thread (GTask        *task,
+			       gpointer      source_object,
+			       gpointer      task_data,
+			       GCancellable *cancellable)
+{
+	char      **pathv = task_data;
+	GPtrArray  *names;
+	guint       i, j;
+
+	names = g_ptr_array_new ();
+
+	for (i = 0; pathv [i]; i++) {
+		if (pathv [i][0] == '\0')
+			continue;
+
+		scan_directory (pathv [i], names);
+	}
+
+	g_ptr_array_sort (names, compare_names);
+
+	/* the same program can be in several directories */
+	for (i = 0, j = 0; i < names->len; i++) {
+		if (j > 0 && strcmp (names->pdata [i], names->pdata [j - 1]) == 0)
+			g_free (names->pdata [i]);
+		else
+			names->pdata [j++] = names->pdata [i];
+	}
+	g_ptr_array_set_size (names, j);
+	g_ptr_array_add (names, NULL);
+
+	g_task_return_pointer (task, g_ptr_array_free (names, FALSE),
+			       (GDestroyNotify) g_strfreev);
+}
+
+static void
+panel_executable_index_scanned (GObject      *source_object,
+				GAsyncResult *result,
+				gpointer      user_data)
+{
+	char **names;
+
+	executables_loading = FALSE;
+
+	names = g_task_propagate_pointer (G_TASK (result), NULL);
+	if (names) {
+		g_strfreev (executables);
+		executables = names;
+		n_executables = g_strv_length (names);
+
+		if (executables_changed_hooks.is_setup)
+			g_hook_list_invoke (&executables_changed_hooks, FALSE);
+	}
+
+	if (executables_dirty)
+		panel_executable_index_scan ();
+}
+
+static void
+panel_executable_index_scan (void)
+{
+	GTask *task;
+
+	if (executables_loading) {
+		executables_dirty = TRUE;
+		return;
+	}
+
+	executables_loading = TRUE;
+	executables_dirty = FALSE;
+
+	task = g_task_new (NULL, NULL, panel_executable_index_scanned, NULL);
+	g_task_set_task_data (task, g_strsplit (executables_path, ":", 0),
+			      (GDestroyNotify) g_strfreev);
+	g_task_run_in_thread (task, panel_executable_index_thread);
+	g_object_unref (task);
+}
+
+static gboolean
+panel_executable_index_rescan (gpointer data)
+{
+	executables_rescan_id = 0;
+
+	panel_executable_index_scan ();
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+panel_executable_index_directory_changed (GFileMonitor      *monitor,
+					  GFile             *file,
+					  GFile             *other_file,
+					  GFileMonitorEvent  event_type,
+					  gpointer           data)
+{
+	switch (event_type) {
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+	case G_FILE_MONITOR_EVENT_MOVED:
+		break;
+	default:
+		return;
+	}
+
+	/* packages install many files at once */
+	if (!executables_rescan_id)
+		executables_rescan_id =
+			g_timeout_add_seconds (PANEL_EXECUTABLE_INDEX_RESCAN_DELAY,
+					       panel_executable_index_rescan,
+					       NULL);
+}
+
+static void
+panel_executable_index_monitor (void)
+{
+	char **pathv;
+	int    i;
+
+	g_list_free_full (executables_monitors, g_object_unref);
+	executables_monitors = NULL;
+
+	pathv = g_strsplit (executables_path, ":", 0);
+
+	for (i = 0; pathv [i]; i++) {
+		GFile        *file;
+		GFileMonitor *monitor;
+
+		if (pathv [i][0] == '\0')
+			continue;
+
+		file = g_file_new_for_path (pathv [i]);
+		monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE,
+						    NULL, NULL);
+		g_object_unref (file);
+
+		if (!monitor)
+			continue;
+
+		g_signal_connect (monitor, "changed",
+				  G_CALLBACK (panel_executable_index_directory_changed),
+				  NULL);
+		executables_monitors = g_list_prepend (executables_monitors, monitor);
+	}
+
+	g_strfreev (pathv);
+}
+
+/* Starts building the index if it isn't yet, or if $PATH changed. */
+void
+panel_executable_index_ensure (void)
+{
+	const char *path;
+
+	path = g_getenv ("PATH");
+	if (!path)
+		path = "";
+
+	if (g_strcmp0 (path, executables_path) == 0)
+		return;
+
+	g_free (executables_path);
+	executables_path = g_strdup (path);
+
+	panel_executable_index_monitor ();
+	panel_executable_index_scan ();
+}
+
+/* Sets @result to a list of the names of the executables starting
+ * with @prefix, in alphabetical order. Returns FALSE if the index is
+ * not built yet. */
+gboolean
+panel_executable_index_lookup (const char  *prefix,
+			       GList      **result)
+{
+	GList  *list;
+	gsize   prefix_len;
+	guint   low, high;
+
+	g_return_val_if_fail (prefix != NULL, FALSE);
+	g_return_val_if_fail (result != NULL, FALSE);
+
+	*result = NULL;
+
+	if (!executables)
+		return FALSE;
+
+	prefix_len = strlen (prefix);
+
+	/* first name not sorting before @prefix */
+	low = 0;
+	high = n_executables;
+	while (low < high) {
+		guint mid = low + (high - low) / 2;
+
+		if (strcmp (executables [mid], prefix) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	list = NULL;
+	for (; low < n_executables; low++) {
+		if (strncmp (executables [low], prefix, prefix_len) != 0)
+			break;
+
+		list = g_list_prepend (list, g_strdup (executables [low]));
+	}
+
+	*result = g_list_reverse (list);
+
+	return TRUE;
+}
+
+/* Calls @func every time the index is built, the first time included.
+ * Returns an id for panel_executable_index_remove_changed_func(). */
+gulong
+panel_executable_index_add_changed_func (PanelExecutableIndexChangedFunc func,
+					 gpointer                        user_data)
+{
+	GHook *hook;
+
+	g_return_val_if_fail (func != NULL, 0);
+
+	if (!executables_changed_hooks.is_setup)
+		g_hook_list_init (&executables_changed_hooks, sizeof (GHook));
+
+	hook = g_hook_alloc (&executables_changed_hooks);
+	hook->func = (gpointer) func;
+	hook->data = user_data;
+	g_hook_append (&executables_changed_hooks, hook);
+
+	return hook->hook_id;
+}
+
+void
+panel_executable_index_remove_changed_func (gulong id)
+{
+	if (id && executables_changed_hooks.is_setup)
+		g_hook_destroy (&executables_changed_hooks, id);
+}
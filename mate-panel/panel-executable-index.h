@@ -0,0 +1,45 @@
+/*
+ * panel-executable-index.h: index of the executables in $PATH
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_EXECUTABLE_INDEX_H__
+#define __PANEL_EXECUTABLE_INDEX_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (* PanelExecutableIndexChangedFunc) (gpointer user_data);
+
+void     panel_executable_index_ensure (void);
+gboolean panel_executable_index_lookup (const char  *prefix,
+					GList      **result);
+
+gulong   panel_executable_index_add_changed_func    (PanelExecutableIndexChangedFunc  func,
+						     gpointer                         user_data);
+void     panel_executable_index_remove_changed_func (gulong                           id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_EXECUTABLE_INDEX_H__ */
@@ -0,0 +1,230 @@
+/*
+ * panel-icon-cache.c: cache of the icon surfaces loaded by the panel
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <glib/gstdio.h>
+
+#include "panel-icon-cache.h"
+
+/* Launchers, drawers and menu buttons often show the same icon at the
+ * same size: the surfaces are shared instead of loading the icon again
+ * for every button. The least recently used surfaces are dropped when
+ * the cache grows over PANEL_ICON_CACHE_MAX_SIZE bytes of pixel data,
+ * and the whole cache is dropped when an icon theme changes. Icons
+ * loaded from a file are dropped when the file is modified. */
+#define PANEL_ICON_CACHE_MAX_SIZE (8 * 1024 * 1024)
+
+typedef struct {
+	char            *key;
+	cairo_surface_t *surface;
+	gsize            size;
+	/* modification time of the file of an icon given by path */
+	gint64           mtime;
+	GList           *link;
+} PanelIconCacheEntry;
+
+static GHashTable *icon_cache = NULL;
+/* most recently used first */
+static GQueue      icon_cache_lru = G_QUEUE_INIT;
+static gsize       icon_cache_size = 0;
+static guint       icon_cache_hits = 0;
+static guint       icon_cache_misses = 0;
+
+static void
+panel_icon_cache_entry_free (PanelIconCacheEntry *entry)
+{
+	g_queue_delete_link (&icon_cache_lru, entry->link);
+	icon_cache_size -= entry->size;
+
+	cairo_surface_destroy (entry->surface);
+	g_free (entry->key);
+	g_free (entry);
+}
+
+static gboolean
+panel_icon_cache_theme_changed (GSignalInvocationHint *ihint,
+				guint                  n_param_values,
+				const GValue          *param_values,
+				gpointer               data)
+{
+	panel_icon_cache_clear ();
+
+	return TRUE;
+}
+
+static void
+panel_icon_cache_ensure (void)
+{
+	if (icon_cache)
+		return;
+
+	icon_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+					    NULL,
+					    (GDestroyNotify) panel_icon_cache_entry_free);
+
+	/* an emission hook runs before the "changed" handlers of the
+	 * buttons, so they don't get the icons of the previous theme
+	 * when they reload them */
+	g_signal_add_emission_hook (g_signal_lookup ("changed", GTK_TYPE_ICON_THEME),
+				    0, panel_icon_cache_theme_changed,
+				    NULL, NULL);
+}
+
+static char *
+panel_icon_cache_make_key (const char            *icon,
+			   int                    size,
+			   int                    scale,
+			   guint                  flags,
+			   PanelIconCacheVariant  variant)
+{
+	return g_strdup_printf ("%d:%d:%d:%u:%s", variant, size, scale, flags, icon);
+}
+
+/* in nanoseconds where the system has them, or -1 if @icon is not a
+ * path to a file */
+static gint64
+panel_icon_cache_get_mtime (const char *icon)
+{
+	GStatBuf buf;
+	gint64   mtime;
+
+	if (!g_path_is_absolute (icon) || g_stat (icon, &buf) != 0)
+		return -1;
+
+	mtime = (gint64) buf.st_mtime * G_GINT64_CONSTANT (1000000000);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	mtime += buf.st_mtim.tv_nsec;
+#endif
+
+	return mtime;
+}
+
+static gsize
+panel_icon_cache_surface_size (cairo_surface_t *surface)
+{
+	if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE)
+		return 0;
+
+	return (gsize) cairo_image_surface_get_stride (surface) *
+		cairo_image_surface_get_height (surface);
+}
+
+/* Returns a new reference to the surface of @icon loaded at @size and
+ * @scale, or NULL. @flags are any other parameters the caller loaded the
+ * icon with. */
+cairo_surface_t *
+panel_icon_cache_lookup (const char            *icon,
+			 int                    size,
+			 int                    scale,
+			 guint                  flags,
+			 PanelIconCacheVariant  variant)
+{
+	PanelIconCacheEntry *entry;
+	char                *key;
+
+	g_return_val_if_fail (icon != NULL, NULL);
+
+	panel_icon_cache_ensure ();
+
+	key = panel_icon_cache_make_key (icon, size, scale, flags, variant);
+	entry = g_hash_table_lookup (icon_cache, key);
+	g_free (key);
+
+	if (entry && entry->mtime != panel_icon_cache_get_mtime (icon)) {
+		g_hash_table_remove (icon_cache, entry->key);
+		entry = NULL;
+	}
+
+	if (!entry) {
+		icon_cache_misses++;
+		return NULL;
+	}
+
+	icon_cache_hits++;
+
+	g_queue_unlink (&icon_cache_lru, entry->link);
+	g_queue_push_head_link (&icon_cache_lru, entry->link);
+
+	return cairo_surface_reference (entry->surface);
+}
+
+void
+panel_icon_cache_insert (const char            *icon,
+			 int                    size,
+			 int                    scale,
+			 guint                  flags,
+			 PanelIconCacheVariant  variant,
+			 cairo_surface_t       *surface)
+{
+	PanelIconCacheEntry *entry;
+
+	g_return_if_fail (icon != NULL);
+
+	if (!surface || cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+		return;
+
+	panel_icon_cache_ensure ();
+
+	entry = g_new (PanelIconCacheEntry, 1);
+	entry->key = panel_icon_cache_make_key (icon, size, scale, flags, variant);
+	entry->surface = cairo_surface_reference (surface);
+	entry->size = panel_icon_cache_surface_size (surface);
+	entry->mtime = panel_icon_cache_get_mtime (icon);
+
+	g_queue_push_head (&icon_cache_lru, entry);
+	entry->link = icon_cache_lru.head;
+	icon_cache_size += entry->size;
+
+	/* replaces (and frees) an entry with the same key */
+	g_hash_table_replace (icon_cache, entry->key, entry);
+
+	while (icon_cache_size > PANEL_ICON_CACHE_MAX_SIZE &&
+	       icon_cache_lru.tail != icon_cache_lru.head) {
+		PanelIconCacheEntry *last = icon_cache_lru.tail->data;
+
+		g_hash_table_remove (icon_cache, last->key);
+	}
+}
+
+void
+panel_icon_cache_clear (void)
+{
+	if (!icon_cache)
+		return;
+
+	g_hash_table_remove_all (icon_cache);
+}
+
+/* Returns how many lookups found an icon and how many did not, since
+ * the panel started, and the bytes of pixel data currently cached */
+void
+panel_icon_cache_get_stats (guint *hits,
+			    guint *misses,
+			    gsize *size)
+{
+	if (hits)
+		*hits = icon_cache_hits;
+	if (misses)
+		*misses = icon_cache_misses;
+	if (size)
+		*size = icon_cache_size;
+}
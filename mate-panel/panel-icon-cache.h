@@ -0,0 +1,58 @@
+/*
+ * panel-icon-cache.h: cache of the icon surfaces loaded by the panel
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_ICON_CACHE_H__
+#define __PANEL_ICON_CACHE_H__
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	PANEL_ICON_CACHE_NORMAL,
+	/* the brightened icon drawn when the pointer is over a button */
+	PANEL_ICON_CACHE_HIGH_CONTRAST
+} PanelIconCacheVariant;
+
+cairo_surface_t *panel_icon_cache_lookup    (const char            *icon,
+					     int                    size,
+					     int                    scale,
+					     guint                  flags,
+					     PanelIconCacheVariant  variant);
+void             panel_icon_cache_insert    (const char            *icon,
+					     int                    size,
+					     int                    scale,
+					     guint                  flags,
+					     PanelIconCacheVariant  variant,
+					     cairo_surface_t       *surface);
+
+void             panel_icon_cache_clear     (void);
+void             panel_icon_cache_get_stats (guint                 *hits,
+					     guint                 *misses,
+					     gsize                 *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_ICON_CACHE_H__ */
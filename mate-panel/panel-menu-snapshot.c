@@ -0,0 +1,562 @@
+/*
+ * panel-menu-snapshot.c: snapshot of the content of a menu tree
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "panel-app-catalog.h"
+#include "panel-menu-snapshot.h"
+
+/* The menus are populated from a snapshot of their tree saved the last
+ * time it was loaded, while the tree is loaded again in the background.
+ * The snapshot is only used if the menu file and the directories of
+ * desktop files haven't been modified since it was saved: the items of
+ * the menu are replaced by the ones of the tree once it is loaded
+ * anyway, if they changed in a way not caught by this. */
+
+#define PANEL_MENU_SNAPSHOT_VERSION 2
+
+/* version, environment, menu file, its modification time, modification
+ * times of the directories and items */
+#define PANEL_MENU_SNAPSHOT_TYPE "(ussxa(sx)a" PANEL_MENU_SNAPSHOT_ITEM_TYPE ")"
+
+struct _PanelMenuSnapshot {
+	gint      ref_count;
+	GVariant *data;
+	GVariant *items;
+};
+
+static char *
+panel_menu_snapshot_get_filename (const char *menu_file)
+{
+	char *basename;
+	char *filename;
+
+	basename = g_strconcat (menu_file, ".snapshot", NULL);
+	filename = g_build_filename (g_get_user_cache_dir (), "mate-panel",
+				     "menus", basename, NULL);
+	g_free (basename);
+
+	return filename;
+}
+
+/* The names are localized, and the menu files depend on the prefix */
+static char *
+panel_menu_snapshot_get_environment (void)
+{
+	const char *prefix;
+	char       *languages;
+	char       *environment;
+
+	prefix = g_getenv ("XDG_MENU_PREFIX");
+	languages = g_strjoinv (":", (char **) g_get_language_names ());
+	environment = g_strconcat (languages, "\n", prefix ? prefix : "", NULL);
+	g_free (languages);
+
+	return environment;
+}
+
+/* in nanoseconds where the system has them, so that files rewritten
+ * within the same second are noticed */
+static gint64
+get_mtime (const char *path)
+{
+	GStatBuf buf;
+	gint64   mtime;
+
+	if (!path || g_stat (path, &buf) != 0)
+		return -1;
+
+	mtime = (gint64) buf.st_mtime * G_GINT64_CONSTANT (1000000000);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	mtime += buf.st_mtim.tv_nsec;
+#endif
+
+	return mtime;
+}
+
+static void
+add_stamp (GVariantBuilder *builder,
+	   const char      *dir,
+	   const char      *subdir)
+{
+	char *path;
+
+	path = g_build_filename (dir, subdir, NULL);
+	g_variant_builder_add (builder, "(sx)", path, get_mtime (path));
+	g_free (path);
+}
+
+/* The directories change when desktop files are added to or removed from
+ * them. Subdirectories are not looked at, as listing the directories
+ * would cost more than it saves. */
+static GVariant *
+panel_menu_snapshot_get_stamps (void)
+{
+	GVariantBuilder      builder;
+	const char * const  *dirs;
+	int                  i;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sx)"));
+
+	add_stamp (&builder, g_get_user_data_dir (), "applications");
+	add_stamp (&builder, g_get_user_data_dir (), "desktop-directories");
+	dirs = g_get_system_data_dirs ();
+	for (i = 0; dirs [i]; i++) {
+		add_stamp (&builder, dirs [i], "applications");
+		add_stamp (&builder, dirs [i], "desktop-directories");
+	}
+
+	add_stamp (&builder, g_get_user_config_dir (), "menus");
+	add_stamp (&builder, g_get_user_config_dir (), "menus/applications-merged");
+	dirs = g_get_system_config_dirs ();
+	for (i = 0; dirs [i]; i++) {
+		add_stamp (&builder, dirs [i], "menus");
+		add_stamp (&builder, dirs [i], "menus/applications-merged");
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+static gboolean
+panel_menu_snapshot_is_valid (GVariant *data)
+{
+	GVariant    *stamps;
+	GVariant    *child;
+	const char  *str;
+	char        *environment;
+	gint64       mtime;
+	gboolean     valid;
+	gsize        n_items;
+	gsize        i;
+
+	child = g_variant_get_child_value (data, 0);
+	valid = g_variant_get_uint32 (child) == PANEL_MENU_SNAPSHOT_VERSION;
+	g_variant_unref (child);
+	if (!valid)
+		return FALSE;
+
+	environment = panel_menu_snapshot_get_environment ();
+	g_variant_get_child (data, 1, "&s", &str);
+	valid = g_strcmp0 (str, environment) == 0;
+	g_free (environment);
+	if (!valid)
+		return FALSE;
+
+	g_variant_get_child (data, 2, "&s", &str);
+	g_variant_get_child (data, 3, "x", &mtime);
+	if (get_mtime (str) != mtime)
+		return FALSE;
+
+	/* same directories, modified at the same time */
+	child = g_variant_get_child_value (data, 4);
+	stamps = g_variant_ref_sink (panel_menu_snapshot_get_stamps ());
+	valid = g_variant_equal (child, stamps);
+	g_variant_unref (stamps);
+	g_variant_unref (child);
+	if (!valid)
+		return FALSE;
+
+	/* the ranges of children are used as indices: a damaged file must
+	 * not abort the panel. There is always the root, the item 0. */
+	child = g_variant_get_child_value (data, 5);
+	n_items = g_variant_n_children (child);
+	valid = n_items > 0;
+
+	for (i = 0; valid && i < n_items; i++) {
+		GVariant *item;
+		guint32   first_child;
+		guint32   n_children;
+
+		item = g_variant_get_child_value (child, i);
+		g_variant_get_child (item, 10, "u", &first_child);
+		g_variant_get_child (item, 11, "u", &n_children);
+		g_variant_unref (item);
+
+		valid = first_child <= n_items && n_children <= n_items - first_child;
+	}
+	g_variant_unref (child);
+
+	return valid;
+}
+
+/* Returns the snapshot saved for @menu_file, or NULL if there is none
+ * or if it is out of date. */
+PanelMenuSnapshot *
+panel_menu_snapshot_load (const char *menu_file)
+{
+	PanelMenuSnapshot *snapshot;
+	GMappedFile       *mapped;
+	GVariant          *data;
+	GBytes            *bytes;
+	char              *filename;
+
+	g_return_val_if_fail (menu_file != NULL, NULL);
+
+	filename = panel_menu_snapshot_get_filename (menu_file);
+	mapped = g_mapped_file_new (filename, FALSE, NULL);
+	g_free (filename);
+
+	if (!mapped)
+		return NULL;
+
+	bytes = g_mapped_file_get_bytes (mapped);
+	g_mapped_file_unref (mapped);
+
+	data = g_variant_new_from_bytes (G_VARIANT_TYPE (PANEL_MENU_SNAPSHOT_TYPE),
+					 bytes, FALSE);
+	g_variant_ref_sink (data);
+	g_bytes_unref (bytes);
+
+	if (!panel_menu_snapshot_is_valid (data)) {
+		g_variant_unref (data);
+		return NULL;
+	}
+
+	snapshot = g_new0 (PanelMenuSnapshot, 1);
+	snapshot->ref_count = 1;
+	snapshot->data = data;
+	snapshot->items = g_variant_get_child_value (data, 5);
+
+	return snapshot;
+}
+
+PanelMenuSnapshot *
+panel_menu_snapshot_ref (PanelMenuSnapshot *snapshot)
+{
+	g_return_val_if_fail (snapshot != NULL, NULL);
+
+	snapshot->ref_count++;
+
+	return snapshot;
+}
+
+void
+panel_menu_snapshot_unref (PanelMenuSnapshot *snapshot)
+{
+	g_return_if_fail (snapshot != NULL);
+
+	if (--snapshot->ref_count > 0)
+		return;
+
+	g_variant_unref (snapshot->items);
+	g_variant_unref (snapshot->data);
+	g_free (snapshot);
+}
+
+guint
+panel_menu_snapshot_get_n_items (PanelMenuSnapshot *snapshot)
+{
+	g_return_val_if_fail (snapshot != NULL, 0);
+
+	return g_variant_n_children (snapshot->items);
+}
+
+/* The strings of @item belong to @snapshot. */
+void
+panel_menu_snapshot_get_item (PanelMenuSnapshot     *snapshot,
+			      guint                  index,
+			      PanelMenuSnapshotItem *item)
+{
+	guchar type;
+
+	g_return_if_fail (snapshot != NULL);
+	g_return_if_fail (item != NULL);
+	g_return_if_fail (index < g_variant_n_children (snapshot->items));
+
+	g_variant_get_child (snapshot->items, index, "(iy&sm&s&s&s&s&s&s&suu)",
+			     &item->parent, &type,
+			     &item->key, &item->signature,
+			     &item->name, &item->icon,
+			     &item->tooltip, &item->path,
+			     &item->exec, &item->categories,
+			     &item->first_child, &item->n_children);
+	item->type = type;
+}
+
+/* Saves @items, of type "a" PANEL_MENU_SNAPSHOT_ITEM_TYPE, as the snapshot
+ * of @menu_file, found at @menu_path. */
+static void
+panel_menu_snapshot_save (const char *menu_file,
+			  const char *menu_path,
+			  GVariant   *items)
+{
+	GVariant *data;
+	char     *environment;
+	char     *filename;
+	char     *dirname;
+	GError   *error = NULL;
+
+	g_return_if_fail (menu_file != NULL);
+	g_return_if_fail (items != NULL);
+
+	environment = panel_menu_snapshot_get_environment ();
+	data = g_variant_new ("(ussx@a(sx)@a" PANEL_MENU_SNAPSHOT_ITEM_TYPE ")",
+			      PANEL_MENU_SNAPSHOT_VERSION,
+			      environment,
+			      menu_path ? menu_path : "",
+			      get_mtime (menu_path),
+			      panel_menu_snapshot_get_stamps (),
+			      items);
+	g_variant_ref_sink (data);
+	g_free (environment);
+
+	filename = panel_menu_snapshot_get_filename (menu_file);
+	dirname = g_path_get_dirname (filename);
+
+	if (g_mkdir_with_parents (dirname, 0700) != 0 ||
+	    !g_file_set_contents (filename,
+				  g_variant_get_data (data),
+				  g_variant_get_size (data),
+				  &error)) {
+		g_debug ("Could not write the menu snapshot %s: %s", filename,
+			 error ? error->message : g_strerror (errno));
+		g_clear_error (&error);
+	}
+
+	g_free (dirname);
+	g_free (filename);
+	g_variant_unref (data);
+}
+
+typedef struct {
+	int                    parent;
+	guchar                 type;
+	char                  *key;
+	char                  *signature;
+	char                  *name;
+	char                  *icon;
+	char                  *tooltip;
+	char                  *path;
+	char                  *exec;
+	char                  *categories;
+	guint                  first_child;
+	guint                  n_children;
+
+	/* the directory to add the children from */
+	MateMenuTreeDirectory *children;
+} SnapshotItem;
+
+static void
+snapshot_item_clear (SnapshotItem *item)
+{
+	g_free (item->key);
+	g_free (item->signature);
+	g_free (item->name);
+	g_free (item->icon);
+	g_free (item->tooltip);
+	g_free (item->path);
+	g_free (item->exec);
+	g_free (item->categories);
+	g_clear_pointer (&item->children, matemenu_tree_item_unref);
+}
+
+/* Adds the items of @directory to @items, in the order of the menu, as
+ * the children of the item at @parent. The children of an item are next
+ * to each other, so that the menus find them without a scan: they are
+ * added before the children of the submenus. */
+static void
+add_directory (GArray                *items,
+	       MateMenuTreeDirectory *directory,
+	       guint                  parent)
+{
+	MateMenuTreeIter     *iter;
+	MateMenuTreeItemType  type;
+	guint                 first;
+	guint                 i;
+
+	first = items->len;
+
+	iter = matemenu_tree_directory_iter (directory);
+	while ((type = matemenu_tree_iter_next (iter)) != MATEMENU_TREE_ITEM_INVALID) {
+		MateMenuTreeDirectory *display_directory = NULL;
+		MateMenuTreeDirectory *children = NULL;
+		MateMenuTreeEntry     *entry = NULL;
+		GDesktopAppInfo       *ginfo;
+		GIcon                 *gicon = NULL;
+		SnapshotItem           snapshot_item = { 0, };
+		gpointer               item;
+		char                  *key;
+		char                  *signature;
+		const char            *name = NULL;
+		const char            *tooltip = NULL;
+		const char            *path = NULL;
+		const char            *exec = NULL;
+		const char            *categories = NULL;
+		guchar                 snapshot_type = 0;
+
+		item = panel_app_catalog_iter_get_item (iter, type);
+		panel_app_catalog_item_get_key (type, item, &key, &signature);
+
+		switch (type) {
+		case MATEMENU_TREE_ITEM_DIRECTORY:
+			snapshot_type = PANEL_MENU_SNAPSHOT_DIRECTORY;
+			display_directory = matemenu_tree_item_ref (item);
+			children = matemenu_tree_item_ref (item);
+			break;
+
+		case MATEMENU_TREE_ITEM_ENTRY:
+			snapshot_type = PANEL_MENU_SNAPSHOT_ENTRY;
+			entry = matemenu_tree_item_ref (item);
+			break;
+
+		case MATEMENU_TREE_ITEM_SEPARATOR:
+			snapshot_type = PANEL_MENU_SNAPSHOT_SEPARATOR;
+			break;
+
+		case MATEMENU_TREE_ITEM_HEADER:
+			snapshot_type = PANEL_MENU_SNAPSHOT_HEADER;
+			display_directory = matemenu_tree_header_get_directory (item);
+			break;
+
+		case MATEMENU_TREE_ITEM_ALIAS:
+			display_directory = matemenu_tree_alias_get_directory (item);
+			if (matemenu_tree_alias_get_aliased_item_type (item) == MATEMENU_TREE_ITEM_DIRECTORY) {
+				snapshot_type = PANEL_MENU_SNAPSHOT_DIRECTORY;
+				children = matemenu_tree_item_ref (display_directory);
+				break;
+			} else if (matemenu_tree_alias_get_aliased_item_type (item) == MATEMENU_TREE_ITEM_ENTRY) {
+				snapshot_type = PANEL_MENU_SNAPSHOT_ENTRY;
+				entry = matemenu_tree_alias_get_aliased_entry (item);
+				tooltip = matemenu_tree_directory_get_comment (display_directory);
+				break;
+			}
+			/* fall through */
+
+		default:
+			/* no menu item for this one */
+			g_clear_pointer (&display_directory, matemenu_tree_item_unref);
+			g_free (key);
+			g_free (signature);
+			if (item)
+				matemenu_tree_item_unref (item);
+			continue;
+		}
+
+		if (display_directory) {
+			name = matemenu_tree_directory_get_name (display_directory);
+			gicon = matemenu_tree_directory_get_icon (display_directory);
+		}
+
+		if (entry) {
+			ginfo = matemenu_tree_entry_get_app_info (entry);
+			path = matemenu_tree_entry_get_desktop_file_path (entry);
+			exec = g_app_info_get_commandline (G_APP_INFO (ginfo));
+			categories = g_desktop_app_info_get_categories (ginfo);
+
+			if (!display_directory) {
+				name = g_app_info_get_name (G_APP_INFO (ginfo));
+				gicon = g_app_info_get_icon (G_APP_INFO (ginfo));
+				tooltip = g_app_info_get_description (G_APP_INFO (ginfo));
+				if (!tooltip)
+					tooltip = g_desktop_app_info_get_generic_name (ginfo);
+			}
+		}
+
+		snapshot_item.parent = parent;
+		snapshot_item.type = snapshot_type;
+		snapshot_item.key = key;
+		snapshot_item.signature = signature;
+		snapshot_item.name = g_strdup (name);
+		snapshot_item.icon = gicon ? g_icon_to_string (gicon) : NULL;
+		snapshot_item.tooltip = g_strdup (tooltip);
+		snapshot_item.path = g_strdup (path);
+		snapshot_item.exec = g_strdup (exec);
+		snapshot_item.categories = g_strdup (categories);
+		snapshot_item.children = children;
+
+		g_array_append_val (items, snapshot_item);
+
+		g_clear_pointer (&display_directory, matemenu_tree_item_unref);
+		g_clear_pointer (&entry, matemenu_tree_item_unref);
+		if (item)
+			matemenu_tree_item_unref (item);
+	}
+	matemenu_tree_iter_unref (iter);
+
+	g_array_index (items, SnapshotItem, parent).first_child = first;
+	g_array_index (items, SnapshotItem, parent).n_children = items->len - first;
+
+	for (i = first; i < first + g_array_index (items, SnapshotItem, parent).n_children; i++) {
+		MateMenuTreeDirectory *children;
+
+		children = g_array_index (items, SnapshotItem, i).children;
+		g_array_index (items, SnapshotItem, i).children = NULL;
+
+		if (children) {
+			add_directory (items, children, i);
+			matemenu_tree_item_unref (children);
+		}
+	}
+}
+
+/* Saves the content of @tree, loaded from @menu_file, so that the menus
+ * can be populated before it is loaded the next time. */
+void
+panel_menu_snapshot_save_tree (const char   *menu_file,
+			       MateMenuTree *tree)
+{
+	MateMenuTreeDirectory *root;
+	GVariantBuilder        builder;
+	GArray                *items;
+	SnapshotItem           root_item = { 0, };
+	guint                  i;
+
+	root = matemenu_tree_get_root_directory (tree);
+	if (!root)
+		return;
+
+	items = g_array_new (FALSE, FALSE, sizeof (SnapshotItem));
+	g_array_set_clear_func (items, (GDestroyNotify) snapshot_item_clear);
+
+	/* the root is the item 0 */
+	root_item.parent = -1;
+	root_item.type = PANEL_MENU_SNAPSHOT_DIRECTORY;
+	g_array_append_val (items, root_item);
+	add_directory (items, root, 0);
+	matemenu_tree_item_unref (root);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" PANEL_MENU_SNAPSHOT_ITEM_TYPE));
+	for (i = 0; i < items->len; i++) {
+		SnapshotItem *item = &g_array_index (items, SnapshotItem, i);
+
+		g_variant_builder_add (&builder, PANEL_MENU_SNAPSHOT_ITEM_TYPE,
+				       item->parent, item->type,
+				       item->key ? item->key : "",
+				       item->signature,
+				       item->name ? item->name : "",
+				       item->icon ? item->icon : "",
+				       item->tooltip ? item->tooltip : "",
+				       item->path ? item->path : "",
+				       item->exec ? item->exec : "",
+				       item->categories ? item->categories : "",
+				       item->first_child, item->n_children);
+	}
+	g_array_free (items, TRUE);
+
+	panel_menu_snapshot_save (menu_file,
+				  matemenu_tree_get_canonical_menu_path (tree),
+				  g_variant_builder_end (&builder));
+}
@@ -0,0 +1,79 @@
+/*
+ * panel-menu-snapshot.h: snapshot of the content of a menu tree
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_MENU_SNAPSHOT_H__
+#define __PANEL_MENU_SNAPSHOT_H__
+
+#include <glib.h>
+#include <matemenu-tree.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Type of the items of a snapshot, in
+ * PANEL_MENU_SNAPSHOT_ITEM_TYPE: parent item, type, key, signature,
+ * name, icon, tooltip, desktop file path, command line, categories,
+ * and the index of the first child and number of children */
+#define PANEL_MENU_SNAPSHOT_ITEM_TYPE "(iysmsssssssuu)"
+
+typedef enum {
+	PANEL_MENU_SNAPSHOT_DIRECTORY = 'd',
+	PANEL_MENU_SNAPSHOT_ENTRY     = 'e',
+	PANEL_MENU_SNAPSHOT_SEPARATOR = 's',
+	PANEL_MENU_SNAPSHOT_HEADER    = 'h'
+} PanelMenuSnapshotItemType;
+
+typedef struct _PanelMenuSnapshot PanelMenuSnapshot;
+
+typedef struct {
+	int                        parent;
+	PanelMenuSnapshotItemType  type;
+	const char                *key;
+	const char                *signature;
+	const char                *name;
+	const char                *icon;
+	const char                *tooltip;
+	const char                *path;
+	const char                *exec;
+	const char                *categories;
+	/* the children of a directory are next to each other */
+	guint                      first_child;
+	guint                      n_children;
+} PanelMenuSnapshotItem;
+
+PanelMenuSnapshot *panel_menu_snapshot_load        (const char        *menu_file);
+PanelMenuSnapshot *panel_menu_snapshot_ref         (PanelMenuSnapshot *snapshot);
+void               panel_menu_snapshot_unref       (PanelMenuSnapshot *snapshot);
+
+guint              panel_menu_snapshot_get_n_items (PanelMenuSnapshot *snapshot);
+void               panel_menu_snapshot_get_item    (PanelMenuSnapshot     *snapshot,
+						    guint                  index,
+						    PanelMenuSnapshotItem *item);
+
+void               panel_menu_snapshot_save_tree   (const char        *menu_file,
+						    MateMenuTree      *tree);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_MENU_SNAPSHOT_H__ */
@@ -1567,8 +1567,8 @@ panel_profile_toplevel_id_list_notify (GSettings *settings,
 static void
 panel_profile_object_id_list_update (gchar **objects)
 {
-	GSList *existing_applets;
-	GSList *sublist = NULL, *l;
+	GList  *existing_applets, *l;
+	GSList *sublist = NULL;
 	GSList *object_ids;
 
 	object_ids = mate_gsettings_strv_to_gslist ((const gchar **) objects);
@@ -33,7 +33,6 @@
 #include "panel-run-dialog.h"
 
 #include <string.h>
-#include <dirent.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -57,12 +56,15 @@
 #include "panel-globals.h"
 #include "panel-enums.h"
 #include "panel-profile.h"
+#include "panel-run-search.h"
 #include "panel-schemas.h"
 #include "panel-stock-icons.h"
 #include "panel-multimonitor.h"
 #include "menu.h"
 #include "panel-lockdown.h"
 #include "panel-icon-names.h"
+#include "panel-executable-index.h"
+#include "panel-app-catalog.h"
 
 #ifdef HAVE_X11
 #include "xstuff.h"
@@ -86,11 +88,15 @@ typedef struct {
 	long              changed_id;
 
 	GtkListStore     *program_list_store;
+	GPtrArray        *program_index;
+	struct _PanelRunDialogSearch *search;
 
 	GHashTable       *dir_hash;
-	GList		 *possible_executables;
-	GList		 *completion_items;
+	GHashTable       *completion_items;
+	GtkListStore     *completion_store;
 	GtkEntryCompletion *completion;
+	struct _PanelRunDirectoryLoad *directory_load;
+	gulong            executables_changed_id;
 
 	int	          add_items_idle_id;
 	int		  find_command_idle_id;
@@ -138,6 +144,57 @@ const AcceleratorKeyMapping accelerator_key_mapping[] =
 
 static GHashTable *accelerator_keys_to_tree_iter_map = NULL;
 
+/* What the program list is filtered on, prepared once when the list is
+ * built so typing in the entry doesn't have to read back and casefold
+ * every row of the store on each key press. */
+typedef struct {
+	GtkTreeIter  iter;
+	GIcon       *icon;
+	char        *name;
+	PanelRunSearchKeys keys;
+
+	/* position in the alphabetical list */
+	guint        index;
+	/* score in the current search */
+	int          score;
+
+	/* what is currently set in the store */
+	guint        position;
+	gboolean     visible;
+	int          accelerator;
+} PanelRunDialogIndexEntry;
+
+/* The program list is scored in slices of at most
+ * PANEL_RUN_SEARCH_SLICE microseconds, so typing is never held up by a
+ * large list: a search in progress is restarted when the text changes.
+ * The matches are shown as each slice completes. */
+#define PANEL_RUN_SEARCH_SLICE 4000
+
+typedef struct _PanelRunDialogSearch {
+	PanelRunQuery *query;
+
+	guint       pos;
+
+	GIcon      *found_icon;
+	char       *found_name;
+	gboolean    fuzzy;
+} PanelRunDialogSearch;
+
+/* A directory being read to complete file names in it */
+typedef struct _PanelRunDirectoryLoad {
+	PanelRunDialog *dialog;
+	GCancellable   *cancellable;
+
+	GFile          *dir;
+	char           *dirname;
+	char           *dirprefix;
+	/* first characters of the names to complete */
+	GString        *prefixes;
+
+	gint64          mtime;
+	GPtrArray      *names;
+} PanelRunDirectoryLoad;
+
 static PanelRunDialog *static_dialog = NULL;
 
 static void panel_run_dialog_disconnect_pixmap (PanelRunDialog *dialog);
@@ -235,10 +292,24 @@ _panel_run_save_recent_programs_list (PanelRunDialog   *dialog,
 }
 
 static void
-panel_run_dialog_destroy (PanelRunDialog *dialog)
+panel_run_dialog_search_free (PanelRunDialog *dialog)
 {
-	GList *l;
+	PanelRunDialogSearch *search = dialog->search;
 
+	if (!search)
+		return;
+
+	panel_run_query_free (search->query);
+	g_clear_object (&search->found_icon);
+	g_free (search->found_name);
+	g_free (search);
+
+	dialog->search = NULL;
+}
+
+static void
+panel_run_dialog_destroy (PanelRunDialog *dialog)
+{
 	dialog->changed_id = 0;
 
 	g_object_unref (dialog->program_list_box);
@@ -255,8 +326,13 @@ panel_run_dialog_destroy (PanelRunDialog *dialog)
 		g_source_remove (dialog->find_command_idle_id);
 	dialog->find_command_idle_id = 0;
 
+	panel_run_dialog_search_free (dialog);
+
 	g_clear_object (&dialog->settings);
 
+	panel_executable_index_remove_changed_func (dialog->executables_changed_id);
+	dialog->executables_changed_id = 0;
+
 	if (dialog->dir_hash)
 		g_hash_table_destroy (dialog->dir_hash);
 	dialog->dir_hash = NULL;
@@ -265,16 +341,21 @@ panel_run_dialog_destroy (PanelRunDialog *dialog)
 		g_hash_table_destroy (accelerator_keys_to_tree_iter_map);
 	accelerator_keys_to_tree_iter_map = NULL;
 
-	for (l = dialog->possible_executables; l; l = l->next)
-		g_free (l->data);
-	g_list_free (dialog->possible_executables);
-	dialog->possible_executables = NULL;
+	if (dialog->program_index)
+		g_ptr_array_free (dialog->program_index, TRUE);
+	dialog->program_index = NULL;
 
-	for (l = dialog->completion_items; l; l = l->next)
-		g_free (l->data);
-	g_list_free (dialog->completion_items);
+	/* the load frees itself once it notices */
+	if (dialog->directory_load)
+		g_cancellable_cancel (dialog->directory_load->cancellable);
+	dialog->directory_load = NULL;
+
+	if (dialog->completion_items)
+		g_hash_table_destroy (dialog->completion_items);
 	dialog->completion_items = NULL;
 
+	g_clear_object (&dialog->completion_store);
+
 	panel_run_dialog_disconnect_pixmap (dialog);
 
 	g_free (dialog);
@@ -640,278 +721,271 @@ panel_run_dialog_append_file (PanelRunDialog *dialog,
 	g_free (utf8_file);
 }
 
-static gboolean
-fuzzy_command_match (const char *cmd1,
-		     const char *cmd2,
-		     gboolean   *fuzzy)
+static void
+panel_run_dialog_index_entry_free (PanelRunDialogIndexEntry *entry)
 {
-	char **tokens;
-	char  *word1, *word2;
+	g_clear_object (&entry->icon);
+	g_free (entry->name);
+	panel_run_search_keys_clear (&entry->keys);
+	g_free (entry);
+}
 
-	g_return_val_if_fail (cmd1 && cmd2, TRUE);
+/* Only touches the store when the row changes, as every change is
+ * propagated through the filter model to the tree view. */
+static void
+panel_run_dialog_index_entry_set (PanelRunDialog           *dialog,
+				  PanelRunDialogIndexEntry *entry,
+				  gboolean                  visible,
+				  int                       accelerator)
+{
+	if (accelerator >= 0)
+		g_hash_table_insert (accelerator_keys_to_tree_iter_map,
+				     GUINT_TO_POINTER (accelerator_key_mapping[accelerator].key_id),
+				     GINT_TO_POINTER (accelerator));
+
+	if (entry->visible != visible) {
+		entry->visible = visible;
+		gtk_list_store_set (dialog->program_list_store, &entry->iter,
+				    COLUMN_VISIBLE, visible,
+				    -1);
+	}
 
-	*fuzzy = FALSE;
+	if (entry->accelerator == accelerator)
+		return;
 
-	if (!strcmp (cmd1, cmd2))
-		return TRUE;
+	entry->accelerator = accelerator;
 
-	/* find basename of exec from desktop item.
-	   strip of all arguments after the initial command */
-	tokens = g_strsplit (cmd1, " ", -1);
-	if (!tokens || !tokens [0]) {
-		g_strfreev (tokens);
-		return FALSE;
+	if (accelerator >= 0)
+		gtk_list_store_set (dialog->program_list_store, &entry->iter,
+				    COLUMN_ACCELERATOR_MASK, (gint) accelerator_key_mapping[accelerator].modifier,
+				    COLUMN_ACCELERATOR_KEY_VALUE, accelerator_key_mapping[accelerator].key_id,
+				    -1);
+	else
+		gtk_list_store_set (dialog->program_list_store, &entry->iter,
+				    COLUMN_ACCELERATOR_MASK, (gint) GDK_MOD1_MASK,
+				    COLUMN_ACCELERATOR_KEY_VALUE, 0,
+				    -1);
+}
+
+static int
+compare_index_entries (gconstpointer a,
+		       gconstpointer b)
+{
+	const PanelRunDialogIndexEntry *entry_a = *(PanelRunDialogIndexEntry **) a;
+	const PanelRunDialogIndexEntry *entry_b = *(PanelRunDialogIndexEntry **) b;
+
+	if (entry_a->score != entry_b->score)
+		return entry_a->score > entry_b->score ? -1 : 1;
+
+	return entry_a->index < entry_b->index ? -1 : (entry_a->index > entry_b->index);
+}
+
+/* Sorts the rows of the store by the score of their entry, hides the
+ * rows that don't match and gives the accelerators to the first rows. */
+static void
+panel_run_dialog_show_programs (PanelRunDialog *dialog)
+{
+	GPtrArray *sorted;
+	gint      *new_order;
+	gboolean   reordered = FALSE;
+	guint      i;
+
+	g_hash_table_remove_all (accelerator_keys_to_tree_iter_map);
+
+	if (!dialog->program_index || dialog->program_index->len == 0)
+		return;
+
+	sorted = g_ptr_array_sized_new (dialog->program_index->len);
+	for (i = 0; i < dialog->program_index->len; i++)
+		g_ptr_array_add (sorted, g_ptr_array_index (dialog->program_index, i));
+	g_ptr_array_sort (sorted, compare_index_entries);
+
+	new_order = g_new (gint, sorted->len);
+	for (i = 0; i < sorted->len; i++) {
+		PanelRunDialogIndexEntry *entry = g_ptr_array_index (sorted, i);
+
+		new_order [i] = entry->position;
+		if (entry->position != i)
+			reordered = TRUE;
 	}
 
-	word1 = g_path_get_basename (tokens [0]);
-	g_strfreev (tokens);
+	if (reordered) {
+		gtk_list_store_reorder (dialog->program_list_store, new_order);
 
-	/* same for the user command */
-	tokens = g_strsplit (cmd2, " ", -1);
-	if (!tokens || !tokens [0]) {
-		g_free (word1);
-		g_strfreev (tokens);
-		return FALSE;
+		for (i = 0; i < sorted->len; i++)
+			((PanelRunDialogIndexEntry *) g_ptr_array_index (sorted, i))->position = i;
 	}
 
-	word2 = g_path_get_basename (tokens [0]);
-	g_strfreev (tokens);
+	g_free (new_order);
 
-	if (!strcmp (word1, word2)) {
-		g_free (word1);
-		g_free (word2);
-		*fuzzy = TRUE;
-		return TRUE;
+	for (i = 0; i < sorted->len; i++) {
+		PanelRunDialogIndexEntry *entry = g_ptr_array_index (sorted, i);
+		gboolean                  visible;
+
+		visible = entry->score != PANEL_RUN_SCORE_NO_MATCH;
+		panel_run_dialog_index_entry_set (dialog, entry, visible,
+						  visible && i < G_N_ELEMENTS (accelerator_key_mapping) ? (int) i : -1);
 	}
 
-	g_free (word1);
-	g_free (word2);
+	g_ptr_array_free (sorted, TRUE);
+}
 
-	return FALSE;
+static void
+panel_run_dialog_scroll_to_first (PanelRunDialog *dialog)
+{
+	GtkTreeIter  iter;
+	GtkTreePath *path;
+
+	path = gtk_tree_path_new_first ();
+	if (gtk_tree_model_get_iter (gtk_tree_view_get_model (GTK_TREE_VIEW (dialog->program_list)),
+				     &iter, path))
+		gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (dialog->program_list),
+					      path, NULL, FALSE, 0, 0);
+
+	gtk_tree_path_free (path);
+}
+
+static void
+panel_run_dialog_show_all_programs (PanelRunDialog *dialog)
+{
+	guint i;
+
+	if (!dialog->program_index)
+		return;
+
+	/* back to alphabetical order */
+	for (i = 0; i < dialog->program_index->len; i++) {
+		PanelRunDialogIndexEntry *entry = g_ptr_array_index (dialog->program_index, i);
+
+		entry->score = 0;
+	}
+
+	panel_run_dialog_show_programs (dialog);
+}
+
+static PanelRunDialogSearch *
+panel_run_dialog_search_new (const char *text)
+{
+	PanelRunDialogSearch *search;
+
+	search = g_new0 (PanelRunDialogSearch, 1);
+	search->query = panel_run_query_new (text);
+
+	return search;
+}
+
+static void
+panel_run_dialog_search_entry (PanelRunDialogSearch     *search,
+			       PanelRunDialogIndexEntry *entry)
+{
+	gboolean fuzzy;
+
+	if (!search->fuzzy && entry->icon &&
+	    panel_run_query_match_command (search->query, &entry->keys, &fuzzy)) {
+		search->fuzzy = fuzzy;
+
+		g_clear_object (&search->found_icon);
+		g_free (search->found_name);
+
+		search->found_icon = g_object_ref (entry->icon);
+		search->found_name = g_strdup (entry->name);
+
+		entry->score = panel_run_query_score_command (search->query, &entry->keys);
+		return;
+	}
+
+	entry->score = panel_run_query_score (search->query, &entry->keys);
 }
 
 static gboolean
 panel_run_dialog_find_command_idle (PanelRunDialog *dialog)
 {
-	GtkTreeIter   iter;
-	GtkTreeModel *model;
-	GtkTreePath  *path;
-	char         *text;
-	GIcon        *found_icon;
-	char         *found_name;
-	gboolean      fuzzy;
-	gint          visible_program_idx = 0;
-
-	model = GTK_TREE_MODEL (dialog->program_list_store);
-	path = gtk_tree_path_new_first ();
-
-	if (!path || !gtk_tree_model_get_iter (model, &iter, path)) {
-		if (path)
-			gtk_tree_path_free (path);
+	PanelRunDialogSearch *search;
+	gint64                slice_start;
+	guint                 i;
 
+	if (!dialog->program_index || dialog->program_index->len == 0) {
 		panel_run_dialog_set_icon (dialog, NULL, FALSE);
 
 		dialog->find_command_idle_id = 0;
 		return FALSE;
 	}
 
-	text = g_strdup (panel_run_dialog_get_combo_text (dialog));
-	found_icon = NULL;
-	found_name = NULL;
-	fuzzy = FALSE;
-	g_hash_table_remove_all (accelerator_keys_to_tree_iter_map);
+	if (!dialog->search) {
+		dialog->search = panel_run_dialog_search_new (panel_run_dialog_get_combo_text (dialog));
 
-	do {
-		char *exec = NULL;
-		GIcon *icon = NULL;
-		char *name = NULL;
-		char *comment = NULL;
-		gboolean visible = FALSE;
-
-		gtk_tree_model_get (model, &iter,
-				    COLUMN_EXEC,      &exec,
-				    COLUMN_GICON,     &icon,
-				    COLUMN_NAME,      &name,
-				    COLUMN_COMMENT,   &comment,
-				    -1);
+		/* the programs not scored yet are hidden until their slice
+		 * completes, rather than shown with the previous scores */
+		for (i = 0; i < dialog->program_index->len; i++) {
+			PanelRunDialogIndexEntry *entry = g_ptr_array_index (dialog->program_index, i);
 
-		if (!fuzzy && exec && icon &&
-		    fuzzy_command_match (text, exec, &fuzzy)) {
-			g_clear_object (&found_icon);
-			g_free (found_name);
-
-			found_icon = g_object_ref (icon);
-			found_name = g_strdup (name);
-
-			gtk_list_store_set (dialog->program_list_store,
-					    &iter,
-					    COLUMN_VISIBLE, TRUE,
-					    -1);
-		} else if (panel_g_utf8_strstrcase (exec, text) != NULL ||
-			   panel_g_utf8_strstrcase (name, text) != NULL ||
-			   panel_g_utf8_strstrcase (comment, text) != NULL) {
-			gtk_list_store_set (dialog->program_list_store,
-					    &iter,
-					    COLUMN_VISIBLE, TRUE,
-					    -1);
-		} else {
-			gtk_list_store_set (dialog->program_list_store,
-					    &iter,
-					    COLUMN_VISIBLE, FALSE,
-					    -1);
+			entry->score = PANEL_RUN_SCORE_NO_MATCH;
 		}
+	}
+	search = dialog->search;
 
-		gtk_tree_model_get (model, &iter, COLUMN_VISIBLE, &visible, -1);
-		if (visible && visible_program_idx < G_N_ELEMENTS (accelerator_key_mapping)) {
-			gtk_list_store_set (dialog->program_list_store,
-					    &iter,
-					    COLUMN_ACCELERATOR_MASK, (gint)accelerator_key_mapping[visible_program_idx].modifier,
-					    COLUMN_ACCELERATOR_KEY_VALUE, accelerator_key_mapping[visible_program_idx].key_id,
-					    -1);
-			g_hash_table_insert (accelerator_keys_to_tree_iter_map, GUINT_TO_POINTER(accelerator_key_mapping[visible_program_idx].key_id), GINT_TO_POINTER(visible_program_idx));
-			visible_program_idx++;
-		} else {
-			gtk_list_store_set (dialog->program_list_store,
-					    &iter,
-					    COLUMN_ACCELERATOR_MASK, 0,
-					    COLUMN_ACCELERATOR_KEY_VALUE, 0,
-					    -1);
-		}
+	slice_start = g_get_monotonic_time ();
 
-		g_free (exec);
-		if (icon != NULL)
-			g_object_unref (icon);
-		g_free (name);
-		g_free (comment);
+	while (search->pos < dialog->program_index->len) {
+		panel_run_dialog_search_entry (search,
+					       g_ptr_array_index (dialog->program_index,
+								  search->pos));
+		search->pos++;
 
-        } while (gtk_tree_model_iter_next (model, &iter));
+		if (search->pos % 64 == 0 &&
+		    g_get_monotonic_time () - slice_start > PANEL_RUN_SEARCH_SLICE)
+			break;
+	}
 
-	if (gtk_tree_model_get_iter (gtk_tree_view_get_model (GTK_TREE_VIEW (dialog->program_list)),
-				     &iter, path))
-		gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (dialog->program_list),
-					      path, NULL, FALSE, 0, 0);
+	panel_run_dialog_show_programs (dialog);
+	panel_run_dialog_scroll_to_first (dialog);
 
-	gtk_tree_path_free (path);
+	if (search->pos < dialog->program_index->len)
+		return TRUE;
 
-	panel_run_dialog_set_icon (dialog, found_icon, FALSE);
+	panel_run_dialog_set_icon (dialog, search->found_icon, FALSE);
 	/* FIXME update dialog->program_label */
 
-	g_clear_object (&found_icon);
-	g_free (text);
-
 	g_free (dialog->item_name);
-	dialog->item_name = found_name;
+	dialog->item_name = search->found_name;
+	search->found_name = NULL;
+
+	panel_run_dialog_search_free (dialog);
 
 	dialog->find_command_idle_id = 0;
 	return FALSE;
 }
 
-static int
-compare_applications (MateMenuTreeEntry *a,
-		      MateMenuTreeEntry *b)
-{
-	GDesktopAppInfo *infoa, *infob;
-	const gchar* name1;
-	const gchar* name2;
-	gint compare;
-
-	infoa = matemenu_tree_entry_get_app_info (a);
-	infob = matemenu_tree_entry_get_app_info (b);
-	name1 = g_app_info_get_name(G_APP_INFO(infoa));
-	name2 = g_app_info_get_name(G_APP_INFO(infob));
-	compare = g_utf8_collate(name1, name2);
-	return compare;
-}
-
-static GSList *get_all_applications_from_dir (MateMenuTreeDirectory *directory,
-					      GSList            *list);
-
-static GSList *
-get_all_applications_from_alias (MateMenuTreeAlias *alias,
-				 GSList         *list)
-{
-	gpointer item;
-	switch (matemenu_tree_alias_get_aliased_item_type (alias)) {
-		case MATEMENU_TREE_ITEM_ENTRY:
-			item = matemenu_tree_alias_get_aliased_entry (alias);
-			list = g_slist_append (list, (MateMenuTreeEntry*) item);
-			break;
-		case MATEMENU_TREE_ITEM_DIRECTORY:
-			item = matemenu_tree_alias_get_aliased_directory (alias);
-			list = get_all_applications_from_dir ((MateMenuTreeDirectory*) item, list);
-			matemenu_tree_item_unref(item);
-			break;
-		default:
-			break;
-	}
-	return list;
-}
-
-static GSList *
-get_all_applications_from_dir (MateMenuTreeDirectory *directory,
-			       GSList             *list)
-{
-	MateMenuTreeIter *iter;
-	MateMenuTreeItemType type;
-
-	iter = matemenu_tree_directory_iter (directory);
-	while ((type = matemenu_tree_iter_next (iter)) != MATEMENU_TREE_ITEM_INVALID) {
-		gpointer item;
-		switch (type) {
-			case MATEMENU_TREE_ITEM_ENTRY:
-				item = matemenu_tree_iter_get_entry (iter);
-				list = g_slist_append (list, (MateMenuTreeEntry*) item);
-				break;
-
-			case MATEMENU_TREE_ITEM_DIRECTORY:
-				item = matemenu_tree_iter_get_directory (iter);
-				list = get_all_applications_from_dir ((MateMenuTreeDirectory*)item, list);
-				matemenu_tree_item_unref(item);
-				break;
-
-			case MATEMENU_TREE_ITEM_ALIAS:
-				item = matemenu_tree_iter_get_alias (iter);
-				list = get_all_applications_from_alias ((MateMenuTreeAlias *)item, list);
-				matemenu_tree_item_unref(item);
-				break;
-
-			default:
-				break;
-		}
-	}
-	matemenu_tree_iter_unref (iter);
-	return list;
-}
-
-static GSList* get_all_applications(void)
+/* Maps the commands run from this dialog, without their arguments, to
+ * how many other commands have been run since. */
+static GHashTable *
+panel_run_dialog_get_history_ranks (PanelRunDialog *dialog,
+				    int            *n_history)
 {
-	MateMenuTree* tree;
-	MateMenuTreeDirectory* root;
-	GError        *error = NULL;
-	GSList* retval;
+	GHashTable  *history;
+	char       **items;
+	int          i;
 
-	tree = matemenu_tree_new ("mate-applications.menu", MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-	if (!matemenu_tree_load_sync (tree, &error)) {
-		g_printerr ("Failed to load tree: %s\n", error->message);
-		g_error_free(error);
-		g_object_unref(tree);
-		return NULL;
-	}
+	history = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-	root = matemenu_tree_get_root_directory (tree);
-	if (root == NULL){
-		g_object_unref(tree);
-		return NULL;
-	}
+	/* the most recent command is always first in the setting */
+	items = g_settings_get_strv (dialog->settings, PANEL_RUN_HISTORY_KEY);
+	for (i = 0; items [i]; i++) {
+		char *basename = panel_run_command_basename (items [i]);
 
-	retval = get_all_applications_from_dir(root, NULL);
+		if (!basename)
+			continue;
 
-	matemenu_tree_item_unref(root);
-	g_object_unref(tree);
+		if (g_hash_table_contains (history, basename))
+			g_free (basename);
+		else
+			g_hash_table_insert (history, basename, GINT_TO_POINTER (i));
+	}
 
-	retval = g_slist_sort(retval, (GCompareFunc) compare_applications);
+	*n_history = i;
+	g_strfreev (items);
 
-	return retval;
+	return history;
 }
 
 static gboolean
@@ -920,10 +994,10 @@ panel_run_dialog_add_items_idle (PanelRunDialog *dialog)
 	GtkCellRenderer   *renderer;
 	GtkTreeViewColumn *column;
 	GtkTreeModel      *model_filter;
-	GSList            *all_applications;
-	GSList            *l;
-	GSList            *next;
-	const char        *prev_name;
+	GPtrArray         *applications;
+	GHashTable        *history;
+	int                n_history;
+	guint              i;
 
 	/* create list store */
 	dialog->program_list_store = gtk_list_store_new (NUM_COLUMNS,
@@ -936,64 +1010,62 @@ panel_run_dialog_add_items_idle (PanelRunDialog *dialog)
 							 G_TYPE_STRING,
 							 G_TYPE_BOOLEAN);
 
-	all_applications = get_all_applications ();
-
-	/* Strip duplicates */
-	prev_name = NULL;
-	for (l = all_applications; l; l = next) {
-		MateMenuTreeEntry *entry = l->data;
-		const char     *entry_name;
-
-		next = l->next;
-		GDesktopAppInfo *ginfo;
-		ginfo = matemenu_tree_entry_get_app_info (entry);
-
-		entry_name = g_app_info_get_display_name(G_APP_INFO(ginfo));
-		if (prev_name && entry_name && strcmp (entry_name, prev_name) == 0) {
-			matemenu_tree_item_unref (entry);
-
-			all_applications = g_slist_delete_link (all_applications, l);
-		} else {
-			prev_name = entry_name;
-		}
-	}
+	/* sorted, without duplicates */
+	applications = panel_app_catalog_get_applications (panel_app_catalog_get ("mate-applications.menu"));
 
-	gint i = 0;
-	g_hash_table_remove_all (accelerator_keys_to_tree_iter_map);
+	dialog->program_index = g_ptr_array_new_with_free_func ((GDestroyNotify) panel_run_dialog_index_entry_free);
+	history = panel_run_dialog_get_history_ranks (dialog, &n_history);
 
-	for (l = all_applications; l; l = l->next) {
-		MateMenuTreeEntry *entry = l->data;
-		GtkTreeIter    iter;
+	for (i = 0; i < applications->len; i++) {
+		MateMenuTreeEntry *entry = applications->pdata [i];
+		PanelRunDialogIndexEntry *index_entry;
 		GDesktopAppInfo *ginfo;
 		GIcon *gicon = NULL;
+		const char *name;
+		const char *comment;
+		const char *exec;
 
 		ginfo = matemenu_tree_entry_get_app_info (entry);
 		gicon = g_app_info_get_icon(G_APP_INFO(ginfo));
+		name = g_app_info_get_display_name (G_APP_INFO (ginfo));
+		comment = g_app_info_get_description (G_APP_INFO (ginfo));
+		exec = g_app_info_get_commandline (G_APP_INFO (ginfo));
+
+		index_entry = g_new0 (PanelRunDialogIndexEntry, 1);
+		index_entry->icon = gicon ? g_object_ref (gicon) : NULL;
+		index_entry->name = g_strdup (name);
+		panel_run_search_keys_init (&index_entry->keys, name, comment, exec);
+		index_entry->index = dialog->program_index->len;
+		index_entry->position = index_entry->index;
+		index_entry->visible = TRUE;
+		index_entry->accelerator = -1;
+
+		if (index_entry->keys.exec_basename) {
+			gpointer rank;
+
+			if (g_hash_table_lookup_extended (history, index_entry->keys.exec_basename,
+							  NULL, &rank))
+				index_entry->keys.history_bonus = PANEL_RUN_BONUS_HISTORY *
+					(n_history - GPOINTER_TO_INT (rank)) / n_history;
+		}
 
-		gtk_list_store_append (dialog->program_list_store, &iter);
-		gtk_list_store_set (dialog->program_list_store, &iter,
+		gtk_list_store_append (dialog->program_list_store, &index_entry->iter);
+		gtk_list_store_set (dialog->program_list_store, &index_entry->iter,
 				    COLUMN_GICON,     gicon,
-				    COLUMN_NAME,      g_app_info_get_display_name(G_APP_INFO(ginfo)),
-				    COLUMN_COMMENT,   g_app_info_get_description(G_APP_INFO(ginfo)),
-				    COLUMN_EXEC,      g_app_info_get_commandline(G_APP_INFO(ginfo)),
+				    COLUMN_NAME,      name,
+				    COLUMN_COMMENT,   comment,
+				    COLUMN_EXEC,      exec,
 				    COLUMN_PATH,      matemenu_tree_entry_get_desktop_file_path (entry),
 				    COLUMN_VISIBLE,   TRUE,
+				    COLUMN_ACCELERATOR_MASK, (gint)GDK_MOD1_MASK,
+				    COLUMN_ACCELERATOR_KEY_VALUE, 0,
 				    -1);
-		if (i < G_N_ELEMENTS (accelerator_key_mapping)) {
-			gtk_list_store_set (dialog->program_list_store, &iter,
-					    COLUMN_ACCELERATOR_MASK, (gint)accelerator_key_mapping[i].modifier,
-					    COLUMN_ACCELERATOR_KEY_VALUE, accelerator_key_mapping[i].key_id,
-					    -1);
-			g_hash_table_insert (accelerator_keys_to_tree_iter_map, GUINT_TO_POINTER(accelerator_key_mapping[i].key_id), GINT_TO_POINTER(i));
-			i++;
-		} else {
-			gtk_list_store_set (dialog->program_list_store, &iter,
-					    COLUMN_ACCELERATOR_MASK, (gint)GDK_MOD1_MASK,
-					    COLUMN_ACCELERATOR_KEY_VALUE, 0,
-					    -1);
-		}
+
+		g_ptr_array_add (dialog->program_index, index_entry);
 	}
-	g_slist_free_full (all_applications, matemenu_tree_item_unref);
+	g_hash_table_destroy (history);
+
+	panel_run_dialog_show_all_programs (dialog);
 
 	model_filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (dialog->program_list_store),
 						  NULL);
@@ -1360,163 +1432,289 @@ panel_run_dialog_setup_file_button (PanelRunDialog *dialog,
 			  dialog);
 }
 
-static GList *
-fill_files_from (const char *dirname,
-		 const char *dirprefix,
-		 char        prefix,
-		 GList      *existing_items)
-{
-	GList         *list;
-	DIR           *dir;
-	struct dirent *dent;
-
-	list = NULL;
-	dir = opendir (dirname);
+/* Names in the directories completed from, kept for as long as the
+ * directories aren't modified. */
+#define PANEL_RUN_DIRECTORY_CACHE_MAX 32
 
-	if (!dir)
-		return list;
+typedef struct {
+	gint64     mtime;
+	/* with a trailing slash for directories */
+	GPtrArray *names;
+} PanelRunDirectoryCacheEntry;
 
-	while ((dent = readdir (dir))) {
-		char       *file;
-		char       *item;
-		const char *suffix;
+static GHashTable *directory_cache = NULL;
 
-		if (dent->d_name [0] != prefix)
-			continue;
+static void
+panel_run_directory_cache_entry_free (PanelRunDirectoryCacheEntry *entry)
+{
+	g_ptr_array_free (entry->names, TRUE);
+	g_free (entry);
+}
 
-		file = g_build_filename (dirname, dent->d_name, NULL);
-
-		suffix = NULL;
-		if (
-#ifdef HAVE_STRUCT_DIRENT_D_TYPE
-		/* don't use g_file_test at first so we don't stat() */
-		    dent->d_type == DT_DIR ||
-		    (dent->d_type == DT_LNK &&
-		     g_file_test (file, G_FILE_TEST_IS_DIR))
-#else
-		    g_file_test (file, G_FILE_TEST_IS_DIR)
-#endif
-		   )
-			suffix = "/";
+static void
+panel_run_dialog_add_completion_items (PanelRunDialog *dialog,
+				       GList          *items)
+{
+	GList *l;
 
-		g_free (file);
+	for (l = items; l; l = l->next) {
+		char *item = l->data;
 
-		item = g_build_filename (dirprefix, dent->d_name, suffix, NULL);
+		if (g_hash_table_contains (dialog->completion_items, item)) {
+			g_free (item);
+			continue;
+		}
 
-		list = g_list_prepend (list, item);
+		g_hash_table_add (dialog->completion_items, item);
+		gtk_list_store_insert_with_values (dialog->completion_store,
+						   NULL, -1,
+						   0, item,
+						   -1);
 	}
 
-	closedir (dir);
-
-	return list;
+	g_list_free (items);
 }
 
-static GList *
-fill_possible_executables (void)
+static gint64
+get_file_info_mtime (GFileInfo *info)
 {
-	GList         *list;
-	const char    *path;
-	char         **pathv;
-	int            i;
+	return (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
 
-	list = NULL;
-	path = g_getenv ("PATH");
+static void
+panel_run_directory_load_free (PanelRunDirectoryLoad *load)
+{
+	g_object_unref (load->cancellable);
+	g_object_unref (load->dir);
+	g_free (load->dirname);
+	g_free (load->dirprefix);
+	g_string_free (load->prefixes, TRUE);
+	if (load->names)
+		g_ptr_array_free (load->names, TRUE);
+	g_free (load);
+}
 
-	if (!path || !path [0])
-		return list;
+/* Adds the names of the directory starting with the characters that
+ * were typed while it was read. @names can be NULL if the directory
+ * couldn't be read. */
+static void
+panel_run_directory_load_finish (PanelRunDirectoryLoad *load,
+				 GPtrArray             *names)
+{
+	PanelRunDialog *dialog = load->dialog;
+	GList          *items = NULL;
+	gsize           i;
+	guint           j;
 
-	pathv = g_strsplit (path, ":", 0);
+	dialog->directory_load = NULL;
 
-	for (i = 0; pathv [i]; i++) {
-		const char *file;
-		GDir       *dir;
+	for (i = 0; i < load->prefixes->len; i++) {
+		char prefix = load->prefixes->str [i];
 
-		dir = g_dir_open (pathv [i], 0, NULL);
+		g_hash_table_add (dialog->dir_hash,
+				  g_strdup_printf ("%s%c%c", load->dirprefix,
+						   G_DIR_SEPARATOR, prefix));
 
-		if (!dir)
-			continue;
+		for (j = 0; names && j < names->len; j++) {
+			const char *name = g_ptr_array_index (names, j);
 
-		while ((file = g_dir_read_name (dir))) {
-			list = g_list_prepend (list, g_build_filename (pathv [i], file, NULL));
+			if (name [0] == prefix)
+				items = g_list_prepend (items,
+							g_build_filename (load->dirprefix, name, NULL));
 		}
-
-		g_dir_close (dir);
 	}
 
-	g_strfreev (pathv);
+	panel_run_dialog_add_completion_items (dialog, items);
 
-	return list;
+	panel_run_directory_load_free (load);
 }
 
-static GList *
-fill_executables (GList *possible_executables,
-		  GList *existing_items,
-		  char   prefix)
+static void
+panel_run_directory_load_next_files (GObject      *source_object,
+				     GAsyncResult *result,
+				     gpointer      user_data)
 {
-	GList *list;
-	GList *l;
+	PanelRunDirectoryLoad       *load = user_data;
+	GFileEnumerator             *enumerator = G_FILE_ENUMERATOR (source_object);
+	PanelRunDirectoryCacheEntry *entry;
+	GList                       *infos;
+	GList                       *l;
+	GError                      *error = NULL;
+
+	infos = g_file_enumerator_next_files_finish (enumerator, result, &error);
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_error_free (error);
+		g_object_unref (enumerator);
+		panel_run_directory_load_free (load);
+		return;
+	}
 
-	list = NULL;
+	for (l = infos; l; l = l->next) {
+		GFileInfo  *info = l->data;
+		const char *name = g_file_info_get_name (info);
 
-	for (l = possible_executables; l; l = l->next) {
-		const char *filename;
-		char       *basename;
+		/* symlinks are followed, so this is the type of their target */
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+			g_ptr_array_add (load->names, g_strconcat (name, "/", NULL));
+		else
+			g_ptr_array_add (load->names, g_strdup (name));
+	}
 
-		filename = l->data;
-		basename = g_path_get_basename (filename);
+	if (infos) {
+		g_list_free_full (infos, g_object_unref);
+		g_file_enumerator_next_files_async (enumerator, 64,
+						    G_PRIORITY_DEFAULT,
+						    load->cancellable,
+						    panel_run_directory_load_next_files,
+						    load);
+		return;
+	}
 
-		if (basename [0] == prefix &&
-		    g_file_test (filename, G_FILE_TEST_IS_REGULAR) &&
-		    g_file_test (filename, G_FILE_TEST_IS_EXECUTABLE)) {
+	g_object_unref (enumerator);
 
-			if (g_list_find_custom (existing_items, basename,
-						(GCompareFunc) strcmp)) {
-				g_free (basename);
-				return NULL;
-			}
+	if (error) {
+		g_error_free (error);
+		panel_run_directory_load_finish (load, NULL);
+		return;
+	}
 
-			list = g_list_prepend (list, basename);
-		 } else {
-			g_free (basename);
-		 }
+	if (!directory_cache)
+		directory_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free,
+							 (GDestroyNotify) panel_run_directory_cache_entry_free);
+	else if (g_hash_table_size (directory_cache) >= PANEL_RUN_DIRECTORY_CACHE_MAX)
+		g_hash_table_remove_all (directory_cache);
+
+	entry = g_new (PanelRunDirectoryCacheEntry, 1);
+	entry->mtime = load->mtime;
+	entry->names = load->names;
+	load->names = NULL;
+	g_hash_table_replace (directory_cache, g_strdup (load->dirname), entry);
+
+	panel_run_directory_load_finish (load, entry->names);
+}
+
+static void
+panel_run_directory_load_enumerated (GObject      *source_object,
+				     GAsyncResult *result,
+				     gpointer      user_data)
+{
+	PanelRunDirectoryLoad *load = user_data;
+	GFileEnumerator       *enumerator;
+	GError                *error = NULL;
+
+	enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
+						       result, &error);
+
+	if (!enumerator) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			panel_run_directory_load_free (load);
+		else
+			panel_run_directory_load_finish (load, NULL);
+
+		g_error_free (error);
+		return;
 	}
 
-	return list;
+	load->names = g_ptr_array_new_with_free_func (g_free);
+	g_file_enumerator_next_files_async (enumerator, 64,
+					    G_PRIORITY_DEFAULT,
+					    load->cancellable,
+					    panel_run_directory_load_next_files,
+					    load);
 }
 
-static GtkTreeModel *
-create_completion_model (GList *list)
+static void
+panel_run_directory_load_queried (GObject      *source_object,
+				  GAsyncResult *result,
+				  gpointer      user_data)
 {
-	GtkListStore *store;
-	GtkTreeIter   iter;
-	GList        *l;
+	PanelRunDirectoryLoad       *load = user_data;
+	PanelRunDirectoryCacheEntry *entry;
+	GFileInfo                   *info;
+	GError                      *error = NULL;
 
-	store = gtk_list_store_new (1, G_TYPE_STRING);
-	for (l = list; l; l = l->next)
-	{
-		gtk_list_store_append (store, &iter);
-		gtk_list_store_set (store, &iter, 0, l->data, -1);
+	info = g_file_query_info_finish (G_FILE (source_object), result, &error);
+
+	if (!info) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			panel_run_directory_load_free (load);
+		else
+			panel_run_directory_load_finish (load, NULL);
+
+		g_error_free (error);
+		return;
+	}
+
+	load->mtime = get_file_info_mtime (info);
+	g_object_unref (info);
+
+	entry = directory_cache ? g_hash_table_lookup (directory_cache, load->dirname) : NULL;
+	if (entry && entry->mtime == load->mtime) {
+		panel_run_directory_load_finish (load, entry->names);
+		return;
 	}
 
-	return GTK_TREE_MODEL (store);
+	g_file_enumerate_children_async (load->dir,
+					 G_FILE_ATTRIBUTE_STANDARD_NAME ","
+					 G_FILE_ATTRIBUTE_STANDARD_TYPE,
+					 G_FILE_QUERY_INFO_NONE,
+					 G_PRIORITY_DEFAULT,
+					 load->cancellable,
+					 panel_run_directory_load_enumerated,
+					 load);
 }
 
+/* Reads @dirname in the background, to complete the names in it starting
+ * with @prefix. Reading another directory is given up, as the user is
+ * not typing in it anymore. */
 static void
-completion_add_items (GtkEntryCompletion *completion, GList *list)
+panel_run_dialog_load_directory (PanelRunDialog *dialog,
+				 const char     *dirname,
+				 const char     *dirprefix,
+				 char            prefix)
 {
-	GtkTreeModel          *completion_model;
+	PanelRunDirectoryLoad *load = dialog->directory_load;
+
+	if (load) {
+		if (strcmp (load->dirname, dirname) == 0 &&
+		    strcmp (load->dirprefix, dirprefix) == 0) {
+			if (!strchr (load->prefixes->str, prefix))
+				g_string_append_c (load->prefixes, prefix);
+			return;
+		}
+
+		g_cancellable_cancel (load->cancellable);
+		dialog->directory_load = NULL;
+	}
 
-	completion_model = create_completion_model (list);
-	gtk_entry_completion_set_model (completion, completion_model);
-	g_object_unref (completion_model);
+	load = g_new0 (PanelRunDirectoryLoad, 1);
+	load->dialog = dialog;
+	load->cancellable = g_cancellable_new ();
+	load->dir = g_file_new_for_path (dirname);
+	load->dirname = g_strdup (dirname);
+	load->dirprefix = g_strdup (dirprefix);
+	load->prefixes = g_string_new (NULL);
+	g_string_append_c (load->prefixes, prefix);
+
+	dialog->directory_load = load;
+
+	g_file_query_info_async (load->dir,
+				 G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				 G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				 G_FILE_QUERY_INFO_NONE,
+				 G_PRIORITY_DEFAULT,
+				 load->cancellable,
+				 panel_run_directory_load_queried,
+				 load);
 }
 
 static void
 panel_run_dialog_update_completion (PanelRunDialog *dialog,
 				    const char     *text)
 {
-	GList *list;
-	GList *executables;
 	char   prefix;
 	char  *buf;
 	char  *dirname;
@@ -1525,9 +1723,6 @@ panel_run_dialog_update_completion (PanelRunDialog *dialog,
 
 	g_assert (text != NULL && *text != '\0' && !g_ascii_isspace (*text));
 
-	list = NULL;
-	executables = NULL;
-
 	buf = g_path_get_basename (text);
 	prefix = buf[0];
 	g_free (buf);
@@ -1541,9 +1736,20 @@ panel_run_dialog_update_completion (PanelRunDialog *dialog,
 	} else {
 		/* complete against relative path and executable name */
 		if (!strchr (text, '/')) {
-			executables = fill_executables (dialog->possible_executables,
-							dialog->completion_items,
-							text [0]);
+			char   exec_prefix [2] = { text [0], '\0' };
+			GList *executables;
+
+			/* only the first time this character is typed, and
+			 * once the index is there */
+			key = g_strdup_printf ("PATH:%c", text [0]);
+			if (!g_hash_table_contains (dialog->dir_hash, key) &&
+			    panel_executable_index_lookup (exec_prefix, &executables)) {
+				g_hash_table_add (dialog->dir_hash, key);
+				panel_run_dialog_add_completion_items (dialog, executables);
+			} else {
+				g_free (key);
+			}
+
 			dirprefix = g_strdup ("");
 		} else {
 			dirprefix = g_path_get_dirname (text);
@@ -1554,26 +1760,36 @@ panel_run_dialog_update_completion (PanelRunDialog *dialog,
 
 	key = g_strdup_printf ("%s%c%c", dirprefix, G_DIR_SEPARATOR, prefix);
 
-	if (!g_hash_table_lookup (dialog->dir_hash, key)) {
-		g_hash_table_insert (dialog->dir_hash, key, dialog);
-
-		list = fill_files_from (dirname, dirprefix, prefix,
-					dialog->completion_items);
-	} else {
-		g_free (key);
-	}
-
-	list = g_list_concat (list, executables);
+	if (!g_hash_table_contains (dialog->dir_hash, key))
+		panel_run_dialog_load_directory (dialog, dirname, dirprefix, prefix);
 
+	g_free (key);
 	g_free (dirname);
 	g_free (dirprefix);
+}
+
+/* The programs in $PATH changed, or were not indexed yet when the
+ * completion was last updated: the completions are built again for the
+ * text in the entry, and for the rest as it is typed. */
+static void
+panel_run_dialog_executables_changed (gpointer user_data)
+{
+	PanelRunDialog *dialog = user_data;
+	const char     *text;
 
-	if (list == NULL)
+	g_hash_table_remove_all (dialog->dir_hash);
+	g_hash_table_remove_all (dialog->completion_items);
+	gtk_list_store_clear (dialog->completion_store);
+
+	if (!panel_profile_get_enable_autocompletion ())
 		return;
 
-	completion_add_items (dialog->completion, list);
-	dialog->completion_items = g_list_concat (dialog->completion_items,
-						  list);
+	text = panel_run_dialog_get_combo_text (dialog);
+	while (*text != '\0' && g_ascii_isspace (*text))
+		text++;
+
+	if (*text != '\0')
+		panel_run_dialog_update_completion (dialog, text);
 }
 
 static gboolean
@@ -1692,41 +1908,11 @@ combobox_changed (GtkComboBox    *combobox,
 			g_source_remove (dialog->find_command_idle_id);
 			dialog->find_command_idle_id = 0;
 		}
+		panel_run_dialog_search_free (dialog);
 
 		if (panel_profile_get_enable_program_list ()) {
-			GtkTreeIter   iter;
-			GtkTreePath  *path;
-			GtkTreeModel *model;
-			gint          i = 0;
-			gboolean      valid = FALSE;
-
-			g_hash_table_remove_all (accelerator_keys_to_tree_iter_map);
-			model = GTK_TREE_MODEL (dialog->program_list_store);
-			for (valid = gtk_tree_model_get_iter_first (model, &iter); valid; valid = gtk_tree_model_iter_next (model, &iter)) {
-				if (i < G_N_ELEMENTS (accelerator_key_mapping)) {
-					gtk_list_store_set (GTK_LIST_STORE (GTK_TREE_MODEL (dialog->program_list_store)), &iter,
-							    COLUMN_VISIBLE, TRUE,
-							    COLUMN_ACCELERATOR_MASK, (gint)accelerator_key_mapping[i].modifier,
-							    COLUMN_ACCELERATOR_KEY_VALUE, accelerator_key_mapping[i].key_id,
-							    -1);
-					g_hash_table_insert (accelerator_keys_to_tree_iter_map, GUINT_TO_POINTER (accelerator_key_mapping[i].key_id), GINT_TO_POINTER(i));
-					i++;
-				} else {
-					gtk_list_store_set (GTK_LIST_STORE (GTK_TREE_MODEL (dialog->program_list_store)), &iter,
-							    COLUMN_VISIBLE, TRUE,
-							    COLUMN_ACCELERATOR_MASK, (gint)GDK_MOD1_MASK,
-							    COLUMN_ACCELERATOR_KEY_VALUE, 0,
-							    -1);
-				}
-			}
-
-			path = gtk_tree_path_new_first ();
-			if (gtk_tree_model_get_iter (gtk_tree_view_get_model (GTK_TREE_VIEW (dialog->program_list)),
-						     &iter, path))
-				gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (dialog->program_list),
-							      path, NULL,
-							      FALSE, 0, 0);
-			gtk_tree_path_free (path);
+			panel_run_dialog_show_all_programs (dialog);
+			panel_run_dialog_scroll_to_first (dialog);
 		}
 
 		return;
@@ -1747,7 +1933,9 @@ combobox_changed (GtkComboBox    *combobox,
 		g_free (msg);
 	}
 
-	/* look up icon for the command */
+	/* look up icon for the command, starting over if the text changed
+	 * in the middle of a search */
+	panel_run_dialog_search_free (dialog);
 	if (panel_profile_get_enable_program_list () &&
 	    !dialog->use_program_list &&
 	    !dialog->find_command_idle_id)
@@ -1813,8 +2001,10 @@ panel_run_dialog_setup_entry (PanelRunDialog *dialog,
 	GtkWidget             *entry;
 
 	dialog->combobox = PANEL_GTK_BUILDER_GET (gui, "comboboxentry");
-	dialog->possible_executables = fill_possible_executables ();
+	panel_executable_index_ensure ();
 	dialog->dir_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	dialog->completion_items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	dialog->completion_store = gtk_list_store_new (1, G_TYPE_STRING);
 
 	entry = gtk_bin_get_child (GTK_BIN (dialog->combobox));
 	gtk_entry_set_activates_default (GTK_ENTRY (entry), TRUE);
@@ -1823,8 +2013,14 @@ panel_run_dialog_setup_entry (PanelRunDialog *dialog,
 	gtk_entry_completion_set_inline_completion (dialog->completion, TRUE);
 	gtk_entry_completion_set_popup_completion (dialog->completion, FALSE);
 	gtk_entry_set_completion (GTK_ENTRY (entry), dialog->completion);
+	gtk_entry_completion_set_model (dialog->completion,
+					GTK_TREE_MODEL (dialog->completion_store));
 	gtk_entry_completion_set_text_column (dialog->completion, 0);
 
+	dialog->executables_changed_id =
+		panel_executable_index_add_changed_func (panel_run_dialog_executables_changed,
+							 dialog);
+
 	gtk_combo_box_set_model (GTK_COMBO_BOX (dialog->combobox),
 				 _panel_run_get_recent_programs_list (dialog));
 	gtk_combo_box_set_entry_text_column
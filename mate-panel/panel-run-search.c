@@ -0,0 +1,260 @@
+/*
+ * panel-run-search.c: scoring of the program list of the Run dialog
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include <libpanel-util/panel-glib.h>
+
+#include "panel-run-search.h"
+
+/* Scores of fuzzy_match_score() */
+#define PANEL_RUN_SCORE_MATCH           16
+#define PANEL_RUN_SCORE_GAP_START       -3
+#define PANEL_RUN_SCORE_GAP_EXTENSION   -1
+#define PANEL_RUN_BONUS_BOUNDARY        8
+#define PANEL_RUN_BONUS_CONSECUTIVE     4
+/* Programs only matching in their description come last */
+#define PANEL_RUN_SCORE_COMMENT         -1000
+/* Programs matching the command being typed come first */
+#define PANEL_RUN_BONUS_COMMAND         1000
+
+struct _PanelRunQuery {
+	char             *text;
+	char             *text_basename;
+	PanelGUtf8Needle *text_needle;
+	gunichar         *needle;
+	glong             needle_len;
+};
+
+/* Returns the basename of the command in @cmd, stripped of all its
+ * arguments. */
+char *
+panel_run_command_basename (const char *cmd)
+{
+	const char *space;
+	char       *command;
+	char       *retval;
+
+	if (!cmd || !cmd [0])
+		return NULL;
+
+	space = strchr (cmd, ' ');
+	if (!space)
+		return g_path_get_basename (cmd);
+
+	command = g_strndup (cmd, space - cmd);
+	retval = g_path_get_basename (command);
+	g_free (command);
+
+	return retval;
+}
+
+void
+panel_run_search_keys_init (PanelRunSearchKeys *keys,
+			    const char         *name,
+			    const char         *comment,
+			    const char         *exec)
+{
+	keys->exec = g_strdup (exec);
+	keys->exec_basename = panel_run_command_basename (exec);
+	keys->exec_key = panel_g_utf8_make_search_key (exec);
+	keys->name_key = panel_g_utf8_make_search_key (name);
+	keys->comment_key = panel_g_utf8_make_search_key (comment);
+	keys->history_bonus = 0;
+}
+
+void
+panel_run_search_keys_clear (PanelRunSearchKeys *keys)
+{
+	g_free (keys->exec);
+	g_free (keys->exec_basename);
+	g_free (keys->exec_key);
+	g_free (keys->name_key);
+	g_free (keys->comment_key);
+	memset (keys, 0, sizeof (PanelRunSearchKeys));
+}
+
+PanelRunQuery *
+panel_run_query_new (const char *text)
+{
+	PanelRunQuery *query;
+
+	query = g_new0 (PanelRunQuery, 1);
+	query->text = g_strdup (text ? text : "");
+	query->text_basename = panel_run_command_basename (text);
+	query->text_needle = panel_g_utf8_needle_new (text);
+	query->needle = g_utf8_to_ucs4_fast (panel_g_utf8_needle_get_key (query->text_needle),
+					     -1, &query->needle_len);
+
+	return query;
+}
+
+void
+panel_run_query_free (PanelRunQuery *query)
+{
+	if (!query)
+		return;
+
+	g_free (query->text);
+	g_free (query->text_basename);
+	panel_g_utf8_needle_free (query->text_needle);
+	g_free (query->needle);
+	g_free (query);
+}
+
+/* Returns whether the text is the command of the program. @fuzzy is set
+ * when only the basenames of the commands are the same. */
+gboolean
+panel_run_query_match_command (const PanelRunQuery      *query,
+			       const PanelRunSearchKeys *keys,
+			       gboolean                 *fuzzy)
+{
+	*fuzzy = FALSE;
+
+	if (!keys->exec)
+		return FALSE;
+
+	if (!strcmp (query->text, keys->exec))
+		return TRUE;
+
+	if (query->text_basename && keys->exec_basename &&
+	    !strcmp (query->text_basename, keys->exec_basename)) {
+		*fuzzy = TRUE;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+is_word_boundary (gunichar c)
+{
+	return c == 0 || !g_unichar_isalnum (c);
+}
+
+/* Scores how well the casefolded @needle matches @haystack as a
+ * subsequence: the shortest window of @haystack containing the whole
+ * needle is searched for, and matching characters score more when they
+ * start a word or follow another matching character, while characters
+ * left out of the match cost a little. */
+static int
+fuzzy_match_score (const char     *haystack,
+		   const gunichar *needle,
+		   glong           needle_len)
+{
+	const char *p;
+	const char *start = NULL;
+	const char *end = NULL;
+	gunichar    prev;
+	gboolean    consecutive;
+	gboolean    in_gap;
+	glong       n;
+	int         score;
+
+	if (!haystack || needle_len == 0)
+		return PANEL_RUN_SCORE_NO_MATCH;
+
+	/* end of the first match */
+	for (p = haystack, n = 0; *p && n < needle_len; p = g_utf8_next_char (p)) {
+		if (g_utf8_get_char (p) == needle [n]) {
+			n++;
+			end = g_utf8_next_char (p);
+		}
+	}
+
+	if (n < needle_len)
+		return PANEL_RUN_SCORE_NO_MATCH;
+
+	/* tightest start for that end */
+	for (p = end, n = needle_len - 1; n >= 0; ) {
+		p = g_utf8_prev_char (p);
+		if (g_utf8_get_char (p) == needle [n])
+			n--;
+	}
+	start = p;
+
+	prev = (start == haystack) ? 0 : g_utf8_get_char (g_utf8_prev_char (start));
+	consecutive = FALSE;
+	in_gap = FALSE;
+	score = 0;
+
+	for (p = start, n = 0; p < end; p = g_utf8_next_char (p)) {
+		gunichar c = g_utf8_get_char (p);
+
+		if (n < needle_len && c == needle [n]) {
+			score += PANEL_RUN_SCORE_MATCH;
+			if (is_word_boundary (prev))
+				score += n == 0 ? 2 * PANEL_RUN_BONUS_BOUNDARY : PANEL_RUN_BONUS_BOUNDARY;
+			if (consecutive)
+				score += PANEL_RUN_BONUS_CONSECUTIVE;
+
+			consecutive = TRUE;
+			in_gap = FALSE;
+			n++;
+		} else {
+			score += in_gap ? PANEL_RUN_SCORE_GAP_EXTENSION : PANEL_RUN_SCORE_GAP_START;
+
+			consecutive = FALSE;
+			in_gap = TRUE;
+		}
+
+		prev = c;
+	}
+
+	return score;
+}
+
+/* Scores a program whose command is being typed: it comes before all
+ * the others */
+int
+panel_run_query_score_command (const PanelRunQuery      *query,
+			       const PanelRunSearchKeys *keys)
+{
+	int score;
+
+	/* the arguments being typed may not be in the command */
+	score = fuzzy_match_score (keys->exec_basename,
+				   query->needle, query->needle_len);
+
+	return PANEL_RUN_BONUS_COMMAND + keys->history_bonus + MAX (score, 0);
+}
+
+int
+panel_run_query_score (const PanelRunQuery      *query,
+		       const PanelRunSearchKeys *keys)
+{
+	int score;
+
+	score = MAX (fuzzy_match_score (keys->name_key,
+					query->needle, query->needle_len),
+		     fuzzy_match_score (keys->exec_key,
+					query->needle, query->needle_len));
+
+	if (score == PANEL_RUN_SCORE_NO_MATCH &&
+	    panel_g_utf8_needle_find (query->text_needle, keys->comment_key))
+		score = PANEL_RUN_SCORE_COMMENT;
+
+	if (score != PANEL_RUN_SCORE_NO_MATCH)
+		score += keys->history_bonus;
+
+	return score;
+}
@@ -0,0 +1,77 @@
+/*
+ * panel-run-search.h: scoring of the program list of the Run dialog
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_RUN_SEARCH_H__
+#define __PANEL_RUN_SEARCH_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Score of the programs that don't match */
+#define PANEL_RUN_SCORE_NO_MATCH        G_MININT
+/* Most the history can add to the score of a program */
+#define PANEL_RUN_BONUS_HISTORY         64
+
+/* What the text typed in the dialog is matched against, prepared once
+ * per program */
+typedef struct {
+	char *exec;
+	/* basename of the command, without its arguments */
+	char *exec_basename;
+	/* normalized and casefolded */
+	char *exec_key;
+	char *name_key;
+	char *comment_key;
+
+	/* added to the score of the program when it matches: the more
+	 * recently it was run from the dialog, the higher */
+	int   history_bonus;
+} PanelRunSearchKeys;
+
+typedef struct _PanelRunQuery PanelRunQuery;
+
+char          *panel_run_command_basename    (const char               *cmd);
+
+void           panel_run_search_keys_init    (PanelRunSearchKeys       *keys,
+					      const char               *name,
+					      const char               *comment,
+					      const char               *exec);
+void           panel_run_search_keys_clear   (PanelRunSearchKeys       *keys);
+
+PanelRunQuery *panel_run_query_new           (const char               *text);
+void           panel_run_query_free          (PanelRunQuery            *query);
+
+gboolean       panel_run_query_match_command (const PanelRunQuery      *query,
+					      const PanelRunSearchKeys *keys,
+					      gboolean                 *fuzzy);
+int            panel_run_query_score_command (const PanelRunQuery      *query,
+					      const PanelRunSearchKeys *keys);
+int            panel_run_query_score         (const PanelRunQuery      *query,
+					      const PanelRunSearchKeys *keys);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_RUN_SEARCH_H__ */
@@ -16,6 +16,7 @@
 #define PANEL_LOCKED_DOWN_KEY         "locked-down"
 #define PANEL_DISABLE_FORCE_QUIT_KEY  "disable-force-quit"
 #define PANEL_DISABLED_APPLETS_KEY    "disabled-applets"
+#define PANEL_APPLET_ACTIVATION_LIMIT_KEY "applet-activation-limit"
 
 #define PANEL_TOPLEVEL_SCHEMA                "org.mate.panel.toplevel"
 #define PANEL_TOPLEVEL_NAME_KEY              "name"
@@ -74,6 +74,7 @@
 #define HANDLE_SIZE               10
 #define N_ATTACH_TOPLEVEL_SIGNALS 5
 #define N_ATTACH_WIDGET_SIGNALS   5
+#define N_FRAME_TIME_BUCKETS      8
 
 typedef enum {
 	PANEL_GRAB_OP_NONE,
@@ -152,7 +153,12 @@ struct _PanelToplevelPrivate {
 	int                     animation_end_height;
 	gint64                  animation_start_time; /* monotonic start time in microseconds */
 	GTimeSpan               animation_duration_time; /* monotonic duration time in microseconds */
-	guint                   animation_timeout;
+	gint64                  animation_frame_time; /* frame clock time of the current animation frame */
+	gint64                  animation_applied_time; /* frame time the geometry was last advanced to */
+	gint64                  animation_last_tick_time;
+	guint                   animation_tick_id;
+	/* intervals between the frames of the current animation */
+	guint                   frame_time_histogram [N_FRAME_TIME_BUCKETS];
 
 	PanelWidget            *panel_widget;
 	PanelFrame             *inner_frame;
@@ -251,6 +257,12 @@ G_DEFINE_TYPE_WITH_PRIVATE (PanelToplevel, panel_toplevel, GTK_TYPE_WINDOW)
 static guint toplevel_signals[LAST_SIGNAL] = {0};
 static GSList* toplevel_list = NULL;
 
+/* Upper bounds, in milliseconds, of the buckets of the animation frame
+ * time histogram. The last bucket collects everything above. */
+static const int frame_time_bucket_limits [N_FRAME_TIME_BUCKETS - 1] = {
+	5, 8, 12, 17, 25, 34, 50
+};
+
 static void panel_toplevel_calculate_animation_end_geometry(PanelToplevel *toplevel);
 
 static void panel_toplevel_update_monitor(PanelToplevel* toplevel);
@@ -1990,7 +2002,15 @@ panel_toplevel_update_animating_position (PanelToplevel *toplevel)
 	    (toplevel->priv->animation_duration_time <= 0))
 		return;
 
-	animation_elapsed_time = g_get_monotonic_time () - toplevel->priv->animation_start_time;
+	/* The geometry is only advanced once per frame: a size request
+	 * queued from the frame clock tick must not move the panel again */
+	if (toplevel->priv->animation_frame_time <= 0 ||
+	    toplevel->priv->animation_frame_time == toplevel->priv->animation_applied_time)
+		return;
+
+	toplevel->priv->animation_applied_time = toplevel->priv->animation_frame_time;
+
+	animation_elapsed_time = toplevel->priv->animation_frame_time - toplevel->priv->animation_start_time;
 
 	monitor_offset_x = panel_multimonitor_x (toplevel->priv->monitor);
 	monitor_offset_y = panel_multimonitor_y (toplevel->priv->monitor);
@@ -3020,9 +3040,10 @@ panel_toplevel_disconnect_timeouts (PanelToplevel *toplevel)
 		g_source_remove (toplevel->priv->unhide_timeout);
 	toplevel->priv->unhide_timeout = 0;
 
-	if (toplevel->priv->animation_timeout)
-		g_source_remove (toplevel->priv->animation_timeout);
-	toplevel->priv->animation_timeout = 0;
+	if (toplevel->priv->animation_tick_id)
+		gtk_widget_remove_tick_callback (GTK_WIDGET (toplevel),
+						 toplevel->priv->animation_tick_id);
+	toplevel->priv->animation_tick_id = 0;
 }
 
 static void
@@ -3483,23 +3504,123 @@ panel_toplevel_motion_notify_event (GtkWidget      *widget,
 		return FALSE;
 }
 
+static void
+panel_toplevel_record_frame_time (PanelToplevel *toplevel,
+				  gint64         frame_time)
+{
+	gint64 interval;
+	int    i;
+
+	if (toplevel->priv->animation_last_tick_time > 0) {
+		interval = (frame_time - toplevel->priv->animation_last_tick_time) / G_TIME_SPAN_MILLISECOND;
+
+		for (i = 0; i < N_FRAME_TIME_BUCKETS - 1; i++)
+			if (interval < frame_time_bucket_limits [i])
+				break;
+
+		toplevel->priv->frame_time_histogram [i]++;
+	}
+
+	toplevel->priv->animation_last_tick_time = frame_time;
+}
+
+/* Logs the distribution of the intervals between the frames of the
+ * animation that just ended, as a debug message, and starts over */
+static void
+panel_toplevel_dump_frame_time_histogram (PanelToplevel *toplevel)
+{
+	guint   *histogram = toplevel->priv->frame_time_histogram;
+	GString *str;
+	int      i;
+
+	str = g_string_new (NULL);
+	g_string_printf (str, "Animation frame times of %s:",
+			 toplevel->priv->settings_path);
+
+	for (i = 0; i < N_FRAME_TIME_BUCKETS - 1; i++)
+		g_string_append_printf (str, " <%dms: %u",
+					frame_time_bucket_limits [i],
+					histogram [i]);
+	g_string_append_printf (str, " >=%dms: %u",
+				frame_time_bucket_limits [N_FRAME_TIME_BUCKETS - 2],
+				histogram [N_FRAME_TIME_BUCKETS - 1]);
+
+	g_debug ("%s", str->str);
+	g_string_free (str, TRUE);
+
+	memset (histogram, 0, sizeof (toplevel->priv->frame_time_histogram));
+}
+
+static void
+panel_toplevel_animation_done (PanelToplevel *toplevel)
+{
+	toplevel->priv->animation_end_x              = 0xdead;
+	toplevel->priv->animation_end_y              = 0xdead;
+	toplevel->priv->animation_end_width          = 0xdead;
+	toplevel->priv->animation_end_height         = 0xdead;
+	toplevel->priv->animation_start_time         = 0xdead;
+	toplevel->priv->animation_duration_time      = 0xdead;
+	toplevel->priv->animation_frame_time         = 0;
+	toplevel->priv->animation_applied_time       = 0;
+	toplevel->priv->animation_last_tick_time     = 0;
+	toplevel->priv->animation_tick_id            = 0;
+	toplevel->priv->initial_animation_done       = TRUE;
+
+	panel_toplevel_dump_frame_time_histogram (toplevel);
+}
+
 static gboolean
-panel_toplevel_animation_timeout (PanelToplevel *toplevel)
+panel_toplevel_animation_tick (GtkWidget     *widget,
+			       GdkFrameClock *frame_clock,
+			       gpointer       user_data)
 {
-	gtk_widget_queue_resize (GTK_WIDGET (toplevel));
+	PanelToplevel  *toplevel = PANEL_TOPLEVEL (widget);
+	GdkRectangle    old_geometry;
+	PanelFrameEdge  old_edges;
+	GtkRequisition  requisition;
+	gboolean        position_changed;
+	gboolean        size_changed;
 
 	if (!toplevel->priv->animating) {
-		toplevel->priv->animation_end_x              = 0xdead;
-		toplevel->priv->animation_end_y              = 0xdead;
-		toplevel->priv->animation_end_width          = 0xdead;
-		toplevel->priv->animation_end_height         = 0xdead;
-		toplevel->priv->animation_start_time         = 0xdead;
-		toplevel->priv->animation_duration_time      = 0xdead;
-		toplevel->priv->animation_timeout            = 0;
-		toplevel->priv->initial_animation_done       = TRUE;
+		panel_toplevel_animation_done (toplevel);
+		return G_SOURCE_REMOVE;
 	}
 
-	return toplevel->priv->animating;
+	toplevel->priv->animation_frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+	panel_toplevel_record_frame_time (toplevel, toplevel->priv->animation_frame_time);
+
+	old_geometry = toplevel->priv->geometry;
+	old_edges    = toplevel->priv->edges;
+
+	/* panel_toplevel_update_size() is a no-op while animating, so the
+	 * current size is all we need to pass in */
+	requisition.width  = old_geometry.width;
+	requisition.height = old_geometry.height;
+
+	panel_toplevel_update_geometry (toplevel, &requisition);
+
+	position_changed = (old_geometry.x != toplevel->priv->geometry.x ||
+			    old_geometry.y != toplevel->priv->geometry.y);
+	size_changed = (old_geometry.width  != toplevel->priv->geometry.width ||
+			old_geometry.height != toplevel->priv->geometry.height);
+
+	/* The size request queued below, or by the last frame, sees the
+	 * geometry already advanced and doesn't move the window: this
+	 * frame is applied here, the last one included */
+	if (gtk_widget_get_realized (widget))
+		panel_toplevel_move_resize_window (toplevel, position_changed, size_changed);
+
+	/* When the animation ended, panel_toplevel_update_animating_position()
+	 * already queued a resize or unmapped the toplevel */
+	if (!toplevel->priv->animating)
+		return G_SOURCE_CONTINUE;
+
+	/* Only a change in size or frame edges needs a new size negotiation
+	 * of the panel contents */
+	if (size_changed || old_edges != toplevel->priv->edges)
+		gtk_widget_queue_resize (widget);
+
+	return G_SOURCE_CONTINUE;
 }
 
 static GTimeSpan
@@ -3644,10 +3765,14 @@ panel_toplevel_start_animation (PanelToplevel *toplevel)
 
 	toplevel->priv->animation_start_time = g_get_monotonic_time ();
 	toplevel->priv->animation_duration_time = panel_toplevel_get_animation_time (toplevel);
+	toplevel->priv->animation_frame_time = 0;
+	toplevel->priv->animation_applied_time = 0;
 
-	if (!toplevel->priv->animation_timeout)
-		toplevel->priv->animation_timeout =
-			g_timeout_add (20, (GSourceFunc) panel_toplevel_animation_timeout, toplevel);
+	if (!toplevel->priv->animation_tick_id)
+		toplevel->priv->animation_tick_id =
+			gtk_widget_add_tick_callback (GTK_WIDGET (toplevel),
+						      panel_toplevel_animation_tick,
+						      NULL, NULL);
 }
 
 void
@@ -4711,7 +4836,10 @@ panel_toplevel_init (PanelToplevel *toplevel)
 	toplevel->priv->animation_end_height         = 0;
 	toplevel->priv->animation_start_time         = 0;
 	toplevel->priv->animation_duration_time      = 0;
-	toplevel->priv->animation_timeout            = 0;
+	toplevel->priv->animation_frame_time         = 0;
+	toplevel->priv->animation_applied_time       = 0;
+	toplevel->priv->animation_last_tick_time     = 0;
+	toplevel->priv->animation_tick_id            = 0;
 
 	toplevel->priv->panel_widget       = NULL;
 	toplevel->priv->inner_frame        = NULL;
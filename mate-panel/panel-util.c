@@ -82,8 +82,8 @@ panel_util_make_exec_uri_for_desktop (const char *exec)
 int
 panel_find_applet_index (GtkWidget *widget)
 {
-	GSList *applet_list, *l;
-	int     i;
+	GList *applet_list, *l;
+	int    i;
 
 	applet_list = mate_panel_applet_list_applets ();
 
@@ -84,6 +84,7 @@ static void panel_widget_cremove        (GtkContainer     *container,
 					 GtkWidget        *widget);
 static void panel_widget_dispose        (GObject *obj);
 static void panel_widget_finalize       (GObject          *obj);
+static void panel_widget_invalidate_layout (PanelWidget   *panel);
 
 static void panel_widget_push_move_applet   (PanelWidget      *panel,
                                              GtkDirectionType  dir);
@@ -598,6 +599,8 @@ panel_widget_cremove (GtkContainer *container, GtkWidget *widget)
 	if (ad)
 		panel->applet_list = g_list_remove (panel->applet_list, ad);
 
+	panel_widget_invalidate_layout (panel);
+
 	g_signal_emit (G_OBJECT (container),
 		       panel_widget_signals[APPLET_REMOVED_SIGNAL],
 		       0, widget);
@@ -782,6 +785,7 @@ panel_widget_jump_applet_right (PanelWidget *panel,
 	adjust_applet_position (panel, ad);
 	panel->applet_list = g_list_remove_link (panel->applet_list, list);
 	panel->applet_list = panel_g_list_insert_before (panel->applet_list, next, list);
+	panel_widget_invalidate_layout (panel);
 	gtk_widget_queue_resize (GTK_WIDGET (panel));
 	emit_applet_moved (panel, ad);
 }
@@ -823,6 +827,7 @@ panel_widget_switch_applet_right (PanelWidget *panel,
 	adjust_applet_position (panel, nad);
 	adjust_applet_position (panel, ad);
 	panel->applet_list = panel_g_list_swap_next (panel->applet_list, list);
+	panel_widget_invalidate_layout (panel);
 
 	gtk_widget_queue_resize (GTK_WIDGET (panel));
 
@@ -862,6 +867,7 @@ panel_widget_jump_applet_left (PanelWidget *panel,
 	adjust_applet_position (panel, ad);
 	panel->applet_list = g_list_remove_link (panel->applet_list, list);
 	panel->applet_list = panel_g_list_insert_after (panel->applet_list, prev, list);
+	panel_widget_invalidate_layout (panel);
 	gtk_widget_queue_resize (GTK_WIDGET (panel));
 	emit_applet_moved (panel, ad);
 }
@@ -901,6 +907,7 @@ panel_widget_switch_applet_left (PanelWidget *panel,
 	adjust_applet_position (panel, ad);
 	adjust_applet_position (panel, pad);
 	panel->applet_list = panel_g_list_swap_prev (panel->applet_list, list);
+	panel_widget_invalidate_layout (panel);
 
 	gtk_widget_queue_resize (GTK_WIDGET (panel));
 
@@ -1247,12 +1254,49 @@ panel_widget_get_preferred_size(GtkWidget	     *widget,
 	GList *list;
 	GList *ad_with_hints;
 	gboolean dont_fill;
+	gboolean changed;
 	gint scale;
 
 	g_return_if_fail(PANEL_IS_WIDGET(widget));
 	g_return_if_fail(minimum_size != NULL);
 
 	panel = PANEL_WIDGET(widget);
+	scale = gtk_widget_get_scale_factor(widget);
+
+	/* The applets answer from their own request cache unless they
+	 * queued a resize: only the applets whose requisition changed make
+	 * the request of the panel, and its size hints, computed again. */
+	changed = !panel->request_valid || panel->request_scale != scale;
+
+	for (list = panel->applet_list; list!=NULL; list = g_list_next(list)) {
+		AppletData *ad = list->data;
+		GtkRequisition child_min_size;
+		GtkRequisition child_natural_size;
+		gtk_widget_get_preferred_size(ad->applet,
+		                              &child_min_size,
+		                              &child_natural_size);
+
+		/* remember which applets changed size since the last
+		 * layout, so size_allocate() can place only those */
+		if (!ad->req_valid ||
+		    ad->min_req.width != child_min_size.width ||
+		    ad->min_req.height != child_min_size.height ||
+		    ad->natural_req.width != child_natural_size.width ||
+		    ad->natural_req.height != child_natural_size.height) {
+			ad->req_changed = TRUE;
+			changed = TRUE;
+		}
+
+		ad->min_req = child_min_size;
+		ad->natural_req = child_natural_size;
+		ad->req_valid = TRUE;
+	}
+
+	if (!changed) {
+		*minimum_size = panel->request_min;
+		*natural_size = panel->request_natural;
+		return;
+	}
 
 	if (panel->orient == GTK_ORIENTATION_HORIZONTAL) {
 		minimum_size->width = 0;
@@ -1265,15 +1309,11 @@ panel_widget_get_preferred_size(GtkWidget	     *widget,
 	natural_size->height = minimum_size->height;
 
 	ad_with_hints = NULL;
-	scale = gtk_widget_get_scale_factor(widget);
 
 	for (list = panel->applet_list; list!=NULL; list = g_list_next(list)) {
 		AppletData *ad = list->data;
-		GtkRequisition child_min_size;
-		GtkRequisition child_natural_size;
-		gtk_widget_get_preferred_size(ad->applet,
-		                              &child_min_size,
-		                              &child_natural_size);
+		GtkRequisition child_min_size = ad->min_req;
+		GtkRequisition child_natural_size = ad->natural_req;
 
 		if (panel->orient == GTK_ORIENTATION_HORIZONTAL) {
 			if (minimum_size->height < child_min_size.height &&
@@ -1366,6 +1406,11 @@ panel_widget_get_preferred_size(GtkWidget	     *widget,
 		if (natural_size->height < 12 && !dont_fill)
 			natural_size->height = 12;
 	}
+
+	panel->request_min = *minimum_size;
+	panel->request_natural = *natural_size;
+	panel->request_scale = scale;
+	panel->request_valid = TRUE;
 }
 
 static void
@@ -1401,6 +1446,157 @@ queue_resize_on_all_applets(PanelWidget *panel)
 	}
 }
 
+static void
+panel_widget_get_applet_requisition (AppletData     *ad,
+				     GtkRequisition *requisition)
+{
+	if (!ad->req_valid) {
+		gtk_widget_get_preferred_size (ad->applet,
+					       &ad->min_req,
+					       &ad->natural_req);
+		ad->req_valid = TRUE;
+	}
+
+	*requisition = ad->min_req;
+}
+
+static void
+panel_widget_allocate_applet (AppletData    *ad,
+			      GtkAllocation *challoc)
+{
+	gtk_widget_size_allocate (ad->applet, challoc);
+
+	ad->allocation    = *challoc;
+	ad->allocated_pos = ad->pos;
+	ad->alloc_valid   = TRUE;
+	ad->req_changed   = FALSE;
+}
+
+static void
+panel_widget_invalidate_layout (PanelWidget *panel)
+{
+	panel->layout_valid = FALSE;
+	panel->request_valid = FALSE;
+}
+
+/* Checks whether the previous layout can be reused, only placing again
+ * the applets that changed size. This is the case when the panel itself
+ * was not resized, and when no applet was added, moved, or changed its
+ * size along the panel in a way that would shift the other applets. */
+static gboolean
+panel_widget_can_relayout_incrementally (PanelWidget   *panel,
+					 GtkAllocation *allocation,
+					 gboolean       ltr)
+{
+	GList *list;
+
+	if (!panel->layout_valid ||
+	    panel->layout_ltr != (ltr != FALSE) ||
+	    panel->layout_packed != panel->packed ||
+	    panel->layout_horizontal != (panel->orient == GTK_ORIENTATION_HORIZONTAL) ||
+	    panel->layout_allocation.x != allocation->x ||
+	    panel->layout_allocation.y != allocation->y ||
+	    panel->layout_allocation.width != allocation->width ||
+	    panel->layout_allocation.height != allocation->height)
+		return FALSE;
+
+	/* packed panels redistribute the size hints on every request */
+	if (panel->packed)
+		return panel->nb_applets_size_hints == 0;
+
+	if (panel->currently_dragged_applet)
+		return FALSE;
+
+	for (list = panel->applet_list; list != NULL; list = g_list_next (list)) {
+		AppletData *ad = list->data;
+		GtkRequisition chreq;
+		int major;
+
+		if (!ad->alloc_valid || ad->allocated_pos != ad->pos)
+			return FALSE;
+
+		if (!ad->req_changed || (ad->expand_major && ad->size_hints))
+			continue;
+
+		panel_widget_get_applet_requisition (ad, &chreq);
+		major = panel->orient == GTK_ORIENTATION_HORIZONTAL ? chreq.width : chreq.height;
+		if (major != ad->min_cells)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+panel_widget_relayout_incrementally (PanelWidget   *panel,
+				     GtkAllocation *allocation,
+				     gboolean       ltr)
+{
+	GList *list;
+	int i;
+
+	i = 0;
+	for (list = panel->applet_list; list != NULL; list = g_list_next (list)) {
+		AppletData *ad = list->data;
+		GtkAllocation challoc;
+		GtkRequisition chreq;
+
+		panel_widget_get_applet_requisition (ad, &chreq);
+
+		if (panel->packed) {
+			/* same computation as the full layout, minus the
+			 * size hints that this path is never used with */
+			challoc.width = chreq.width;
+			challoc.height = chreq.height;
+			if (panel->orient == GTK_ORIENTATION_HORIZONTAL) {
+				if (ad->expand_minor)
+					challoc.height = allocation->height;
+				ad->cells = challoc.width;
+				challoc.x = ltr ? i : panel->size - i - challoc.width;
+				challoc.y = allocation->height / 2 - challoc.height / 2;
+			} else {
+				if (ad->expand_minor)
+					challoc.width = allocation->width;
+				ad->cells = challoc.height;
+				challoc.x = allocation->width / 2 - challoc.width / 2;
+				challoc.y = i;
+			}
+			ad->constrained = i;
+			ad->min_cells = ad->cells;
+			i += ad->cells;
+		} else {
+			/* only the minor size of the applet may have changed */
+			if (!ad->req_changed)
+				continue;
+
+			if (panel->orient == GTK_ORIENTATION_HORIZONTAL) {
+				challoc.width = ad->cells;
+				challoc.height = ad->expand_minor ? allocation->height : chreq.height;
+				challoc.x = ltr ? ad->constrained : panel->size - ad->constrained - challoc.width;
+				challoc.y = allocation->height / 2 - challoc.height / 2;
+			} else {
+				challoc.height = ad->cells;
+				challoc.width = ad->expand_minor ? allocation->width : chreq.width;
+				challoc.x = allocation->width / 2 - challoc.width / 2;
+				challoc.y = ad->constrained;
+			}
+
+			challoc.width = MAX (challoc.width, 1);
+			challoc.height = MAX (challoc.height, 1);
+		}
+
+		if (!ad->req_changed &&
+		    ad->alloc_valid &&
+		    ad->allocation.x == challoc.x &&
+		    ad->allocation.y == challoc.y &&
+		    ad->allocation.width == challoc.width &&
+		    ad->allocation.height == challoc.height)
+			continue;
+
+		panel_widget_allocate_applet (ad, &challoc);
+	}
+}
+
 static void
 panel_widget_size_allocate(GtkWidget *widget, GtkAllocation *allocation)
 {
@@ -1429,6 +1625,15 @@ panel_widget_size_allocate(GtkWidget *widget, GtkAllocation *allocation)
 	else
 		panel->size = allocation->height;
 
+	if (panel_widget_can_relayout_incrementally (panel, allocation, ltr)) {
+		panel_widget_relayout_incrementally (panel, allocation, ltr);
+		panel->n_incremental_relayouts++;
+		gtk_widget_queue_resize (widget);
+		return;
+	}
+
+	panel->n_full_relayouts++;
+
 	if (panel->packed) {
 		/* we're assuming the order is the same as the one that was
 		 * in size_request() */
@@ -1441,7 +1646,7 @@ panel_widget_size_allocate(GtkWidget *widget, GtkAllocation *allocation)
 			AppletData *ad = list->data;
 			GtkAllocation challoc;
 			GtkRequisition chreq;
-			gtk_widget_get_preferred_size (ad->applet, &chreq, NULL);
+			panel_widget_get_applet_requisition (ad, &chreq);
 
 			ad->constrained = i;
 
@@ -1475,7 +1680,7 @@ panel_widget_size_allocate(GtkWidget *widget, GtkAllocation *allocation)
 				challoc.y = ad->constrained;
 			}
 			ad->min_cells  = ad->cells;
-			gtk_widget_size_allocate(ad->applet,&challoc);
+			panel_widget_allocate_applet (ad, &challoc);
 			i += ad->cells;
 		}
 
@@ -1508,7 +1713,7 @@ panel_widget_size_allocate(GtkWidget *widget, GtkAllocation *allocation)
 			PanelObjectEdgeRelativity edge_relativity = PANEL_EDGE_START;
 			gboolean right_stuck = FALSE;
 
-			gtk_widget_get_preferred_size (ad->applet, &chreq, NULL);
+			panel_widget_get_applet_requisition (ad, &chreq);
 
 			if (!ad->expand_major || !ad->size_hints) {
 				if(panel->orient == GTK_ORIENTATION_HORIZONTAL)
@@ -1759,7 +1964,7 @@ panel_widget_size_allocate(GtkWidget *widget, GtkAllocation *allocation)
 			AppletData *ad = list->data;
 			GtkAllocation challoc;
 			GtkRequisition chreq;
-			gtk_widget_get_preferred_size (ad->applet, &chreq, NULL);
+			panel_widget_get_applet_requisition (ad, &chreq);
 
 			challoc.width = chreq.width;
 			challoc.height = chreq.height;
@@ -1782,10 +1987,16 @@ panel_widget_size_allocate(GtkWidget *widget, GtkAllocation *allocation)
 			challoc.width = MAX(challoc.width, 1);
 			challoc.height = MAX(challoc.height, 1);
 
-			gtk_widget_size_allocate(ad->applet,&challoc);
+			panel_widget_allocate_applet (ad, &challoc);
 		}
 	}
 
+	panel->layout_allocation = *allocation;
+	panel->layout_ltr = (ltr != FALSE);
+	panel->layout_packed = panel->packed;
+	panel->layout_horizontal = (panel->orient == GTK_ORIENTATION_HORIZONTAL);
+	panel->layout_valid = TRUE;
+
 	gtk_widget_queue_resize(widget);
 }
 
@@ -1910,6 +2121,11 @@ panel_widget_init (PanelWidget *panel)
 	panel->applets_hints = NULL;
 	panel->applets_using_hint = NULL;
 
+	panel->n_full_relayouts = 0;
+	panel->n_incremental_relayouts = 0;
+	panel->layout_valid = FALSE;
+	panel->request_valid = FALSE;
+
 	panels = g_slist_append (panels, panel);
 }
 
@@ -2630,6 +2846,7 @@ panel_widget_applet_destroy (GtkWidget *applet, gpointer data)
 			panel_widget_applet_drag_end (panel);
 
 		panel->applet_list = g_list_remove (panel->applet_list,ad);
+		panel_widget_invalidate_layout (panel);
 	}
 
 	g_free (ad->size_hints);
@@ -2783,6 +3000,10 @@ panel_widget_add (PanelWidget *panel,
 		ad->expand_minor = FALSE;
 		ad->locked = (locked != FALSE);
 		ad->size_hints = NULL;
+		ad->allocated_pos = pos;
+		ad->req_valid = FALSE;
+		ad->req_changed = FALSE;
+		ad->alloc_valid = FALSE;
 		g_object_set_data (G_OBJECT (applet),
 				   MATE_PANEL_APPLET_DATA, ad);
 
@@ -2794,6 +3015,9 @@ panel_widget_add (PanelWidget *panel,
 		g_list_insert_sorted(panel->applet_list,ad,
 				     (GCompareFunc)applet_data_compare);
 
+	ad->alloc_valid = FALSE;
+	panel_widget_invalidate_layout (panel);
+
 	/*this will get done right on size allocate!*/
 	if(panel->orient == GTK_ORIENTATION_HORIZONTAL)
 		gtk_fixed_put(GTK_FIXED(panel),applet,
@@ -2845,6 +3069,10 @@ panel_widget_reparent (PanelWidget *old_panel,
 	if (ad->pos == -1)
 		ad->pos = ad->constrained = 0;
 
+	ad->alloc_valid = FALSE;
+	panel_widget_invalidate_layout (new_panel);
+	panel_widget_invalidate_layout (old_panel);
+
 	gtk_widget_queue_resize (GTK_WIDGET (new_panel));
 	gtk_widget_queue_resize (GTK_WIDGET (old_panel));
 
@@ -2890,6 +3118,7 @@ panel_widget_set_packed (PanelWidget *panel_widget,
 {
 	panel_widget->packed = (packed != FALSE);
 
+	panel_widget_invalidate_layout (panel_widget);
 	gtk_widget_queue_resize (GTK_WIDGET (panel_widget));
 }
 
@@ -2899,6 +3128,7 @@ panel_widget_set_orientation (PanelWidget    *panel_widget,
 {
 	panel_widget->orient = orientation;
 
+	panel_widget_invalidate_layout (panel_widget);
 	gtk_widget_queue_resize (GTK_WIDGET (panel_widget));
 }
 
@@ -2913,6 +3143,7 @@ panel_widget_set_size (PanelWidget *panel_widget,
 
 	panel_widget->sz = size;
 
+	panel_widget_invalidate_layout (panel_widget);
 	queue_resize_on_all_applets (panel_widget);
 
 	g_signal_emit (panel_widget, panel_widget_signals [SIZE_CHANGE_SIGNAL], 0);
@@ -3113,6 +3344,7 @@ panel_widget_set_applet_size_constrained (PanelWidget *panel,
 
 	ad->size_constrained = (size_constrained != FALSE);
 
+	panel_widget_invalidate_layout (panel);
 	gtk_widget_queue_resize (GTK_WIDGET (panel));
 }
 
@@ -3137,6 +3369,7 @@ panel_widget_set_applet_expandable (PanelWidget *panel,
 	ad->expand_major = (major != FALSE);
 	ad->expand_minor = (minor != FALSE);
 
+	panel_widget_invalidate_layout (panel);
 	gtk_widget_queue_resize (GTK_WIDGET (panel));
 }
 
@@ -3162,6 +3395,7 @@ panel_widget_set_applet_size_hints (PanelWidget *panel,
 		ad->size_hints = NULL;
 	}
 
+	panel_widget_invalidate_layout (panel);
 	gtk_widget_queue_resize (GTK_WIDGET (panel));
 }
 
@@ -3228,3 +3462,16 @@ panel_widget_register_open_dialog (PanelWidget *panel,
 				 panel,
 				 G_CONNECT_SWAPPED);
 }
+
+void
+panel_widget_get_relayout_counts (PanelWidget *panel,
+				  guint       *n_full,
+				  guint       *n_incremental)
+{
+	g_return_if_fail (PANEL_IS_WIDGET (panel));
+
+	if (n_full)
+		*n_full = panel->n_full_relayouts;
+	if (n_incremental)
+		*n_incremental = panel->n_incremental_relayouts;
+}
@@ -76,10 +76,20 @@ struct _AppletData
 	int *           size_hints;
 	int             size_hints_len;
 
+	/* last requisition of the applet, and the allocation and position
+	 * it was last placed with, used to avoid full relayouts */
+	GtkRequisition  min_req;
+	GtkRequisition  natural_req;
+	GtkAllocation   allocation;
+	int             allocated_pos;
+
 	guint           size_constrained : 1;
 	guint           expand_major : 1;
 	guint           expand_minor : 1;
 	guint           locked : 1;
+	guint           req_valid : 1;
+	guint           req_changed : 1;
+	guint           alloc_valid : 1;
 
 };
 
@@ -116,7 +126,24 @@ struct _PanelWidget
 	AppletSizeHints      *applets_hints;
 	AppletSizeHintsAlloc *applets_using_hint;
 
+	/* allocation of the last layout, and how many layouts had to place
+	 * every applet versus only the applets whose size changed */
+	GtkAllocation   layout_allocation;
+	guint           n_full_relayouts;
+	guint           n_incremental_relayouts;
+
+	/* last request of the panel, valid as long as no applet changed
+	 * its requisition and the applets did not change */
+	GtkRequisition  request_min;
+	GtkRequisition  request_natural;
+	int             request_scale;
+
 	guint           packed : 1;
+	guint           layout_valid : 1;
+	guint           request_valid : 1;
+	guint           layout_ltr : 1;
+	guint           layout_packed : 1;
+	guint           layout_horizontal : 1;
 };
 
 struct _PanelWidgetClass
@@ -229,6 +256,10 @@ gboolean panel_widget_toggle_applet_locked        (PanelWidget *panel,
 
 void     panel_widget_register_open_dialog        (PanelWidget *panel,
 						   GtkWidget   *dialog);
+
+void     panel_widget_get_relayout_counts         (PanelWidget *panel,
+						   guint       *n_full,
+						   guint       *n_incremental);
 #ifdef __cplusplus
 }
 #endif
@@ -876,13 +876,13 @@ drop_internal_icon (PanelWidget *panel,
 static gboolean
 move_applet (PanelWidget *panel, int pos, int applet_index)
 {
-	GSList     *applet_list;
+	GList      *applet_list;
 	AppletInfo *info;
 	GtkWidget  *parent;
 
 	applet_list = mate_panel_applet_list_applets ();
 
-	info = g_slist_nth_data (applet_list, applet_index);
+	info = g_list_nth_data (applet_list, applet_index);
 
 	if ( ! mate_panel_applet_can_freely_move (info))
 		return FALSE;
@@ -995,11 +995,11 @@ drop_internal_applet (PanelWidget *panel, int pos, const char *applet_type,
 	if (remove_applet &&
 	    action == GDK_ACTION_MOVE) {
 		AppletInfo *info;
-		GSList     *applet_list;
+		GList      *applet_list;
 
 		applet_list = mate_panel_applet_list_applets ();
 
-		info = g_slist_nth_data (applet_list, applet_index);
+		info = g_list_nth_data (applet_list, applet_index);
 
 		if (info)
 			panel_profile_delete_object (info);
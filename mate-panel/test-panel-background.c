@@ -0,0 +1,166 @@
+/* Test for the rotation of panel background images
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "panel-background-transform.h"
+
+/* sizes around the tiles and the 4x4 blocks */
+static const struct {
+	int width;
+	int height;
+} sizes[] = {
+	{   1,   1 },
+	{   3,   5 },
+	{   4,   4 },
+	{   5,   3 },
+	{   7,  33 },
+	{  31,  32 },
+	{  32,  32 },
+	{  33,  31 },
+	{  65,  67 },
+	{ 130,   9 },
+	{  11, 129 }
+};
+
+/* extra bytes at the end of the rows of the source */
+static const int paddings[] = { 0, 4, 12 };
+
+/* The rotation as it was done before the tiled kernels: every pixel of
+ * the source row y goes to the column y of the destination */
+static void
+rotate_reference (guchar       *dest,
+		  int           destrowstride,
+		  const guchar *src,
+		  int           srcrowstride,
+		  int           n_channels,
+		  int           width,
+		  int           height)
+{
+	int x, y;
+
+	for (y = 0; y < height; y++)
+		for (x = 0; x < width; x++)
+			memcpy (dest + n_channels * y + destrowstride * (width - x - 1),
+				src + y * srcrowstride + n_channels * x,
+				n_channels);
+}
+
+static void
+pixels_free (guchar   *pixels,
+	     gpointer  data)
+{
+	g_free (pixels);
+}
+
+static void
+check_rotation (gboolean has_alpha,
+		int      width,
+		int      height,
+		int      padding)
+{
+	GdkPixbuf *image;
+	GdkPixbuf *rotated;
+	guchar    *src;
+	guchar    *expected;
+	int        n_channels;
+	int        srcrowstride;
+	int        destrowstride;
+	int        i;
+
+	n_channels = has_alpha ? 4 : 3;
+	srcrowstride = width * n_channels + padding;
+
+	src = g_malloc (srcrowstride * height);
+	for (i = 0; i < srcrowstride * height; i++)
+		src[i] = g_test_rand_int_range (0, 256);
+
+	image = gdk_pixbuf_new_from_data (src, GDK_COLORSPACE_RGB, has_alpha, 8,
+					  width, height, srcrowstride,
+					  pixels_free, NULL);
+
+	/* same size: only rotated */
+	rotated = panel_background_scale_and_rotate (image, width, height, TRUE);
+	g_assert_cmpint (gdk_pixbuf_get_width (rotated), ==, height);
+	g_assert_cmpint (gdk_pixbuf_get_height (rotated), ==, width);
+	g_assert_cmpint (gdk_pixbuf_get_has_alpha (rotated), ==, has_alpha);
+
+	destrowstride = gdk_pixbuf_get_rowstride (rotated);
+	expected = g_malloc0 (destrowstride * width);
+	rotate_reference (expected, destrowstride, src, srcrowstride,
+			  n_channels, width, height);
+
+	/* the padding of the destination rows is left as is */
+	for (i = 0; i < width; i++)
+		g_assert_cmpmem (gdk_pixbuf_get_pixels (rotated) + i * destrowstride,
+				 height * n_channels,
+				 expected + i * destrowstride,
+				 height * n_channels);
+
+	g_free (expected);
+	g_object_unref (rotated);
+	g_object_unref (image);
+}
+
+static void
+test_rotate (gconstpointer data)
+{
+	gboolean has_alpha = GPOINTER_TO_INT (data);
+	guint    i, j;
+
+	for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+		for (j = 0; j < G_N_ELEMENTS (paddings); j++)
+			check_rotation (has_alpha,
+					sizes[i].width, sizes[i].height,
+					paddings[j] + (has_alpha ? 0 : j));
+}
+
+static void
+test_scale (void)
+{
+	GdkPixbuf *image;
+	GdkPixbuf *result;
+
+	image = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 17, 5);
+
+	/* the image itself when there is nothing to do */
+	result = panel_background_scale_and_rotate (image, 17, 5, FALSE);
+	g_assert_true (result == image);
+	g_object_unref (result);
+
+	result = panel_background_scale_and_rotate (image, 34, 10, TRUE);
+	g_assert_cmpint (gdk_pixbuf_get_width (result), ==, 10);
+	g_assert_cmpint (gdk_pixbuf_get_height (result), ==, 34);
+	g_object_unref (result);
+
+	g_object_unref (image);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_data_func ("/panel-background/rotate/rgb",
+			      GINT_TO_POINTER (FALSE), test_rotate);
+	g_test_add_data_func ("/panel-background/rotate/rgba",
+			      GINT_TO_POINTER (TRUE), test_rotate);
+	g_test_add_func ("/panel-background/scale", test_scale);
+
+	return g_test_run ();
+}
@@ -0,0 +1,213 @@
+/* Test for the brightening of the icons of highlighted buttons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <cairo.h>
+#include "panel-colorshift.h"
+
+#define N_ROWS 3
+
+/* around the 4 pixel blocks of the SSE2 kernel */
+static const int widths[] = {
+	1, 2, 3, 4, 5, 6, 7, 8, 9, 15, 16, 17, 31, 33, 64, 65, 127
+};
+
+static const guint8 shifts[] = { 0, 30, 200, 255 };
+
+static cairo_surface_t *
+random_surface (cairo_format_t format,
+		int            width)
+{
+	cairo_surface_t *surface;
+	guchar          *data;
+	int              stride;
+	int              x, y;
+
+	surface = cairo_image_surface_create (format, width, N_ROWS);
+	g_assert_cmpint (cairo_surface_status (surface), ==, CAIRO_STATUS_SUCCESS);
+
+	cairo_surface_flush (surface);
+	data = cairo_image_surface_get_data (surface);
+	stride = cairo_image_surface_get_stride (surface);
+
+	for (y = 0; y < N_ROWS; y++) {
+		guint32 *row = (guint32 *) (data + y * stride);
+
+		for (x = 0; x < width; x++) {
+			guint32 a, r, g, b;
+
+			/* some fully transparent and opaque pixels, the
+			 * colors of the others premultiplied */
+			switch (g_test_rand_int_range (0, 4)) {
+			case 0:
+				a = 0;
+				break;
+			case 1:
+				a = 255;
+				break;
+			default:
+				a = g_test_rand_int_range (0, 256);
+				break;
+			}
+
+			if (format == CAIRO_FORMAT_RGB24) {
+				r = g_test_rand_int_range (0, 256);
+				g = g_test_rand_int_range (0, 256);
+				b = g_test_rand_int_range (0, 256);
+			} else {
+				r = g_test_rand_int_range (0, a + 1);
+				g = g_test_rand_int_range (0, a + 1);
+				b = g_test_rand_int_range (0, a + 1);
+			}
+
+			row[x] = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+	}
+
+	cairo_surface_mark_dirty (surface);
+
+	return surface;
+}
+
+/* What make_hc_surface() did before the fused kernels: a colorshift of
+ * the color channels clamped one at a time, then the icon painted with
+ * CAIRO_OPERATOR_DEST_IN as a mask. The colorshift walks 32-bit pixels;
+ * the old one walked 3 bytes per pixel for CAIRO_FORMAT_RGB24 icons,
+ * which was a bug. */
+static cairo_surface_t *
+colorshift_reference (cairo_surface_t *src,
+		      guint8           shift)
+{
+	cairo_surface_t *dest;
+	cairo_t         *cr;
+	guchar          *src_data;
+	guchar          *dest_data;
+	int              width;
+	int              x, y;
+
+	width = cairo_image_surface_get_width (src);
+	dest = cairo_image_surface_create (cairo_image_surface_get_format (src),
+					   width, N_ROWS);
+
+	cairo_surface_flush (dest);
+	src_data = cairo_image_surface_get_data (src);
+	dest_data = cairo_image_surface_get_data (dest);
+
+	for (y = 0; y < N_ROWS; y++) {
+		const guint32 *srcrow = (const guint32 *) (src_data + y * cairo_image_surface_get_stride (src));
+		guint32       *destrow = (guint32 *) (dest_data + y * cairo_image_surface_get_stride (dest));
+
+		for (x = 0; x < width; x++) {
+			int r, g, b;
+
+			r = ((srcrow[x] >> 16) & 0xff) + shift;
+			g = ((srcrow[x] >>  8) & 0xff) + shift;
+			b = ( srcrow[x]        & 0xff) + shift;
+
+			destrow[x] = (srcrow[x] & 0xff000000) |
+				     (CLAMP (r, 0, 255) << 16) |
+				     (CLAMP (g, 0, 255) <<  8) |
+				      CLAMP (b, 0, 255);
+		}
+	}
+
+	cairo_surface_mark_dirty (dest);
+
+	cr = cairo_create (dest);
+	cairo_set_operator (cr, CAIRO_OPERATOR_DEST_IN);
+	cairo_mask_surface (cr, src, 0, 0);
+	cairo_destroy (cr);
+
+	cairo_surface_flush (dest);
+
+	return dest;
+}
+
+static void
+check_colorshift (cairo_format_t format,
+		  int            width,
+		  guint8         shift)
+{
+	cairo_surface_t *src;
+	cairo_surface_t *reference;
+	gboolean         has_alpha;
+	guint32         *scalar;
+	guint32         *fused;
+	guint32          mask;
+	int              x, y;
+
+	has_alpha = format == CAIRO_FORMAT_ARGB32;
+	/* the unused byte of CAIRO_FORMAT_RGB24 pixels can be anything */
+	mask = has_alpha ? 0xffffffff : 0x00ffffff;
+
+	src = random_surface (format, width);
+	reference = colorshift_reference (src, shift);
+
+	/* one pixel more, to also run the kernels on unaligned rows */
+	scalar = g_new0 (guint32, width + 1);
+	fused = g_new0 (guint32, width + 1);
+
+	for (y = 0; y < N_ROWS; y++) {
+		const guint32 *srcrow = (const guint32 *) (cairo_image_surface_get_data (src) +
+							   y * cairo_image_surface_get_stride (src));
+		const guint32 *refrow = (const guint32 *) (cairo_image_surface_get_data (reference) +
+							   y * cairo_image_surface_get_stride (reference));
+
+		panel_colorshift_row_scalar (scalar, srcrow, width, shift, has_alpha);
+		panel_colorshift_row (fused, srcrow, width, shift, has_alpha);
+
+		for (x = 0; x < width; x++) {
+			g_assert_cmphex (fused[x], ==, scalar[x]);
+			g_assert_cmphex (scalar[x] & mask, ==, refrow[x] & mask);
+		}
+
+		panel_colorshift_row (fused + 1, srcrow, width, shift, has_alpha);
+
+		for (x = 0; x < width; x++)
+			g_assert_cmphex (fused[x + 1], ==, scalar[x]);
+	}
+
+	g_free (fused);
+	g_free (scalar);
+	cairo_surface_destroy (reference);
+	cairo_surface_destroy (src);
+}
+
+static void
+test_colorshift (gconstpointer data)
+{
+	cairo_format_t format = GPOINTER_TO_INT (data);
+	guint          i, j;
+
+	for (i = 0; i < G_N_ELEMENTS (widths); i++)
+		for (j = 0; j < G_N_ELEMENTS (shifts); j++)
+			check_colorshift (format, widths[i], shifts[j]);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_data_func ("/panel-colorshift/argb32",
+			      GINT_TO_POINTER (CAIRO_FORMAT_ARGB32), test_colorshift);
+	g_test_add_data_func ("/panel-colorshift/rgb24",
+			      GINT_TO_POINTER (CAIRO_FORMAT_RGB24), test_colorshift);
+
+	return g_test_run ();
+}